@@ -1,6 +1,11 @@
 #ifndef IX_H
 #define IX_H
 
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <vector>
 #include "../../RM/include/redbase.h"
 #include "../../RM/include/rm_rid.h"
 #include "../../PF/include/pf.h"
@@ -8,9 +13,72 @@
 // Forward declarations
 class IX_IndexHandle;
 class IX_IndexScan;
+class IX_BulkLoader;
 class PF_Manager;
 class PF_FileHandle;
 class PF_PageHandle;
+struct IX_KeyOps;
+struct IX_BulkLoadState;
+struct IX_LatchTable;
+struct IX_CachedNode;
+struct IX_HashTable;
+struct IX_MsgBuffer;
+struct IX_ScanMerge;
+struct IX_StatCounters;
+struct IX_BloomFilter;
+struct IX_FileHdr;
+
+#define IX_MAX_KEY_PARTS 4                             // 组合索引最多包含的属性数
+
+//
+// IX_KeyDesc: 索引键的组成
+// 组合索引的键由各属性值按顺序拼接而成，比较时逐个属性按各自的类型比较（字典序）。
+// 单属性索引只有一个部分。includeLength为叶子条目中RID之后附带的数据长度
+// （覆盖索引的INCLUDE列），不参与比较，也不出现在内部节点中
+//
+struct IX_KeyDesc {
+    int nParts;                                        // 属性个数
+    AttrType types[IX_MAX_KEY_PARTS];                  // 各属性的类型
+    int lengths[IX_MAX_KEY_PARTS];                     // 各属性的长度
+    int keyLength;                                     // 键的总长度
+    int includeLength;                                 // 叶子条目附带的数据长度（0表示没有）
+};
+
+//
+// IX_IndexType: 索引的存取方法
+// B+树支持范围扫描和有序输出；可扩展哈希索引只支持等值查找，点查找只读一个bucket页。
+// 带写缓冲的B+树把插入和删除先记入内存中按键值排序的消息缓冲区，攒够后按键值顺序
+// 一次写入叶子，适合以插入为主的表；查找和扫描把缓冲区中的消息与B+树中的条目合并
+//
+enum IX_IndexType {
+    IX_BTREE = 0,
+    IX_HASH = 1,
+    IX_BUFFERED = 2
+};
+
+//
+// IX_IndexStats: 索引的运行统计
+// 形状（高度、叶子页数、条目数）和各种操作的次数随插入、删除、查找和扫描增量维护，
+// 保存在索引文件头中，重新打开后继续累计。查询优化器用它估算索引扫描的代价
+//
+struct IX_IndexStats {
+    int height;                                        // B+树的层数（根为叶子时为1，空索引和哈希索引为0）
+    int nLeafPages;                                    // 叶子页数（哈希索引为bucket页数，包括溢出页）
+    long long nEntries;                                // 条目数（重复键的RID列表按RID个数计）
+    long long nSplits;                                 // 节点分裂次数（哈希索引为bucket分裂次数）
+    long long nMerges;                                 // 节点合并次数
+    long long nProbes;                                 // 从根下降到叶子（哈希索引为读一个bucket）的次数
+    long long nProbePages;                             // 下降时通过缓冲区读取的页数（不含常驻内存的上层节点）
+    long long nScanReturned;                           // 扫描返回的条目数
+    long long nScanFiltered;                           // 扫描读到但不满足条件而跳过的条目数
+    long long nFilterSkips;                            // Bloom过滤器判定键值不存在、不必下降的查找次数
+    double leafFill;                                   // 叶子的平均填充率，按条目数估算（GetStats时计算）
+};
+
+// 批量建立索引的默认参数
+#define IX_DEFAULT_FILL_FACTOR 0.9                     // 叶子和内部节点的填充比例
+#define IX_DEFAULT_SORT_MEMORY (16 * 1024 * 1024)      // 外部排序的内存预算（字节）
+#define IX_DEFAULT_MSG_BUFFER (4 * 1024 * 1024)        // 带写缓冲的B+树的消息缓冲区大小（字节）
 
 //
 // IX_Manager: 索引管理器类
@@ -25,33 +93,61 @@ public:
                    int indexNo,
                    AttrType attrType,
                    int attrLength);
+    RC CreateIndex(const char *fileName,               // 创建（组合）索引
+                   int indexNo,
+                   const IX_KeyDesc &keyDesc,
+                   IX_IndexType indexType = IX_BTREE,
+                   bool bBloomFilter = false);
     RC DestroyIndex(const char *fileName,              // 删除索引
                     int indexNo);
     RC OpenIndex(const char *fileName,                 // 打开索引
                  int indexNo,
                  IX_IndexHandle &indexHandle);
     RC CloseIndex(IX_IndexHandle &indexHandle);        // 关闭索引
+    void SetTopCacheBudget(int bytes);                 // 之后打开的索引常驻内存的上层节点最多占用的字节数
+    void SetMessageBufferSize(int bytes);              // 之后打开的带写缓冲的索引的消息缓冲区大小
 
 private:
     PF_Manager *pfManager;                             // PF管理器指针
+    int topCacheBudget;                                // 常驻内存的上层节点的内存预算
+    int msgBufferSize;                                 // 消息缓冲区的大小
 };
 
 //
 // IX_IndexHandle: 索引句柄类
 // 用于操作打开索引中的条目
+// InsertEntry、DeleteEntry和Lookup可以在多个线程中对同一个句柄并发调用：
+// Lookup不加锁（乐观读），只修改一个叶子的插入和删除只锁住该叶子，
+// 分裂与合并在持有根的锁时进行。扫描（IX_IndexScan）和批量建立不能与修改并发。
+// 哈希索引的操作持有文件头页的锁，同一句柄上的操作串行执行；
+// 带写缓冲的B+树的操作持有消息缓冲区的锁，同样串行执行。
+// 带Bloom过滤器的索引在查找和等值扫描下降之前先查过滤器，判定不存在的键值不读任何页面
 //
 class IX_IndexHandle {
 public:
     IX_IndexHandle();                                  // 构造函数
     ~IX_IndexHandle();                                 // 析构函数
     
-    RC InsertEntry(void *pData, const RID &rid);      // 插入索引条目
+    RC InsertEntry(void *pData, const RID &rid,       // 插入索引条目，payload为附带的数据
+                   const void *payload = NULL);
     RC DeleteEntry(void *pData, const RID &rid);      // 删除索引条目
-    RC ForcePages();                                   // 强制写入页面
+    RC Lookup(void *pData, std::vector<RID> &rids);   // 键值等于pData的所有RID
+    RC LookupBatch(void *const keys[], int nKeys,      // 批量查找，每个匹配调用一次callback
+                   const std::function<RC(int keyIndex, const RID &rid)> &callback);
+    RC Exists(void *pData, bool &bExists);             // 是否有键值等于pData的条目
+    RC ForcePages();                                   // 强制写入页面（先写入缓冲的消息）
+    RC FlushMessages();                                // 把消息缓冲区中的插入和删除写入B+树
+    RC GetStats(IX_IndexStats &stats) const;           // 索引的运行统计
+    const IX_KeyDesc &GetKeyDesc() const { return keyDesc; }  // 键的组成
+    IX_IndexType GetIndexType() const {                // 存取方法
+        return hashTable ? IX_HASH : msgBuffer ? IX_BUFFERED : IX_BTREE;
+    }
+    bool HasBloomFilter() const { return bloom != NULL; }  // 是否带Bloom过滤器
 
 private:
     friend class IX_Manager;
     friend class IX_IndexScan;
+    friend class IX_BulkLoader;
     
     // 基本信息
     bool isOpenHandle;                                 // 索引句柄是否打开
@@ -65,42 +161,181 @@ private:
         int numPages;                                 // 文件中的总页数
         PageNum firstFreePage;                        // 第一个空闲页号
     } indexHdr;
+    IX_KeyDesc keyDesc;                                // 键的组成（attrLength为各部分长度之和）
+    const IX_KeyOps *keyOps;                           // 按键类型选定的比较和查找函数
+    IX_LatchTable *latches;                            // 节点的乐观锁（打开时创建）
+    std::shared_ptr<const IX_CachedNode> topCache;     // 常驻内存的上层节点（根的副本）
+    int topCacheBudget;                                // 上层节点副本最多占用的字节数
+    IX_HashTable *hashTable;                           // 哈希索引的目录（B+树为NULL）
+    IX_MsgBuffer *msgBuffer;                           // 带写缓冲的B+树的消息缓冲区（其他为NULL）
+    IX_StatCounters *counters;                         // 运行统计（打开时从文件头读入）
+    IX_BloomFilter *bloom;                             // 键值的Bloom过滤器（没有时为NULL）
+    
+    // 直接修改B+树的插入和删除
+    RC InsertIntoTree(const void *pData, const RID &rid, const void *payload);
+    RC DeleteFromTree(void *pData, const RID &rid);
     
     // B+树操作的私有方法（声明）
-    RC InsertIntoNode(PageNum pageNum, void *pData, const RID &rid,
+    RC InsertIntoNode(PageNum pageNum, const char *entry,
                      bool &wasSplit, void *&newChildKey, PageNum &newChildPage);
-    RC InsertIntoLeaf(PageNum currentPageNum, char *nodeData, void *pData, const RID &rid,
+    RC InsertIntoLeaf(PageNum currentPageNum, char *nodeData, const char *entry, bool bCanSplit,
                      bool &wasSplit, void *&newChildKey, PageNum &newChildPage);
-    RC InsertEntryIntoLeaf(char *nodeData, void *pData, const RID &rid);
-    RC SplitLeafNode(PageNum currentPageNum, char *nodeData, void *pData, const RID &rid,
+    RC InsertEntryIntoLeaf(char *nodeData, const char *entry);
+    RC SplitLeafNode(PageNum currentPageNum, char *nodeData, const char *entries, int nEntries,
                     bool &wasSplit, void *&newChildKey, PageNum &newChildPage);
-    RC DeleteFromNode(PageNum pageNum, void *pData, const RID &rid);
+    RC DeleteFromNode(PageNum pageNum, void *pData, const RID &rid, bool &bUnderflow);
     RC DeleteFromLeaf(char *nodeData, void *pData, const RID &rid);
     RC FindChildPage(char *nodeData, void *pData, PageNum &childPage);
+    int SearchNode(const char *nodeData, const void *pData, bool bUpper) const;  // 节点内二分查找
+    PageNum GetChildPage(const char *nodeData, int childNo) const;              // 内部节点的第childNo个子节点
     RC CreateNewRoot(void *pData, PageNum leftPage, PageNum rightPage);
+    RC CreateEmptyRoot();
     RC WriteHeader();
     int CompareKeys(void *key1, void *key2);
     
     // 辅助方法
-    int GetMaxLeafEntries();
-    int GetMaxInternalEntries();
-    int GetLeafEntrySize();
-    int GetInternalEntrySize();
+    int GetMaxLeafEntries() const;                     // 不做前缀压缩时叶子的容量
+    int GetLeafEntrySize() const;                      // 完整的叶子条目大小
+    
+    // 节点的存储格式：前缀压缩的叶子和截断的分隔键（在ix_node.cc中实现）
+    bool TruncateKeys() const;
+    int CommonPrefix(const char *key1, const char *key2) const;
+    int SeparatorLength(const char *key) const;
+    void MakeSeparator(const char *leftKey, const char *rightKey, char *sep) const;
+    int LeafSpace(const char *firstKey, const char *lastKey, int nEntries) const;
+    bool LeafHasRoom(const char *nodeData, const char *key) const;
+    char *LeafEntry(char *nodeData, int slot) const;
+    char *LeafRidField(char *nodeData, int slot) const;
+    void GetLeafKey(const char *nodeData, int slot, char *key) const;
+    int CompareLeafKey(const void *key, const char *nodeData, int slot) const;
+    void ReadLeaf(const char *nodeData, std::vector<char> &entries) const;
+    bool WriteLeaf(char *nodeData, const char *entries, int nEntries) const;
+    int InternalSpace(int sepLength, int nKeys) const;
+    void ReadInternal(const char *nodeData, std::vector<char> &keys,
+                      std::vector<PageNum> &children) const;
+    bool WriteInternal(char *nodeData, const char *keys, const PageNum *children, int nKeys) const;
+    int CompareSeparator(const void *key, const char *nodeData, int sepNo) const;
+    int NodeSpace(const char *nodeData) const;
+    int ChooseLeafSplit(const char *entries, int nEntries) const;
+    int ChooseInternalSplit(const char *keys, int nKeys) const;
     
     // B+树内部操作方法（在ix_btree.cc中实现）
-    RC InsertIntoInternal(char *nodeData, void *pData, PageNum newPage,
+    RC InsertIntoInternal(char *nodeData, int insertPos, void *pData, PageNum newPage,
                          bool &wasSplit, void *&newChildKey, PageNum &newChildPage);
-    RC InsertEntryIntoInternal(char *nodeData, void *pData, PageNum newPage);
-    RC SplitInternalNode(char *nodeData, void *pData, PageNum newPage,
+    RC InsertEntryIntoInternal(char *nodeData, int insertPos, void *pData, PageNum newPage);
+    RC SplitInternalNode(char *nodeData, const char *keys, const PageNum *children, int nKeys,
                         bool &wasSplit, void *&newChildKey, PageNum &newChildPage);
+    RC RebalanceChild(char *nodeData, int childNo);
+    RC RebalanceLeaves(char *nodeData, int sepNo, PageNum leftPage, char *leftData, char *rightData,
+                       bool &bMerged);
+    RC RebalanceInternal(char *nodeData, int sepNo, char *leftData, char *rightData, bool &bMerged);
+    RC ShrinkRoot();
+    // 重复键的RID列表（在ix_posting.cc中实现）
+    bool UsePostings() const;
+    int GetPostingThreshold();
+    bool IsPostingRef(const char *ridField) const;
+    RC CreatePostingList(const std::vector<RID> &rids, PageNum &headPage);
+    RC ConvertToPosting(char *nodeData, int firstPos, int nDups, const RID &rid);
+    RC InsertIntoPosting(char *ridField, const RID &rid);
+    RC DeleteFromPosting(char *ridField, const RID &rid, bool &bEmpty);
+    RC ReadPostingPage(PageNum pageNum, std::vector<RID> &rids, PageNum &nextPage);
+    void DecodePostingPage(const char *pageData, std::vector<RID> &rids, PageNum &nextPage) const;
+    
+    // 并发控制：节点的乐观锁和只修改叶子的插入、删除（在ix_latch.cc中实现）
+    uint64_t ReadLatch(PageNum pageNum) const;
+    bool ValidateLatch(PageNum pageNum, uint64_t version) const;
+    bool UpgradeLatch(PageNum pageNum, uint64_t version);
+    void LockNode(PageNum pageNum);
+    void UnlockNode(PageNum pageNum, bool bModified);
+    RC AllocatePage(PF_PageHandle &pageHandle);
+    RC DisposePage(PageNum pageNum);
+    RC ReadNodeOptimistic(PageNum pageNum, uint64_t version, char *nodeCopy);
+    RC FindLeafOptimistic(const void *pData, bool bUpper, PageNum &leafPage, char *leafCopy,
+                          uint64_t &leafVersion);
+    RC LookupOptimistic(const void *pData, std::vector<RID> &rids);
+    RC CollectEqualOptimistic(const void *pData, PageNum &leafPage, char *leafData,
+                              uint64_t &version, std::vector<RID> &rids);
+    RC InsertIntoLeafOptimistic(const char *entry);
+    RC DeleteFromLeafOptimistic(void *pData, const RID &rid);
+    
+    // 批量查找（在ix_lookup.cc中实现）
+    bool LeafCovers(const char *leafData, const void *pData) const;
+    RC PositionForKey(const void *pData, PageNum &leafPage, char *leafData, char *spareData,
+                      uint64_t &version, bool &bPositioned);
+    
+    // 常驻内存的上层节点（在ix_topcache.cc中实现）
+    RC RefreshTopCache();
+    RC GetTreeHeight(int &height);
+    
+    // 可扩展哈希索引（在ix_hash.cc中实现）
+    uint64_t KeyHash64(const void *pData) const;
+    uint32_t HashKey(const void *pData) const;
+    int GetHashBucketCapacity() const;
+    RC LoadHashDirectory(PageNum dirPage);
+    RC WriteHashDirectory(int firstSlot, int lastSlot);
+    RC CreateHashDirectory();
+    RC AllocateHashPage(int localDepth, PageNum &pageNum);
+    RC HashInsert(const void *pData, const RID &rid);
+    RC HashDelete(const void *pData, const RID &rid);
+    RC HashLookup(const void *pData, std::vector<RID> &rids);
+    RC SplitHashBucket(int slot);
+    RC AppendToHashChain(PageNum pageNum, const char *entry);
+    RC ReadHashChain(PageNum pageNum, const void *pData, int &localDepth, std::vector<char> &entries,
+                     std::vector<PageNum> *overflowPages);
+    RC WriteHashChain(PageNum pageNum, int localDepth, const char *entries, int nEntries,
+                      std::vector<PageNum> &sparePages);
+    
+    // 带写缓冲的B+树（在ix_buffer.cc中实现）
+    RC BufferMessage(int op, const void *pData, const RID &rid, const void *payload);
+    RC ApplyMessages();
+    void MergeMessages(const void *pData, std::vector<RID> &rids) const;
+    bool HasMessage(const char *key, const RID &rid) const;
+    
+    // 运行统计（在ix_stats.cc中实现）
+    RC RecountStats();
+    void SaveStats(IX_FileHdr *fileHdr) const;
+    
+    // Bloom过滤器（在ix_bloom.cc中实现）
+    bool BloomMayContain(const void *pData) const;
+    RC OpenBloomFilter(const IX_FileHdr &fileHdr);
+    RC ResetBloomFilter(long long nKeys);
+    RC RebuildBloomFilter();
+    RC CheckBloomFilter();
+    RC AddToBloomFilter(const void *pData);
+    RC MarkBloomUnclean();
+    RC WriteBloomFilter();
+    void SaveBloomHeader(IX_FileHdr *fileHdr) const;
+    
     RC TraverseTree(PageNum pageNum, int level);
     RC ValidateTree(PageNum pageNum, void *minKey, void *maxKey, int &height);
     RC PrintTree();
 };
 
+//
+// IX_ScanBatch: 索引扫描一次返回的一批(键值, RID, 附带数据)
+//
+struct IX_ScanBatch {
+    std::vector<char> keys;                            // nEntries个键值，每个keyLength字节
+    std::vector<RID> rids;
+    std::vector<char> payloads;                        // nEntries份附带数据，每份payloadLength字节
+    int keyLength;
+    int payloadLength;
+    int nEntries;
+    
+    IX_ScanBatch() : keyLength(0), payloadLength(0), nEntries(0) {}
+    const char *GetKey(int i) const { return &keys[(size_t)i * keyLength]; }
+    const char *GetPayload(int i) const { return &payloads[(size_t)i * payloadLength]; }
+};
+
 //
 // IX_IndexScan: 索引扫描类  
-// 提供对索引的条件扫描功能
+// 提供对索引的条件扫描和范围扫描功能。扫描从下界所在的叶子开始，
+// 遇到第一个超过上界的键即结束；反向扫描（bReverse）从上界所在的叶子开始沿左链接读取，
+// 键值从大到小，遇到第一个低于下界的键即结束。
+// 哈希索引只能扫描全部条目（NO_OP、NE_OP，不按键值排序）或上下界相同且都包含的等值范围，
+// 每次取出一个bucket（连同溢出页）中满足条件的条目，不能反向扫描。
+// 带写缓冲的B+树在扫描开始时复制范围内待插入的条目，与叶子中的条目按键值归并，
+// 有待写入消息的叶子条目以消息为准
 //
 class IX_IndexScan {
 public:
@@ -110,37 +345,105 @@ public:
     RC OpenScan(const IX_IndexHandle &indexHandle,     // 开始扫描
                 CompOp compOp,
                 void *value,
-                ClientHint pinHint = NO_HINT);
+                ClientHint pinHint = NO_HINT,
+                bool bReverse = false);
+    RC OpenRangeScan(const IX_IndexHandle &indexHandle,  // 开始范围扫描，NULL表示该侧无界
+                     void *lowKey, bool lowInclusive,
+                     void *highKey, bool highInclusive,
+                     ClientHint pinHint = NO_HINT,
+                     bool bReverse = false);
     RC GetNextEntry(RID &rid);                         // 获取下一条条目
+    RC GetNextBatch(IX_ScanBatch &batch);              // 获取当前叶子中剩余的满足条件的条目
     RC CloseScan();                                    // 结束扫描
 
 private:
     // 基本状态
     bool isOpenScan;                                   // 扫描是否打开
     bool scanEnded;                                    // 扫描是否结束
-    bool hasValue;                                     // 是否有比较值
     bool pinned;                                       // 当前页面是否被pin
     
     // 扫描参数
     IX_IndexHandle *indexHandle;                       // 索引句柄指针
-    CompOp compOp;                                     // 比较操作
-    void *value;                                       // 比较值
+    CompOp compOp;                                     // 比较操作（NE_OP时逐条排除相等的键）
+    char *value;                                       // 比较值
+    char *lowKey;                                      // 下界（NULL表示无下界）
+    char *highKey;                                     // 上界（NULL表示无上界）
+    bool lowInclusive;
+    bool highInclusive;
+    bool bReverse;                                     // 键值从大到小扫描
     
     // 当前位置
     PageNum currentPageNum;                            // 当前页面号
     int currentSlot;                                   // 当前槽位
     PF_PageHandle *pfPageHandle;                       // 当前页面句柄
+    char *curKey;                                      // 当前条目的完整键值（叶子中只存了后缀）
+    
+    // 当前重复键条目的RID列表，每次解码一个bucket页
+    std::vector<RID> postingRids;
+    size_t postingPos;
+    PageNum postingNext;                               // 下一个bucket页
+    
+    // 哈希索引：当前bucket中满足条件的(键值, RID)条目
+    std::vector<char> hashEntries;
+    size_t hashPos;
+    int hashSlot;                                      // 下一个要读的目录项
+    
+    // 带写缓冲的B+树：与消息缓冲区归并的状态（没有待写入的消息时为NULL）
+    IX_ScanMerge *merge;
+    
+    // 运行统计：返回的和不满足条件而跳过的条目数，关闭扫描时计入索引的统计
+    long long nReturned;
+    long long nFiltered;
     
     // 扫描相关的私有方法
+    RC OpenRange(const IX_IndexHandle &indexHandle,
+                 const void *low, bool lowIncl, const void *high, bool highIncl, bool bReverse);
+    char *CopyKey(const void *key) const;
     RC FindFirstLeafPage();
     RC FindStartPosition();
+    RC FindEndPosition();
     RC SearchKey(void *searchKey, PageNum &leafPage, int &slotNum);
     RC FindKeyInLeaf(char *nodeData, void *searchKey, int &slotNum);
     RC GetNextEntryInPage(RID &rid);
     RC MoveToNextPage();
-    bool SatisfiesCondition(const RID &rid);
-    RC FindChildPageForKey(char *nodeData, void *searchKey, PageNum &childPage);
-    RC FindInsertPosition(void *searchKey, PageNum &leafPage, int &slotNum);
+    RC NextMatch(RID &rid, char *&key, bool &bLastInPage);
+    RC NextHashMatch(RID &rid, char *&key, bool &bLastInPage);
+    RC NextMergedMatch(RID &rid, char *&key, bool &bLastInPage, const char *&payload);
+    void CollectMessages();
+    int CheckBounds(char *key);
+};
+
+//
+// IX_BulkLoader: 自底向上批量建立B+树
+// 条目可以按任意顺序加入，超过内存预算时把排好序的一批写入临时文件（归并段）。
+// Finish时多路归并，按填充比例从左到右写满叶子节点，再逐层建立内部节点。
+// 只能用于空索引
+//
+class IX_BulkLoader {
+public:
+    IX_BulkLoader();                                   // 构造函数
+    ~IX_BulkLoader();                                  // 析构函数
+    
+    RC Open(IX_IndexHandle &indexHandle,               // 开始批量建立
+            double fillFactor = IX_DEFAULT_FILL_FACTOR,
+            size_t memoryBudget = IX_DEFAULT_SORT_MEMORY);
+    RC AddEntry(void *pData, const RID &rid,           // 加入一个条目，payload为附带的数据
+                const void *payload = NULL);
+    RC Finish();                                       // 排序并建立B+树
+    RC Abort();                                        // 放弃，释放临时文件
+
+private:
+    IX_BulkLoadState *state;
+    
+    RC SortAndSpill();                                 // 排序内存中的条目并写成一个归并段
+    RC MergeRuns(size_t first, size_t count, FILE *out);  // 归并若干个归并段，out为NULL时直接建树
+    RC AppendSorted(const char *entry);                // 加入下一个（有序的）条目，重复的键先攒起来
+    RC FlushDuplicates();                              // 写出攒下的重复键，足够多时合并为RID列表
+    RC AppendEntry(const char *entry);                 // 把下一个条目加入当前叶子
+    RC FlushLeaf();                                    // 写出当前叶子并链接到叶子层
+    RC AllocateNode(bool isLeaf, PageNum &pageNum, char *&nodeData);
+    RC AddChild(int level, const char *key, PageNum childPage);  // 向第level层追加一个子节点
+    RC FinishTree();
 };
 
 //
@@ -151,7 +454,8 @@ void IX_PrintError(RC rc);
 // IX组件返回码
 #define IX_ENTRYNOTFOUND       (START_IX_WARN + 1)   // 条目未找到
 #define IX_EOF                 (START_IX_WARN + 2)   // 扫描结束
-#define IX_LASTWARN            IX_EOF
+#define IX_RESTART             (START_IX_WARN + 3)   // 乐观操作与并发的修改冲突，需要重新开始
+#define IX_LASTWARN            IX_RESTART
 
 #define IX_INDEXNOTOPEN        (START_IX_ERR - 1)    // 索引未打开
 #define IX_SCANNOTOPEN         (START_IX_ERR - 2)    // 扫描未打开
@@ -159,7 +463,11 @@ void IX_PrintError(RC rc);
 #define IX_BUCKETFULL          (START_IX_ERR - 4)    // Bucket页已满
 #define IX_NULLPOINTER         (START_IX_ERR - 5)    // 空指针参数
 #define IX_INVALIDTREE         (START_IX_ERR - 6)    // B+树结构无效
-#define IX_LASTERROR           IX_INVALIDTREE
+#define IX_BADINDEXSPEC        (START_IX_ERR - 7)    // 无效索引规格
+#define IX_INDEXNOTEMPTY       (START_IX_ERR - 8)    // 批量建立要求索引为空
+#define IX_SORTFILEERROR       (START_IX_ERR - 9)    // 外部排序临时文件读写失败
+#define IX_HASHSCAN            (START_IX_ERR - 10)   // 哈希索引不支持范围扫描
+#define IX_LASTERROR           IX_HASHSCAN
 
 // IX组件返回码范围定义（添加到redbase.h中）
 #define START_IX_WARN          200
@@ -1,6 +1,11 @@
 #ifndef IX_INTERNAL_H
 #define IX_INTERNAL_H
 
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
 #include "../include/ix.h"
 #include "../../PF/include/pf.h"
 #include "../../PF/include/pf_manager.h"
@@ -29,18 +34,60 @@
 // B+树相关常量
 #define IX_MIN_DEGREE          2                        // 最小度数
 #define IX_MAX_KEYS(keySize)   ((PF_PAGE_SIZE - IX_NODE_HDR_SIZE) / (keySize + sizeof(PageNum))) - 1
-#define IX_MAX_RIDS_PER_BUCKET ((PF_PAGE_SIZE - sizeof(int)) / sizeof(RID))
+#define IX_BUCKET_DATA_SIZE    (PF_PAGE_SIZE - sizeof(IX_BucketHdr))  // bucket页中压缩RID的空间
+
+// 叶子节点至少要能放下的条目数（限制附带数据的长度）
+#define IX_MIN_LEAF_ENTRIES    4
+
+// 批量建立时一趟最多同时归并的归并段数
+#define IX_MAX_MERGE_FANIN     64
 
 //
 // 索引文件头结构
 // 存储在文件的第一页（页号0）
 //
 struct IX_FileHdr {
-    AttrType attrType;              // 属性类型
-    int attrLength;                 // 属性长度  
+    AttrType attrType;              // 属性类型（组合索引为第一个属性的类型）
+    int attrLength;                 // 属性长度（组合索引为键的总长度）
     PageNum rootPage;               // 根节点页号
     int numPages;                   // 文件中的总页数
     PageNum firstFreePage;          // 第一个空闲页号
+    int nKeyParts;                  // 键包含的属性数
+    AttrType partTypes[IX_MAX_KEY_PARTS];  // 各属性的类型
+    int partLengths[IX_MAX_KEY_PARTS];     // 各属性的长度
+    int includeLength;              // 叶子条目中RID之后附带的数据长度
+    int indexType;                  // IX_BTREE、IX_HASH或IX_BUFFERED
+    int globalDepth;                // 哈希索引：目录的全局深度
+    PageNum dirPage;                // 哈希索引：第一个目录页（IX_NO_PAGE表示索引为空）
+    int statsValid;                 // stats是否有效（旧索引文件为0，打开时重新统计）
+    IX_IndexStats stats;            // 运行统计
+    int bloomFilter;                // 是否带Bloom过滤器（旧索引文件为0）
+    PageNum bloomPage;              // 过滤器位图的第一页（IX_NO_PAGE表示还没有写出）
+    int bloomBlocks;                // 位图的块数
+    long long bloomCapacity;        // 位图按多少个键确定的大小
+    long long bloomStale;           // 建立位图之后删除的条目数
+    int bloomClean;                 // 位图包含全部键值；打开后第一次修改前置0，正常关闭时置1
+};
+
+//
+// 索引的运行统计（ix_stats.cc）
+// 打开索引时从文件头读入，结构修改和关闭索引时写回文件头。
+// 只修改叶子的插入、删除和不加锁的查找可以并发更新，计数器都是原子变量
+//
+struct IX_StatCounters {
+    std::atomic<int> height;
+    std::atomic<int> nLeafPages;
+    std::atomic<long long> nEntries;
+    std::atomic<long long> nSplits;
+    std::atomic<long long> nMerges;
+    std::atomic<long long> nProbes;
+    std::atomic<long long> nProbePages;
+    std::atomic<long long> nScanReturned;
+    std::atomic<long long> nScanFiltered;
+    std::atomic<long long> nFilterSkips;
+
+    void Load(const IX_IndexStats &stats);
+    void Save(IX_IndexStats &stats) const;
 };
 
 //
@@ -53,18 +100,224 @@ struct IX_NodeHdr {
     PageNum parent;                 // 父节点页号
     PageNum left;                   // 左兄弟节点页号
     PageNum right;                  // 右兄弟节点页号
-    // 键值和指针数据紧跟在节点头后面
+    int prefixLength;               // 叶子：各键共同的前缀长度（前缀紧跟在节点头后面，只存一份）
+    int sepLength;                  // 内部节点：每个分隔键保存的字节数
+    // 键值和指针数据紧跟在节点头（和前缀）后面
+};
+
+//
+// 节点的存储格式（ix_node.cc）
+// 单属性字符串索引的叶子节点把所有键共同的前缀提出来只存一份，条目中只保存键的其余部分；
+// 内部节点的分隔键截断为区分左右子树所需的最短前缀，同一节点内按其中最长的分隔键定长存放，
+// 截掉的部分视为'\0'。其他索引的prefixLength总是0，sepLength总是键长
+//
+#define IX_NODE_SPACE          ((int)(PF_PAGE_SIZE - sizeof(IX_NodeHdr)))  // 节点头之后可用的空间
+#define IX_MIN_NODE_SPACE      (IX_NODE_SPACE / 3)      // 删除后已用空间少于此值的节点与兄弟节点合并或重新分配
+
+//
+// 节点的乐观锁（ix_latch.cc）
+// 每个页面对应一个64位的版本号，最低位为1表示有写者持有，写者修改后释放时版本号加2。
+// 读者不加锁：读之前记下版本号，读完后验证版本号没有变化，否则从根重新开始。
+// 下降时先读出子节点的版本号再验证父节点的版本号（乐观锁耦合），保证子节点的页号仍然有效。
+// 文件头页（页0）的版本号保护indexHdr.rootPage，分裂、合并等结构修改期间一直持有它。
+// 版本号只存在于内存中，不写入页面
+//
+#define IX_HEADER_PAGE         0                        // 文件头页，其版本号保护根页号
+#define IX_LATCH_CHUNK         4096                     // 每次分配的版本号个数
+#define IX_LATCH_MAX_CHUNKS    4096                     // 最多支持IX_LATCH_CHUNK * IX_LATCH_MAX_CHUNKS个页面
+#define IX_LATCH_SPINS         64                       // 等待写者时让出CPU之前的自旋次数
+
+struct IX_LatchTable {
+    std::atomic<std::atomic<uint64_t> *> chunks[IX_LATCH_MAX_CHUNKS];  // 按需分配的版本号数组
+    std::mutex fileLatch;           // 保护页面的分配和释放（PF文件头）
+
+    IX_LatchTable();
+    ~IX_LatchTable();
+    std::atomic<uint64_t> *Latch(PageNum pageNum);      // 页面的版本号，页号超出范围时返回NULL
+};
+
+//
+// 常驻内存的上层节点（ix_topcache.cc）
+// 打开索引时从根开始按层复制内部节点的已用部分，直到用完内存预算；叶子总是通过缓冲区读。
+// 子节点也在内存中时换成指向它的副本的指针（pointer swizzling），下降时不经过缓冲区管理器。
+// 每个副本记下复制时页面的版本号，读者与页面当前的版本号比较，不一致时说明节点已被修改，
+// 改为通过缓冲区下降。副本建立后不再修改，分裂、合并等结构修改结束时换上新的一组副本，
+// 没有修改过的节点直接沿用，正在使用旧副本的读者由shared_ptr保证其仍然有效
+//
+#define IX_TOP_CACHE_BUDGET    (256 * 1024)             // 每个打开的索引默认最多占用的字节数
+
+struct IX_CachedNode {
+    PageNum pageNum;                // 节点的页号
+    uint64_t version;               // 复制时页面的版本号
+    std::vector<char> data;         // 节点头和已用的条目，可以直接用SearchNode和GetChildPage
+    std::vector<std::shared_ptr<const IX_CachedNode> > children;  // 子节点的副本，不在内存中时为空
+};
+
+//
+// 可扩展哈希索引（ix_hash.cc）
+// 目录有2^globalDepth项，键的哈希值的低globalDepth位选出一项，指向一个bucket页。
+// 每个bucket有自己的localDepth，有2^(globalDepth-localDepth)个目录项指向它。
+// bucket满时分裂为两个localDepth加一的bucket，localDepth已经等于globalDepth时先把目录加倍
+// （后一半复制前一半，只需写出新增的目录页）。bucket中的键哈希值全部相同（大量重复键）
+// 或深度达到IX_HASH_MAX_DEPTH时不再分裂，在后面链接溢出页。
+// 目录打开索引时读入内存，点查找只读一个bucket页（有溢出页时再读溢出页）。
+// 删除只释放变空的溢出页，bucket不合并，目录不收缩
+//
+#define IX_HASH_MAX_DEPTH      20                       // 目录最多2^20项
+#define IX_HASH_DIR_SLOTS      ((int)((PF_PAGE_SIZE - sizeof(PageNum)) / sizeof(PageNum)))  // 每个目录页的目录项数
+
+struct IX_HashBucketHdr {
+    int localDepth;                 // 局部深度（溢出页与所在链的主bucket相同）
+    int numEntries;                 // 本页的条目数
+    PageNum overflow;               // 下一个溢出页
+    // (键值, RID)条目紧跟在后面
+};
+
+// 目录页的开头是下一个目录页的页号，其后是IX_HASH_DIR_SLOTS个目录项
+struct IX_HashTable {
+    int globalDepth;
+    std::vector<PageNum> directory; // 2^globalDepth个bucket页号，索引为空时没有目录
+    std::vector<PageNum> dirPages;  // 按顺序存放目录的页面
 };
 
 //
 // Bucket页头结构（用于存储相同键值的多个RID）
+// 同一个键的RID按顺序存放在bucket链表中，每个RID记为与前一个RID的差值（varint编码）：
+// 与前一个RID在同一页面时只记槽号之差，否则记页号之差和槽号
 //
 struct IX_BucketHdr {
     int numRIDs;                    // 当前RID数量
     PageNum nextBucket;             // 下一个bucket页号（链表）
+    int numBytes;                   // 压缩后的RID数据长度
+    PageNum lastPage;               // 最后一个RID（追加时不必解码）
+    SlotNum lastSlot;
     // RID数据紧跟在bucket头后面
 };
 
+//
+// 重复键的RID列表：一个叶子中同一键值的条目达到GetPostingThreshold()个时，
+// 合并为一个条目，条目中RID的位置存放IX_PostingRef（marker为IX_POSTING_MARKER，
+// 正常RID的槽号不会是负数），RID本身存放在以headPage开始的bucket链表中。
+// 带附带数据的索引（INCLUDE列）不合并
+//
+struct IX_PostingRef {
+    PageNum headPage;               // 第一个bucket页
+    SlotNum marker;                 // IX_POSTING_MARKER
+    int numRIDs;                    // 列表中的RID总数
+};
+
+#define IX_POSTING_MARKER      -1
+#define IX_POSTING_MIN_RIDS    4                        // 合并所需的最少重复条目数
+#define IX_POSTING_MIN_BYTES   (PF_PAGE_SIZE / 4)       // 重复条目至少占用这么多叶子空间才合并
+
+//
+// 键操作：按键类型特化的比较和节点内二分查找（ix_keyops.cc）
+// keys指向第0个键，相邻键之间相隔stride字节
+//
+struct IX_KeyOps {
+    int (*compare)(const void *key1, const void *key2, const IX_KeyDesc *desc);  // <0, 0, >0
+    int (*lowerBound)(const char *keys, int nKeys, int stride,
+                      const void *key, const IX_KeyDesc *desc);             // 第一个不小于key的位置
+    int (*upperBound)(const char *keys, int nKeys, int stride,
+                      const void *key, const IX_KeyDesc *desc);             // 第一个大于key的位置
+};
+
+const IX_KeyOps *IX_GetKeyOps(const IX_KeyDesc &desc);
+const IX_KeyOps *IX_GetStringKeyOps();                 // 按运行时长度比较的字符串键
+int IX_CompareSeparator(const void *key, const char *sep, int sepLength, int keyLength);
+int IX_SearchSeparators(const char *seps, int nKeys, int stride, int sepLength,
+                        const void *key, int keyLength, bool bUpper);
+bool IX_ValidKeyDesc(const IX_KeyDesc &desc);          // 检查各属性的类型和长度以及叶子条目的大小
+
+//
+// 带写缓冲的B+树（ix_buffer.cc）
+// 插入和删除不直接修改B+树，而是作为消息记入按(键值, RID)排序的缓冲区，
+// 同一条目的消息合并为一条（插入后删除相互抵消）。缓冲区满、ForcePages和关闭索引时
+// 按键值顺序把消息写入B+树，相邻的消息多半落在同一个叶子中，每个叶子只需读写一次。
+// 上层节点常驻内存，写入的代价主要在叶子，因此只在树顶设一个缓冲区。
+// 消息只在内存中，与缓冲池中尚未写出的页面一样在关闭索引时写入文件
+//
+#define IX_MSG_INSERT          1                        // 插入条目
+#define IX_MSG_DELETE          2                        // 删除条目（两者都有时先删除再插入）
+#define IX_MSG_OVERHEAD        64                       // 每条消息在缓冲区中额外占用的字节数（估计）
+
+// 缓冲区中的键为键值后接RID
+struct IX_MsgLess {
+    const IX_KeyOps *keyOps;
+    const IX_KeyDesc *keyDesc;
+    bool operator()(const std::string &a, const std::string &b) const {
+        int cmp = keyOps->compare(a.data(), b.data(), keyDesc);
+        if (cmp != 0) {
+            return cmp < 0;
+        }
+        RID ridA, ridB;
+        memcpy((char *)&ridA, a.data() + keyDesc->keyLength, sizeof(RID));
+        memcpy((char *)&ridB, b.data() + keyDesc->keyLength, sizeof(RID));
+        return ridA < ridB;
+    }
+};
+
+struct IX_Message {
+    int op;                         // IX_MSG_INSERT和IX_MSG_DELETE的组合
+    std::string payload;            // 插入条目的附带数据
+};
+
+struct IX_MsgBuffer {
+    std::mutex latch;               // 缓冲区上的操作串行执行
+    std::map<std::string, IX_Message, IX_MsgLess> messages;
+    size_t bytes;                   // 消息占用的字节数（估计）
+    size_t capacity;                // 达到这么多字节时写入B+树
+    
+    IX_MsgBuffer(const IX_MsgLess &less, size_t capacity)
+        : messages(less), bytes(0), capacity(capacity) {}
+};
+
+//
+// 键值的Bloom过滤器（ix_bloom.cc）
+// 分块的Bloom过滤器：位图分成512位（一个cache line）的块，键的哈希值的高32位选出一块，
+// 再在块内置IX_BLOOM_HASHES位，查一个键只访问一个cache line。
+// 建立时按IX_BLOOM_BITS_PER_KEY位/键、为当时条目数的两倍留出空间。删除不清除位，
+// 过滤器只会把不存在的键判为可能存在，不会漏掉存在的键。打开索引时，
+// 条目数超过容量、删除的条目数超过容量的一半或位图没有正常写回（bloomClean为0）时按现有的条目重新建立。
+// 位图关闭时写入从bloomPage开始的页链，每页开头是下一页的页号，其后是IX_BLOOM_PAGE_BLOCKS块
+//
+#define IX_BLOOM_BITS_PER_KEY  10                       // 每个键占用的位数（按容量计）
+#define IX_BLOOM_HASHES        6                        // 每个键在块内置的位数
+#define IX_BLOOM_MIN_KEYS      1024                     // 最小的容量
+#define IX_BLOOM_BLOCK_WORDS   8                        // 每块的64位字数
+#define IX_BLOOM_BLOCK_BITS    (IX_BLOOM_BLOCK_WORDS * 64)
+#define IX_BLOOM_PAGE_BLOCKS   ((int)((PF_PAGE_SIZE - sizeof(PageNum)) / (IX_BLOOM_BLOCK_WORDS * sizeof(uint64_t))))
+
+struct IX_BloomFilter {
+    int nBlocks;
+    long long capacity;             // 位图按多少个键确定的大小
+    std::atomic<long long> nStale;  // 建立位图之后删除的条目数
+    std::atomic<uint64_t> *words;   // nBlocks * IX_BLOOM_BLOCK_WORDS个字，按64字节对齐
+    std::atomic<uint64_t> *storage;
+    std::vector<PageNum> pages;     // 存放位图的页面，按顺序
+    std::atomic<bool> bDirty;       // 位图打开后修改过，关闭时写回
+    std::atomic<bool> bMarked;      // 文件头中的bloomClean已经置0
+    std::mutex latch;               // 保护第一次修改时写文件头
+
+    IX_BloomFilter(long long capacity);
+    ~IX_BloomFilter();
+    void Add(uint64_t hash);
+    bool MayContain(uint64_t hash) const;
+};
+
+// 扫描与消息缓冲区的归并（ix_indexscan.cc）
+struct IX_ScanMerge {
+    bool bCollected;                // 是否已复制范围内待插入的条目（第一次取条目时复制）
+    std::vector<char> inserts;      // 待插入的(键值, RID, 附带数据)，按键值排序
+    size_t insertPos;
+    bool bTreeAhead;                // 是否有已从叶子取出、尚未返回的条目
+    bool bTreeDone;                 // 叶子中的条目是否已取完
+    RID treeRid;
+    bool bTreeLast;                 // 该条目是否为当前叶子中的最后一个
+    std::vector<char> treeKey;
+    std::vector<char> treePayload;
+};
+
 //
 // 错误处理函数声明
 //
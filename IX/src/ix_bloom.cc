@@ -0,0 +1,356 @@
+//
+// ix_bloom.cc: 索引键值的Bloom过滤器
+//
+// 查找不存在的键值（插入前检查重复、反连接）时，B+树仍要从根下降到叶子并在叶子中查找，
+// 哈希索引仍要读一个bucket页。带Bloom过滤器的索引在下降之前先查过滤器，
+// 判定不存在的键值不读任何页面。插入先把键值加入过滤器再修改索引，
+// 并发的查找不会因为过滤器而漏掉已经插入的条目。过滤器的组织见ix_internal.h
+//
+
+#include <algorithm>
+#include <cstring>
+#include "ix_internal.h"
+
+using namespace std;
+
+//
+// BloomBlocks: 容量为capacity个键的位图的块数
+//
+static int BloomBlocks(long long capacity) {
+    long long bits = capacity * IX_BLOOM_BITS_PER_KEY;
+    return (int)((bits + IX_BLOOM_BLOCK_BITS - 1) / IX_BLOOM_BLOCK_BITS);
+}
+
+//
+// BloomBit: 键的第i位在块内的位置
+// 哈希值乘以一个奇数常数后从高位开始每9位（块内的位号）取一段
+//
+static inline int BloomBit(uint64_t hash, int i) {
+    uint64_t bits = hash * 0x9e3779b97f4a7c15ULL;
+    return (int)(bits >> (64 - 9 * (i + 1))) & (IX_BLOOM_BLOCK_BITS - 1);
+}
+
+//
+// 构造函数：容量为capacity个键的空位图
+//
+IX_BloomFilter::IX_BloomFilter(long long capacity)
+    : nBlocks(BloomBlocks(capacity)), capacity(capacity), nStale(0), bDirty(false), bMarked(false) {
+    // 多分配一块，从64字节对齐的位置开始使用，每块正好占一个cache line
+    size_t nWords = (size_t)nBlocks * IX_BLOOM_BLOCK_WORDS;
+    storage = new atomic<uint64_t>[nWords + IX_BLOOM_BLOCK_WORDS];
+    words = (atomic<uint64_t> *)(((uintptr_t)storage + 63) & ~(uintptr_t)63);
+    for (size_t i = 0; i < nWords; i++) {
+        words[i].store(0, memory_order_relaxed);
+    }
+}
+
+IX_BloomFilter::~IX_BloomFilter() {
+    delete[] storage;
+}
+
+//
+// Add: 把哈希值为hash的键加入位图，哈希值的高32位选块（乘法代替取模）
+//
+void IX_BloomFilter::Add(uint64_t hash) {
+    atomic<uint64_t> *block = words + (size_t)(((hash >> 32) * (uint64_t)nBlocks) >> 32) * IX_BLOOM_BLOCK_WORDS;
+    for (int i = 0; i < IX_BLOOM_HASHES; i++) {
+        int bit = BloomBit(hash, i);
+        block[bit >> 6].fetch_or((uint64_t)1 << (bit & 63), memory_order_relaxed);
+    }
+}
+
+//
+// MayContain: 哈希值为hash的键是否可能在位图中，返回false时一定不在
+//
+bool IX_BloomFilter::MayContain(uint64_t hash) const {
+    const atomic<uint64_t> *block =
+        words + (size_t)(((hash >> 32) * (uint64_t)nBlocks) >> 32) * IX_BLOOM_BLOCK_WORDS;
+    for (int i = 0; i < IX_BLOOM_HASHES; i++) {
+        int bit = BloomBit(hash, i);
+        if ((block[bit >> 6].load(memory_order_relaxed) & ((uint64_t)1 << (bit & 63))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//
+// BloomMayContain: 键值pData是否可能在索引中（没有过滤器时总是true）
+//
+bool IX_IndexHandle::BloomMayContain(const void *pData) const {
+    return bloom == NULL || bloom->MayContain(KeyHash64(pData));
+}
+
+//
+// Exists: 是否有键值等于pData的条目，用于EXISTS和插入前检查重复
+// 过滤器判定不存在时不读任何页面，否则查找该键值（带写缓冲的B+树合并缓冲区中的消息）
+//
+RC IX_IndexHandle::Exists(void *pData, bool &bExists) {
+    RC rc;
+    vector<RID> rids;
+
+    bExists = false;
+    if ((rc = Lookup(pData, rids))) {
+        return rc;
+    }
+    bExists = !rids.empty();
+    return 0;
+}
+
+//
+// OpenBloomFilter: 打开索引时读入位图
+// 位图还没有写出、没有正常写回、已经装满或删除的条目过多时按现有的条目重新建立，
+// 原来的页面留给新的位图使用
+//
+RC IX_IndexHandle::OpenBloomFilter(const IX_FileHdr &fileHdr) {
+    RC rc;
+    bool bValid = (fileHdr.bloomPage != IX_NO_PAGE && fileHdr.bloomClean &&
+                   fileHdr.bloomBlocks > 0 && fileHdr.bloomBlocks == BloomBlocks(fileHdr.bloomCapacity));
+
+    bloom = new IX_BloomFilter(bValid ? fileHdr.bloomCapacity : IX_BLOOM_MIN_KEYS);
+    bloom->nStale = fileHdr.bloomStale;
+
+    int block = 0;
+    PageNum pageNum = fileHdr.bloomPage;
+    while (pageNum != IX_NO_PAGE) {
+        PF_PageHandle ph;
+        char *data;
+        if ((rc = pfh->GetThisPage(pageNum, ph))) {
+            return rc;
+        }
+        if ((rc = ph.GetData(data))) {
+            pfh->UnpinPage(pageNum);
+            return rc;
+        }
+        if (bValid) {
+            int n = max(0, min(IX_BLOOM_PAGE_BLOCKS, bloom->nBlocks - block));
+            const char *src = data + sizeof(PageNum);
+            for (size_t w = 0; w < (size_t)n * IX_BLOOM_BLOCK_WORDS; w++) {
+                uint64_t word;
+                memcpy(&word, src + w * sizeof(uint64_t), sizeof(uint64_t));
+                bloom->words[(size_t)block * IX_BLOOM_BLOCK_WORDS + w].store(word, memory_order_relaxed);
+            }
+            block += n;
+        }
+        bloom->pages.push_back(pageNum);
+
+        PageNum nextPage;
+        memcpy(&nextPage, data, sizeof(PageNum));
+        if ((rc = pfh->UnpinPage(pageNum))) {
+            return rc;
+        }
+        pageNum = nextPage;
+    }
+
+    if (!bValid || block < bloom->nBlocks) {
+        return RebuildBloomFilter();
+    }
+    return CheckBloomFilter();
+}
+
+//
+// ResetBloomFilter: 换成能放下nKeys个键（留出一倍空间）的空位图，原来的页面留给新位图
+//
+RC IX_IndexHandle::ResetBloomFilter(long long nKeys) {
+    IX_BloomFilter *filter = new IX_BloomFilter(max((long long)IX_BLOOM_MIN_KEYS, 2 * nKeys));
+    filter->pages.swap(bloom->pages);
+    filter->bMarked = bloom->bMarked.load();
+    filter->bDirty = true;
+    delete bloom;
+    bloom = filter;
+    return 0;
+}
+
+//
+// RebuildBloomFilter: 按索引中现有的条目重新建立位图
+// B+树沿最左边的路径下降后顺着叶子链表读取每个键（RID列表条目只有一个键），
+// 哈希索引读出每个bucket链中的条目。只在打开索引和批量建立时调用，不与修改并发
+//
+RC IX_IndexHandle::RebuildBloomFilter() {
+    RC rc;
+
+    if ((rc = ResetBloomFilter(counters->nEntries))) {
+        return rc;
+    }
+
+    if (hashTable != NULL) {
+        vector<PageNum> buckets(hashTable->directory);
+        sort(buckets.begin(), buckets.end());
+        buckets.erase(unique(buckets.begin(), buckets.end()), buckets.end());
+        size_t entrySize = indexHdr.attrLength + sizeof(RID);
+        for (size_t i = 0; i < buckets.size(); i++) {
+            vector<char> entries;
+            int localDepth;
+            if ((rc = ReadHashChain(buckets[i], NULL, localDepth, entries, NULL))) {
+                return rc;
+            }
+            for (size_t offset = 0; offset < entries.size(); offset += entrySize) {
+                bloom->Add(KeyHash64(&entries[offset]));
+            }
+        }
+        return 0;
+    }
+
+    vector<char> key(indexHdr.attrLength);
+    PageNum pageNum = indexHdr.rootPage;
+    while (pageNum != IX_NO_PAGE) {
+        PF_PageHandle ph;
+        char *nodeData;
+        if ((rc = pfh->GetThisPage(pageNum, ph))) {
+            return rc;
+        }
+        if ((rc = ph.GetData(nodeData))) {
+            pfh->UnpinPage(pageNum);
+            return rc;
+        }
+
+        IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
+        PageNum nextPage;
+        if (nodeHdr->isLeaf) {
+            for (int slot = 0; slot < nodeHdr->numKeys; slot++) {
+                GetLeafKey(nodeData, slot, &key[0]);
+                bloom->Add(KeyHash64(&key[0]));
+            }
+            nextPage = nodeHdr->right;
+        } else {
+            nextPage = GetChildPage(nodeData, 0);
+        }
+        if ((rc = pfh->UnpinPage(pageNum))) {
+            return rc;
+        }
+        pageNum = nextPage;
+    }
+    return 0;
+}
+
+//
+// CheckBloomFilter: 条目数超过位图的容量或删除的条目过多时重新建立位图
+//
+RC IX_IndexHandle::CheckBloomFilter() {
+    if (bloom == NULL ||
+        (counters->nEntries <= bloom->capacity && 2 * bloom->nStale <= bloom->capacity)) {
+        return 0;
+    }
+    return RebuildBloomFilter();
+}
+
+//
+// AddToBloomFilter: 插入条目之前把键值加入位图
+//
+RC IX_IndexHandle::AddToBloomFilter(const void *pData) {
+    RC rc;
+
+    if (!bloom->bMarked.load() && (rc = MarkBloomUnclean())) {
+        return rc;
+    }
+    bloom->Add(KeyHash64(pData));
+    if (!bloom->bDirty.load(memory_order_relaxed)) {
+        bloom->bDirty = true;
+    }
+    return 0;
+}
+
+//
+// MarkBloomUnclean: 打开后第一次插入之前把文件头中的bloomClean置0并写入磁盘，
+// 磁盘上的位图从此可能缺少新插入的键，没有正常关闭时下次打开重新建立位图
+//
+RC IX_IndexHandle::MarkBloomUnclean() {
+    RC rc;
+    lock_guard<mutex> guard(bloom->latch);
+
+    if (bloom->bMarked.load()) {
+        return 0;
+    }
+
+    PF_PageHandle ph;
+    char *data;
+    if ((rc = pfh->GetThisPage(IX_HEADER_PAGE, ph))) {
+        return rc;
+    }
+    if ((rc = ph.GetData(data))) {
+        pfh->UnpinPage(IX_HEADER_PAGE);
+        return rc;
+    }
+    ((IX_FileHdr *)data)->bloomClean = 0;
+    if ((rc = pfh->MarkDirty(IX_HEADER_PAGE)) ||
+        (rc = pfh->UnpinPage(IX_HEADER_PAGE)) ||
+        (rc = pfh->ForcePages(IX_HEADER_PAGE))) {
+        return rc;
+    }
+
+    bloom->bMarked = true;
+    return 0;
+}
+
+//
+// WriteBloomFilter: 关闭索引时写回修改过的位图，页面不够时分配新页，多余的页面归还
+//
+RC IX_IndexHandle::WriteBloomFilter() {
+    RC rc;
+
+    if (!bloom->bDirty.load()) {
+        return 0;
+    }
+
+    size_t nPages = (bloom->nBlocks + IX_BLOOM_PAGE_BLOCKS - 1) / IX_BLOOM_PAGE_BLOCKS;
+    while (bloom->pages.size() < nPages) {
+        PF_PageHandle ph;
+        PageNum pageNum;
+        if ((rc = AllocatePage(ph)) ||
+            (rc = ph.GetPageNum(pageNum))) {
+            return rc;
+        }
+        if ((rc = pfh->UnpinPage(pageNum))) {
+            return rc;
+        }
+        bloom->pages.push_back(pageNum);
+    }
+    while (bloom->pages.size() > nPages) {
+        if ((rc = DisposePage(bloom->pages.back()))) {
+            return rc;
+        }
+        bloom->pages.pop_back();
+    }
+
+    for (size_t p = 0; p < nPages; p++) {
+        PF_PageHandle ph;
+        char *data;
+        PageNum pageNum = bloom->pages[p];
+        if ((rc = pfh->GetThisPage(pageNum, ph))) {
+            return rc;
+        }
+        if ((rc = ph.GetData(data))) {
+            pfh->UnpinPage(pageNum);
+            return rc;
+        }
+
+        PageNum nextPage = (p + 1 < nPages) ? bloom->pages[p + 1] : IX_NO_PAGE;
+        memcpy(data, &nextPage, sizeof(PageNum));
+        size_t first = p * IX_BLOOM_PAGE_BLOCKS;
+        size_t n = min((size_t)IX_BLOOM_PAGE_BLOCKS, bloom->nBlocks - first);
+        char *dst = data + sizeof(PageNum);
+        for (size_t w = 0; w < n * IX_BLOOM_BLOCK_WORDS; w++) {
+            uint64_t word = bloom->words[first * IX_BLOOM_BLOCK_WORDS + w].load(memory_order_relaxed);
+            memcpy(dst + w * sizeof(uint64_t), &word, sizeof(uint64_t));
+        }
+
+        if ((rc = pfh->MarkDirty(pageNum)) ||
+            (rc = pfh->UnpinPage(pageNum))) {
+            return rc;
+        }
+    }
+
+    bloom->bDirty = false;
+    return 0;
+}
+
+//
+// SaveBloomHeader: 位图写回后把它的位置和大小写入文件头（调用者已固定头页）
+//
+void IX_IndexHandle::SaveBloomHeader(IX_FileHdr *fileHdr) const {
+    fileHdr->bloomPage = bloom->pages.empty() ? IX_NO_PAGE : bloom->pages[0];
+    fileHdr->bloomBlocks = bloom->nBlocks;
+    fileHdr->bloomCapacity = bloom->capacity;
+    fileHdr->bloomStale = bloom->nStale;
+    fileHdr->bloomClean = 1;
+}
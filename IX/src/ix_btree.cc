@@ -4,60 +4,62 @@
 // 这个文件包含B+树的核心算法，包括节点操作和树维护功能
 //
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
+#include <vector>
 #include "ix_internal.h"
 
 using namespace std;
 
 //
 // InsertIntoInternal: 向内部节点插入键值-页面对
-// 当子节点分裂时调用此函数
+// 当子节点分裂时调用此函数，insertPos是分裂的子节点的序号，
+// 新键值放在第insertPos个键的位置，新页面成为第insertPos+1个子节点
 //
-RC IX_IndexHandle::InsertIntoInternal(char *nodeData, void *pData, PageNum newPage,
+RC IX_IndexHandle::InsertIntoInternal(char *nodeData, int insertPos, void *pData, PageNum newPage,
                                      bool &wasSplit, void *&newChildKey, PageNum &newChildPage) {
     RC rc = 0;
     IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
     
-    // 计算内部节点的最大条目数
-    int maxEntries = GetMaxInternalEntries();
+    // 新分隔键不比节点中的分隔键长并且放得下时直接插入
+    if (SeparatorLength((const char *)pData) <= nodeHdr->sepLength &&
+        InternalSpace(nodeHdr->sepLength, nodeHdr->numKeys + 1) <= IX_NODE_SPACE) {
+        wasSplit = false;
+        return InsertEntryIntoInternal(nodeData, insertPos, pData, newPage);
+    }
     
-    // 检查是否需要分裂
-    if (nodeHdr->numKeys >= maxEntries) {
-        // 需要分裂内部节点
-        rc = SplitInternalNode(nodeData, pData, newPage, wasSplit, newChildKey, newChildPage);
-    } else {
-        // 直接插入到内部节点
-        rc = InsertEntryIntoInternal(nodeData, pData, newPage);
+    // 否则按新的分隔键长度重写节点，仍然放不下时分裂
+    int attrLength = indexHdr.attrLength;
+    vector<char> keys;
+    vector<PageNum> children;
+    ReadInternal(nodeData, keys, children);
+    keys.insert(keys.begin() + (size_t)insertPos * attrLength,
+                (const char *)pData, (const char *)pData + attrLength);
+    children.insert(children.begin() + insertPos + 1, newPage);
+    
+    if (WriteInternal(nodeData, &keys[0], &children[0], nodeHdr->numKeys + 1)) {
         wasSplit = false;
+        return 0;
     }
+    rc = SplitInternalNode(nodeData, &keys[0], &children[0], nodeHdr->numKeys + 1,
+                           wasSplit, newChildKey, newChildPage);
     
     return rc;
 }
 
 //
-// InsertEntryIntoInternal: 在内部节点中插入条目（假设有足够空间）
+// InsertEntryIntoInternal: 在内部节点中插入条目（假设有足够空间，并且分隔键不超过sepLength）
 //
-RC IX_IndexHandle::InsertEntryIntoInternal(char *nodeData, void *pData, PageNum newPage) {
+RC IX_IndexHandle::InsertEntryIntoInternal(char *nodeData, int insertPos, void *pData, PageNum newPage) {
     IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
     char *entries = nodeData + sizeof(IX_NodeHdr);
-    int entrySize = GetInternalEntrySize();
+    int sepLength = nodeHdr->sepLength;
+    int entrySize = sepLength + sizeof(PageNum);
     
     // 跳过第一个页面指针
     entries += sizeof(PageNum);
     
-    int insertPos = 0;
-    
-    // 找到插入位置（保持排序）
-    for (int i = 0; i < nodeHdr->numKeys; i++) {
-        char *currentEntry = entries + i * entrySize;
-        if (CompareKeys(pData, currentEntry) <= 0) {
-            insertPos = i;
-            break;
-        }
-        insertPos = i + 1;
-    }
-    
     // 移动后面的条目为新条目腾出空间
     if (insertPos < nodeHdr->numKeys) {
         char *insertPoint = entries + insertPos * entrySize;
@@ -68,8 +70,8 @@ RC IX_IndexHandle::InsertEntryIntoInternal(char *nodeData, void *pData, PageNum
     
     // 插入新条目
     char *newEntry = entries + insertPos * entrySize;
-    memcpy(newEntry, pData, indexHdr.attrLength);
-    memcpy(newEntry + indexHdr.attrLength, &newPage, sizeof(PageNum));
+    memcpy(newEntry, pData, sepLength);
+    memcpy(newEntry + sepLength, &newPage, sizeof(PageNum));
     
     nodeHdr->numKeys++;
     
@@ -77,16 +79,25 @@ RC IX_IndexHandle::InsertEntryIntoInternal(char *nodeData, void *pData, PageNum
 }
 
 //
-// SplitInternalNode: 分裂内部节点
+// SplitInternalNode: 把nKeys个完整的分隔键和nKeys + 1个子节点（已包含新插入的）
+// 分到原节点和一个新节点中，中间的键移到上一层
+// 中间键尽量靠近中间，但两边都要能按各自最长的分隔键放下
 //
-RC IX_IndexHandle::SplitInternalNode(char *nodeData, void *pData, PageNum newPage,
+RC IX_IndexHandle::SplitInternalNode(char *nodeData, const char *keys, const PageNum *children, int nKeys,
                                     bool &wasSplit, void *&newChildKey, PageNum &newChildPage) {
     RC rc;
     IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
+    int attrLength = indexHdr.attrLength;
+    
+    // 计算分裂点：第splitPoint个键移到上一层
+    int splitPoint = ChooseInternalSplit(keys, nKeys);
+    if (splitPoint < 0) {
+        return IX_INVALIDTREE;
+    }
     
     // 分配新页面
     PF_PageHandle newPh;
-    if ((rc = pfh->AllocatePage(newPh))) {
+    if ((rc = AllocatePage(newPh))) {
         return rc;
     }
     
@@ -108,108 +119,250 @@ RC IX_IndexHandle::SplitInternalNode(char *nodeData, void *pData, PageNum newPag
     newNodeHdr->parent = nodeHdr->parent;
     newNodeHdr->left = IX_NO_PAGE;  // 内部节点不使用兄弟指针
     newNodeHdr->right = IX_NO_PAGE;
-    
-    // 创建临时数组包含所有条目（原有的加上新的）
-    int entrySize = GetInternalEntrySize();
-    int totalEntries = nodeHdr->numKeys + 1;
-    char *tempEntries = new char[totalEntries * entrySize];
-    char *tempPages = new char[(totalEntries + 1) * sizeof(PageNum)];
-    
-    // 复制原有的页面指针和条目
-    char *oldEntries = nodeData + sizeof(IX_NodeHdr);
-    char *oldPages = oldEntries;
-    oldEntries += sizeof(PageNum);
-    
-    // 复制第一个页面指针
-    memcpy(tempPages, oldPages, sizeof(PageNum));
-    
-    // 复制原有条目和对应的页面指针，并插入新条目到正确位置
-    int insertPos = 0;
-    bool inserted = false;
-    
-    for (int i = 0, j = 0; j < totalEntries; j++) {
-        if (!inserted && (i >= nodeHdr->numKeys || 
-            CompareKeys(pData, oldEntries + i * entrySize) <= 0)) {
-            // 插入新条目
-            memcpy(tempEntries + j * entrySize, pData, indexHdr.attrLength);
-            memcpy(tempEntries + j * entrySize + indexHdr.attrLength, &newPage, sizeof(PageNum));
-            memcpy(tempPages + (j + 1) * sizeof(PageNum), &newPage, sizeof(PageNum));
-            inserted = true;
-        } else {
-            // 复制原有条目
-            memcpy(tempEntries + j * entrySize, oldEntries + i * entrySize, entrySize);
-            memcpy(tempPages + (j + 1) * sizeof(PageNum), 
-                   oldEntries + i * entrySize + indexHdr.attrLength, sizeof(PageNum));
-            i++;
-        }
-    }
-    
-    // 计算分裂点和中间键
-    int splitPoint = totalEntries / 2;
+    newNodeHdr->prefixLength = 0;
     
     // 提取中间键作为向上传播的键
-    memcpy(newChildKey, tempEntries + splitPoint * entrySize, indexHdr.attrLength);
+    memcpy(newChildKey, keys + splitPoint * attrLength, attrLength);
     
-    // 更新原节点（包含前splitPoint个条目）
-    nodeHdr->numKeys = splitPoint;
-    char *originalEntries = nodeData + sizeof(IX_NodeHdr);
+    // 原节点保留前splitPoint个键，新节点包含中间键之后的键
+    WriteInternal(nodeData, keys, children, splitPoint);
+    WriteInternal(newNodeData, keys + (splitPoint + 1) * attrLength, children + splitPoint + 1,
+                  nKeys - splitPoint - 1);
     
-    // 复制页面指针（splitPoint + 1个）
-    memcpy(originalEntries, tempPages, (splitPoint + 1) * sizeof(PageNum));
-    originalEntries += sizeof(PageNum);
+    wasSplit = true;
+    counters->nSplits++;
     
-    // 复制条目（splitPoint个）
-    memcpy(originalEntries, tempEntries, splitPoint * entrySize);
+    pfh->MarkDirty(newChildPage);
+    pfh->UnpinPage(newChildPage);
     
-    // 填充新节点（包含剩余条目，不包括中间键）
-    int rightEntries = totalEntries - splitPoint - 1;
-    newNodeHdr->numKeys = rightEntries;
-    char *newEntries = newNodeData + sizeof(IX_NodeHdr);
+    return 0;
+}
+
+//
+// FindChildPage: 在内部节点中找到可能包含指定键值第一次出现的子页面
+// 相等的键可能跨越分裂点留在分隔键左边的子节点中，因此查找时取第一个不小于键值的分隔键的左侧子节点
+//
+RC IX_IndexHandle::FindChildPage(char *nodeData, void *pData, PageNum &childPage) {
+    childPage = GetChildPage(nodeData, SearchNode(nodeData, pData, false));
+    return 0;
+}
+
+//
+// RebalanceChild: 内部节点nodeData的第childNo个子节点删除条目后过空，与相邻的兄弟节点
+// （优先取右兄弟）合并；两者合起来放不下时在两者之间重新分配。
+// 合并后右边的节点从父节点中删除，页面归还给PF的空闲页链表
+//
+RC IX_IndexHandle::RebalanceChild(char *nodeData, int childNo) {
+    RC rc;
+    IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
     
-    // 复制页面指针（从中间键的右指针开始）
-    memcpy(newEntries, tempPages + (splitPoint + 1) * sizeof(PageNum), 
-           (rightEntries + 1) * sizeof(PageNum));
-    newEntries += sizeof(PageNum);
+    // 只有一个子节点时没有兄弟节点，由上一层处理本节点
+    if (nodeHdr->numKeys == 0) {
+        return 0;
+    }
     
-    // 复制条目（跳过中间键）
-    memcpy(newEntries, tempEntries + (splitPoint + 1) * entrySize, rightEntries * entrySize);
+    // 第sepNo个分隔键两边的子节点
+    int sepNo = (childNo < nodeHdr->numKeys) ? childNo : childNo - 1;
+    PageNum leftPage = GetChildPage(nodeData, sepNo);
+    PageNum rightPage = GetChildPage(nodeData, sepNo + 1);
     
-    delete[] tempEntries;
-    delete[] tempPages;
-    wasSplit = true;
+    PF_PageHandle leftPh, rightPh;
+    char *leftData, *rightData;
+    if ((rc = pfh->GetThisPage(leftPage, leftPh))) {
+        return rc;
+    }
+    if ((rc = leftPh.GetData(leftData)) ||
+        (rc = pfh->GetThisPage(rightPage, rightPh))) {
+        pfh->UnpinPage(leftPage);
+        return rc;
+    }
+    if ((rc = rightPh.GetData(rightData))) {
+        pfh->UnpinPage(rightPage);
+        pfh->UnpinPage(leftPage);
+        return rc;
+    }
     
-    pfh->MarkDirty(newChildPage);
-    pfh->UnpinPage(newChildPage);
+    // 父节点已由调用者加写锁，两个子节点在解锁之前不会被读者看到修改了一半的状态
+    LockNode(leftPage);
+    LockNode(rightPage);
+    bool bMerged = false;
+    bool bLeaf = ((IX_NodeHdr *)leftData)->isLeaf;
+    if (bLeaf) {
+        rc = RebalanceLeaves(nodeData, sepNo, leftPage, leftData, rightData, bMerged);
+    } else {
+        rc = RebalanceInternal(nodeData, sepNo, leftData, rightData, bMerged);
+    }
     
+    pfh->MarkDirty(leftPage);
+    pfh->MarkDirty(rightPage);
+    UnlockNode(rightPage, true);
+    UnlockNode(leftPage, true);
+    pfh->UnpinPage(rightPage);
+    pfh->UnpinPage(leftPage);
+    
+    if (rc == 0 && bMerged) {
+        counters->nMerges++;
+        if (bLeaf) {
+            counters->nLeafPages--;
+        }
+        rc = DisposePage(rightPage);
+    }
+    return rc;
+}
+
+//
+// RebalanceLeaves: 合并或重新分配父节点nodeData第sepNo个分隔键两边的叶子
+// 合并时右边的叶子从叶子链表和父节点中删除，bMerged置为true；
+// 重新分配时先改写父节点中的分隔键，父节点放不下更长的分隔键时保持原样
+//
+RC IX_IndexHandle::RebalanceLeaves(char *nodeData, int sepNo, PageNum leftPage, char *leftData,
+                                   char *rightData, bool &bMerged) {
+    IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
+    IX_NodeHdr *leftHdr = (IX_NodeHdr *)leftData;
+    IX_NodeHdr *rightHdr = (IX_NodeHdr *)rightData;
+    int attrLength = indexHdr.attrLength;
+    int entrySize = GetLeafEntrySize();
+    
+    vector<char> entries, rightEntries;
+    ReadLeaf(leftData, entries);
+    ReadLeaf(rightData, rightEntries);
+    entries.insert(entries.end(), rightEntries.begin(), rightEntries.end());
+    int nEntries = leftHdr->numKeys + rightHdr->numKeys;
+    
+    vector<char> keys;
+    vector<PageNum> children;
+    ReadInternal(nodeData, keys, children);
+    
+    bMerged = false;
+    if (WriteLeaf(leftData, entries.data(), nEntries)) {
+        // 合并到左边的叶子，从链表中摘下右边的叶子
+        leftHdr->right = rightHdr->right;
+        if (rightHdr->right != IX_NO_PAGE) {
+            PF_PageHandle nextPh;
+            char *nextData;
+            if (pfh->GetThisPage(rightHdr->right, nextPh) == 0) {
+                if (nextPh.GetData(nextData) == 0) {
+                    LockNode(rightHdr->right);
+                    ((IX_NodeHdr *)nextData)->left = leftPage;
+                    pfh->MarkDirty(rightHdr->right);
+                    UnlockNode(rightHdr->right, true);
+                }
+                pfh->UnpinPage(rightHdr->right);
+            }
+        }
+        rightHdr->numKeys = 0;
+        
+        keys.erase(keys.begin() + (size_t)sepNo * attrLength,
+                   keys.begin() + (size_t)(sepNo + 1) * attrLength);
+        children.erase(children.begin() + sepNo + 1);
+        WriteInternal(nodeData, keys.data(), children.data(), nodeHdr->numKeys - 1);
+        bMerged = true;
+        return 0;
+    }
+    
+    // 放不下时在两个叶子之间平均分配
+    int splitPoint = ChooseLeafSplit(entries.data(), nEntries);
+    if (splitPoint < 0) {
+        return 0;
+    }
+    MakeSeparator(entries.data() + (splitPoint - 1) * entrySize, entries.data() + splitPoint * entrySize,
+                  &keys[(size_t)sepNo * attrLength]);
+    if (!WriteInternal(nodeData, keys.data(), children.data(), nodeHdr->numKeys)) {
+        return 0;
+    }
+    WriteLeaf(leftData, entries.data(), splitPoint);
+    WriteLeaf(rightData, entries.data() + splitPoint * entrySize, nEntries - splitPoint);
     return 0;
 }
 
 //
-// FindChildPage: 在内部节点中找到包含指定键值的子页面
+// RebalanceInternal: 合并或重新分配父节点nodeData第sepNo个分隔键两边的内部节点
+// 父节点中的分隔键下移到两个节点的键之间，重新分配时再把新的中间键移上去
 //
-RC IX_IndexHandle::FindChildPage(char *nodeData, void *pData, PageNum &childPage) {
+RC IX_IndexHandle::RebalanceInternal(char *nodeData, int sepNo, char *leftData, char *rightData,
+                                     bool &bMerged) {
     IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
-    char *entries = nodeData + sizeof(IX_NodeHdr);
-    int entrySize = GetInternalEntrySize();
+    IX_NodeHdr *leftHdr = (IX_NodeHdr *)leftData;
+    IX_NodeHdr *rightHdr = (IX_NodeHdr *)rightData;
+    int attrLength = indexHdr.attrLength;
+    
+    vector<char> keys, mergedKeys, rightKeys;
+    vector<PageNum> children, mergedChildren, rightChildren;
+    ReadInternal(nodeData, keys, children);
+    ReadInternal(leftData, mergedKeys, mergedChildren);
+    ReadInternal(rightData, rightKeys, rightChildren);
+    
+    char *sep = &keys[(size_t)sepNo * attrLength];
+    mergedKeys.insert(mergedKeys.end(), sep, sep + attrLength);
+    mergedKeys.insert(mergedKeys.end(), rightKeys.begin(), rightKeys.end());
+    mergedChildren.insert(mergedChildren.end(), rightChildren.begin(), rightChildren.end());
+    int nKeys = leftHdr->numKeys + 1 + rightHdr->numKeys;
+    
+    bMerged = false;
+    if (WriteInternal(leftData, mergedKeys.data(), mergedChildren.data(), nKeys)) {
+        rightHdr->numKeys = 0;
+        keys.erase(keys.begin() + (size_t)sepNo * attrLength,
+                   keys.begin() + (size_t)(sepNo + 1) * attrLength);
+        children.erase(children.begin() + sepNo + 1);
+        WriteInternal(nodeData, keys.data(), children.data(), nodeHdr->numKeys - 1);
+        bMerged = true;
+        return 0;
+    }
     
-    // 第一个子页面指针
-    childPage = *(PageNum *)entries;
-    entries += sizeof(PageNum);
+    // 放不下时第splitPoint个键移到父节点，两边各保留一半
+    int splitPoint = ChooseInternalSplit(mergedKeys.data(), nKeys);
+    if (splitPoint < 0) {
+        return 0;
+    }
+    memcpy(sep, mergedKeys.data() + (size_t)splitPoint * attrLength, attrLength);
+    if (!WriteInternal(nodeData, keys.data(), children.data(), nodeHdr->numKeys)) {
+        return 0;
+    }
+    WriteInternal(leftData, mergedKeys.data(), mergedChildren.data(), splitPoint);
+    WriteInternal(rightData, mergedKeys.data() + (size_t)(splitPoint + 1) * attrLength,
+                  mergedChildren.data() + splitPoint + 1, nKeys - splitPoint - 1);
+    return 0;
+}
+
+//
+// ShrinkRoot: 内部根节点没有分隔键时由唯一的子节点代替，空的叶子根节点删除后索引变为空，
+// 原来的根页面归还给PF的空闲页链表
+//
+RC IX_IndexHandle::ShrinkRoot() {
+    RC rc;
     
-    // 查找正确的子页面
-    for (int i = 0; i < nodeHdr->numKeys; i++) {
-        char *keyPtr = entries + i * entrySize;
+    while (indexHdr.rootPage != IX_NO_PAGE) {
+        PF_PageHandle ph;
+        char *nodeData;
+        PageNum rootPage = indexHdr.rootPage;
+        
+        if ((rc = pfh->GetThisPage(rootPage, ph))) {
+            return rc;
+        }
+        if ((rc = ph.GetData(nodeData))) {
+            pfh->UnpinPage(rootPage);
+            return rc;
+        }
         
-        if (CompareKeys(pData, keyPtr) < 0) {
-            // 键值小于当前键，应该在当前子页面中
-            return 0;
+        IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
+        if (nodeHdr->numKeys > 0) {
+            return pfh->UnpinPage(rootPage);
+        }
+        indexHdr.rootPage = nodeHdr->isLeaf ? IX_NO_PAGE : GetChildPage(nodeData, 0);
+        counters->height--;
+        if (nodeHdr->isLeaf) {
+            counters->nLeafPages--;
         }
         
-        // 移动到下一个子页面
-        childPage = *(PageNum *)(keyPtr + indexHdr.attrLength);
+        // 修改版本号，已经读到旧根节点的读者重新开始
+        LockNode(rootPage);
+        UnlockNode(rootPage, true);
+        pfh->UnpinPage(rootPage);
+        if ((rc = DisposePage(rootPage))) {
+            return rc;
+        }
     }
     
-    // 键值大于等于所有键，在最右边的子页面中
     return 0;
 }
 
@@ -244,11 +397,12 @@ RC IX_IndexHandle::TraverseTree(PageNum pageNum, int level) {
     
     if (nodeHdr->isLeaf) {
         // 叶子节点：打印所有键值
-        char *entries = nodeData + sizeof(IX_NodeHdr);
+        vector<char> entries;
         int entrySize = GetLeafEntrySize();
+        ReadLeaf(nodeData, entries);
         
         for (int i = 0; i < nodeHdr->numKeys; i++) {
-            char *entry = entries + i * entrySize;
+            char *entry = &entries[(size_t)i * entrySize];
             
             for (int j = 0; j < level + 1; j++) cout << "  ";
             cout << "Entry " << i << ": ";
@@ -274,7 +428,10 @@ RC IX_IndexHandle::TraverseTree(PageNum pageNum, int level) {
             RID *rid = (RID *)(entry + indexHdr.attrLength);
             PageNum pageNum;
             SlotNum slotNum;
-            if (rid->GetPageNum(pageNum) == 0 && rid->GetSlotNum(slotNum) == 0) {
+            if (IsPostingRef(entry + indexHdr.attrLength)) {
+                IX_PostingRef *ref = (IX_PostingRef *)(entry + indexHdr.attrLength);
+                cout << " -> " << ref->numRIDs << " RIDs in bucket " << ref->headPage << endl;
+            } else if (rid->GetPageNum(pageNum) == 0 && rid->GetSlotNum(slotNum) == 0) {
                 cout << " -> (" << pageNum << "," << slotNum << ")" << endl;
             } else {
                 cout << " -> (invalid RID)" << endl;
@@ -282,19 +439,16 @@ RC IX_IndexHandle::TraverseTree(PageNum pageNum, int level) {
         }
     } else {
         // 内部节点：递归遍历子节点
-        char *entries = nodeData + sizeof(IX_NodeHdr);
-        int entrySize = GetInternalEntrySize();
-        
-        // 第一个子指针
-        PageNum firstChild = *(PageNum *)entries;
-        entries += sizeof(PageNum);
+        vector<char> keys;
+        vector<PageNum> children;
+        ReadInternal(nodeData, keys, children);
         
         // 递归遍历第一个子树
-        TraverseTree(firstChild, level + 1);
+        TraverseTree(children[0], level + 1);
         
         // 遍历其余子树
         for (int i = 0; i < nodeHdr->numKeys; i++) {
-            char *entry = entries + i * entrySize;
+            char *entry = &keys[(size_t)i * indexHdr.attrLength];
             
             // 打印键值
             for (int j = 0; j < level + 1; j++) cout << "  ";
@@ -319,8 +473,7 @@ RC IX_IndexHandle::TraverseTree(PageNum pageNum, int level) {
             cout << endl;
             
             // 递归遍历右子树
-            PageNum rightChild = *(PageNum *)(entry + indexHdr.attrLength);
-            TraverseTree(rightChild, level + 1);
+            TraverseTree(children[i + 1], level + 1);
         }
     }
     
@@ -358,7 +511,9 @@ RC IX_IndexHandle::ValidateTree(PageNum pageNum, void *minKey, void *maxKey, int
         height = 1;
         
         // 检查键值是否有序
-        char *entries = nodeData + sizeof(IX_NodeHdr);
+        vector<char> leafEntries;
+        ReadLeaf(nodeData, leafEntries);
+        char *entries = leafEntries.empty() ? NULL : &leafEntries[0];
         int entrySize = GetLeafEntrySize();
         
         for (int i = 1; i < nodeHdr->numKeys; i++) {
@@ -393,12 +548,14 @@ RC IX_IndexHandle::ValidateTree(PageNum pageNum, void *minKey, void *maxKey, int
         
     } else {
         // 内部节点验证
-        char *entries = nodeData + sizeof(IX_NodeHdr);
-        int entrySize = GetInternalEntrySize();
+        vector<char> keys;
+        vector<PageNum> children;
+        ReadInternal(nodeData, keys, children);
+        char *entries = keys.empty() ? NULL : &keys[0];
+        int entrySize = indexHdr.attrLength;
         
         // 验证所有子树
-        PageNum firstChild = *(PageNum *)entries;
-        entries += sizeof(PageNum);
+        PageNum firstChild = children[0];
         
         int childHeight;
         rc = ValidateTree(firstChild, minKey, 
@@ -412,7 +569,7 @@ RC IX_IndexHandle::ValidateTree(PageNum pageNum, void *minKey, void *maxKey, int
         
         for (int i = 0; i < nodeHdr->numKeys; i++) {
             char *keyPtr = entries + i * entrySize;
-            PageNum rightChild = *(PageNum *)(keyPtr + indexHdr.attrLength);
+            PageNum rightChild = children[i + 1];
             
             void *leftBound = keyPtr;
             void *rightBound = (i + 1 < nodeHdr->numKeys) ? 
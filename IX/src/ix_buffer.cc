@@ -0,0 +1,145 @@
+//
+// ix_buffer.cc: 带写缓冲的B+树
+//
+// 随机插入时每个条目落在不同的叶子上，叶子不在缓冲池中时每次插入都要读写一个页面。
+// 带写缓冲的索引把插入和删除先记入内存中按键值排序的消息缓冲区，缓冲区满时按键值顺序
+// 一次写入B+树：落在同一个叶子中的消息连续写入，叶子只需读入一次。
+// 查找和扫描把缓冲区中的消息与B+树中的条目合并，结果与直接修改B+树相同。
+// 缓冲区的组织见ix_internal.h
+//
+
+#include <algorithm>
+#include <cstring>
+#include "ix_internal.h"
+
+using namespace std;
+
+//
+// BufferMessage: 把一次插入（IX_MSG_INSERT）或删除（IX_MSG_DELETE）记入缓冲区
+// 同一(键值, RID)已有消息时合并：插入后再删除相互抵消，删除后再插入记为先删除再插入
+//
+RC IX_IndexHandle::BufferMessage(int op, const void *pData, const RID &rid, const void *payload) {
+    lock_guard<mutex> guard(msgBuffer->latch);
+    map<string, IX_Message, IX_MsgLess> &messages = msgBuffer->messages;
+    size_t msgBytes = indexHdr.attrLength + sizeof(RID) + keyDesc.includeLength + IX_MSG_OVERHEAD;
+
+    string key((const char *)pData, indexHdr.attrLength);
+    key.append((const char *)&rid, sizeof(RID));
+
+    map<string, IX_Message, IX_MsgLess>::iterator it = messages.find(key);
+    if (op == IX_MSG_INSERT) {
+        if (it == messages.end()) {
+            it = messages.insert(make_pair(key, IX_Message())).first;
+            it->second.op = 0;
+            msgBuffer->bytes += msgBytes;
+        }
+        it->second.op |= IX_MSG_INSERT;
+        if (payload != NULL) {
+            it->second.payload.assign((const char *)payload, keyDesc.includeLength);
+        } else {
+            it->second.payload.assign(keyDesc.includeLength, '\0');
+        }
+    } else if (it == messages.end()) {
+        IX_Message msg;
+        msg.op = IX_MSG_DELETE;
+        messages.insert(make_pair(key, msg));
+        msgBuffer->bytes += msgBytes;
+    } else if (it->second.op == IX_MSG_INSERT) {
+        // 插入的条目还没有写入B+树，直接抵消
+        messages.erase(it);
+        msgBuffer->bytes -= msgBytes;
+    } else {
+        it->second.op = IX_MSG_DELETE;
+        it->second.payload.clear();
+    }
+
+    if (msgBuffer->bytes >= msgBuffer->capacity) {
+        return ApplyMessages();
+    }
+    return 0;
+}
+
+//
+// FlushMessages: 把缓冲区中的全部消息写入B+树
+//
+RC IX_IndexHandle::FlushMessages() {
+    if (!isOpenHandle) {
+        return IX_INDEXNOTOPEN;
+    }
+    if (msgBuffer == NULL) {
+        return 0;
+    }
+
+    lock_guard<mutex> guard(msgBuffer->latch);
+    return ApplyMessages();
+}
+
+//
+// ApplyMessages: 按键值顺序把消息写入B+树（调用时持有缓冲区的锁）
+// 写入一条删除一条，出错时缓冲区中只剩下未写入的消息
+//
+RC IX_IndexHandle::ApplyMessages() {
+    RC rc;
+    map<string, IX_Message, IX_MsgLess> &messages = msgBuffer->messages;
+    size_t msgBytes = indexHdr.attrLength + sizeof(RID) + keyDesc.includeLength + IX_MSG_OVERHEAD;
+    vector<char> key(indexHdr.attrLength);
+    RID rid;
+
+    while (!messages.empty()) {
+        map<string, IX_Message, IX_MsgLess>::iterator it = messages.begin();
+        memcpy(&key[0], it->first.data(), indexHdr.attrLength);
+        memcpy((char *)&rid, it->first.data() + indexHdr.attrLength, sizeof(RID));
+
+        // 删除不存在的条目不是错误（删除消息不检查条目是否存在）
+        if ((it->second.op & IX_MSG_DELETE) &&
+            (rc = DeleteFromTree(&key[0], rid)) && rc != IX_ENTRYNOTFOUND) {
+            return rc;
+        }
+        if ((it->second.op & IX_MSG_INSERT) &&
+            (rc = InsertIntoTree(&key[0], rid, it->second.payload.data()))) {
+            return rc;
+        }
+
+        messages.erase(it);
+        msgBuffer->bytes -= msgBytes;
+    }
+
+    return 0;
+}
+
+//
+// MergeMessages: 把键值等于pData的消息合并到从B+树查到的rids中（调用时持有缓冲区的锁）
+// 有消息的RID以消息为准：先去掉，再加入待插入的
+//
+void IX_IndexHandle::MergeMessages(const void *pData, vector<RID> &rids) const {
+    const map<string, IX_Message, IX_MsgLess> &messages = msgBuffer->messages;
+    if (messages.empty()) {
+        return;
+    }
+
+    // 从该键值最小的RID开始
+    RID minRid(0, 0);
+    string probe((const char *)pData, indexHdr.attrLength);
+    probe.append((const char *)&minRid, sizeof(RID));
+
+    vector<RID> inserted;
+    map<string, IX_Message, IX_MsgLess>::const_iterator it = messages.lower_bound(probe);
+    for (; it != messages.end() && keyOps->compare(it->first.data(), pData, &keyDesc) == 0; ++it) {
+        RID rid;
+        memcpy((char *)&rid, it->first.data() + indexHdr.attrLength, sizeof(RID));
+        rids.erase(remove(rids.begin(), rids.end(), rid), rids.end());
+        if (it->second.op & IX_MSG_INSERT) {
+            inserted.push_back(rid);
+        }
+    }
+    rids.insert(rids.end(), inserted.begin(), inserted.end());
+}
+
+//
+// HasMessage: (key, rid)是否有待写入的消息
+//
+bool IX_IndexHandle::HasMessage(const char *key, const RID &rid) const {
+    string probe(key, indexHdr.attrLength);
+    probe.append((const char *)&rid, sizeof(RID));
+    return msgBuffer->messages.count(probe) > 0;
+}
@@ -0,0 +1,651 @@
+//
+// ix_bulkload.cc: 自底向上批量建立B+树
+//
+// 条目先在内存中缓存，超过内存预算时排序后写入临时文件成为一个归并段；
+// Finish时把所有归并段多路归并（归并段过多时先分几趟合并），
+// 按顺序把条目写满叶子节点（同一键值的条目足够多时合并为一个RID列表条目）。
+// 叶子的条目先攒在内存中，按公共前缀压缩后放不下时才写出。
+// 每写完一个节点就把它与左边节点之间的分隔键和它的页号
+// 追加到上一层的当前节点，上一层节点满了再开一个新节点并继续向上追加，
+// 最后最上层唯一的节点就是根。带Bloom过滤器的索引在归并时按条目总数重新建立过滤器。
+//
+
+#include <algorithm>
+#include <cstring>
+#include <queue>
+#include <vector>
+#include "ix_internal.h"
+
+using namespace std;
+
+//
+// IX_BulkLoadLevel: 正在建立的某一层（0为叶子层）
+//
+struct IX_BulkLoadLevel {
+    PageNum firstPage;                     // 这一层最左边的节点
+    PageNum curPage;                       // 这一层当前正在写的节点
+};
+
+//
+// IX_BulkLoadState: 批量建立期间的状态
+//
+struct IX_BulkLoadState {
+    IX_IndexHandle *indexHandle;
+    int attrLength;
+    int entrySize;                         // 键值 + RID + 附带数据
+    int nodeSpace;                         // 每个节点按填充比例使用的空间
+
+    // 外部排序
+    vector<char> buffer;                   // 内存中尚未排序的条目
+    size_t maxBuffered;                    // 内存中最多缓存的条目数
+    size_t nBuffered;
+    vector<FILE*> runs;                    // 已写出的归并段
+    long long nEntries;                    // 加入的条目总数
+
+    // 有序条目中尚未写出的一组相同键值
+    vector<char> dupEntries;
+    int nDups;
+
+    // 建树
+    vector<IX_BulkLoadLevel> levels;
+    vector<char> leafEntries;              // 下一个叶子的条目（完整条目）
+    int nLeafEntries;
+    vector<char> lastKey;                  // 上一个叶子最后的键
+    char *leafData;                        // 上一个叶子节点（保持固定，直到链接上下一个叶子）
+};
+
+//
+// IX_CompareEntries: 比较两个(键值, RID)条目，键值相等时按RID排序
+//
+static int IX_CompareEntries(const IX_KeyOps *keyOps, const IX_KeyDesc *keyDesc,
+                             const char *entry1, const char *entry2) {
+    int attrLength = keyDesc->keyLength;
+    int cmp = keyOps->compare(entry1, entry2, keyDesc);
+    if (cmp != 0) {
+        return cmp;
+    }
+    RID rid1, rid2;
+    memcpy((char *)&rid1, entry1 + attrLength, sizeof(RID));
+    memcpy((char *)&rid2, entry2 + attrLength, sizeof(RID));
+    if (rid1 < rid2) return -1;
+    if (rid2 < rid1) return 1;
+    return 0;
+}
+
+//
+// 构造函数
+//
+IX_BulkLoader::IX_BulkLoader() {
+    state = NULL;
+}
+
+//
+// 析构函数
+//
+IX_BulkLoader::~IX_BulkLoader() {
+    if (state != NULL) {
+        Abort();
+    }
+}
+
+//
+// Open: 开始批量建立
+// fillFactor为每个节点写入的比例（0, 1]，memoryBudget为排序缓冲区的字节数
+//
+RC IX_BulkLoader::Open(IX_IndexHandle &indexHandle, double fillFactor, size_t memoryBudget) {
+    // 检查索引是否打开
+    if (!indexHandle.isOpenHandle) {
+        return IX_INDEXNOTOPEN;
+    }
+
+    // 检查是否已经开始
+    if (state != NULL) {
+        return IX_SCANOPEN;
+    }
+
+    // 只能建立空索引（带写缓冲的B+树的缓冲区也要为空）
+    if (indexHandle.indexHdr.rootPage != IX_NO_PAGE ||
+        (indexHandle.hashTable != NULL && !indexHandle.hashTable->directory.empty()) ||
+        (indexHandle.msgBuffer != NULL && !indexHandle.msgBuffer->messages.empty())) {
+        return IX_INDEXNOTEMPTY;
+    }
+
+    if (fillFactor <= 0.0 || fillFactor > 1.0) {
+        fillFactor = IX_DEFAULT_FILL_FACTOR;
+    }
+
+    state = new IX_BulkLoadState;
+    state->indexHandle = &indexHandle;
+    state->attrLength = indexHandle.indexHdr.attrLength;
+    state->entrySize = indexHandle.GetLeafEntrySize();
+    state->nodeSpace = (int)(IX_NODE_SPACE * fillFactor);
+    state->maxBuffered = max((size_t)1, memoryBudget / state->entrySize);
+    state->nBuffered = 0;
+    state->nEntries = 0;
+    state->nDups = 0;
+    state->nLeafEntries = 0;
+    state->lastKey.resize(state->attrLength);
+    state->leafData = NULL;
+
+    return OK;
+}
+
+//
+// AddEntry: 加入一个条目，内存缓冲区满时排序并写出一个归并段
+// payload为附带的数据（索引的includeLength字节），NULL时填零
+//
+RC IX_BulkLoader::AddEntry(void *pData, const RID &rid, const void *payload) {
+    RC rc;
+
+    if (state == NULL) {
+        return IX_INDEXNOTOPEN;
+    }
+    if (pData == NULL) {
+        return IX_NULLPOINTER;
+    }
+
+    // 哈希索引不需要排序，直接插入
+    if (state->indexHandle->hashTable != NULL) {
+        return state->indexHandle->InsertEntry(pData, rid, payload);
+    }
+
+    if (state->nBuffered == state->maxBuffered && (rc = SortAndSpill())) {
+        return rc;
+    }
+
+    state->buffer.resize((state->nBuffered + 1) * state->entrySize);
+    char *entry = &state->buffer[state->nBuffered * state->entrySize];
+    memcpy(entry, pData, state->attrLength);
+    memcpy(entry + state->attrLength, &rid, sizeof(RID));
+    int includeLength = state->entrySize - state->attrLength - (int)sizeof(RID);
+    if (includeLength > 0) {
+        if (payload != NULL) {
+            memcpy(entry + state->attrLength + sizeof(RID), payload, includeLength);
+        } else {
+            memset(entry + state->attrLength + sizeof(RID), 0, includeLength);
+        }
+    }
+    state->nBuffered++;
+    state->nEntries++;
+
+    return OK;
+}
+
+//
+// Finish: 归并所有条目并建立B+树
+//
+RC IX_BulkLoader::Finish() {
+    RC rc = OK;
+
+    if (state == NULL) {
+        return IX_INDEXNOTOPEN;
+    }
+
+    const IX_KeyOps *keyOps = state->indexHandle->keyOps;
+    const IX_KeyDesc *keyDesc = &state->indexHandle->keyDesc;
+
+    // 哈希索引的条目已经逐个插入，过滤器装满时重新建立；B+树按条目总数换成空的过滤器，
+    // 归并时加入每个键值
+    IX_IndexHandle *indexHandle = state->indexHandle;
+    if (indexHandle->bloom != NULL &&
+        (rc = (indexHandle->hashTable != NULL) ? indexHandle->CheckBloomFilter()
+                                               : indexHandle->ResetBloomFilter(state->nEntries))) {
+        Abort();
+        return rc;
+    }
+
+    if (state->runs.empty()) {
+        // 所有条目都在内存中：直接排序后建树
+        vector<const char*> sorted(state->nBuffered);
+        for (size_t i = 0; i < state->nBuffered; i++) {
+            sorted[i] = &state->buffer[i * state->entrySize];
+        }
+        sort(sorted.begin(), sorted.end(), [keyOps, keyDesc](const char *a, const char *b) {
+            return IX_CompareEntries(keyOps, keyDesc, a, b) < 0;
+        });
+        for (size_t i = 0; i < sorted.size() && rc == OK; i++) {
+            rc = AppendSorted(sorted[i]);
+        }
+    } else {
+        // 写出最后一段，归并段过多时先分趟合并，最后一趟直接建树
+        if (state->nBuffered > 0) {
+            rc = SortAndSpill();
+        }
+        while (rc == OK && state->runs.size() > IX_MAX_MERGE_FANIN) {
+            FILE *out = tmpfile();
+            if (out == NULL) {
+                rc = IX_SORTFILEERROR;
+                break;
+            }
+            state->runs.push_back(out);
+            if ((rc = MergeRuns(0, IX_MAX_MERGE_FANIN, out)) == OK) {
+                state->runs.erase(state->runs.begin(), state->runs.begin() + IX_MAX_MERGE_FANIN);
+            }
+        }
+        if (rc == OK) {
+            rc = MergeRuns(0, state->runs.size(), NULL);
+        }
+    }
+
+    if (rc == OK) {
+        rc = FinishTree();
+    }
+
+    if (rc) {
+        Abort();
+        return rc;
+    }
+
+    // 释放临时文件
+    for (size_t i = 0; i < state->runs.size(); i++) {
+        if (state->runs[i] != NULL) {
+            fclose(state->runs[i]);
+        }
+    }
+    delete state;
+    state = NULL;
+
+    return OK;
+}
+
+//
+// Abort: 放弃批量建立
+// 已经写入索引文件的节点不会回收，调用者应当删除该索引
+//
+RC IX_BulkLoader::Abort() {
+    if (state == NULL) {
+        return IX_INDEXNOTOPEN;
+    }
+
+    if (state->leafData != NULL) {
+        state->indexHandle->pfh->UnpinPage(state->levels[0].curPage);
+    }
+    for (size_t i = 0; i < state->runs.size(); i++) {
+        if (state->runs[i] != NULL) {
+            fclose(state->runs[i]);
+        }
+    }
+    delete state;
+    state = NULL;
+
+    return OK;
+}
+
+//
+// SortAndSpill: 对内存中的条目排序，写入一个新的临时文件
+//
+RC IX_BulkLoader::SortAndSpill() {
+    const IX_KeyOps *keyOps = state->indexHandle->keyOps;
+    const IX_KeyDesc *keyDesc = &state->indexHandle->keyDesc;
+    int entrySize = state->entrySize;
+
+    vector<const char*> sorted(state->nBuffered);
+    for (size_t i = 0; i < state->nBuffered; i++) {
+        sorted[i] = &state->buffer[i * entrySize];
+    }
+    sort(sorted.begin(), sorted.end(), [keyOps, keyDesc](const char *a, const char *b) {
+        return IX_CompareEntries(keyOps, keyDesc, a, b) < 0;
+    });
+
+    FILE *run = tmpfile();
+    if (run == NULL) {
+        return IX_SORTFILEERROR;
+    }
+    state->runs.push_back(run);
+
+    for (size_t i = 0; i < sorted.size(); i++) {
+        if (fwrite(sorted[i], entrySize, 1, run) != 1) {
+            return IX_SORTFILEERROR;
+        }
+    }
+    if (fflush(run) != 0) {
+        return IX_SORTFILEERROR;
+    }
+    rewind(run);
+
+    state->nBuffered = 0;
+    state->buffer.clear();
+
+    return OK;
+}
+
+//
+// MergeRuns: 多路归并runs[first, first+count)，结果写入out；out为NULL时直接建树
+// 归并完的归并段被关闭并置为NULL
+//
+RC IX_BulkLoader::MergeRuns(size_t first, size_t count, FILE *out) {
+    RC rc;
+    const IX_KeyOps *keyOps = state->indexHandle->keyOps;
+    const IX_KeyDesc *keyDesc = &state->indexHandle->keyDesc;
+    int entrySize = state->entrySize;
+
+    // 每个归并段当前的条目
+    vector<char> heads(count * entrySize);
+    auto greater = [&](size_t a, size_t b) {
+        return IX_CompareEntries(keyOps, keyDesc, &heads[a * entrySize], &heads[b * entrySize]) > 0;
+    };
+    priority_queue<size_t, vector<size_t>, decltype(greater)> heap(greater);
+
+    for (size_t i = 0; i < count; i++) {
+        if (fread(&heads[i * entrySize], entrySize, 1, state->runs[first + i]) == 1) {
+            heap.push(i);
+        }
+    }
+
+    while (!heap.empty()) {
+        size_t i = heap.top();
+        heap.pop();
+
+        char *entry = &heads[i * entrySize];
+        if (out != NULL) {
+            if (fwrite(entry, entrySize, 1, out) != 1) {
+                return IX_SORTFILEERROR;
+            }
+        } else if ((rc = AppendSorted(entry))) {
+            return rc;
+        }
+
+        if (fread(entry, entrySize, 1, state->runs[first + i]) == 1) {
+            heap.push(i);
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (ferror(state->runs[first + i])) {
+            return IX_SORTFILEERROR;
+        }
+        fclose(state->runs[first + i]);
+        state->runs[first + i] = NULL;
+    }
+
+    if (out != NULL) {
+        if (fflush(out) != 0) {
+            return IX_SORTFILEERROR;
+        }
+        rewind(out);
+    }
+
+    return OK;
+}
+
+//
+// AllocateNode: 分配并初始化一个空节点，页面保持固定
+//
+RC IX_BulkLoader::AllocateNode(bool isLeaf, PageNum &pageNum, char *&nodeData) {
+    RC rc;
+    PF_PageHandle ph;
+
+    if ((rc = state->indexHandle->pfh->AllocatePage(ph)) ||
+        (rc = ph.GetPageNum(pageNum)) ||
+        (rc = ph.GetData(nodeData))) {
+        return rc;
+    }
+
+    IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
+    nodeHdr->isLeaf = isLeaf;
+    nodeHdr->numKeys = 0;
+    nodeHdr->parent = IX_NO_PAGE;
+    nodeHdr->left = IX_NO_PAGE;
+    nodeHdr->right = IX_NO_PAGE;
+    nodeHdr->prefixLength = 0;
+    nodeHdr->sepLength = state->attrLength;
+    if (isLeaf) {
+        state->indexHandle->counters->nLeafPages++;
+    }
+
+    return state->indexHandle->pfh->MarkDirty(pageNum);
+}
+
+//
+// AppendSorted: 加入下一个有序的条目。相同键值的条目先攒起来，键值变化时一起写出
+//
+RC IX_BulkLoader::AppendSorted(const char *entry) {
+    RC rc;
+    IX_IndexHandle *indexHandle = state->indexHandle;
+    int entrySize = state->entrySize;
+
+    if (indexHandle->bloom != NULL && (rc = indexHandle->AddToBloomFilter(entry))) {
+        return rc;
+    }
+
+    if (!indexHandle->UsePostings()) {
+        return AppendEntry(entry);
+    }
+
+    if (state->nDups > 0 &&
+        indexHandle->CompareKeys(&state->dupEntries[0], (void *)entry) != 0 &&
+        (rc = FlushDuplicates())) {
+        return rc;
+    }
+
+    state->dupEntries.resize((state->nDups + 1) * entrySize);
+    memcpy(&state->dupEntries[state->nDups * entrySize], entry, entrySize);
+    state->nDups++;
+
+    return OK;
+}
+
+//
+// FlushDuplicates: 写出攒下的相同键值的条目，达到合并的数目时写成一个RID列表条目
+//
+RC IX_BulkLoader::FlushDuplicates() {
+    RC rc;
+    IX_IndexHandle *indexHandle = state->indexHandle;
+    int entrySize = state->entrySize;
+    int nDups = state->nDups;
+
+    state->nDups = 0;
+    if (nDups == 0) {
+        return OK;
+    }
+
+    if (nDups < indexHandle->GetPostingThreshold()) {
+        for (int i = 0; i < nDups; i++) {
+            if ((rc = AppendEntry(&state->dupEntries[i * entrySize]))) {
+                return rc;
+            }
+        }
+        return OK;
+    }
+
+    // 条目已经按RID排好序
+    vector<RID> rids(nDups);
+    for (int i = 0; i < nDups; i++) {
+        memcpy((char *)&rids[i], &state->dupEntries[i * entrySize] + state->attrLength, sizeof(RID));
+    }
+    rids.erase(unique(rids.begin(), rids.end()), rids.end());
+
+    IX_PostingRef ref;
+    ref.marker = IX_POSTING_MARKER;
+    ref.numRIDs = (int)rids.size();
+    if ((rc = indexHandle->CreatePostingList(rids, ref.headPage))) {
+        return rc;
+    }
+    char *entry = &state->dupEntries[0];
+    memcpy(entry + state->attrLength, &ref, sizeof(IX_PostingRef));
+
+    return AppendEntry(entry);
+}
+
+//
+// AppendEntry: 把下一个条目加入当前叶子，按公共前缀压缩后超过填充比例时先写出当前叶子
+//
+RC IX_BulkLoader::AppendEntry(const char *entry) {
+    RC rc;
+    IX_IndexHandle *indexHandle = state->indexHandle;
+    int entrySize = state->entrySize;
+    int n = state->nLeafEntries;
+
+    if (n > 0 &&
+        indexHandle->LeafSpace(&state->leafEntries[0], entry, n + 1) > state->nodeSpace &&
+        (rc = FlushLeaf())) {
+        return rc;
+    }
+
+    n = state->nLeafEntries;
+    state->leafEntries.resize((size_t)(n + 1) * entrySize);
+    memcpy(&state->leafEntries[(size_t)n * entrySize], entry, entrySize);
+    state->nLeafEntries++;
+
+    // 运行统计中的条目数，RID列表按其中的RID个数计
+    const char *ridField = entry + state->attrLength;
+    if (indexHandle->UsePostings() && indexHandle->IsPostingRef(ridField)) {
+        IX_PostingRef ref;
+        memcpy(&ref, ridField, sizeof(IX_PostingRef));
+        indexHandle->counters->nEntries += ref.numRIDs;
+    } else {
+        indexHandle->counters->nEntries++;
+    }
+
+    return OK;
+}
+
+//
+// FlushLeaf: 把攒下的条目写成一个新叶子，链接到上一个叶子的右边，
+// 并把两者之间的分隔键加入上一层
+//
+RC IX_BulkLoader::FlushLeaf() {
+    RC rc;
+    IX_IndexHandle *indexHandle = state->indexHandle;
+    PF_FileHandle *pfh = indexHandle->pfh;
+    int entrySize = state->entrySize;
+    int n = state->nLeafEntries;
+    const char *entries = &state->leafEntries[0];
+    PageNum newPage;
+    char *newData;
+
+    if ((rc = AllocateNode(true, newPage, newData))) {
+        return rc;
+    }
+    indexHandle->WriteLeaf(newData, entries, n);
+    state->nLeafEntries = 0;
+
+    if (state->leafData == NULL) {
+        // 第一个叶子
+        IX_BulkLoadLevel leafLevel;
+        leafLevel.firstPage = newPage;
+        leafLevel.curPage = newPage;
+        state->levels.push_back(leafLevel);
+    } else {
+        // 链接到上一个叶子的右边
+        PageNum prevPage = state->levels[0].curPage;
+        ((IX_NodeHdr *)state->leafData)->right = newPage;
+        ((IX_NodeHdr *)newData)->left = prevPage;
+        if ((rc = pfh->UnpinPage(prevPage))) {
+            pfh->UnpinPage(newPage);
+            state->leafData = NULL;
+            return rc;
+        }
+        state->levels[0].curPage = newPage;
+
+        // 上一个叶子最后的键和新叶子第一个键之间的分隔键加入上一层
+        vector<char> sep(state->attrLength);
+        indexHandle->MakeSeparator(&state->lastKey[0], entries, &sep[0]);
+        if ((rc = AddChild(1, &sep[0], newPage))) {
+            state->leafData = newData;
+            return rc;
+        }
+    }
+    state->leafData = newData;
+    memcpy(&state->lastKey[0], entries + (n - 1) * entrySize, state->attrLength);
+
+    return OK;
+}
+
+//
+// AddChild: 向第level层（>= 1）追加子节点childPage，key为它与左边子节点之间的分隔键
+//
+RC IX_BulkLoader::AddChild(int level, const char *key, PageNum childPage) {
+    RC rc;
+    IX_IndexHandle *indexHandle = state->indexHandle;
+    PF_FileHandle *pfh = indexHandle->pfh;
+    int attrLength = state->attrLength;
+    PF_PageHandle ph;
+    PageNum pageNum;
+    char *nodeData;
+
+    if (level == (int)state->levels.size()) {
+        // 这一层的第一个节点：最左边的子节点是下一层的第一个节点
+        if ((rc = AllocateNode(false, pageNum, nodeData))) {
+            return rc;
+        }
+        *(PageNum *)(nodeData + sizeof(IX_NodeHdr)) = state->levels[level - 1].firstPage;
+        IX_BulkLoadLevel newLevel;
+        newLevel.firstPage = pageNum;
+        newLevel.curPage = pageNum;
+        state->levels.push_back(newLevel);
+    } else {
+        pageNum = state->levels[level].curPage;
+        if ((rc = pfh->GetThisPage(pageNum, ph)) ||
+            (rc = ph.GetData(nodeData))) {
+            return rc;
+        }
+    }
+
+    // 加上新的分隔键后（分隔键可能变长）不超过填充比例时追加到当前节点
+    IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
+    int sepLength = max(nodeHdr->numKeys > 0 ? nodeHdr->sepLength : 0, indexHandle->SeparatorLength(key));
+    if (nodeHdr->numKeys == 0 ||
+        indexHandle->InternalSpace(sepLength, nodeHdr->numKeys + 1) <= state->nodeSpace) {
+        vector<char> keys;
+        vector<PageNum> children;
+        indexHandle->ReadInternal(nodeData, keys, children);
+        keys.insert(keys.end(), key, key + attrLength);
+        children.push_back(childPage);
+        indexHandle->WriteInternal(nodeData, &keys[0], &children[0], nodeHdr->numKeys + 1);
+        if ((rc = pfh->MarkDirty(pageNum)) ||
+            (rc = pfh->UnpinPage(pageNum))) {
+            return rc;
+        }
+        return OK;
+    }
+
+    // 当前节点已满：childPage成为新节点最左边的子节点，分隔键移到上一层
+    if ((rc = pfh->UnpinPage(pageNum))) {
+        return rc;
+    }
+    PageNum newPage;
+    char *newData;
+    if ((rc = AllocateNode(false, newPage, newData))) {
+        return rc;
+    }
+    *(PageNum *)(newData + sizeof(IX_NodeHdr)) = childPage;
+    state->levels[level].curPage = newPage;
+    if ((rc = pfh->UnpinPage(newPage))) {
+        return rc;
+    }
+
+    return AddChild(level + 1, key, newPage);
+}
+
+//
+// FinishTree: 释放最后一个叶子，把最上层的节点设为根并写回索引头，复制新的上层节点
+//
+RC IX_BulkLoader::FinishTree() {
+    RC rc;
+    IX_IndexHandle *indexHandle = state->indexHandle;
+
+    if ((rc = FlushDuplicates()) ||
+        (state->nLeafEntries > 0 && (rc = FlushLeaf()))) {
+        return rc;
+    }
+
+    if (state->levels.empty()) {
+        // 没有条目，索引保持为空
+        return OK;
+    }
+
+    rc = indexHandle->pfh->UnpinPage(state->levels[0].curPage);
+    state->leafData = NULL;
+    if (rc) {
+        return rc;
+    }
+
+    indexHandle->indexHdr.rootPage = state->levels.back().firstPage;
+    indexHandle->counters->height = (int)state->levels.size();
+    if ((rc = indexHandle->WriteHeader()) ||
+        (rc = indexHandle->RefreshTopCache())) {
+        return rc;
+    }
+    return OK;
+}
@@ -13,22 +13,26 @@ using namespace std;
 //
 // 错误信息数组
 //
+// 下标为返回码与START_IX_WARN/START_IX_ERR之差，下标0不使用
 static char *IX_WarnMsg[] = {
+    (char*)"",
     (char*)"索引条目未找到",
     (char*)"索引扫描结束",
+    (char*)"与并发的修改冲突，需要重新开始",
 };
 
 static char *IX_ErrorMsg[] = {
+    (char*)"",
     (char*)"索引未打开",
-    (char*)"索引已打开",  
     (char*)"扫描未打开",
     (char*)"扫描已打开",
     (char*)"bucket页已满",
     (char*)"空指针参数",
-    (char*)"无效的属性类型",
-    (char*)"无效的比较操作",
     (char*)"B+树结构无效",
-    (char*)"页面格式错误",
+    (char*)"无效索引规格",
+    (char*)"批量建立要求索引为空",
+    (char*)"外部排序临时文件读写失败",
+    (char*)"哈希索引不支持范围扫描",
 };
 
 //
@@ -38,7 +42,7 @@ void IX_PrintError(RC rc) {
     if (rc >= START_IX_WARN && rc <= IX_LASTWARN) {
         // 警告信息
         cerr << "IX警告: " << IX_WarnMsg[rc - START_IX_WARN] << endl;
-    } else if (rc >= START_IX_ERR && rc >= IX_LASTERROR) {
+    } else if (rc < START_IX_ERR && rc >= IX_LASTERROR) {
         // 错误信息  
         cerr << "IX错误: " << IX_ErrorMsg[START_IX_ERR - rc] << endl;
     } else {
@@ -53,7 +57,7 @@ void IX_PrintError(RC rc) {
 const char* IX_GetErrorString(RC rc) {
     if (rc >= START_IX_WARN && rc <= IX_LASTWARN) {
         return IX_WarnMsg[rc - START_IX_WARN];
-    } else if (rc >= START_IX_ERR && rc >= IX_LASTERROR) {
+    } else if (rc < START_IX_ERR && rc >= IX_LASTERROR) {
         return IX_ErrorMsg[START_IX_ERR - rc];
     } else {
         return "未知错误";
@@ -0,0 +1,629 @@
+//
+// ix_hash.cc: 可扩展哈希索引
+//
+// 只有等值条件的查询用B+树时每次都要从根下降到叶子；哈希索引的目录常驻内存，
+// 由键的哈希值直接找到bucket页，点查找只读一个页面。
+// 目录和bucket的组织见ix_internal.h。bucket页中的条目为(键值, RID)，不排序，
+// 插入时追加在末尾，删除时用最后一个条目填补空位
+//
+
+#include <algorithm>
+#include <cstring>
+#include "ix_internal.h"
+
+using namespace std;
+
+//
+// KeyHash64: 键的64位哈希值，与键比较的语义一致：
+// 字符串只取到第一个'\0'为止，0.0和-0.0得到相同的哈希值。Bloom过滤器也使用它
+//
+uint64_t IX_IndexHandle::KeyHash64(const void *pData) const {
+    uint64_t h = 14695981039346656037ULL;          // FNV-1a
+    const unsigned char *p = (const unsigned char *)pData;
+
+    for (int i = 0; i < keyDesc.nParts; i++) {
+        int length = keyDesc.lengths[i];
+        float f;
+        const unsigned char *bytes = p;
+        if (keyDesc.types[i] == STRING) {
+            length = (int)strnlen((const char *)p, keyDesc.lengths[i]);
+        } else if (keyDesc.types[i] == FLOAT) {
+            memcpy(&f, p, sizeof(float));
+            if (f == 0.0f) {
+                f = 0.0f;
+            }
+            bytes = (const unsigned char *)&f;
+        }
+        for (int j = 0; j < length; j++) {
+            h = (h ^ bytes[j]) * 1099511628211ULL;
+        }
+        h = (h ^ 0xFF) * 1099511628211ULL;         // 属性之间的分隔
+        p += keyDesc.lengths[i];
+    }
+
+    // 目录按低位选择bucket，把高位混合到低位
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+//
+// HashKey: 哈希索引的目录使用的哈希值（KeyHash64的低32位）
+//
+uint32_t IX_IndexHandle::HashKey(const void *pData) const {
+    return (uint32_t)KeyHash64(pData);
+}
+
+//
+// GetHashBucketCapacity: 每个bucket页（或溢出页）能放的条目数
+//
+int IX_IndexHandle::GetHashBucketCapacity() const {
+    return (int)((PF_PAGE_SIZE - sizeof(IX_HashBucketHdr)) / (indexHdr.attrLength + sizeof(RID)));
+}
+
+//
+// LoadHashDirectory: 打开索引时从dirPage开始读入目录
+//
+RC IX_IndexHandle::LoadHashDirectory(PageNum dirPage) {
+    RC rc;
+    IX_HashTable *table = hashTable;
+
+    table->directory.clear();
+    table->dirPages.clear();
+    if (dirPage == IX_NO_PAGE) {
+        return 0;
+    }
+
+    size_t nSlots = (size_t)1 << table->globalDepth;
+    table->directory.reserve(nSlots);
+    PageNum pageNum = dirPage;
+    while (table->directory.size() < nSlots) {
+        if (pageNum == IX_NO_PAGE) {
+            return IX_INVALIDTREE;
+        }
+
+        PF_PageHandle ph;
+        char *data;
+        if ((rc = pfh->GetThisPage(pageNum, ph))) {
+            return rc;
+        }
+        if ((rc = ph.GetData(data))) {
+            pfh->UnpinPage(pageNum);
+            return rc;
+        }
+        size_t n = min(nSlots - table->directory.size(), (size_t)IX_HASH_DIR_SLOTS);
+        const PageNum *slots = (const PageNum *)(data + sizeof(PageNum));
+        table->directory.insert(table->directory.end(), slots, slots + n);
+        table->dirPages.push_back(pageNum);
+
+        PageNum nextPage;
+        memcpy(&nextPage, data, sizeof(PageNum));
+        if ((rc = pfh->UnpinPage(pageNum))) {
+            return rc;
+        }
+        pageNum = nextPage;
+    }
+    return 0;
+}
+
+//
+// WriteHashDirectory: 写出目录项[firstSlot, lastSlot]所在的目录页，目录变长时先分配新的目录页
+//
+RC IX_IndexHandle::WriteHashDirectory(int firstSlot, int lastSlot) {
+    RC rc;
+    IX_HashTable *table = hashTable;
+
+    // 目录加倍后需要更多的目录页，原来的最后一页要链接到新的页面
+    size_t nPages = (table->directory.size() + IX_HASH_DIR_SLOTS - 1) / IX_HASH_DIR_SLOTS;
+    int firstPage = firstSlot / IX_HASH_DIR_SLOTS;
+    if (table->dirPages.size() < nPages && !table->dirPages.empty()) {
+        firstPage = min(firstPage, (int)table->dirPages.size() - 1);
+    }
+    while (table->dirPages.size() < nPages) {
+        PF_PageHandle ph;
+        PageNum pageNum;
+        if ((rc = AllocatePage(ph)) ||
+            (rc = ph.GetPageNum(pageNum))) {
+            return rc;
+        }
+        if ((rc = pfh->UnpinPage(pageNum))) {
+            return rc;
+        }
+        table->dirPages.push_back(pageNum);
+    }
+
+    int lastPage = lastSlot / IX_HASH_DIR_SLOTS;
+    for (int p = firstPage; p <= lastPage && p < (int)nPages; p++) {
+        PF_PageHandle ph;
+        char *data;
+        PageNum pageNum = table->dirPages[p];
+        if ((rc = pfh->GetThisPage(pageNum, ph))) {
+            return rc;
+        }
+        if ((rc = ph.GetData(data))) {
+            pfh->UnpinPage(pageNum);
+            return rc;
+        }
+
+        PageNum nextPage = (p + 1 < (int)nPages) ? table->dirPages[p + 1] : IX_NO_PAGE;
+        memcpy(data, &nextPage, sizeof(PageNum));
+        size_t first = (size_t)p * IX_HASH_DIR_SLOTS;
+        size_t n = min(table->directory.size() - first, (size_t)IX_HASH_DIR_SLOTS);
+        memcpy(data + sizeof(PageNum), &table->directory[first], n * sizeof(PageNum));
+
+        if ((rc = pfh->MarkDirty(pageNum)) ||
+            (rc = pfh->UnpinPage(pageNum))) {
+            return rc;
+        }
+    }
+    return 0;
+}
+
+//
+// CreateHashDirectory: 第一次插入时建立只有一项的目录和一个空bucket
+//
+RC IX_IndexHandle::CreateHashDirectory() {
+    RC rc;
+    PageNum bucketPage;
+
+    if ((rc = AllocateHashPage(0, bucketPage))) {
+        return rc;
+    }
+    hashTable->globalDepth = 0;
+    hashTable->directory.assign(1, bucketPage);
+    if ((rc = WriteHashDirectory(0, 0)) ||
+        (rc = WriteHeader())) {
+        return rc;
+    }
+    return 0;
+}
+
+//
+// AllocateHashPage: 分配一个空的bucket页
+//
+RC IX_IndexHandle::AllocateHashPage(int localDepth, PageNum &pageNum) {
+    RC rc;
+    PF_PageHandle ph;
+    char *data;
+
+    if ((rc = AllocatePage(ph)) ||
+        (rc = ph.GetPageNum(pageNum))) {
+        return rc;
+    }
+    if ((rc = ph.GetData(data))) {
+        pfh->UnpinPage(pageNum);
+        return rc;
+    }
+
+    IX_HashBucketHdr *bucketHdr = (IX_HashBucketHdr *)data;
+    bucketHdr->localDepth = localDepth;
+    bucketHdr->numEntries = 0;
+    bucketHdr->overflow = IX_NO_PAGE;
+    counters->nLeafPages++;
+
+    if ((rc = pfh->MarkDirty(pageNum)) ||
+        (rc = pfh->UnpinPage(pageNum))) {
+        return rc;
+    }
+    return 0;
+}
+
+//
+// HashInsert: 插入(键值, RID)。bucket已满时，如果其中有哈希值与新键不同的条目就分裂后重试，
+// 否则分裂也分不开，追加到溢出页
+//
+RC IX_IndexHandle::HashInsert(const void *pData, const RID &rid) {
+    RC rc;
+    int attrLength = indexHdr.attrLength;
+    int entrySize = attrLength + (int)sizeof(RID);
+    int capacity = GetHashBucketCapacity();
+
+    if (hashTable->directory.empty() && (rc = CreateHashDirectory())) {
+        return rc;
+    }
+
+    vector<char> entry(entrySize);
+    memcpy(entry.data(), pData, attrLength);
+    memcpy(entry.data() + attrLength, &rid, sizeof(RID));
+
+    uint32_t hash = HashKey(pData);
+    counters->nProbes++;
+    while (true) {
+        int slot = (int)(hash & (((uint32_t)1 << hashTable->globalDepth) - 1));
+        PageNum pageNum = hashTable->directory[slot];
+        counters->nProbePages++;
+
+        PF_PageHandle ph;
+        char *data;
+        if ((rc = pfh->GetThisPage(pageNum, ph))) {
+            return rc;
+        }
+        if ((rc = ph.GetData(data))) {
+            pfh->UnpinPage(pageNum);
+            return rc;
+        }
+        IX_HashBucketHdr *bucketHdr = (IX_HashBucketHdr *)data;
+        char *entries = data + sizeof(IX_HashBucketHdr);
+
+        // bucket页还有空间：直接追加
+        if (bucketHdr->numEntries < capacity) {
+            memcpy(entries + bucketHdr->numEntries * entrySize, entry.data(), entrySize);
+            bucketHdr->numEntries++;
+            if ((rc = pfh->MarkDirty(pageNum)) ||
+                (rc = pfh->UnpinPage(pageNum))) {
+                return rc;
+            }
+            return 0;
+        }
+
+        bool bSplit = false;
+        if (bucketHdr->localDepth < IX_HASH_MAX_DEPTH) {
+            for (int i = 0; i < bucketHdr->numEntries && !bSplit; i++) {
+                bSplit = (HashKey(entries + i * entrySize) != hash);
+            }
+        }
+        if ((rc = pfh->UnpinPage(pageNum))) {
+            return rc;
+        }
+
+        if (!bSplit) {
+            return AppendToHashChain(pageNum, entry.data());
+        }
+        if ((rc = SplitHashBucket(slot))) {
+            return rc;
+        }
+    }
+}
+
+//
+// AppendToHashChain: 把条目加入bucket的第一个有空间的溢出页，都满时在链尾分配新的溢出页
+//
+RC IX_IndexHandle::AppendToHashChain(PageNum pageNum, const char *entry) {
+    RC rc;
+    int entrySize = indexHdr.attrLength + (int)sizeof(RID);
+    int capacity = GetHashBucketCapacity();
+
+    while (true) {
+        PF_PageHandle ph;
+        char *data;
+        counters->nProbePages++;
+        if ((rc = pfh->GetThisPage(pageNum, ph))) {
+            return rc;
+        }
+        if ((rc = ph.GetData(data))) {
+            pfh->UnpinPage(pageNum);
+            return rc;
+        }
+        IX_HashBucketHdr *bucketHdr = (IX_HashBucketHdr *)data;
+
+        if (bucketHdr->numEntries >= capacity && bucketHdr->overflow == IX_NO_PAGE) {
+            PageNum newPage;
+            if ((rc = AllocateHashPage(bucketHdr->localDepth, newPage))) {
+                pfh->UnpinPage(pageNum);
+                return rc;
+            }
+            bucketHdr->overflow = newPage;
+            if ((rc = pfh->MarkDirty(pageNum))) {
+                pfh->UnpinPage(pageNum);
+                return rc;
+            }
+        }
+
+        if (bucketHdr->numEntries < capacity) {
+            memcpy(data + sizeof(IX_HashBucketHdr) + bucketHdr->numEntries * entrySize,
+                   entry, entrySize);
+            bucketHdr->numEntries++;
+            if ((rc = pfh->MarkDirty(pageNum)) ||
+                (rc = pfh->UnpinPage(pageNum))) {
+                return rc;
+            }
+            return 0;
+        }
+
+        PageNum nextPage = bucketHdr->overflow;
+        if ((rc = pfh->UnpinPage(pageNum))) {
+            return rc;
+        }
+        pageNum = nextPage;
+    }
+}
+
+//
+// SplitHashBucket: 把目录项slot指向的bucket按哈希值的第localDepth位分成两个，
+// localDepth等于globalDepth时先把目录加倍。原来的溢出页在重新写入两个bucket时复用
+//
+RC IX_IndexHandle::SplitHashBucket(int slot) {
+    RC rc;
+    IX_HashTable *table = hashTable;
+    int entrySize = indexHdr.attrLength + (int)sizeof(RID);
+    PageNum pageNum = table->directory[slot];
+
+    int localDepth;
+    vector<char> entries;
+    vector<PageNum> sparePages;
+    if ((rc = ReadHashChain(pageNum, NULL, localDepth, entries, &sparePages))) {
+        return rc;
+    }
+
+    // 目录加倍：后一半与前一半相同
+    int firstSlot = (int)table->directory.size();
+    int lastSlot = -1;
+    if (localDepth == table->globalDepth) {
+        size_t nSlots = table->directory.size();
+        table->directory.resize(nSlots * 2);
+        copy(table->directory.begin(), table->directory.begin() + nSlots,
+             table->directory.begin() + nSlots);
+        table->globalDepth++;
+        firstSlot = (int)nSlots;
+        lastSlot = (int)(nSlots * 2 - 1);
+    }
+
+    // 按第localDepth位分开条目
+    uint32_t bit = (uint32_t)1 << localDepth;
+    int nEntries = (int)(entries.size() / entrySize);
+    vector<char> stay, moved;
+    for (int i = 0; i < nEntries; i++) {
+        const char *entry = &entries[(size_t)i * entrySize];
+        vector<char> &part = (HashKey(entry) & bit) ? moved : stay;
+        part.insert(part.end(), entry, entry + entrySize);
+    }
+
+    PageNum newPage;
+    if ((rc = AllocateHashPage(localDepth + 1, newPage)) ||
+        (rc = WriteHashChain(pageNum, localDepth + 1, stay.data(),
+                             (int)(stay.size() / entrySize), sparePages)) ||
+        (rc = WriteHashChain(newPage, localDepth + 1, moved.data(),
+                             (int)(moved.size() / entrySize), sparePages))) {
+        return rc;
+    }
+    for (size_t i = 0; i < sparePages.size(); i++) {
+        if ((rc = DisposePage(sparePages[i]))) {
+            return rc;
+        }
+        counters->nLeafPages--;
+    }
+    counters->nSplits++;
+
+    // 原来指向这个bucket、第localDepth位为1的目录项改为指向新的bucket
+    for (int j = slot & (int)(bit - 1); j < (int)table->directory.size(); j += (int)bit) {
+        if (j & bit) {
+            table->directory[j] = newPage;
+            firstSlot = min(firstSlot, j);
+            lastSlot = max(lastSlot, j);
+        }
+    }
+
+    if ((rc = WriteHashDirectory(firstSlot, lastSlot)) ||
+        (rc = WriteHeader())) {
+        return rc;
+    }
+    return 0;
+}
+
+//
+// ReadHashChain: 读出从pageNum开始的bucket链中的条目（pData不为NULL时只取键值等于pData的条目），
+// 追加到entries。overflowPages不为NULL时记下各溢出页的页号
+//
+RC IX_IndexHandle::ReadHashChain(PageNum pageNum, const void *pData, int &localDepth,
+                                 vector<char> &entries, vector<PageNum> *overflowPages) {
+    RC rc;
+    int entrySize = indexHdr.attrLength + (int)sizeof(RID);
+    bool bFirst = true;
+
+    while (pageNum != IX_NO_PAGE) {
+        PF_PageHandle ph;
+        char *data;
+        if ((rc = pfh->GetThisPage(pageNum, ph))) {
+            return rc;
+        }
+        if ((rc = ph.GetData(data))) {
+            pfh->UnpinPage(pageNum);
+            return rc;
+        }
+        const IX_HashBucketHdr *bucketHdr = (const IX_HashBucketHdr *)data;
+        const char *pageEntries = data + sizeof(IX_HashBucketHdr);
+
+        if (bFirst) {
+            localDepth = bucketHdr->localDepth;
+        } else if (overflowPages != NULL) {
+            overflowPages->push_back(pageNum);
+        }
+        if (pData == NULL) {
+            entries.insert(entries.end(), pageEntries,
+                           pageEntries + (size_t)bucketHdr->numEntries * entrySize);
+        } else {
+            for (int i = 0; i < bucketHdr->numEntries; i++) {
+                const char *entry = pageEntries + (size_t)i * entrySize;
+                if (keyOps->compare(pData, entry, &keyDesc) == 0) {
+                    entries.insert(entries.end(), entry, entry + entrySize);
+                }
+            }
+        }
+
+        PageNum nextPage = bucketHdr->overflow;
+        if ((rc = pfh->UnpinPage(pageNum))) {
+            return rc;
+        }
+        pageNum = nextPage;
+        bFirst = false;
+    }
+    return 0;
+}
+
+//
+// WriteHashChain: 把nEntries个条目写入从pageNum开始的bucket链，
+// 一页放不下时优先使用sparePages中的页面作为溢出页（用掉的从sparePages中移除）
+//
+RC IX_IndexHandle::WriteHashChain(PageNum pageNum, int localDepth, const char *entries,
+                                  int nEntries, vector<PageNum> &sparePages) {
+    RC rc;
+    int entrySize = indexHdr.attrLength + (int)sizeof(RID);
+    int capacity = GetHashBucketCapacity();
+    int pos = 0;
+
+    while (pageNum != IX_NO_PAGE) {
+        int n = min(capacity, nEntries - pos);
+        PageNum nextPage = IX_NO_PAGE;
+        if (pos + n < nEntries) {
+            if (!sparePages.empty()) {
+                nextPage = sparePages.back();
+                sparePages.pop_back();
+            } else if ((rc = AllocateHashPage(localDepth, nextPage))) {
+                return rc;
+            }
+        }
+
+        PF_PageHandle ph;
+        char *data;
+        if ((rc = pfh->GetThisPage(pageNum, ph))) {
+            return rc;
+        }
+        if ((rc = ph.GetData(data))) {
+            pfh->UnpinPage(pageNum);
+            return rc;
+        }
+        IX_HashBucketHdr *bucketHdr = (IX_HashBucketHdr *)data;
+        bucketHdr->localDepth = localDepth;
+        bucketHdr->numEntries = n;
+        bucketHdr->overflow = nextPage;
+        memcpy(data + sizeof(IX_HashBucketHdr), entries + (size_t)pos * entrySize,
+               (size_t)n * entrySize);
+        if ((rc = pfh->MarkDirty(pageNum)) ||
+            (rc = pfh->UnpinPage(pageNum))) {
+            return rc;
+        }
+
+        pos += n;
+        pageNum = nextPage;
+    }
+    return 0;
+}
+
+//
+// HashDelete: 删除(键值, RID)，用本页最后一个条目填补空位，溢出页变空时从链中摘下并释放
+//
+RC IX_IndexHandle::HashDelete(const void *pData, const RID &rid) {
+    RC rc;
+    int attrLength = indexHdr.attrLength;
+    int entrySize = attrLength + (int)sizeof(RID);
+
+    if (hashTable->directory.empty()) {
+        return IX_ENTRYNOTFOUND;
+    }
+
+    uint32_t hash = HashKey(pData);
+    PageNum pageNum = hashTable->directory[hash & (((uint32_t)1 << hashTable->globalDepth) - 1)];
+    PageNum prevPage = IX_NO_PAGE;
+    counters->nProbes++;
+    while (pageNum != IX_NO_PAGE) {
+        PF_PageHandle ph;
+        char *data;
+        counters->nProbePages++;
+        if ((rc = pfh->GetThisPage(pageNum, ph))) {
+            return rc;
+        }
+        if ((rc = ph.GetData(data))) {
+            pfh->UnpinPage(pageNum);
+            return rc;
+        }
+        IX_HashBucketHdr *bucketHdr = (IX_HashBucketHdr *)data;
+        char *entries = data + sizeof(IX_HashBucketHdr);
+
+        int i = 0;
+        while (i < bucketHdr->numEntries) {
+            char *entry = entries + i * entrySize;
+            RID entryRid;
+            memcpy((char *)&entryRid, entry + attrLength, sizeof(RID));
+            if (entryRid == rid && keyOps->compare(pData, entry, &keyDesc) == 0) {
+                break;
+            }
+            i++;
+        }
+
+        PageNum nextPage = bucketHdr->overflow;
+        if (i < bucketHdr->numEntries) {
+            bucketHdr->numEntries--;
+            memmove(entries + i * entrySize, entries + bucketHdr->numEntries * entrySize,
+                    entrySize);
+            bool bFree = (prevPage != IX_NO_PAGE && bucketHdr->numEntries == 0);
+            if ((rc = pfh->MarkDirty(pageNum)) ||
+                (rc = pfh->UnpinPage(pageNum))) {
+                return rc;
+            }
+            if (!bFree) {
+                return 0;
+            }
+
+            // 从链中摘下变空的溢出页
+            if ((rc = pfh->GetThisPage(prevPage, ph))) {
+                return rc;
+            }
+            if ((rc = ph.GetData(data))) {
+                pfh->UnpinPage(prevPage);
+                return rc;
+            }
+            ((IX_HashBucketHdr *)data)->overflow = nextPage;
+            if ((rc = pfh->MarkDirty(prevPage)) ||
+                (rc = pfh->UnpinPage(prevPage))) {
+                return rc;
+            }
+            counters->nLeafPages--;
+            return DisposePage(pageNum);
+        }
+
+        if ((rc = pfh->UnpinPage(pageNum))) {
+            return rc;
+        }
+        prevPage = pageNum;
+        pageNum = nextPage;
+    }
+    return IX_ENTRYNOTFOUND;
+}
+
+//
+// HashLookup: 键值等于pData的所有RID
+//
+RC IX_IndexHandle::HashLookup(const void *pData, vector<RID> &rids) {
+    RC rc;
+    int attrLength = indexHdr.attrLength;
+    int entrySize = attrLength + (int)sizeof(RID);
+
+    if (hashTable->directory.empty()) {
+        return 0;
+    }
+
+    uint32_t hash = HashKey(pData);
+    PageNum pageNum = hashTable->directory[hash & (((uint32_t)1 << hashTable->globalDepth) - 1)];
+    counters->nProbes++;
+    while (pageNum != IX_NO_PAGE) {
+        PF_PageHandle ph;
+        char *data;
+        counters->nProbePages++;
+        if ((rc = pfh->GetThisPage(pageNum, ph))) {
+            return rc;
+        }
+        if ((rc = ph.GetData(data))) {
+            pfh->UnpinPage(pageNum);
+            return rc;
+        }
+        const IX_HashBucketHdr *bucketHdr = (const IX_HashBucketHdr *)data;
+        const char *entries = data + sizeof(IX_HashBucketHdr);
+
+        for (int i = 0; i < bucketHdr->numEntries; i++) {
+            const char *entry = entries + i * entrySize;
+            if (keyOps->compare(pData, entry, &keyDesc) == 0) {
+                RID rid;
+                memcpy((char *)&rid, entry + attrLength, sizeof(RID));
+                rids.push_back(rid);
+            }
+        }
+
+        PageNum nextPage = bucketHdr->overflow;
+        if ((rc = pfh->UnpinPage(pageNum))) {
+            return rc;
+        }
+        pageNum = nextPage;
+    }
+    return 0;
+}
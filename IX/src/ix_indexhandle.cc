@@ -17,6 +17,16 @@ using namespace std;
 IX_IndexHandle::IX_IndexHandle() {
     isOpenHandle = FALSE;
     pfh = NULL;
+    keyDesc.nParts = 0;
+    keyDesc.keyLength = 0;
+    keyDesc.includeLength = 0;
+    keyOps = NULL;
+    latches = NULL;
+    topCacheBudget = 0;
+    hashTable = NULL;
+    msgBuffer = NULL;
+    counters = NULL;
+    bloom = NULL;
 }
 
 //
@@ -31,11 +41,12 @@ IX_IndexHandle::~IX_IndexHandle() {
 
 //
 // InsertEntry: 向索引中插入一个条目
-// 输入: pData - 指向属性值的指针
-//       rid   - 记录标识符
+// 输入: pData   - 指向属性值的指针
+//       rid     - 记录标识符
+//       payload - 附带的数据（keyDesc.includeLength字节），NULL时填零
 // 返回: RC码
 //
-RC IX_IndexHandle::InsertEntry(void *pData, const RID &rid) {
+RC IX_IndexHandle::InsertEntry(void *pData, const RID &rid, const void *payload) {
     RC rc;
     
     // 检查句柄是否打开
@@ -48,20 +59,80 @@ RC IX_IndexHandle::InsertEntry(void *pData, const RID &rid) {
         return IX_NULLPOINTER;
     }
     
+    // 带Bloom过滤器的索引先把键值加入过滤器，再修改索引
+    if (bloom != NULL && (rc = AddToBloomFilter(pData))) {
+        return rc;
+    }
+    
+    // 哈希索引：持有文件头页的锁，插入bucket
+    if (hashTable != NULL) {
+        LockNode(IX_HEADER_PAGE);
+        rc = HashInsert(pData, rid);
+        UnlockNode(IX_HEADER_PAGE, false);
+        if (rc == 0) {
+            counters->nEntries++;
+        }
+        return rc;
+    }
+    
+    // 带写缓冲的B+树：记入消息缓冲区，攒够后按键值顺序写入叶子
+    if (msgBuffer != NULL) {
+        return BufferMessage(IX_MSG_INSERT, pData, rid, payload);
+    }
+    
+    return InsertIntoTree(pData, rid, payload);
+}
+
+//
+// InsertIntoTree: 把条目插入B+树
+//
+RC IX_IndexHandle::InsertIntoTree(const void *pData, const RID &rid, const void *payload) {
+    RC rc;
+    
+    // 组装叶子条目：键值、RID、附带数据
+    char *entry = new char[GetLeafEntrySize()];
+    memcpy(entry, pData, indexHdr.attrLength);
+    memcpy(entry + indexHdr.attrLength, &rid, sizeof(RID));
+    if (keyDesc.includeLength > 0) {
+        if (payload != NULL) {
+            memcpy(entry + indexHdr.attrLength + sizeof(RID), payload, keyDesc.includeLength);
+        } else {
+            memset(entry + indexHdr.attrLength + sizeof(RID), 0, keyDesc.includeLength);
+        }
+    }
+    
+    // 叶子放得下时只修改这个叶子，不影响并发的查找和别的叶子上的插入
+    rc = InsertIntoLeafOptimistic(entry);
+    if (rc != IX_RESTART) {
+        delete[] entry;
+        if (rc == 0) {
+            counters->nEntries++;
+        }
+        return rc;
+    }
+    
+    // 需要分裂或索引为空：持有文件头页的写锁，与别的结构修改串行化
+    LockNode(IX_HEADER_PAGE);
+    PageNum oldRootPage = indexHdr.rootPage;
+    
+    // 空索引：先创建一个空的叶子节点作为根
+    rc = 0;
+    if (indexHdr.rootPage == IX_NO_PAGE) {
+        rc = CreateEmptyRoot();
+    }
+    
     // 从根节点开始插入
     bool wasSplit = false;
     void *newChildKey = NULL;
     PageNum newChildPage = IX_NO_PAGE;
     
     // 分配临时缓冲区用于可能的分裂操作
-    if (indexHdr.attrType == STRING) {
-        newChildKey = new char[indexHdr.attrLength];
-    } else {
-        newChildKey = new char[sizeof(int)]; // 假设最大为int大小
-    }
+    newChildKey = new char[indexHdr.attrLength];
     
     // 递归插入
-    rc = InsertIntoNode(indexHdr.rootPage, pData, rid, wasSplit, newChildKey, newChildPage);
+    if (rc == 0) {
+        rc = InsertIntoNode(indexHdr.rootPage, entry, wasSplit, newChildKey, newChildPage);
+    }
     
     // 如果根节点分裂，需要创建新的根节点
     if (rc == 0 && wasSplit) {
@@ -70,12 +141,20 @@ RC IX_IndexHandle::InsertEntry(void *pData, const RID &rid) {
     
     // 清理临时内存
     delete[] (char*)newChildKey;
+    delete[] entry;
     
-    // 更新头信息并写回磁盘
+    // 更新头信息并写回磁盘，换上新的上层节点副本
     if (rc == 0) {
         rc = WriteHeader();
     }
+    if (rc == 0) {
+        rc = RefreshTopCache();
+    }
+    if (rc == 0) {
+        counters->nEntries++;
+    }
     
+    UnlockNode(IX_HEADER_PAGE, indexHdr.rootPage != oldRootPage);
     return rc;
 }
 
@@ -98,14 +177,73 @@ RC IX_IndexHandle::DeleteEntry(void *pData, const RID &rid) {
         return IX_NULLPOINTER;
     }
     
-    // 从根节点开始删除
-    rc = DeleteFromNode(indexHdr.rootPage, pData, rid);
+    if (hashTable != NULL) {
+        LockNode(IX_HEADER_PAGE);
+        rc = HashDelete(pData, rid);
+        UnlockNode(IX_HEADER_PAGE, false);
+        if (rc == 0) {
+            counters->nEntries--;
+        }
+    } else if (msgBuffer != NULL) {
+        // 带写缓冲的B+树：删除也作为消息记入缓冲区，不检查条目是否存在
+        rc = BufferMessage(IX_MSG_DELETE, pData, rid, NULL);
+    } else {
+        rc = DeleteFromTree(pData, rid);
+    }
     
-    // 更新头信息
+    // 删除不清除Bloom过滤器中的位，只记下次数，过多时重新建立过滤器
+    if (rc == 0 && bloom != NULL) {
+        bloom->nStale++;
+    }
+    return rc;
+}
+
+//
+// DeleteFromTree: 从B+树中删除条目
+//
+RC IX_IndexHandle::DeleteFromTree(void *pData, const RID &rid) {
+    RC rc;
+    
+    // 删除后叶子不会过空时只修改这个叶子
+    rc = DeleteFromLeafOptimistic(pData, rid);
+    if (rc != IX_RESTART) {
+        if (rc == 0) {
+            counters->nEntries--;
+        }
+        return rc;
+    }
+    
+    // 可能要合并节点：持有文件头页的写锁，与别的结构修改串行化
+    LockNode(IX_HEADER_PAGE);
+    PageNum oldRootPage = indexHdr.rootPage;
+    
+    // 空索引
+    if (indexHdr.rootPage == IX_NO_PAGE) {
+        UnlockNode(IX_HEADER_PAGE, false);
+        return IX_ENTRYNOTFOUND;
+    }
+    
+    // 从根节点开始删除，过空的节点在返回途中与兄弟节点合并或重新分配
+    bool bUnderflow = false;
+    rc = DeleteFromNode(indexHdr.rootPage, pData, rid, bUnderflow);
+    
+    // 根节点只剩一个子节点时降低树的高度
+    if (rc == 0) {
+        rc = ShrinkRoot();
+    }
+    
+    // 更新头信息，换上新的上层节点副本
     if (rc == 0) {
         rc = WriteHeader();
     }
+    if (rc == 0) {
+        rc = RefreshTopCache();
+    }
+    if (rc == 0) {
+        counters->nEntries--;
+    }
     
+    UnlockNode(IX_HEADER_PAGE, indexHdr.rootPage != oldRootPage);
     return rc;
 }
 
@@ -121,8 +259,8 @@ RC IX_IndexHandle::ForcePages() {
         return IX_INDEXNOTOPEN;
     }
     
-    // 调用PF的ForcePages
-    if ((rc = pfh->ForcePages())) {
+    // 带写缓冲的B+树先把缓冲的消息写入B+树，再调用PF的ForcePages
+    if ((rc = FlushMessages()) || (rc = pfh->ForcePages())) {
         return rc;
     }
     
@@ -131,9 +269,9 @@ RC IX_IndexHandle::ForcePages() {
 
 //
 // InsertIntoNode: 递归地向B+树节点插入条目
-// 这是插入操作的核心递归函数
+// 这是插入操作的核心递归函数，entry为完整的叶子条目（以键值开头）
 //
-RC IX_IndexHandle::InsertIntoNode(PageNum pageNum, void *pData, const RID &rid,
+RC IX_IndexHandle::InsertIntoNode(PageNum pageNum, const char *entry,
                                  bool &wasSplit, void *&newChildKey, PageNum &newChildPage) {
     RC rc;
     PF_PageHandle ph;
@@ -150,69 +288,102 @@ RC IX_IndexHandle::InsertIntoNode(PageNum pageNum, void *pData, const RID &rid,
         return rc;
     }
     
+    // 下降路径上的节点都加写锁，直到子节点的分裂反映到本节点中
+    LockNode(pageNum);
     nodeHdr = (IX_NodeHdr *)nodeData;
+    bool bModified = nodeHdr->isLeaf;
     
     if (nodeHdr->isLeaf) {
         // 叶子节点：直接插入
-        rc = InsertIntoLeaf(pageNum, nodeData, pData, rid, wasSplit, newChildKey, newChildPage);
+        rc = InsertIntoLeaf(pageNum, nodeData, entry, true, wasSplit, newChildKey, newChildPage);
     } else {
-        // 内部节点：找到子节点并递归插入
-        PageNum childPage;
-        rc = FindChildPage(nodeData, pData, childPage);
+        // 内部节点：找到子节点并递归插入（与分隔键相等时进入右边的子节点）
+        int childNo = SearchNode(nodeData, entry, true);
+        PageNum childPage = GetChildPage(nodeData, childNo);
         
-        if (rc == 0) {
-            bool childSplit = false;
-            void *childKey = NULL;
-            PageNum childNewPage = IX_NO_PAGE;
-            
-            // 分配键值缓冲区
-            if (indexHdr.attrType == STRING) {
-                childKey = new char[indexHdr.attrLength];
-            } else {
-                childKey = new char[sizeof(int)];
-            }
-            
-            // 递归插入到子节点
-            rc = InsertIntoNode(childPage, pData, rid, childSplit, childKey, childNewPage);
-            
-            // 如果子节点分裂，需要在当前节点插入新的键值-页面对
-            if (rc == 0 && childSplit) {
-                rc = InsertIntoInternal(nodeData, childKey, childNewPage, wasSplit, newChildKey, newChildPage);
-            }
-            
-            delete[] (char*)childKey;
+        bool childSplit = false;
+        void *childKey = NULL;
+        PageNum childNewPage = IX_NO_PAGE;
+        
+        // 分配键值缓冲区
+        childKey = new char[indexHdr.attrLength];
+        
+        // 递归插入到子节点
+        rc = InsertIntoNode(childPage, entry, childSplit, childKey, childNewPage);
+        
+        // 如果子节点分裂，需要在当前节点紧跟该子节点插入新的键值-页面对
+        if (rc == 0 && childSplit) {
+            rc = InsertIntoInternal(nodeData, childNo, childKey, childNewPage, wasSplit, newChildKey, newChildPage);
+            bModified = true;
         }
+        
+        delete[] (char*)childKey;
     }
     
     // 如果节点被修改，标记为脏页
-    if (rc == 0 && (wasSplit || nodeHdr->isLeaf)) {
+    if (rc == 0 && bModified) {
         pfh->MarkDirty(pageNum);
     }
     
+    UnlockNode(pageNum, bModified);
     pfh->UnpinPage(pageNum);
     return rc;
 }
 
 //
 // InsertIntoLeaf: 向叶子节点插入条目
+// bCanSplit为false时（只修改叶子的插入）需要分裂则返回IX_RESTART，叶子保持不变
 //
-RC IX_IndexHandle::InsertIntoLeaf(PageNum currentPageNum, char *nodeData, void *pData, const RID &rid,
-                                 bool &wasSplit, void *&newChildKey, PageNum &newChildPage) {
+RC IX_IndexHandle::InsertIntoLeaf(PageNum currentPageNum, char *nodeData, const char *entry,
+                                 bool bCanSplit, bool &wasSplit, void *&newChildKey, PageNum &newChildPage) {
     RC rc = 0;
     IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
     
-    // 计算叶子节点的最大条目数
-    int maxEntries = GetMaxLeafEntries();
+    // 重复的键：叶子中已有该键的RID列表时加入列表，
+    // 相等的条目足够多时合并为RID列表，这两种情况都不需要分裂
+    if (UsePostings()) {
+        int firstPos = SearchNode(nodeData, entry, false);
+        int nDups = 0;
+        RID rid;
+        memcpy((char *)&rid, entry + indexHdr.attrLength, sizeof(RID));
+        
+        while (firstPos + nDups < nodeHdr->numKeys &&
+               CompareLeafKey(entry, nodeData, firstPos + nDups) == 0) {
+            char *ridField = LeafRidField(nodeData, firstPos + nDups);
+            if (IsPostingRef(ridField)) {
+                wasSplit = false;
+                return InsertIntoPosting(ridField, rid);
+            }
+            nDups++;
+        }
+        if (nDups + 1 >= GetPostingThreshold()) {
+            wasSplit = false;
+            return ConvertToPosting(nodeData, firstPos, nDups, rid);
+        }
+    }
+    
+    // 新键带有叶子的公共前缀并且放得下时直接插入
+    if (LeafHasRoom(nodeData, entry)) {
+        wasSplit = false;
+        return InsertEntryIntoLeaf(nodeData, entry);
+    }
     
-    // 检查是否需要分裂
-    if (nodeHdr->numKeys >= maxEntries) {
-        // 需要分裂叶子节点
-        rc = SplitLeafNode(currentPageNum, nodeData, pData, rid, wasSplit, newChildKey, newChildPage);
-    } else {
-        // 直接插入到叶子节点
-        rc = InsertEntryIntoLeaf(nodeData, pData, rid);
+    // 否则按新的公共前缀重写叶子，仍然放不下时分裂
+    int entrySize = GetLeafEntrySize();
+    int insertPos = SearchNode(nodeData, entry, false);
+    vector<char> entries;
+    ReadLeaf(nodeData, entries);
+    entries.insert(entries.begin() + (size_t)insertPos * entrySize, entry, entry + entrySize);
+    
+    if (WriteLeaf(nodeData, &entries[0], nodeHdr->numKeys + 1)) {
         wasSplit = false;
+        return 0;
+    }
+    if (!bCanSplit) {
+        return IX_RESTART;
     }
+    rc = SplitLeafNode(currentPageNum, nodeData, &entries[0], nodeHdr->numKeys + 1,
+                       wasSplit, newChildKey, newChildPage);
     
     return rc;
 }
@@ -225,35 +396,25 @@ RC IX_IndexHandle::InsertIntoLeaf(PageNum currentPageNum, char *nodeData, void *
 // 2. 移动后面的条目为新条目腾出空间
 // 3. 插入新条目
 //
-RC IX_IndexHandle::InsertEntryIntoLeaf(char *nodeData, void *pData, const RID &rid) {
+RC IX_IndexHandle::InsertEntryIntoLeaf(char *nodeData, const char *entry) {
     IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
-    char *entries = nodeData + sizeof(IX_NodeHdr);
     
-    int entrySize = GetLeafEntrySize();
-    int insertPos = 0;
-    
-    // 找到插入位置（保持排序）
-    for (int i = 0; i < nodeHdr->numKeys; i++) {
-        char *currentEntry = entries + i * entrySize;
-        if (CompareKeys(pData, currentEntry) <= 0) {
-            insertPos = i;
-            break;
-        }
-        insertPos = i + 1;
-    }
+    // 条目中不保存公共前缀
+    int prefixLength = nodeHdr->prefixLength;
+    int stride = GetLeafEntrySize() - prefixLength;
+    
+    // 二分查找插入位置（保持排序，放在相等键之前）
+    int insertPos = SearchNode(nodeData, entry, false);
+    char *insertPoint = LeafEntry(nodeData, insertPos);
     
     // 移动后面的条目为新条目腾出空间
     if (insertPos < nodeHdr->numKeys) {
-        char *insertPoint = entries + insertPos * entrySize;
-        char *nextPoint = entries + (insertPos + 1) * entrySize;
-        int moveSize = (nodeHdr->numKeys - insertPos) * entrySize;
-        memmove(nextPoint, insertPoint, moveSize);
+        int moveSize = (nodeHdr->numKeys - insertPos) * stride;
+        memmove(insertPoint + stride, insertPoint, moveSize);
     }
     
     // 插入新条目
-    char *newEntry = entries + insertPos * entrySize;
-    memcpy(newEntry, pData, indexHdr.attrLength);
-    memcpy(newEntry + indexHdr.attrLength, &rid, sizeof(RID));
+    memcpy(insertPoint, entry + prefixLength, stride);
     
     nodeHdr->numKeys++;
     
@@ -261,16 +422,25 @@ RC IX_IndexHandle::InsertEntryIntoLeaf(char *nodeData, void *pData, const RID &r
 }
 
 //
-// SplitLeafNode: 分裂叶子节点
+// SplitLeafNode: 把nEntries个有序的完整条目（已包含新条目）分到原叶子和一个新的右兄弟中
+// 分裂点尽量靠近中间，但两边都要能按各自的公共前缀放下；
+// 新键与原有的键没有公共前缀时，可能要把它单独分出去
 //
-RC IX_IndexHandle::SplitLeafNode(PageNum currentPageNum, char *nodeData, void *pData, const RID &rid,
+RC IX_IndexHandle::SplitLeafNode(PageNum currentPageNum, char *nodeData, const char *entries, int nEntries,
                                 bool &wasSplit, void *&newChildKey, PageNum &newChildPage) {
     RC rc;
     IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
     
+    // 计算分裂点：从中间开始向两边找第一个两边都放得下的位置
+    int entrySize = GetLeafEntrySize();
+    int splitPoint = ChooseLeafSplit(entries, nEntries);
+    if (splitPoint < 0) {
+        return IX_INVALIDTREE;
+    }
+    
     // 分配新页面
     PF_PageHandle newPh;
-    if ((rc = pfh->AllocatePage(newPh))) {
+    if ((rc = AllocatePage(newPh))) {
         return rc;
     }
     
@@ -292,17 +462,21 @@ RC IX_IndexHandle::SplitLeafNode(PageNum currentPageNum, char *nodeData, void *p
     newNodeHdr->parent = nodeHdr->parent;
     newNodeHdr->left = IX_NO_PAGE;
     newNodeHdr->right = nodeHdr->right;
+    newNodeHdr->prefixLength = 0;
+    newNodeHdr->sepLength = indexHdr.attrLength;
     
-    // 更新链表指针
+    // 更新链表指针（新节点在本节点和父节点解锁之前不会被读者看到，不需要加锁）
     if (nodeHdr->right != IX_NO_PAGE) {
         // 更新原右兄弟的left指针
         PF_PageHandle rightPh;
         char *rightData;
         if (pfh->GetThisPage(nodeHdr->right, rightPh) == 0) {
             if (rightPh.GetData(rightData) == 0) {
+                LockNode(nodeHdr->right);
                 IX_NodeHdr *rightHdr = (IX_NodeHdr *)rightData;
                 rightHdr->left = newChildPage;
                 pfh->MarkDirty(nodeHdr->right);
+                UnlockNode(nodeHdr->right, true);
             }
             pfh->UnpinPage(nodeHdr->right);
         }
@@ -312,46 +486,17 @@ RC IX_IndexHandle::SplitLeafNode(PageNum currentPageNum, char *nodeData, void *p
     nodeHdr->right = newChildPage;
     newNodeHdr->left = currentPageNum;
     
-    // 创建临时数组包含所有条目（原有的加上新的）
-    int entrySize = GetLeafEntrySize();
-    int totalEntries = nodeHdr->numKeys + 1;
-    char *tempEntries = new char[totalEntries * entrySize];
-    
-    // 复制原有条目并插入新条目到正确位置
-    char *entries = nodeData + sizeof(IX_NodeHdr);
-    int insertPos = 0;
-    bool inserted = false;
-    
-    for (int i = 0, j = 0; j < totalEntries; j++) {
-        if (!inserted && (i >= nodeHdr->numKeys || CompareKeys(pData, entries + i * entrySize) <= 0)) {
-            // 插入新条目
-            memcpy(tempEntries + j * entrySize, pData, indexHdr.attrLength);
-            memcpy(tempEntries + j * entrySize + indexHdr.attrLength, &rid, sizeof(RID));
-            inserted = true;
-        } else {
-            // 复制原有条目
-            memcpy(tempEntries + j * entrySize, entries + i * entrySize, entrySize);
-            i++;
-        }
-    }
-    
-    // 计算分裂点
-    int splitPoint = totalEntries / 2;
-    
-    // 更新原节点
-    nodeHdr->numKeys = splitPoint;
-    memcpy(entries, tempEntries, splitPoint * entrySize);
-    
-    // 填充新节点
-    newNodeHdr->numKeys = totalEntries - splitPoint;
-    char *newEntries = newNodeData + sizeof(IX_NodeHdr);
-    memcpy(newEntries, tempEntries + splitPoint * entrySize, newNodeHdr->numKeys * entrySize);
+    // 更新原节点，填充新节点
+    WriteLeaf(nodeData, entries, splitPoint);
+    WriteLeaf(newNodeData, entries + splitPoint * entrySize, nEntries - splitPoint);
     
-    // 设置分裂键值（新节点的第一个键）
-    memcpy(newChildKey, tempEntries + splitPoint * entrySize, indexHdr.attrLength);
+    // 分隔键：区分左边最大的键和新节点第一个键的最短前缀
+    MakeSeparator(entries + (splitPoint - 1) * entrySize, entries + splitPoint * entrySize,
+                  (char *)newChildKey);
     
-    delete[] tempEntries;
     wasSplit = true;
+    counters->nSplits++;
+    counters->nLeafPages++;
     
     pfh->MarkDirty(newChildPage);
     pfh->UnpinPage(newChildPage);
@@ -361,13 +506,18 @@ RC IX_IndexHandle::SplitLeafNode(PageNum currentPageNum, char *nodeData, void *p
 
 //
 // DeleteFromNode: 从B+树节点删除条目（递归）
+// 相等的键可能跨越分隔键延续到右边的子树中：子树中没有找到并且分隔键等于pData时，
+// 继续在下一个子树中查找。子节点删除后过空时与相邻的兄弟节点合并或重新分配，
+// 本节点过空时bUnderflow置为true，由父节点处理
 //
-RC IX_IndexHandle::DeleteFromNode(PageNum pageNum, void *pData, const RID &rid) {
+RC IX_IndexHandle::DeleteFromNode(PageNum pageNum, void *pData, const RID &rid, bool &bUnderflow) {
     RC rc;
     PF_PageHandle ph;
     char *nodeData;
     IX_NodeHdr *nodeHdr;
     
+    bUnderflow = false;
+    
     // 获取页面
     if ((rc = pfh->GetThisPage(pageNum, ph))) {
         return rc;
@@ -378,23 +528,37 @@ RC IX_IndexHandle::DeleteFromNode(PageNum pageNum, void *pData, const RID &rid)
         return rc;
     }
     
+    // 下降路径上的节点都加写锁，直到子节点的合并反映到本节点中
+    LockNode(pageNum);
     nodeHdr = (IX_NodeHdr *)nodeData;
+    bool bModified = false;
     
     if (nodeHdr->isLeaf) {
         // 叶子节点：直接删除
         rc = DeleteFromLeaf(nodeData, pData, rid);
-        if (rc == 0) {
-            pfh->MarkDirty(pageNum);
-        }
+        bModified = (rc != IX_ENTRYNOTFOUND);
     } else {
-        // 内部节点：找到子节点并递归删除
-        PageNum childPage;
-        rc = FindChildPage(nodeData, pData, childPage);
-        if (rc == 0) {
-            rc = DeleteFromNode(childPage, pData, rid);
+        // 内部节点：从可能包含pData第一次出现的子节点开始递归删除
+        int childNo = SearchNode(nodeData, pData, false);
+        bool bChildUnderflow = false;
+        rc = DeleteFromNode(GetChildPage(nodeData, childNo), pData, rid, bChildUnderflow);
+        while (rc == IX_ENTRYNOTFOUND && childNo < nodeHdr->numKeys &&
+               CompareSeparator(pData, nodeData, childNo) == 0) {
+            childNo++;
+            rc = DeleteFromNode(GetChildPage(nodeData, childNo), pData, rid, bChildUnderflow);
+        }
+        if (rc == 0 && bChildUnderflow) {
+            rc = RebalanceChild(nodeData, childNo);
+            bModified = true;
         }
     }
     
+    if (rc == 0) {
+        pfh->MarkDirty(pageNum);
+        bUnderflow = (NodeSpace(nodeData) < IX_MIN_NODE_SPACE);
+    }
+    
+    UnlockNode(pageNum, bModified);
     pfh->UnpinPage(pageNum);
     return rc;
 }
@@ -404,40 +568,43 @@ RC IX_IndexHandle::DeleteFromNode(PageNum pageNum, void *pData, const RID &rid)
 //
 RC IX_IndexHandle::DeleteFromLeaf(char *nodeData, void *pData, const RID &rid) {
     IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
-    char *entries = nodeData + sizeof(IX_NodeHdr);
-    int entrySize = GetLeafEntrySize();
-    
-    // 查找要删除的条目
-    for (int i = 0; i < nodeHdr->numKeys; i++) {
-        char *currentEntry = entries + i * entrySize;
+    int stride = GetLeafEntrySize() - nodeHdr->prefixLength;
+    
+    // 从第一个不小于pData的条目开始，检查所有相等的键
+    int i = SearchNode(nodeData, pData, false);
+    for (; i < nodeHdr->numKeys; i++) {
+        char *currentEntry = LeafEntry(nodeData, i);
+        char *ridField = LeafRidField(nodeData, i);
+        if (CompareLeafKey(pData, nodeData, i) != 0) {
+            // 键值已经超过，不会找到匹配项
+            return IX_ENTRYNOTFOUND;
+        }
         
-        if (CompareKeys(pData, currentEntry) == 0) {
-            // 找到匹配的键，检查RID
-            RID *currentRID = (RID *)(currentEntry + indexHdr.attrLength);
-            PageNum currentPageNum, ridPageNum;
-            SlotNum currentSlotNum, ridSlotNum;
-            
-            if (currentRID->GetPageNum(currentPageNum) == 0 && 
-                currentRID->GetSlotNum(currentSlotNum) == 0 &&
-                rid.GetPageNum(ridPageNum) == 0 &&
-                rid.GetSlotNum(ridSlotNum) == 0 &&
-                currentPageNum == ridPageNum && 
-                currentSlotNum == ridSlotNum) {
-                
-                // 找到要删除的条目，移动后面的条目
-                int moveSize = (nodeHdr->numKeys - i - 1) * entrySize;
-                if (moveSize > 0) {
-                    char *deletePoint = currentEntry;
-                    char *nextEntry = currentEntry + entrySize;
-                    memmove(deletePoint, nextEntry, moveSize);
-                }
-                
-                nodeHdr->numKeys--;
+        // 重复键的RID列表：在列表中删除，列表变空时删除该条目
+        bool bRemove = false;
+        if (IsPostingRef(ridField)) {
+            RC rc = DeleteFromPosting(ridField, rid, bRemove);
+            if (rc == 0 && !bRemove) {
                 return 0;
             }
-        } else if (CompareKeys(pData, currentEntry) < 0) {
-            // 键值已经超过，不会找到匹配项
-            break;
+            if (rc != 0 && rc != IX_ENTRYNOTFOUND) {
+                return rc;
+            }
+        } else {
+            // 找到匹配的键，检查RID
+            RID currentRID;
+            memcpy((char *)&currentRID, ridField, sizeof(RID));
+            bRemove = (currentRID == rid);
+        }
+        if (bRemove) {
+            // 找到要删除的条目，移动后面的条目
+            int moveSize = (nodeHdr->numKeys - i - 1) * stride;
+            if (moveSize > 0) {
+                memmove(currentEntry, currentEntry + stride, moveSize);
+            }
+            
+            nodeHdr->numKeys--;
+            return 0;
         }
     }
     
@@ -449,51 +616,81 @@ RC IX_IndexHandle::DeleteFromLeaf(char *nodeData, void *pData, const RID &rid) {
 // 返回: <0 如果key1 < key2, 0 如果相等, >0 如果key1 > key2
 //
 int IX_IndexHandle::CompareKeys(void *key1, void *key2) {
-    switch (indexHdr.attrType) {
-        case INT:
-            return (*(int *)key1 - *(int *)key2);
-            
-        case FLOAT:
-            {
-                float f1 = *(float *)key1;
-                float f2 = *(float *)key2;
-                if (f1 < f2) return -1;
-                if (f1 > f2) return 1;
-                return 0;
+    return keyOps->compare(key1, key2, &keyDesc);
+}
+
+//
+// SearchNode: 在节点内二分查找pData
+// bUpper为false时返回第一个不小于pData的键的位置，为true时返回第一个大于pData的键的位置。
+// 内部节点中，位置i的子节点（GetChildPage）恰好包含第i个键之前的范围。
+// 叶子先比较公共前缀，前缀相等时只在后缀中查找；截断的分隔键按IX_CompareSeparator比较
+//
+int IX_IndexHandle::SearchNode(const char *nodeData, const void *pData, bool bUpper) const {
+    const IX_NodeHdr *nodeHdr = (const IX_NodeHdr *)nodeData;
+    const char *keys = nodeData + sizeof(IX_NodeHdr);
+    int stride;
+    
+    if (nodeHdr->isLeaf) {
+        int prefixLength = nodeHdr->prefixLength;
+        stride = GetLeafEntrySize() - prefixLength;
+        if (prefixLength > 0) {
+            int cmp = strncmp((const char *)pData, keys, prefixLength);
+            if (cmp != 0) {
+                return (cmp < 0) ? 0 : nodeHdr->numKeys;
             }
-            
-        case STRING:
-            return strncmp((char *)key1, (char *)key2, indexHdr.attrLength);
-            
-        default:
-            return 0; // 不应该到达这里
+            IX_KeyDesc suffixDesc = keyDesc;
+            suffixDesc.keyLength = indexHdr.attrLength - prefixLength;
+            suffixDesc.lengths[0] = suffixDesc.keyLength;
+            const IX_KeyOps *suffixOps = IX_GetStringKeyOps();
+            keys += prefixLength;
+            pData = (const char *)pData + prefixLength;
+            if (bUpper) {
+                return suffixOps->upperBound(keys, nodeHdr->numKeys, stride, pData, &suffixDesc);
+            }
+            return suffixOps->lowerBound(keys, nodeHdr->numKeys, stride, pData, &suffixDesc);
+        }
+    } else {
+        keys += sizeof(PageNum);
+        stride = nodeHdr->sepLength + sizeof(PageNum);
+        if (TruncateKeys()) {
+            return IX_SearchSeparators(keys, nodeHdr->numKeys, stride, nodeHdr->sepLength,
+                                       pData, indexHdr.attrLength, bUpper);
+        }
     }
+    
+    if (bUpper) {
+        return keyOps->upperBound(keys, nodeHdr->numKeys, stride, pData, &keyDesc);
+    }
+    return keyOps->lowerBound(keys, nodeHdr->numKeys, stride, pData, &keyDesc);
 }
 
 //
-// 辅助函数实现
+// GetChildPage: 内部节点的第childNo个子节点（0 <= childNo <= numKeys）
 //
-
-// 获取叶子节点的最大条目数
-int IX_IndexHandle::GetMaxLeafEntries() {
-    int entrySize = indexHdr.attrLength + sizeof(RID);
-    int availableSpace = PF_PAGE_SIZE - sizeof(IX_NodeHdr);
-    return availableSpace / entrySize;
+PageNum IX_IndexHandle::GetChildPage(const char *nodeData, int childNo) const {
+    const char *entries = nodeData + sizeof(IX_NodeHdr);
+    if (childNo == 0) {
+        return *(const PageNum *)entries;
+    }
+    int sepLength = ((const IX_NodeHdr *)nodeData)->sepLength;
+    int entrySize = sepLength + sizeof(PageNum);
+    PageNum childPage;
+    memcpy(&childPage, entries + sizeof(PageNum) + (childNo - 1) * entrySize + sepLength, sizeof(PageNum));
+    return childPage;
 }
 
-int IX_IndexHandle::GetMaxInternalEntries() {
-    int entrySize = indexHdr.attrLength + sizeof(PageNum);
-    int availableSpace = PF_PAGE_SIZE - sizeof(IX_NodeHdr) - sizeof(PageNum); // 减去第一个指针
-    return availableSpace / entrySize;
-}
+//
+// 辅助函数实现
+//
 
-int IX_IndexHandle::GetLeafEntrySize() {
-    return indexHdr.attrLength + sizeof(RID);
+// 获取叶子节点的最大条目数（不做前缀压缩时）
+int IX_IndexHandle::GetMaxLeafEntries() const {
+    return IX_NODE_SPACE / GetLeafEntrySize();
 }
 
-// 获取内部节点条目大小(键值 + 页号)
-int IX_IndexHandle::GetInternalEntrySize() {
-    return indexHdr.attrLength + sizeof(PageNum);
+// 获取叶子节点条目大小(键值 + RID + 附带数据)
+int IX_IndexHandle::GetLeafEntrySize() const {
+    return indexHdr.attrLength + sizeof(RID) + keyDesc.includeLength;
 }
 
 //
@@ -514,8 +711,16 @@ RC IX_IndexHandle::WriteHeader() {
         return rc;
     }
     
-    // 复制头信息
-    memcpy(data, &indexHdr, sizeof(IX_FileHdr));
+    // 更新会随插入变化的头信息，键的组成在创建后不变
+    IX_FileHdr *fileHdr = (IX_FileHdr *)data;
+    fileHdr->rootPage = indexHdr.rootPage;
+    fileHdr->numPages = indexHdr.numPages;
+    fileHdr->firstFreePage = indexHdr.firstFreePage;
+    if (hashTable != NULL) {
+        fileHdr->globalDepth = hashTable->globalDepth;
+        fileHdr->dirPage = hashTable->dirPages.empty() ? IX_NO_PAGE : hashTable->dirPages[0];
+    }
+    SaveStats(fileHdr);
     
     // 标记为脏页并unpin
     pfh->MarkDirty(0);
@@ -533,7 +738,7 @@ RC IX_IndexHandle::CreateNewRoot(void *pData, PageNum leftPage, PageNum rightPag
     char *nodeData;
     
     // 分配新页面作为新根
-    if ((rc = pfh->AllocatePage(ph))) {
+    if ((rc = AllocatePage(ph))) {
         return rc;
     }
     
@@ -551,30 +756,60 @@ RC IX_IndexHandle::CreateNewRoot(void *pData, PageNum leftPage, PageNum rightPag
     // 初始化新根节点
     IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
     nodeHdr->isLeaf = FALSE;
-    nodeHdr->numKeys = 1;
     nodeHdr->parent = IX_NO_PAGE;
     nodeHdr->left = IX_NO_PAGE;
     nodeHdr->right = IX_NO_PAGE;
+    nodeHdr->prefixLength = 0;
     
-    // 设置键值和指针
-    char *entries = nodeData + sizeof(IX_NodeHdr);
-    
-    // 第一个指针指向左子树
-    *(PageNum *)entries = leftPage;
-    entries += sizeof(PageNum);
-    
-    // 键值
-    memcpy(entries, pData, indexHdr.attrLength);
-    entries += indexHdr.attrLength;
-    
-    // 第二个指针指向右子树
-    *(PageNum *)entries = rightPage;
+    // 一个分隔键，左右两个子树
+    PageNum children[2] = { leftPage, rightPage };
+    WriteInternal(nodeData, (const char *)pData, children, 1);
     
     // 更新索引头中的根页面号
     indexHdr.rootPage = newRootPage;
+    counters->height++;
     
     pfh->MarkDirty(newRootPage);
     pfh->UnpinPage(newRootPage);
     
     return 0;
-}
\ No newline at end of file
+}
+
+//
+// CreateEmptyRoot: 为空索引创建一个空的叶子节点作为根
+//
+RC IX_IndexHandle::CreateEmptyRoot() {
+    RC rc;
+    PF_PageHandle ph;
+    PageNum rootPage;
+    char *nodeData;
+    
+    if ((rc = AllocatePage(ph))) {
+        return rc;
+    }
+    
+    if ((rc = ph.GetPageNum(rootPage)) ||
+        (rc = ph.GetData(nodeData))) {
+        return rc;
+    }
+    
+    IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
+    nodeHdr->isLeaf = TRUE;
+    nodeHdr->numKeys = 0;
+    nodeHdr->parent = IX_NO_PAGE;
+    nodeHdr->left = IX_NO_PAGE;
+    nodeHdr->right = IX_NO_PAGE;
+    nodeHdr->prefixLength = 0;
+    nodeHdr->sepLength = indexHdr.attrLength;
+    
+    indexHdr.rootPage = rootPage;
+    counters->height++;
+    counters->nLeafPages++;
+    
+    if ((rc = pfh->MarkDirty(rootPage)) ||
+        (rc = pfh->UnpinPage(rootPage))) {
+        return rc;
+    }
+    
+    return 0;
+}
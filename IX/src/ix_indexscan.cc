@@ -1,7 +1,10 @@
 //
 // ix_indexscan.cc: IX_IndexScan class implementation  
 //
-// IX_IndexScan提供对索引的扫描功能，支持范围查询和条件过滤
+// IX_IndexScan提供对索引的扫描功能，支持范围查询和条件过滤。
+// 所有比较条件都转换为[下界, 上界]：扫描直接下降到下界所在的叶子，
+// 沿叶子链表向右读取，遇到第一个超过上界的键就结束。
+// 反向扫描下降到上界所在的叶子，沿左链接读取，遇到第一个低于下界的键就结束
 //
 
 #include <iostream>
@@ -16,10 +19,22 @@ using namespace std;
 IX_IndexScan::IX_IndexScan() {
     isOpenScan = FALSE;
     indexHandle = NULL;
+    value = NULL;
+    lowKey = NULL;
+    highKey = NULL;
+    bReverse = false;
     currentPageNum = IX_NO_PAGE;
     currentSlot = -1;
     pfPageHandle = NULL;
+    curKey = NULL;
     pinned = FALSE;
+    postingPos = 0;
+    postingNext = IX_NO_PAGE;
+    hashPos = 0;
+    hashSlot = 0;
+    merge = NULL;
+    nReturned = 0;
+    nFiltered = 0;
 }
 
 //
@@ -29,9 +44,7 @@ IX_IndexScan::~IX_IndexScan() {
     // 如果扫描仍然打开，需要先关闭
     if (isOpenScan) {
         cerr << "IX_IndexScan::~IX_IndexScan() - 警告：析构时索引扫描仍然打开" << endl;
-        if (pinned && pfPageHandle != NULL) {
-            indexHandle->pfh->UnpinPage(currentPageNum);
-        }
+        CloseScan();
     }
 }
 
@@ -41,14 +54,73 @@ IX_IndexScan::~IX_IndexScan() {
 //       compOp      - 比较操作符
 //       value       - 比较值
 //       clientHint  - 客户端提示（未使用）
+//       bReverse    - 键值从大到小扫描
 // 返回: RC码
 //
 RC IX_IndexScan::OpenScan(const IX_IndexHandle &indexHandle_,
                          CompOp compOp_,
                          void *value_,
-                         ClientHint  pinHint) {
+                         ClientHint  pinHint,
+                         bool bReverse_) {
     RC rc;
-    
+
+    // 除NO_OP外都需要比较值
+    if (compOp_ != NO_OP && value_ == NULL) {
+        return IX_NULLPOINTER;
+    }
+
+    // 把比较条件转换为范围
+    switch (compOp_) {
+        case EQ_OP: rc = OpenRange(indexHandle_, value_, true, value_, true, bReverse_);  break;
+        case LT_OP: rc = OpenRange(indexHandle_, NULL, false, value_, false, bReverse_);  break;
+        case LE_OP: rc = OpenRange(indexHandle_, NULL, false, value_, true, bReverse_);   break;
+        case GT_OP: rc = OpenRange(indexHandle_, value_, false, NULL, false, bReverse_);  break;
+        case GE_OP: rc = OpenRange(indexHandle_, value_, true, NULL, false, bReverse_);   break;
+        case NE_OP:
+        case NO_OP: rc = OpenRange(indexHandle_, NULL, false, NULL, false, bReverse_);    break;
+        default:    return IX_BADINDEXSPEC;
+    }
+    if (rc != 0) {
+        return rc;
+    }
+
+    // NE_OP需要逐条排除与比较值相等的键
+    compOp = compOp_;
+    if (compOp == NE_OP) {
+        value = CopyKey(value_);
+    }
+
+    return 0;
+}
+
+//
+// OpenRangeScan: 打开范围扫描
+// 输入: lowKey/highKey - 下界/上界，NULL表示该侧无界
+//       lowInclusive/highInclusive - 是否包含边界值
+//       bReverse - 键值从大到小扫描
+// 返回: RC码
+//
+RC IX_IndexScan::OpenRangeScan(const IX_IndexHandle &indexHandle_,
+                               void *lowKey_, bool lowInclusive_,
+                               void *highKey_, bool highInclusive_,
+                               ClientHint pinHint, bool bReverse_) {
+    RC rc;
+
+    if ((rc = OpenRange(indexHandle_, lowKey_, lowInclusive_, highKey_, highInclusive_,
+                        bReverse_))) {
+        return rc;
+    }
+    compOp = NO_OP;
+
+    return 0;
+}
+
+//
+// OpenRange: 检查状态并保存扫描范围，扫描位置在第一次取条目时才确定
+//
+RC IX_IndexScan::OpenRange(const IX_IndexHandle &indexHandle_,
+                           const void *low, bool lowIncl, const void *high, bool highIncl,
+                           bool bReverse_) {
     // 检查索引句柄是否打开
     if (!indexHandle_.isOpenHandle) {
         return IX_INDEXNOTOPEN;
@@ -61,81 +133,208 @@ RC IX_IndexScan::OpenScan(const IX_IndexHandle &indexHandle_,
     
     // 保存参数
     indexHandle = const_cast<IX_IndexHandle*>(&indexHandle_);
-    compOp = compOp_;
-    
-    // 复制比较值
-    if (value_ != NULL) {
-        if (indexHandle->indexHdr.attrType == STRING) {
-            value = new char[indexHandle->indexHdr.attrLength];
-            memcpy(value, value_, indexHandle->indexHdr.attrLength);
-        } else if (indexHandle->indexHdr.attrType == INT) {
-            value = new int;
-            *(int*)value = *(int*)value_;
-        } else if (indexHandle->indexHdr.attrType == FLOAT) {
-            value = new float;
-            *(float*)value = *(float*)value_;
-        }
-        hasValue = TRUE;
-    } else {
-        value = NULL;
-        hasValue = FALSE;
-    }
-    
+    compOp = NO_OP;
+    value = NULL;
+    lowKey = (low != NULL) ? CopyKey(low) : NULL;
+    highKey = (high != NULL) ? CopyKey(high) : NULL;
+    lowInclusive = lowIncl;
+    highInclusive = highIncl;
+    bReverse = bReverse_;
+    curKey = new char[indexHandle->indexHdr.attrLength];
+
     // 初始化扫描状态
     currentPageNum = IX_NO_PAGE;
     currentSlot = -1;
     pfPageHandle = NULL;
     pinned = FALSE;
     scanEnded = FALSE;
-    
-    // 根据比较操作找到起始位置
-    if (compOp == NO_OP) {
-        // 无条件扫描：从最左边的叶子节点开始
-        rc = FindFirstLeafPage();
-    } else {
-        // 有条件扫描：找到满足条件的第一个位置
-        rc = FindStartPosition();
+    postingRids.clear();
+    postingPos = 0;
+    postingNext = IX_NO_PAGE;
+    hashEntries.clear();
+    hashPos = 0;
+    hashSlot = 0;
+    nReturned = 0;
+    nFiltered = 0;
+
+    // 哈希索引没有键的顺序，只能扫描全部条目或者等值查找
+    if (indexHandle->hashTable != NULL &&
+        (bReverse || ((lowKey != NULL || highKey != NULL) &&
+                      (lowKey == NULL || highKey == NULL || !lowInclusive || !highInclusive ||
+                       indexHandle->CompareKeys(lowKey, highKey) != 0)))) {
+        delete[] lowKey;
+        delete[] highKey;
+        delete[] curKey;
+        lowKey = NULL;
+        highKey = NULL;
+        curKey = NULL;
+        indexHandle = NULL;
+        return IX_HASHSCAN;
     }
-    
-    if (rc != 0) {
-        // 清理已分配的内存
-        if (value != NULL) {
-            if (indexHandle->indexHdr.attrType == STRING) {
-                delete[] (char*)value;
-            } else {
-                delete value;
-            }
+
+    // 下界大于上界（或相等但不都包含）时结果为空
+    if (lowKey != NULL && highKey != NULL) {
+        int cmp = indexHandle->CompareKeys(lowKey, highKey);
+        if (cmp > 0 || (cmp == 0 && !(lowInclusive && highInclusive))) {
+            scanEnded = TRUE;
+        } else if (cmp == 0 && !indexHandle->BloomMayContain(lowKey)) {
+            // 等值扫描的键值被Bloom过滤器判定不存在
+            scanEnded = TRUE;
+            indexHandle->counters->nFilterSkips++;
         }
-        return rc;
     }
     
+    // 带写缓冲的B+树有待写入的消息时，叶子中的条目与消息归并
+    merge = NULL;
+    if (indexHandle->msgBuffer != NULL) {
+        lock_guard<mutex> guard(indexHandle->msgBuffer->latch);
+        if (!indexHandle->msgBuffer->messages.empty()) {
+            merge = new IX_ScanMerge;
+            merge->bCollected = false;
+            merge->insertPos = 0;
+            merge->bTreeAhead = false;
+            merge->bTreeDone = false;
+            merge->bTreeLast = false;
+            merge->treeKey.resize(indexHandle->indexHdr.attrLength);
+            merge->treePayload.resize(indexHandle->keyDesc.includeLength);
+        }
+    }
+
     isOpenScan = TRUE;
     return 0;
 }
 
+//
+// CopyKey: 按索引键长度复制一个键值
+// 字符串常量可能比属性短，只复制到结尾的'\0'为止，其余部分补零。
+// 组合索引的键逐个属性复制
+//
+char *IX_IndexScan::CopyKey(const void *key) const {
+    const IX_KeyDesc &keyDesc = indexHandle->keyDesc;
+    char *copy = new char[keyDesc.keyLength];
+
+    int offset = 0;
+    for (int i = 0; i < keyDesc.nParts; i++) {
+        if (keyDesc.types[i] == STRING) {
+            strncpy(copy + offset, (const char *)key + offset, keyDesc.lengths[i]);
+        } else {
+            memcpy(copy + offset, (const char *)key + offset, keyDesc.lengths[i]);
+        }
+        offset += keyDesc.lengths[i];
+    }
+    return copy;
+}
+
 //
 // GetNextEntry: 获取下一个满足条件的条目
 // 输出: rid - 记录标识符
 // 返回: RC码，如果到达扫描结束返回IX_EOF
 //
 RC IX_IndexScan::GetNextEntry(RID &rid) {
+    char *key;
+    bool bLastInPage;
+
+    // 检查扫描是否打开
+    if (!isOpenScan) {
+        return IX_SCANNOTOPEN;
+    }
+
     RC rc;
-    
+    if (merge != NULL) {
+        const char *payload;
+        rc = NextMergedMatch(rid, key, bLastInPage, payload);
+    } else {
+        rc = NextMatch(rid, key, bLastInPage);
+    }
+    if (rc == 0) {
+        nReturned++;
+    }
+    return rc;
+}
+
+//
+// GetNextBatch: 获取当前叶子中剩余的所有满足条件的条目（包括附带的数据）
+// 返回: RC码，没有更多条目时返回IX_EOF
+//
+RC IX_IndexScan::GetNextBatch(IX_ScanBatch &batch) {
+    RC rc;
+    RID rid;
+    char *key;
+    bool bLastInPage = false;
+    int attrLength;
+    int payloadLength;
+
     // 检查扫描是否打开
     if (!isOpenScan) {
         return IX_SCANNOTOPEN;
     }
-    
+
+    attrLength = indexHandle->indexHdr.attrLength;
+    payloadLength = indexHandle->keyDesc.includeLength;
+    batch.keys.clear();
+    batch.rids.clear();
+    batch.payloads.clear();
+    batch.keyLength = attrLength;
+    batch.payloadLength = payloadLength;
+    batch.nEntries = 0;
+
+    while (!bLastInPage) {
+        const char *payload = NULL;
+        if (merge != NULL) {
+            rc = NextMergedMatch(rid, key, bLastInPage, payload);
+        } else {
+            rc = NextMatch(rid, key, bLastInPage);
+        }
+        if (rc == IX_EOF) {
+            break;
+        }
+        if (rc != 0) {
+            return rc;
+        }
+
+        batch.keys.insert(batch.keys.end(), key, key + attrLength);
+        batch.rids.push_back(rid);
+        if (payloadLength > 0) {
+            if (payload == NULL) {
+                char *nodeData;
+                if ((rc = pfPageHandle->GetData(nodeData))) {
+                    return rc;
+                }
+                payload = indexHandle->LeafRidField(nodeData, currentSlot) + sizeof(RID);
+            }
+            batch.payloads.insert(batch.payloads.end(), payload, payload + payloadLength);
+        }
+        batch.nEntries++;
+    }
+
+    nReturned += batch.nEntries;
+    return (batch.nEntries > 0) ? 0 : IX_EOF;
+}
+
+//
+// NextMatch: 找到下一个满足条件的条目
+// 输出: rid         - 记录标识符
+//       key         - 该条目的完整键值（curKey）
+//       bLastInPage - 该条目是否为当前叶子的最后一个条目
+//
+RC IX_IndexScan::NextMatch(RID &rid, char *&key, bool &bLastInPage) {
+    RC rc;
+
     // 检查是否已经结束
     if (scanEnded) {
         return IX_EOF;
     }
+    if (indexHandle->hashTable != NULL) {
+        return NextHashMatch(rid, key, bLastInPage);
+    }
     
     // 查找下一个满足条件的条目
     while (true) {
-        // 如果没有当前页面，获取第一个页面
+        // 如果没有当前页面，下降到起始位置（反向扫描为上界）
         if (currentPageNum == IX_NO_PAGE) {
-            if (compOp == NO_OP) {
+            if (bReverse) {
+                rc = FindEndPosition();
+            } else if (lowKey == NULL) {
                 rc = FindFirstLeafPage();
             } else {
                 rc = FindStartPosition();
@@ -151,11 +350,37 @@ RC IX_IndexScan::GetNextEntry(RID &rid) {
         rc = GetNextEntryInPage(rid);
         
         if (rc == 0) {
-            // 找到条目，检查是否满足条件
-            if (SatisfiesCondition(rid)) {
+            char *nodeData;
+            if ((rc = pfPageHandle->GetData(nodeData))) {
+                scanEnded = TRUE;
+                return rc;
+            }
+            IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
+            key = curKey;
+            if (!postingRids.empty()) {
+                // 重复键的RID列表：每解码完一个bucket页作为一批
+                bLastInPage = (postingPos >= postingRids.size());
+            } else if (bReverse) {
+                bLastInPage = (currentSlot <= 0);
+            } else {
+                bLastInPage = (currentSlot + 1 >= nodeHdr->numKeys);
+            }
+
+            // 检查是否在范围内
+            int bound = CheckBounds(key);
+            if (bReverse ? bound < 0 : bound > 0) {
+                // 超过上界（反向扫描时低于下界），后面的键都在范围之外
+                scanEnded = TRUE;
+                return IX_EOF;
+            }
+            if (bound == 0 &&
+                (compOp != NE_OP || indexHandle->CompareKeys(key, value) != 0)) {
                 return 0; // 成功找到
             }
-            // 不满足条件，继续查找
+            // 不满足条件，继续查找（RID列表中其余的RID键值相同，一起跳过）
+            nFiltered++;
+            postingPos = postingRids.size();
+            postingNext = IX_NO_PAGE;
         } else if (rc == IX_EOF) {
             // 当前页面结束，移动到下一页
             rc = MoveToNextPage();
@@ -171,6 +396,188 @@ RC IX_IndexScan::GetNextEntry(RID &rid) {
     }
 }
 
+//
+// NextHashMatch: 哈希索引的下一个满足条件的条目
+// 等值查找只读键值所在的bucket；全部扫描按目录项顺序读各个bucket，
+// 一个bucket有多个目录项指向它时只在第一个目录项读（去掉最高的1位后指向同一个bucket的不是第一个）。
+// 每个bucket连同溢出页作为一批
+//
+RC IX_IndexScan::NextHashMatch(RID &rid, char *&key, bool &bLastInPage) {
+    RC rc;
+    IX_HashTable *table = indexHandle->hashTable;
+    int attrLength = indexHandle->indexHdr.attrLength;
+    size_t entrySize = attrLength + sizeof(RID);
+
+    while (hashPos * entrySize >= hashEntries.size()) {
+        hashEntries.clear();
+        hashPos = 0;
+
+        int localDepth;
+        if (lowKey != NULL) {
+            if (hashSlot > 0 || table->directory.empty()) {
+                scanEnded = TRUE;
+                return IX_EOF;
+            }
+            uint32_t hash = indexHandle->HashKey(lowKey);
+            PageNum pageNum = table->directory[hash & (((uint32_t)1 << table->globalDepth) - 1)];
+            hashSlot = 1;
+            vector<PageNum> overflowPages;
+            rc = indexHandle->ReadHashChain(pageNum, lowKey, localDepth, hashEntries, &overflowPages);
+            indexHandle->counters->nProbes++;
+            indexHandle->counters->nProbePages += 1 + overflowPages.size();
+        } else {
+            while (hashSlot < (int)table->directory.size() && hashSlot > 0) {
+                int highBit = 1;
+                while (highBit * 2 <= hashSlot) {
+                    highBit *= 2;
+                }
+                if (table->directory[hashSlot - highBit] != table->directory[hashSlot]) {
+                    break;
+                }
+                hashSlot++;
+            }
+            if (hashSlot >= (int)table->directory.size()) {
+                scanEnded = TRUE;
+                return IX_EOF;
+            }
+            rc = indexHandle->ReadHashChain(table->directory[hashSlot++], NULL, localDepth,
+                                            hashEntries, NULL);
+        }
+        if (rc != 0) {
+            scanEnded = TRUE;
+            return rc;
+        }
+
+        // NE_OP排除与比较值相等的键
+        if (compOp == NE_OP) {
+            size_t kept = 0;
+            for (size_t pos = 0; pos < hashEntries.size(); pos += entrySize) {
+                if (indexHandle->CompareKeys(&hashEntries[pos], value) != 0) {
+                    memmove(&hashEntries[kept], &hashEntries[pos], entrySize);
+                    kept += entrySize;
+                } else {
+                    nFiltered++;
+                }
+            }
+            hashEntries.resize(kept);
+        }
+    }
+
+    const char *entry = &hashEntries[hashPos * entrySize];
+    memcpy(curKey, entry, attrLength);
+    memcpy((char *)&rid, entry + attrLength, sizeof(RID));
+    hashPos++;
+    key = curKey;
+    bLastInPage = (hashPos * entrySize >= hashEntries.size());
+    return 0;
+}
+
+//
+// NextMergedMatch: 带写缓冲的B+树的下一个满足条件的条目
+// 叶子中的条目预读一个，有待写入消息的跳过（以消息为准）；待插入的条目按键值插在叶子条目之间。
+// 叶子条目的批次不变，待插入的条目并入其后的叶子条目所在的批次
+// 输出: payload - 条目附带的数据
+//
+RC IX_IndexScan::NextMergedMatch(RID &rid, char *&key, bool &bLastInPage, const char *&payload) {
+    RC rc;
+    int attrLength = indexHandle->indexHdr.attrLength;
+    int payloadLength = indexHandle->keyDesc.includeLength;
+    size_t insertSize = attrLength + sizeof(RID) + payloadLength;
+
+    if (!merge->bCollected) {
+        CollectMessages();
+    }
+
+    // 预读叶子中的下一个条目
+    while (!merge->bTreeAhead && !merge->bTreeDone) {
+        char *treeKey;
+        rc = NextMatch(merge->treeRid, treeKey, merge->bTreeLast);
+        if (rc == IX_EOF) {
+            merge->bTreeDone = true;
+        } else if (rc != 0) {
+            return rc;
+        } else if (!indexHandle->HasMessage(treeKey, merge->treeRid)) {
+            memcpy(&merge->treeKey[0], treeKey, attrLength);
+            if (payloadLength > 0) {
+                char *nodeData;
+                if ((rc = pfPageHandle->GetData(nodeData))) {
+                    return rc;
+                }
+                memcpy(&merge->treePayload[0],
+                       indexHandle->LeafRidField(nodeData, currentSlot) + sizeof(RID), payloadLength);
+            }
+            merge->bTreeAhead = true;
+        }
+    }
+
+    // 键值更小（反向扫描时更大）的待插入条目先返回
+    if (merge->insertPos < merge->inserts.size()) {
+        char *insert = &merge->inserts[merge->insertPos];
+        int cmp = merge->bTreeAhead ? indexHandle->CompareKeys(insert, &merge->treeKey[0]) : 0;
+        if (!merge->bTreeAhead || (bReverse ? cmp > 0 : cmp < 0)) {
+            merge->insertPos += insertSize;
+            key = insert;
+            memcpy((char *)&rid, insert + attrLength, sizeof(RID));
+            payload = insert + attrLength + sizeof(RID);
+            bLastInPage = !merge->bTreeAhead && merge->insertPos >= merge->inserts.size();
+            return 0;
+        }
+    }
+
+    if (!merge->bTreeAhead) {
+        return IX_EOF;
+    }
+    merge->bTreeAhead = false;
+    key = &merge->treeKey[0];
+    rid = merge->treeRid;
+    payload = &merge->treePayload[0];
+    bLastInPage = merge->bTreeLast;
+    return 0;
+}
+
+//
+// CollectMessages: 复制扫描范围内待插入的条目（不在乎叶子中是否已有），
+// 反向扫描时按键值从大到小排列
+//
+void IX_IndexScan::CollectMessages() {
+    IX_MsgBuffer *msgBuffer = indexHandle->msgBuffer;
+    int attrLength = indexHandle->indexHdr.attrLength;
+    vector<char> key(attrLength);
+
+    lock_guard<mutex> guard(msgBuffer->latch);
+    map<string, IX_Message, IX_MsgLess>::const_iterator it = msgBuffer->messages.begin();
+    if (lowKey != NULL) {
+        RID minRid(0, 0);
+        string probe(lowKey, attrLength);
+        probe.append((const char *)&minRid, sizeof(RID));
+        it = msgBuffer->messages.lower_bound(probe);
+    }
+
+    for (; it != msgBuffer->messages.end(); ++it) {
+        memcpy(&key[0], it->first.data(), attrLength);
+        int bound = CheckBounds(&key[0]);
+        if (bound > 0) {
+            break;
+        }
+        if (bound < 0 || !(it->second.op & IX_MSG_INSERT) ||
+            (compOp == NE_OP && indexHandle->CompareKeys(&key[0], value) == 0)) {
+            continue;
+        }
+        merge->inserts.insert(merge->inserts.end(), it->first.begin(), it->first.end());
+        merge->inserts.insert(merge->inserts.end(), it->second.payload.begin(),
+                              it->second.payload.end());
+    }
+    if (bReverse) {
+        size_t insertSize = attrLength + sizeof(RID) + indexHandle->keyDesc.includeLength;
+        vector<char> reversed(merge->inserts.size());
+        for (size_t pos = 0; pos < reversed.size(); pos += insertSize) {
+            memcpy(&reversed[reversed.size() - pos - insertSize], &merge->inserts[pos], insertSize);
+        }
+        merge->inserts.swap(reversed);
+    }
+    merge->bCollected = true;
+}
+
 //
 // CloseScan: 关闭索引扫描
 // 返回: RC码
@@ -186,21 +593,33 @@ RC IX_IndexScan::CloseScan() {
     // 释放当前pin的页面
     if (pinned && pfPageHandle != NULL) {
         rc = indexHandle->pfh->UnpinPage(currentPageNum);
-        if (rc != 0) {
-            // 即使unpin失败，也要继续清理
-        }
     }
     
+    // 计入索引的运行统计
+    indexHandle->counters->nScanReturned += nReturned;
+    indexHandle->counters->nScanFiltered += nFiltered;
+    nReturned = 0;
+    nFiltered = 0;
+    delete pfPageHandle;
+    postingRids.clear();
+    postingPos = 0;
+    postingNext = IX_NO_PAGE;
+    hashEntries.clear();
+    hashPos = 0;
+    hashSlot = 0;
+    delete merge;
+    merge = NULL;
+
     // 清理分配的内存
-    if (value != NULL) {
-        if (indexHandle->indexHdr.attrType == STRING) {
-            delete[] (char*)value;
-        } else {
-            delete value;
-        }
-        value = NULL;
-    }
-    
+    delete[] value;
+    delete[] lowKey;
+    delete[] highKey;
+    delete[] curKey;
+    value = NULL;
+    lowKey = NULL;
+    highKey = NULL;
+    curKey = NULL;
+
     // 重置状态
     isOpenScan = FALSE;
     indexHandle = NULL;
@@ -213,86 +632,60 @@ RC IX_IndexScan::CloseScan() {
 }
 
 //
-// FindFirstLeafPage: 找到最左边的叶子页面（用于无条件扫描）
+// FindFirstLeafPage: 找到最左边的叶子页面（用于无下界的扫描）
 //
 RC IX_IndexScan::FindFirstLeafPage() {
     RC rc;
-    PageNum pageNum = indexHandle->indexHdr.rootPage;
+    char leafData[PF_PAGE_SIZE];
+    uint64_t version;
+
+    // 经过常驻内存的上层节点沿最左边的路径下降，只有叶子通过缓冲区读
+    do {
+        rc = indexHandle->FindLeafOptimistic(NULL, false, currentPageNum, leafData, version);
+    } while (rc == IX_RESTART);
+    if (rc) {
+        return rc;
+    }
     
     // 如果索引为空
-    if (pageNum == IX_NO_PAGE) {
+    if (currentPageNum == IX_NO_PAGE) {
         return IX_EOF;
     }
     
-    // 从根节点开始，沿着最左边的路径下降到叶子节点
-    while (true) {
-        PF_PageHandle ph;
-        char *nodeData;
-        
-        if ((rc = indexHandle->pfh->GetThisPage(pageNum, ph))) {
-            return rc;
-        }
-        
-        if ((rc = ph.GetData(nodeData))) {
-            indexHandle->pfh->UnpinPage(pageNum);
-            return rc;
-        }
-        
-        IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
-        
-        if (nodeHdr->isLeaf) {
-            // 到达叶子节点
-            currentPageNum = pageNum;
-            currentSlot = -1; // 从第一个条目之前开始
-            pfPageHandle = new PF_PageHandle(ph);
-            pinned = TRUE;
-            
-            return 0;
-        } else {
-            // 内部节点，取第一个子指针
-            char *entries = nodeData + sizeof(IX_NodeHdr);
-            PageNum childPage = *(PageNum *)entries;
-            
-            indexHandle->pfh->UnpinPage(pageNum);
-            pageNum = childPage;
-        }
+    currentSlot = -1; // 从第一个条目之前开始
+    pfPageHandle = new PF_PageHandle();
+    if ((rc = indexHandle->pfh->GetThisPage(currentPageNum, *pfPageHandle))) {
+        delete pfPageHandle;
+        pfPageHandle = NULL;
+        return rc;
     }
+    pinned = TRUE;
+
+    return 0;
 }
 
 //
-// FindStartPosition: 根据比较条件找到扫描起始位置
+// FindStartPosition: 找到第一个不小于下界的条目
 //
 RC IX_IndexScan::FindStartPosition() {
     RC rc;
-    
-    if (!hasValue) {
-        // 没有比较值，根据操作类型决定起始位置
-        if (compOp == LT_OP || compOp == LE_OP || compOp == NE_OP) {
-            return FindFirstLeafPage();
-        } else {
-            return IX_EOF; // GT, GE, EQ 操作需要比较值
-        }
-    }
-    
-    // 使用B+树搜索找到键值位置
+
+    // 使用B+树搜索找到键值位置（没有确切匹配时为插入位置）
     PageNum leafPage;
     int slotNum;
-    
-    rc = SearchKey(value, leafPage, slotNum);
-    
-    if (rc == IX_ENTRYNOTFOUND) {
-        // 没有找到确切匹配，根据比较操作调整位置
-        rc = FindInsertPosition(value, leafPage, slotNum);
-    }
-    
+
+    rc = SearchKey(lowKey, leafPage, slotNum);
     if (rc != 0 && rc != IX_ENTRYNOTFOUND) {
         return rc;
     }
-    
+    if (leafPage == IX_NO_PAGE) {
+        return IX_EOF;
+    }
+
     // 设置扫描起始位置
     currentPageNum = leafPage;
-    currentSlot = slotNum - 1; // GetNextEntry会递增slot
-    
+    currentSlot = slotNum - 1; // GetNextEntryInPage会递增slot
+
     // Pin页面
     pfPageHandle = new PF_PageHandle();
     if ((rc = indexHandle->pfh->GetThisPage(currentPageNum, *pfPageHandle))) {
@@ -305,54 +698,67 @@ RC IX_IndexScan::FindStartPosition() {
     return 0;
 }
 
+//
+// FindEndPosition: 反向扫描的起点，最后一个不超过上界的条目之后
+// 包含上界时沿上界的插入位置下降，否则沿上界第一次出现的位置下降；没有上界时沿最右边的路径下降
+//
+RC IX_IndexScan::FindEndPosition() {
+    RC rc;
+    char leafData[PF_PAGE_SIZE];
+    uint64_t version;
+    bool bUpper = (highKey == NULL || highInclusive);
+
+    do {
+        rc = indexHandle->FindLeafOptimistic(highKey, bUpper, currentPageNum, leafData, version);
+    } while (rc == IX_RESTART);
+    if (rc) {
+        return rc;
+    }
+    if (currentPageNum == IX_NO_PAGE) {
+        return IX_EOF;
+    }
+
+    // GetNextEntryInPage会递减slot
+    if (highKey == NULL) {
+        currentSlot = ((IX_NodeHdr *)leafData)->numKeys;
+    } else {
+        currentSlot = indexHandle->SearchNode(leafData, highKey, bUpper);
+    }
+
+    pfPageHandle = new PF_PageHandle();
+    if ((rc = indexHandle->pfh->GetThisPage(currentPageNum, *pfPageHandle))) {
+        delete pfPageHandle;
+        pfPageHandle = NULL;
+        return rc;
+    }
+    pinned = TRUE;
+
+    return 0;
+}
+
 //
 // SearchKey: 在B+树中搜索键值
+// 输出: leafPage - 可能包含该键第一次出现的叶子
+//       slotNum  - 叶子中第一个不小于该键的位置
+// 返回: 找到确切匹配返回0，否则返回IX_ENTRYNOTFOUND
 //
 RC IX_IndexScan::SearchKey(void *searchKey, PageNum &leafPage, int &slotNum) {
     RC rc;
-    PageNum pageNum = indexHandle->indexHdr.rootPage;
-    
-    if (pageNum == IX_NO_PAGE) {
+    char leafData[PF_PAGE_SIZE];
+    uint64_t version;
+
+    // 经过常驻内存的上层节点下降，只有叶子通过缓冲区读
+    do {
+        rc = indexHandle->FindLeafOptimistic(searchKey, false, leafPage, leafData, version);
+    } while (rc == IX_RESTART);
+    if (rc) {
+        return rc;
+    }
+    if (leafPage == IX_NO_PAGE) {
         return IX_ENTRYNOTFOUND;
     }
     
-    // 从根节点开始搜索
-    while (true) {
-        PF_PageHandle ph;
-        char *nodeData;
-        
-        if ((rc = indexHandle->pfh->GetThisPage(pageNum, ph))) {
-            return rc;
-        }
-        
-        if ((rc = ph.GetData(nodeData))) {
-            indexHandle->pfh->UnpinPage(pageNum);
-            return rc;
-        }
-        
-        IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
-        
-        if (nodeHdr->isLeaf) {
-            // 到达叶子节点，查找键值
-            rc = FindKeyInLeaf(nodeData, searchKey, slotNum);
-            leafPage = pageNum;
-            
-            indexHandle->pfh->UnpinPage(pageNum);
-            return rc;
-        } else {
-            // 内部节点，找到子节点
-            PageNum childPage;
-            rc = FindChildPageForKey(nodeData, searchKey, childPage);
-            
-            indexHandle->pfh->UnpinPage(pageNum);
-            
-            if (rc != 0) {
-                return rc;
-            }
-            
-            pageNum = childPage;
-        }
-    }
+    return FindKeyInLeaf(leafData, searchKey, slotNum);
 }
 
 //
@@ -360,24 +766,15 @@ RC IX_IndexScan::SearchKey(void *searchKey, PageNum &leafPage, int &slotNum) {
 //
 RC IX_IndexScan::FindKeyInLeaf(char *nodeData, void *searchKey, int &slotNum) {
     IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
-    char *entries = nodeData + sizeof(IX_NodeHdr);
-    int entrySize = indexHandle->GetLeafEntrySize();
     
-    for (int i = 0; i < nodeHdr->numKeys; i++) {
-        char *entry = entries + i * entrySize;
-        int cmp = indexHandle->CompareKeys(searchKey, entry);
-        
-        if (cmp == 0) {
-            slotNum = i;
-            return 0; // 找到匹配键值
-        } else if (cmp < 0) {
-            slotNum = i;
-            return IX_ENTRYNOTFOUND; // 没有完全匹配，但找到插入位置
-        }
+    // 二分查找第一个不小于searchKey的条目
+    slotNum = indexHandle->SearchNode(nodeData, searchKey, false);
+    if (slotNum < nodeHdr->numKeys &&
+        indexHandle->CompareLeafKey(searchKey, nodeData, slotNum) == 0) {
+        return 0; // 找到匹配键值
     }
     
-    slotNum = nodeHdr->numKeys;
-    return IX_ENTRYNOTFOUND; // 键值比所有现有键都大
+    return IX_ENTRYNOTFOUND; // 没有完全匹配，slotNum为插入位置
 }
 
 //
@@ -397,27 +794,52 @@ RC IX_IndexScan::GetNextEntryInPage(RID &rid) {
     
     IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
     
-    // 移动到下一个slot
-    currentSlot++;
+    // 当前条目是RID列表时先取完列表中的RID，每次解码一个bucket页
+    if (postingPos < postingRids.size()) {
+        rid = postingRids[postingPos++];
+        return 0;
+    }
+    if (postingNext != IX_NO_PAGE) {
+        if ((rc = indexHandle->ReadPostingPage(postingNext, postingRids, postingNext))) {
+            return rc;
+        }
+        postingPos = 0;
+        rid = postingRids[postingPos++];
+        return 0;
+    }
+    postingRids.clear();
+    postingPos = 0;
+
+    // 移动到下一个slot（反向扫描时为前一个）
+    currentSlot += bReverse ? -1 : 1;
     
-    if (currentSlot >= nodeHdr->numKeys) {
+    if (currentSlot < 0 || currentSlot >= nodeHdr->numKeys) {
         return IX_EOF; // 当前页面结束
     }
     
-    // 获取当前条目的RID
-    char *entries = nodeData + sizeof(IX_NodeHdr);
-    int entrySize = indexHandle->GetLeafEntrySize();
-    char *currentEntry = entries + currentSlot * entrySize;
+    // 还原当前条目的键值，获取RID
+    indexHandle->GetLeafKey(nodeData, currentSlot, curKey);
+    char *ridField = indexHandle->LeafRidField(nodeData, currentSlot);
     
+    if (indexHandle->IsPostingRef(ridField)) {
+        IX_PostingRef ref;
+        memcpy(&ref, ridField, sizeof(IX_PostingRef));
+        if ((rc = indexHandle->ReadPostingPage(ref.headPage, postingRids, postingNext))) {
+            return rc;
+        }
+        postingPos = 0;
+        rid = postingRids[postingPos++];
+        return 0;
+    }
+
     // RID存储在键值之后
-    RID *entryRID = (RID *)(currentEntry + indexHandle->indexHdr.attrLength);
-    rid = *entryRID;
-    
+    memcpy((char *)&rid, ridField, sizeof(RID));
+
     return 0;
 }
 
 //
-// MoveToNextPage: 移动到下一个叶子页面
+// MoveToNextPage: 移动到下一个叶子页面（反向扫描时为左边的叶子）
 //
 RC IX_IndexScan::MoveToNextPage() {
     RC rc;
@@ -433,12 +855,16 @@ RC IX_IndexScan::MoveToNextPage() {
     }
     
     IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
-    PageNum nextPage = nodeHdr->right;
+    PageNum nextPage = bReverse ? nodeHdr->left : nodeHdr->right;
     
     // 释放当前页面
     indexHandle->pfh->UnpinPage(currentPageNum);
     delete pfPageHandle;
+    pfPageHandle = NULL;
     pinned = FALSE;
+    postingRids.clear();
+    postingPos = 0;
+    postingNext = IX_NO_PAGE;
     
     if (nextPage == IX_NO_PAGE) {
         return IX_EOF; // 没有更多页面
@@ -455,95 +881,35 @@ RC IX_IndexScan::MoveToNextPage() {
     currentPageNum = nextPage;
     currentSlot = -1; // 重新开始
     pinned = TRUE;
+    if (bReverse) {
+        if ((rc = pfPageHandle->GetData(nodeData))) {
+            return rc;
+        }
+        currentSlot = ((IX_NodeHdr *)nodeData)->numKeys;
+    }
     
     return 0;
 }
 
 //
-// SatisfiesCondition: 检查当前条目是否满足扫描条件
+// CheckBounds: 检查键值与扫描范围的关系
+// 返回: <0 低于下界（跳过），0 在范围内，>0 超过上界（扫描结束）
 //
-bool IX_IndexScan::SatisfiesCondition(const RID &rid) {
-    RC rc;
-    char *nodeData;
-    
-    if (!hasValue || compOp == NO_OP) {
-        return true; // 无条件或无比较值
-    }
-    
-    // 获取当前条目的键值
-    if ((rc = pfPageHandle->GetData(nodeData))) {
-        return false;
-    }
-    
-    char *entries = nodeData + sizeof(IX_NodeHdr);
-    int entrySize = indexHandle->GetLeafEntrySize();
-    char *currentEntry = entries + currentSlot * entrySize;
-    
-    // 比较键值
-    int cmp = indexHandle->CompareKeys(currentEntry, value);
-    
-    switch (compOp) {
-        case EQ_OP:
-            return cmp == 0;
-        case LT_OP:
-            return cmp < 0;
-        case GT_OP:
-            return cmp > 0;
-        case LE_OP:
-            return cmp <= 0;
-        case GE_OP:
-            return cmp >= 0;
-        case NE_OP:
-            return cmp != 0;
-        case NO_OP:
-            return true;
-        default:
-            return false;
+int IX_IndexScan::CheckBounds(char *key) {
+    if (lowKey != NULL) {
+        int cmp = indexHandle->CompareKeys(key, lowKey);
+        if (cmp < 0 || (cmp == 0 && !lowInclusive)) {
+            return -1;
+        }
     }
-}
 
-//
-// FindChildPageForKey: 在内部节点中找到包含键值的子页面
-//
-RC IX_IndexScan::FindChildPageForKey(char *nodeData, void *searchKey, PageNum &childPage) {
-    IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
-    char *entries = nodeData + sizeof(IX_NodeHdr);
-    int entrySize = indexHandle->GetInternalEntrySize();
-    
-    // 第一个子页面指针
-    childPage = *(PageNum *)entries;
-    entries += sizeof(PageNum);
-    
-    // 查找正确的子页面
-    for (int i = 0; i < nodeHdr->numKeys; i++) {
-        char *keyPtr = entries + i * entrySize;
-        
-        if (indexHandle->CompareKeys(searchKey, keyPtr) < 0) {
-            // 键值小于当前键，应该在当前子页面中
-            return 0;
+    if (highKey != NULL) {
+        int cmp = indexHandle->CompareKeys(key, highKey);
+        if (cmp > 0 || (cmp == 0 && !highInclusive)) {
+            return 1;
         }
-        
-        // 移动到下一个子页面
-        childPage = *(PageNum *)(keyPtr + indexHandle->indexHdr.attrLength);
     }
-    
-    // 键值大于所有键，在最右边的子页面中
+
     return 0;
 }
 
-//
-// FindInsertPosition: 找到键值的插入位置（用于范围查询的起始位置）
-//
-RC IX_IndexScan::FindInsertPosition(void *searchKey, PageNum &leafPage, int &slotNum) {
-    // 这个函数与SearchKey类似，但专门用于找到插入位置
-    // 当没有找到确切匹配时，返回应该插入的位置
-    
-    RC rc = SearchKey(searchKey, leafPage, slotNum);
-    
-    // SearchKey如果返回IX_ENTRYNOTFOUND，slotNum已经设置为插入位置
-    if (rc == IX_ENTRYNOTFOUND) {
-        return 0; // 转换为成功，因为我们需要的是位置信息
-    }
-    
-    return rc;
-}
\ No newline at end of file
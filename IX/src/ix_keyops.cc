@@ -0,0 +1,207 @@
+//
+// ix_keyops.cc: 按键类型特化的键比较和节点内二分查找
+//
+// 每种键类型（以及常见的字符串长度）实例化一组比较和查找函数，
+// OpenIndex时根据索引的属性类型和长度选定一组，之后的比较不再按类型分支，
+// 二分查找内部的比较也会被内联。组合索引的键按属性逐个比较。
+//
+
+#include <cstring>
+#include "ix_internal.h"
+
+//
+// 数值键：INT、FLOAT
+//
+template <typename T>
+struct IX_NumericKey {
+    static int Compare(const char *key1, const char *key2, const IX_KeyDesc *) {
+        T v1, v2;
+        memcpy(&v1, key1, sizeof(T));
+        memcpy(&v2, key2, sizeof(T));
+        return (v1 < v2) ? -1 : ((v1 > v2) ? 1 : 0);
+    }
+};
+
+//
+// 字符串键：N为编译期长度，N为0时使用运行时的属性长度
+//
+template <int N>
+struct IX_StringKey {
+    static int Compare(const char *key1, const char *key2, const IX_KeyDesc *desc) {
+        return strncmp(key1, key2, (N > 0) ? N : desc->keyLength);
+    }
+};
+
+//
+// 组合键：按属性顺序逐个比较，第一个不相等的属性决定结果
+//
+struct IX_CompositeKey {
+    static int Compare(const char *key1, const char *key2, const IX_KeyDesc *desc) {
+        for (int i = 0; i < desc->nParts; i++) {
+            int cmp;
+            switch (desc->types[i]) {
+                case INT:
+                    cmp = IX_NumericKey<int>::Compare(key1, key2, desc);
+                    break;
+                case FLOAT:
+                    cmp = IX_NumericKey<float>::Compare(key1, key2, desc);
+                    break;
+                default:
+                    cmp = strncmp(key1, key2, desc->lengths[i]);
+                    break;
+            }
+            if (cmp != 0) {
+                return cmp;
+            }
+            key1 += desc->lengths[i];
+            key2 += desc->lengths[i];
+        }
+        return 0;
+    }
+};
+
+template <class Key>
+static int IX_CompareT(const void *key1, const void *key2, const IX_KeyDesc *desc) {
+    return Key::Compare((const char *)key1, (const char *)key2, desc);
+}
+
+//
+// IX_LowerBoundT: 第一个不小于key的键的位置（没有时返回nKeys）
+//
+template <class Key>
+static int IX_LowerBoundT(const char *keys, int nKeys, int stride,
+                          const void *key, const IX_KeyDesc *desc) {
+    int lo = 0;
+    int hi = nKeys;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (Key::Compare(keys + mid * stride, (const char *)key, desc) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+//
+// IX_UpperBoundT: 第一个大于key的键的位置（没有时返回nKeys）
+//
+template <class Key>
+static int IX_UpperBoundT(const char *keys, int nKeys, int stride,
+                          const void *key, const IX_KeyDesc *desc) {
+    int lo = 0;
+    int hi = nKeys;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (Key::Compare(keys + mid * stride, (const char *)key, desc) <= 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+template <class Key>
+struct IX_KeyOpsFor {
+    static const IX_KeyOps ops;
+};
+
+template <class Key>
+const IX_KeyOps IX_KeyOpsFor<Key>::ops = {
+    IX_CompareT<Key>,
+    IX_LowerBoundT<Key>,
+    IX_UpperBoundT<Key>
+};
+
+//
+// IX_GetKeyOps: 根据键的组成选择键操作
+//
+const IX_KeyOps *IX_GetKeyOps(const IX_KeyDesc &desc) {
+    if (desc.nParts > 1) {
+        return &IX_KeyOpsFor<IX_CompositeKey>::ops;
+    }
+    switch (desc.types[0]) {
+        case INT:
+            return &IX_KeyOpsFor<IX_NumericKey<int> >::ops;
+        case FLOAT:
+            return &IX_KeyOpsFor<IX_NumericKey<float> >::ops;
+        case STRING:
+            if (desc.keyLength == MAXSTRINGLEN) {
+                return &IX_KeyOpsFor<IX_StringKey<MAXSTRINGLEN> >::ops;
+            }
+            return &IX_KeyOpsFor<IX_StringKey<0> >::ops;
+        default:
+            return NULL;
+    }
+}
+
+//
+// IX_GetStringKeyOps: 按运行时长度比较的字符串键操作（用于叶子中去掉公共前缀后的键）
+//
+const IX_KeyOps *IX_GetStringKeyOps() {
+    return &IX_KeyOpsFor<IX_StringKey<0> >::ops;
+}
+
+//
+// IX_CompareSeparator: 比较完整的键key与截断的分隔键sep
+// sep只保存了前sepLength个字节，其余部分视为'\0'。
+// 前sepLength个字节相等且sep中没有'\0'时，key在此之后还有字符则更大
+//
+int IX_CompareSeparator(const void *key, const char *sep, int sepLength, int keyLength) {
+    const char *k = (const char *)key;
+    int cmp = strncmp(k, sep, sepLength);
+    if (cmp != 0 || sepLength >= keyLength || memchr(sep, '\0', sepLength) != NULL) {
+        return cmp;
+    }
+    return (k[sepLength] != '\0') ? 1 : 0;
+}
+
+//
+// IX_SearchSeparators: 在截断的分隔键中二分查找key
+// bUpper为false时返回第一个不小于key的位置，为true时返回第一个大于key的位置
+//
+int IX_SearchSeparators(const char *seps, int nKeys, int stride, int sepLength,
+                        const void *key, int keyLength, bool bUpper) {
+    int lo = 0;
+    int hi = nKeys;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        int cmp = IX_CompareSeparator(key, seps + mid * stride, sepLength, keyLength);
+        if (cmp > 0 || (bUpper && cmp == 0)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+//
+// IX_ValidKeyDesc: 检查属性个数以及各属性的类型和长度，总长度必须等于各部分之和。
+// 加上附带数据后，一个叶子节点至少要能放下IX_MIN_LEAF_ENTRIES个条目
+//
+bool IX_ValidKeyDesc(const IX_KeyDesc &desc) {
+    if (desc.nParts < 1 || desc.nParts > IX_MAX_KEY_PARTS) {
+        return false;
+    }
+    int keyLength = 0;
+    for (int i = 0; i < desc.nParts; i++) {
+        if ((desc.types[i] == INT || desc.types[i] == FLOAT) && desc.lengths[i] != 4) {
+            return false;
+        }
+        if (desc.types[i] == STRING && (desc.lengths[i] < 1 || desc.lengths[i] > MAXSTRINGLEN)) {
+            return false;
+        }
+        if (desc.types[i] != INT && desc.types[i] != FLOAT && desc.types[i] != STRING) {
+            return false;
+        }
+        keyLength += desc.lengths[i];
+    }
+    if (keyLength != desc.keyLength || desc.includeLength < 0) {
+        return false;
+    }
+    int leafEntrySize = desc.keyLength + (int)sizeof(RID) + desc.includeLength;
+    return leafEntrySize * IX_MIN_LEAF_ENTRIES <= IX_NODE_SPACE;
+}
@@ -0,0 +1,452 @@
+//
+// ix_latch.cc: B+树的并发控制（乐观锁耦合）
+//
+// 每个节点有一个版本号（IX_LatchTable），读者不加锁，读完后验证版本号；
+// 写者修改节点时加写锁，释放时版本号增加，正在读该节点的读者验证失败后从根重新开始。
+//
+//   查找：      从根乐观地下降，在叶子中读出RID后验证叶子的版本号
+//   插入/删除： 乐观地下降到叶子后把读锁升级为写锁，叶子放得下（删除后不会过空）时
+//               只修改这个叶子；否则持有文件头页（根页号）的写锁，在下降路径上的节点
+//               都加写锁后按原来的方式分裂或合并（InsertIntoNode、DeleteFromNode）
+//
+// 结构修改之间由文件头页的写锁串行化，只修改叶子的写者不会在持有锁时等待别的锁，
+// 因此不会死锁。分裂由版本号验证保护：读者经过的父节点在子节点分裂完成之前一直被锁住，
+// 所以不需要B-link树的右链接和上界键，叶子的右链接只用于顺序扫描
+//
+
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "ix_internal.h"
+
+using namespace std;
+
+//
+// IX_LatchTable
+//
+IX_LatchTable::IX_LatchTable() {
+    for (int i = 0; i < IX_LATCH_MAX_CHUNKS; i++) {
+        chunks[i].store(NULL, memory_order_relaxed);
+    }
+}
+
+IX_LatchTable::~IX_LatchTable() {
+    for (int i = 0; i < IX_LATCH_MAX_CHUNKS; i++) {
+        delete[] chunks[i].load(memory_order_relaxed);
+    }
+}
+
+//
+// Latch: 页面的版本号，第一次用到一组页面时才分配
+//
+atomic<uint64_t> *IX_LatchTable::Latch(PageNum pageNum) {
+    if (pageNum < 0 || pageNum >= IX_LATCH_CHUNK * IX_LATCH_MAX_CHUNKS) {
+        return NULL;
+    }
+
+    atomic<atomic<uint64_t> *> &slot = chunks[pageNum / IX_LATCH_CHUNK];
+    atomic<uint64_t> *chunk = slot.load(memory_order_acquire);
+    if (chunk == NULL) {
+        atomic<uint64_t> *fresh = new atomic<uint64_t>[IX_LATCH_CHUNK];
+        for (int i = 0; i < IX_LATCH_CHUNK; i++) {
+            fresh[i].store(0, memory_order_relaxed);
+        }
+        if (slot.compare_exchange_strong(chunk, fresh, memory_order_acq_rel)) {
+            chunk = fresh;
+        } else {
+            delete[] fresh;
+        }
+    }
+    return &chunk[pageNum % IX_LATCH_CHUNK];
+}
+
+//
+// ReadLatch: 等待写者释放后返回页面当前的版本号
+//
+uint64_t IX_IndexHandle::ReadLatch(PageNum pageNum) const {
+    atomic<uint64_t> *latch = latches->Latch(pageNum);
+    if (latch == NULL) {
+        return 0;
+    }
+    for (int spins = 0; ; spins++) {
+        uint64_t version = latch->load(memory_order_acquire);
+        if ((version & 1) == 0) {
+            return version;
+        }
+        if (spins >= IX_LATCH_SPINS) {
+            this_thread::yield();
+        }
+    }
+}
+
+//
+// ValidateLatch: 读完页面后验证版本号仍为version（期间没有写者修改过页面）
+//
+bool IX_IndexHandle::ValidateLatch(PageNum pageNum, uint64_t version) const {
+    atomic<uint64_t> *latch = latches->Latch(pageNum);
+    if (latch == NULL) {
+        return false;
+    }
+    atomic_thread_fence(memory_order_acquire);
+    return latch->load(memory_order_relaxed) == version;
+}
+
+//
+// UpgradeLatch: 版本号仍为version时加写锁
+// 返回: 期间有写者修改过页面（或正持有写锁）时返回false
+//
+bool IX_IndexHandle::UpgradeLatch(PageNum pageNum, uint64_t version) {
+    atomic<uint64_t> *latch = latches->Latch(pageNum);
+    return latch != NULL &&
+           latch->compare_exchange_strong(version, version + 1, memory_order_acquire);
+}
+
+//
+// LockNode: 等待并加写锁
+//
+void IX_IndexHandle::LockNode(PageNum pageNum) {
+    for (int spins = 0; ; spins++) {
+        uint64_t version = ReadLatch(pageNum);
+        if (UpgradeLatch(pageNum, version)) {
+            return;
+        }
+        if (spins >= IX_LATCH_SPINS) {
+            this_thread::yield();
+        }
+    }
+}
+
+//
+// UnlockNode: 释放写锁。修改过页面时版本号加2，否则恢复为加锁前的版本号，
+// 不必让正在读该页面的读者重新开始
+//
+void IX_IndexHandle::UnlockNode(PageNum pageNum, bool bModified) {
+    atomic<uint64_t> *latch = latches->Latch(pageNum);
+    if (latch == NULL) {
+        return;
+    }
+    if (bModified) {
+        latch->fetch_add(1, memory_order_release);
+    } else {
+        latch->fetch_sub(1, memory_order_release);
+    }
+}
+
+//
+// AllocatePage: 分配页面。PF文件头不是线程安全的，分配和释放需要互斥
+//
+RC IX_IndexHandle::AllocatePage(PF_PageHandle &pageHandle) {
+    lock_guard<mutex> guard(latches->fileLatch);
+    RC rc = pfh->AllocatePage(pageHandle);
+
+    // 超出版本号能表示的页数时不能使用这个页面
+    PageNum pageNum;
+    if (rc == 0 && pageHandle.GetPageNum(pageNum) == 0 && latches->Latch(pageNum) == NULL) {
+        pfh->UnpinPage(pageNum);
+        pfh->DisposePage(pageNum);
+        return PF_INVALIDPAGE;
+    }
+    return rc;
+}
+
+//
+// DisposePage: 把页面归还给PF的空闲页链表
+//
+RC IX_IndexHandle::DisposePage(PageNum pageNum) {
+    lock_guard<mutex> guard(latches->fileLatch);
+    return pfh->DisposePage(pageNum);
+}
+
+//
+// ReadNodeOptimistic: 把节点复制到nodeCopy（PF_PAGE_SIZE字节）后验证版本号，
+// 之后只使用这份一致的副本，不会读到写者修改了一半的节点
+// 返回: 与写者冲突时返回IX_RESTART
+//
+RC IX_IndexHandle::ReadNodeOptimistic(PageNum pageNum, uint64_t version, char *nodeCopy) {
+    RC rc;
+    PF_PageHandle ph;
+    char *nodeData;
+
+    if ((rc = pfh->GetThisPage(pageNum, ph))) {
+        return ValidateLatch(pageNum, version) ? rc : IX_RESTART;
+    }
+    if ((rc = ph.GetData(nodeData))) {
+        pfh->UnpinPage(pageNum);
+        return rc;
+    }
+    memcpy(nodeCopy, nodeData, PF_PAGE_SIZE);
+    pfh->UnpinPage(pageNum);
+    return ValidateLatch(pageNum, version) ? 0 : IX_RESTART;
+}
+
+//
+// FindLeafOptimistic: 不加锁地从根下降到pData所在的叶子
+// bUpper为false时取可能包含pData第一次出现的叶子，为true时取插入位置所在的叶子，
+// pData为NULL时取最左边（bUpper为true时最右边）的叶子。
+// 每读出一个子节点的页号，先读子节点的版本号，再验证父节点的版本号（乐观锁耦合）。
+// leafCopy中为叶子的一致副本，leafVersion为对应的版本号。
+// 每次下降计入运行统计，经过缓冲区读取的节点计入nProbePages
+// 返回: 索引为空时leafPage为IX_NO_PAGE；与写者冲突时返回IX_RESTART
+//
+RC IX_IndexHandle::FindLeafOptimistic(const void *pData, bool bUpper, PageNum &leafPage,
+                                      char *leafCopy, uint64_t &leafVersion) {
+    RC rc;
+    PageNum parentPage = IX_HEADER_PAGE;
+    uint64_t parentVersion = ReadLatch(IX_HEADER_PAGE);
+    PageNum pageNum = indexHdr.rootPage;
+
+    leafPage = IX_NO_PAGE;
+    if (pageNum == IX_NO_PAGE) {
+        return ValidateLatch(parentPage, parentVersion) ? 0 : IX_RESTART;
+    }
+    counters->nProbes++;
+
+    // 先在常驻内存的上层节点中下降：副本的版本号就是页面当前的版本号时副本与页面相同。
+    // 副本过时或者下一层不在内存中时，从pageNum开始通过缓冲区继续下降
+    shared_ptr<const IX_CachedNode> node = atomic_load(&topCache);
+    while (node && node->pageNum == pageNum) {
+        if (ReadLatch(pageNum) != node->version) {
+            break;
+        }
+        if (!ValidateLatch(parentPage, parentVersion)) {
+            return IX_RESTART;
+        }
+        const char *nodeData = node->data.data();
+        int childNo = pData ? SearchNode(nodeData, pData, bUpper)
+                            : (bUpper ? ((const IX_NodeHdr *)nodeData)->numKeys : 0);
+        parentPage = pageNum;
+        parentVersion = node->version;
+        pageNum = GetChildPage(nodeData, childNo);
+        node = node->children[childNo];
+    }
+
+    while (true) {
+        uint64_t version = ReadLatch(pageNum);
+        if (!ValidateLatch(parentPage, parentVersion)) {
+            return IX_RESTART;
+        }
+        counters->nProbePages++;
+        if ((rc = ReadNodeOptimistic(pageNum, version, leafCopy))) {
+            return rc;
+        }
+        if (((IX_NodeHdr *)leafCopy)->isLeaf) {
+            leafPage = pageNum;
+            leafVersion = version;
+            return 0;
+        }
+        parentPage = pageNum;
+        parentVersion = version;
+        int childNo = pData ? SearchNode(leafCopy, pData, bUpper)
+                            : (bUpper ? ((IX_NodeHdr *)leafCopy)->numKeys : 0);
+        pageNum = GetChildPage(leafCopy, childNo);
+    }
+}
+
+//
+// Lookup: 键值等于pData的所有RID（重复键的RID列表展开）
+// 不加锁，与并发的插入、删除冲突时重新查找
+//
+RC IX_IndexHandle::Lookup(void *pData, vector<RID> &rids) {
+    RC rc;
+
+    if (!isOpenHandle) {
+        return IX_INDEXNOTOPEN;
+    }
+    if (pData == NULL) {
+        return IX_NULLPOINTER;
+    }
+
+    // 带Bloom过滤器的索引先查过滤器，判定不存在时不下降
+    if (!BloomMayContain(pData)) {
+        rids.clear();
+        counters->nFilterSkips++;
+        return 0;
+    }
+
+    // 哈希索引的目录和bucket在持有文件头页的锁时修改，查找也要持有它
+    if (hashTable != NULL) {
+        rids.clear();
+        LockNode(IX_HEADER_PAGE);
+        rc = HashLookup(pData, rids);
+        UnlockNode(IX_HEADER_PAGE, false);
+        return rc;
+    }
+
+    // 带写缓冲的B+树：持有缓冲区的锁，查找B+树后合并该键的消息
+    if (msgBuffer != NULL) {
+        lock_guard<mutex> guard(msgBuffer->latch);
+        do {
+            rids.clear();
+            rc = LookupOptimistic(pData, rids);
+        } while (rc == IX_RESTART);
+        if (rc == 0) {
+            MergeMessages(pData, rids);
+        }
+        return rc;
+    }
+
+    do {
+        rids.clear();
+        rc = LookupOptimistic(pData, rids);
+    } while (rc == IX_RESTART);
+    return rc;
+}
+
+//
+// LookupOptimistic: Lookup的一次尝试
+//
+RC IX_IndexHandle::LookupOptimistic(const void *pData, vector<RID> &rids) {
+    RC rc;
+    char leafData[PF_PAGE_SIZE];
+    PageNum leafPage;
+    uint64_t version;
+
+    if ((rc = FindLeafOptimistic(pData, false, leafPage, leafData, version))) {
+        return rc;
+    }
+    if (leafPage == IX_NO_PAGE) {
+        return 0;
+    }
+    return CollectEqualOptimistic(pData, leafPage, leafData, version, rids);
+}
+
+//
+// CollectEqualOptimistic: 从叶子副本leafData开始收集键值等于pData的所有RID
+// pData第一次出现不会在leafPage之前。相等的键可能延续到右边的叶子中，沿叶子链表向右时
+// 同样先读右边叶子的版本号，再验证当前叶子的版本号。返回时leafPage、leafData和version
+// 为停下来的叶子（其中第一个大于pData的键之前的键都不大于pData）
+// 返回: 与写者冲突时返回IX_RESTART，此时rids中可能只有一部分RID
+//
+RC IX_IndexHandle::CollectEqualOptimistic(const void *pData, PageNum &leafPage, char *leafData,
+                                          uint64_t &version, vector<RID> &rids) {
+    RC rc;
+
+    while (true) {
+        IX_NodeHdr *nodeHdr = (IX_NodeHdr *)leafData;
+        int i = SearchNode(leafData, pData, false);
+        for (; i < nodeHdr->numKeys && CompareLeafKey(pData, leafData, i) == 0; i++) {
+            char *ridField = LeafRidField(leafData, i);
+            if (!IsPostingRef(ridField)) {
+                RID rid;
+                memcpy((char *)&rid, ridField, sizeof(RID));
+                rids.push_back(rid);
+                continue;
+            }
+
+            // 重复键的RID列表：bucket页由叶子的写锁保护，复制后先验证叶子的版本号再解码
+            IX_PostingRef ref;
+            memcpy(&ref, ridField, sizeof(IX_PostingRef));
+            PageNum bucketPage = ref.headPage;
+            while (bucketPage != IX_NO_PAGE) {
+                char bucketData[PF_PAGE_SIZE];
+                rc = ReadNodeOptimistic(bucketPage, ReadLatch(bucketPage), bucketData);
+                if (!ValidateLatch(leafPage, version)) {
+                    return IX_RESTART;
+                }
+                if (rc) {
+                    return rc;
+                }
+                DecodePostingPage(bucketData, rids, bucketPage);
+            }
+        }
+
+        PageNum rightPage = nodeHdr->right;
+        if (i < nodeHdr->numKeys || rightPage == IX_NO_PAGE) {
+            return 0;
+        }
+
+        // 先读右边叶子的版本号，再确认当前叶子（和它的右链接）没有被修改过
+        uint64_t rightVersion = ReadLatch(rightPage);
+        if (!ValidateLatch(leafPage, version)) {
+            return IX_RESTART;
+        }
+        if ((rc = ReadNodeOptimistic(rightPage, rightVersion, leafData))) {
+            return rc;
+        }
+        leafPage = rightPage;
+        version = rightVersion;
+    }
+}
+
+//
+// InsertIntoLeafOptimistic: 乐观地下降到插入位置所在的叶子并加写锁，
+// 叶子放得下新条目时只修改这个叶子
+// 返回: 需要分裂（或索引为空）时返回IX_RESTART，叶子保持不变，调用者改用结构修改的方式插入
+//
+RC IX_IndexHandle::InsertIntoLeafOptimistic(const char *entry) {
+    RC rc;
+    char leafCopy[PF_PAGE_SIZE];
+    PageNum leafPage;
+    uint64_t version;
+
+    do {
+        rc = FindLeafOptimistic(entry, true, leafPage, leafCopy, version);
+        if (rc == 0 && leafPage == IX_NO_PAGE) {
+            return IX_RESTART;
+        }
+    } while (rc == IX_RESTART || (rc == 0 && !UpgradeLatch(leafPage, version)));
+    if (rc) {
+        return rc;
+    }
+
+    // 持有写锁后叶子与副本相同，直接修改缓冲区中的叶子；InsertIntoLeaf在需要分裂时放弃
+    PF_PageHandle ph;
+    char *leafData;
+    if ((rc = pfh->GetThisPage(leafPage, ph)) == 0 && (rc = ph.GetData(leafData)) == 0) {
+        bool wasSplit = false;
+        void *newChildKey = NULL;
+        PageNum newChildPage = IX_NO_PAGE;
+        rc = InsertIntoLeaf(leafPage, leafData, entry, false, wasSplit, newChildKey, newChildPage);
+        if (rc == 0) {
+            pfh->MarkDirty(leafPage);
+        }
+        pfh->UnpinPage(leafPage);
+    }
+    UnlockNode(leafPage, rc != IX_RESTART);
+    return rc;
+}
+
+//
+// DeleteFromLeafOptimistic: 乐观地下降到可能包含pData第一次出现的叶子并加写锁，
+// 删除后叶子不会过空时只修改这个叶子
+// 返回: 叶子可能过空，或者在这个叶子中没有找到（相等的键可能延续到右边）时返回IX_RESTART，
+//       叶子保持不变，调用者改用结构修改的方式删除
+//
+RC IX_IndexHandle::DeleteFromLeafOptimistic(void *pData, const RID &rid) {
+    RC rc;
+    char leafCopy[PF_PAGE_SIZE];
+    PageNum leafPage;
+    uint64_t version;
+
+    do {
+        rc = FindLeafOptimistic(pData, false, leafPage, leafCopy, version);
+        if (rc == 0 && leafPage == IX_NO_PAGE) {
+            return IX_ENTRYNOTFOUND;
+        }
+    } while (rc == IX_RESTART || (rc == 0 && !UpgradeLatch(leafPage, version)));
+    if (rc) {
+        return rc;
+    }
+
+    IX_NodeHdr *nodeHdr = (IX_NodeHdr *)leafCopy;
+    int stride = GetLeafEntrySize() - nodeHdr->prefixLength;
+    if (NodeSpace(leafCopy) - stride < IX_MIN_NODE_SPACE) {
+        UnlockNode(leafPage, false);
+        return IX_RESTART;
+    }
+
+    PF_PageHandle ph;
+    char *leafData;
+    if ((rc = pfh->GetThisPage(leafPage, ph)) == 0 && (rc = ph.GetData(leafData)) == 0) {
+        rc = DeleteFromLeaf(leafData, pData, rid);
+        if (rc == IX_ENTRYNOTFOUND) {
+            rc = IX_RESTART;
+        }
+        if (rc == 0) {
+            pfh->MarkDirty(leafPage);
+        }
+        pfh->UnpinPage(leafPage);
+    }
+    UnlockNode(leafPage, rc != IX_RESTART);
+    return rc;
+}
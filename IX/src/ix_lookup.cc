@@ -0,0 +1,155 @@
+//
+// ix_lookup.cc: 批量查找
+//
+// 索引嵌套循环连接和IN列表要在同一个索引中查找大量的键值，逐个查找时每次都从根下降。
+// LookupBatch把键值排序后依次查找：下一个键值落在当前叶子或右边相邻的叶子中时沿叶子链表前进，
+// 否则经过常驻内存的上层节点重新下降，排序后相邻的键值共用同一次下降和同一个叶子副本
+//
+
+#include <algorithm>
+#include <cstring>
+#include "ix_internal.h"
+
+using namespace std;
+
+//
+// LookupBatch: 查找keys[0..nKeys-1]中每个键值的所有RID，每个匹配调用一次callback(keyIndex, rid)
+// 按键值从小到大的顺序返回，相等的键值各自得到同样的RID。
+// 与Lookup一样不加锁，可以与InsertEntry、DeleteEntry并发调用，
+// 每个键值的结果是查找该键值时索引的一致状态
+// 返回: callback返回非0时停止查找并返回该值
+//
+RC IX_IndexHandle::LookupBatch(void *const keys[], int nKeys,
+                               const function<RC(int keyIndex, const RID &rid)> &callback) {
+    RC rc;
+
+    if (!isOpenHandle) {
+        return IX_INDEXNOTOPEN;
+    }
+    if (nKeys > 0 && keys == NULL) {
+        return IX_NULLPOINTER;
+    }
+    for (int i = 0; i < nKeys; i++) {
+        if (keys[i] == NULL) {
+            return IX_NULLPOINTER;
+        }
+    }
+
+    // 按键值排序，相等的键值只查找一次
+    vector<int> order(nKeys);
+    for (int i = 0; i < nKeys; i++) {
+        order[i] = i;
+    }
+    stable_sort(order.begin(), order.end(), [this, keys](int a, int b) {
+        return keyOps->compare(keys[a], keys[b], &keyDesc) < 0;
+    });
+
+    char leafData[PF_PAGE_SIZE];
+    char spareData[PF_PAGE_SIZE];
+    PageNum leafPage = IX_NO_PAGE;
+    uint64_t version = 0;
+    bool bPositioned = false;
+    vector<RID> rids;
+
+    for (int first = 0; first < nKeys; ) {
+        const void *pData = keys[order[first]];
+        int last = first + 1;
+        while (last < nKeys && keyOps->compare(pData, keys[order[last]], &keyDesc) == 0) {
+            last++;
+        }
+
+        // Bloom过滤器判定不存在的键值不查找；哈希索引逐个查找；
+        // B+树与写者冲突时从根重新定位，只重新查找这一个键值。
+        // 带写缓冲的B+树在查找每个键值时持有缓冲区的锁，回调在锁外调用
+        if (!BloomMayContain(pData)) {
+            rids.clear();
+            counters->nFilterSkips++;
+            rc = 0;
+        } else if (hashTable != NULL) {
+            rc = Lookup((void *)pData, rids);
+        } else {
+            unique_lock<mutex> guard;
+            if (msgBuffer != NULL) {
+                guard = unique_lock<mutex>(msgBuffer->latch);
+            }
+            do {
+                rids.clear();
+                rc = PositionForKey(pData, leafPage, leafData, spareData, version, bPositioned);
+                if (rc == 0 && leafPage != IX_NO_PAGE) {
+                    rc = CollectEqualOptimistic(pData, leafPage, leafData, version, rids);
+                }
+                if (rc == IX_RESTART) {
+                    bPositioned = false;
+                }
+            } while (rc == IX_RESTART);
+            if (rc == 0 && msgBuffer != NULL) {
+                MergeMessages(pData, rids);
+            }
+        }
+        if (rc) {
+            return rc;
+        }
+
+        for (int k = first; k < last; k++) {
+            for (size_t r = 0; r < rids.size(); r++) {
+                if ((rc = callback(order[k], rids[r]))) {
+                    return rc;
+                }
+            }
+        }
+        first = last;
+    }
+
+    return 0;
+}
+
+//
+// LeafCovers: 叶子中第一个键小于pData，并且pData不大于最后一个键（或者叶子是最右边的叶子）
+// 这时左边的叶子中不会有等于pData的键，可以直接从这个叶子开始查找
+//
+bool IX_IndexHandle::LeafCovers(const char *leafData, const void *pData) const {
+    const IX_NodeHdr *nodeHdr = (const IX_NodeHdr *)leafData;
+    if (nodeHdr->numKeys == 0 || CompareLeafKey(pData, leafData, 0) <= 0) {
+        return false;
+    }
+    return nodeHdr->right == IX_NO_PAGE ||
+           CompareLeafKey(pData, leafData, nodeHdr->numKeys - 1) <= 0;
+}
+
+//
+// PositionForKey: 把当前叶子（leafPage、leafData、version）移到查找pData的起始叶子
+// 当前叶子没有被修改过并且覆盖pData时不动；右边相邻的叶子覆盖pData时移过去；
+// 否则经过常驻内存的上层节点重新下降。spareData为读右边叶子用的缓冲区
+// 返回: 索引为空时leafPage为IX_NO_PAGE；与写者冲突时返回IX_RESTART
+//
+RC IX_IndexHandle::PositionForKey(const void *pData, PageNum &leafPage, char *leafData,
+                                  char *spareData, uint64_t &version, bool &bPositioned) {
+    RC rc;
+
+    if (bPositioned && ValidateLatch(leafPage, version)) {
+        if (LeafCovers(leafData, pData)) {
+            return 0;
+        }
+
+        // 先读右边叶子的版本号，再确认当前叶子（和它的右链接）没有被修改过
+        PageNum rightPage = ((IX_NodeHdr *)leafData)->right;
+        if (rightPage != IX_NO_PAGE) {
+            uint64_t rightVersion = ReadLatch(rightPage);
+            if (ValidateLatch(leafPage, version) &&
+                ReadNodeOptimistic(rightPage, rightVersion, spareData) == 0 &&
+                LeafCovers(spareData, pData)) {
+                memcpy(leafData, spareData, PF_PAGE_SIZE);
+                leafPage = rightPage;
+                version = rightVersion;
+                return 0;
+            }
+        }
+    }
+
+    bPositioned = false;
+    if ((rc = FindLeafOptimistic(pData, false, leafPage, leafData, version))) {
+        return rc;
+    }
+    bPositioned = (leafPage != IX_NO_PAGE);
+    return 0;
+}
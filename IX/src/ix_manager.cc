@@ -3,15 +3,29 @@
 #include <cstring>
 #include <iostream>
 
-// 添加缺失的错误码定义
-#define IX_BADINDEXSPEC        (START_IX_ERR - 7)    // 无效索引规格
+// 添加缺失的定义
 #define IX_INVALID_PAGE        IX_NO_PAGE            // 无效页号
 
 //
 // 构造函数
 //
 IX_Manager::IX_Manager(PF_Manager &pfm) : pfManager(&pfm) {
-    // 无需额外初始化
+    topCacheBudget = IX_TOP_CACHE_BUDGET;
+    msgBufferSize = IX_DEFAULT_MSG_BUFFER;
+}
+
+//
+// SetTopCacheBudget: 之后打开的索引常驻内存的上层节点最多占用的字节数，0表示不保留
+//
+void IX_Manager::SetTopCacheBudget(int bytes) {
+    topCacheBudget = bytes;
+}
+
+//
+// SetMessageBufferSize: 之后打开的带写缓冲的索引的消息缓冲区大小，0表示每次修改都直接写入B+树
+//
+void IX_Manager::SetMessageBufferSize(int bytes) {
+    msgBufferSize = bytes;
 }
 
 //
@@ -34,6 +48,25 @@ IX_Manager::~IX_Manager() {
 //
 RC IX_Manager::CreateIndex(const char *fileName, int indexNo, 
                           AttrType attrType, int attrLength) {
+    IX_KeyDesc keyDesc;
+    keyDesc.nParts = 1;
+    keyDesc.types[0] = attrType;
+    keyDesc.lengths[0] = attrLength;
+    keyDesc.keyLength = attrLength;
+    keyDesc.includeLength = 0;
+    
+    return CreateIndex(fileName, indexNo, keyDesc);
+}
+
+//
+// 创建组合索引：键由keyDesc中的属性按顺序拼接而成，
+// 叶子条目另外附带keyDesc.includeLength字节的数据。
+// indexType为IX_HASH时创建可扩展哈希索引，哈希索引不能附带数据；
+// IX_BUFFERED时创建带写缓冲的B+树，文件格式与B+树相同。
+// bBloomFilter为true时索引带键值的Bloom过滤器，查找不存在的键值时不必下降
+//
+RC IX_Manager::CreateIndex(const char *fileName, int indexNo, const IX_KeyDesc &keyDesc,
+                           IX_IndexType indexType, bool bBloomFilter) {
     RC rc;
     
     // 参数检查
@@ -41,11 +74,12 @@ RC IX_Manager::CreateIndex(const char *fileName, int indexNo,
         return IX_BADINDEXSPEC;
     }
     
-    // 检查属性类型和长度
-    if ((attrType == INT || attrType == FLOAT) && attrLength != 4) {
+    // 检查各属性的类型和长度
+    if (!IX_ValidKeyDesc(keyDesc)) {
         return IX_BADINDEXSPEC;
     }
-    if (attrType == STRING && (attrLength < 1 || attrLength > MAXSTRINGLEN)) {
+    if (indexType != IX_BTREE && indexType != IX_BUFFERED &&
+        (indexType != IX_HASH || keyDesc.includeLength > 0)) {
         return IX_BADINDEXSPEC;
     }
     
@@ -75,11 +109,28 @@ RC IX_Manager::CreateIndex(const char *fileName, int indexNo,
     
     // 初始化IX_FileHdr文件头，一个索引文件有两个不同的文件头，一个是PF_FileHeader，一个是IX_FileHdr
     IX_FileHdr* fileHdr = (IX_FileHdr*)pageData;
-    fileHdr->attrType = attrType;
-    fileHdr->attrLength = attrLength;
+    fileHdr->attrType = keyDesc.types[0];
+    fileHdr->attrLength = keyDesc.keyLength;
     fileHdr->rootPage = IX_INVALID_PAGE;  // 空索引，暂无根节点
     fileHdr->numPages = 1;                // 只有头页面
     fileHdr->firstFreePage = IX_INVALID_PAGE;
+    fileHdr->nKeyParts = keyDesc.nParts;
+    for (int i = 0; i < IX_MAX_KEY_PARTS; i++) {
+        fileHdr->partTypes[i] = (i < keyDesc.nParts) ? keyDesc.types[i] : INT;
+        fileHdr->partLengths[i] = (i < keyDesc.nParts) ? keyDesc.lengths[i] : 0;
+    }
+    fileHdr->includeLength = keyDesc.includeLength;
+    fileHdr->indexType = indexType;
+    fileHdr->globalDepth = 0;
+    fileHdr->dirPage = IX_INVALID_PAGE;     // 哈希索引的目录在第一次插入时建立
+    fileHdr->statsValid = 1;
+    memset(&fileHdr->stats, 0, sizeof(fileHdr->stats));
+    fileHdr->bloomFilter = bBloomFilter ? 1 : 0;
+    fileHdr->bloomPage = IX_INVALID_PAGE;   // 位图在第一次关闭时写出
+    fileHdr->bloomBlocks = 0;
+    fileHdr->bloomCapacity = 0;
+    fileHdr->bloomStale = 0;
+    fileHdr->bloomClean = 0;
     
     // 标记页面为脏页并解除固定
     PageNum pageNum;
@@ -173,6 +224,45 @@ RC IX_Manager::OpenIndex(const char *fileName, int indexNo,
     indexHandle.indexHdr.numPages = fileHdr->numPages;
     indexHandle.indexHdr.firstFreePage = fileHdr->firstFreePage;
     
+    // 键的组成，没有记录属性信息的旧索引文件视为没有附带数据的单属性索引
+    IX_KeyDesc &keyDesc = indexHandle.keyDesc;
+    keyDesc.nParts = fileHdr->nKeyParts;
+    keyDesc.keyLength = fileHdr->attrLength;
+    keyDesc.includeLength = fileHdr->includeLength;
+    if (keyDesc.nParts >= 1 && keyDesc.nParts <= IX_MAX_KEY_PARTS) {
+        memcpy(keyDesc.types, fileHdr->partTypes, sizeof(keyDesc.types));
+        memcpy(keyDesc.lengths, fileHdr->partLengths, sizeof(keyDesc.lengths));
+    }
+    if (!IX_ValidKeyDesc(keyDesc)) {
+        keyDesc.nParts = 1;
+        keyDesc.types[0] = fileHdr->attrType;
+        keyDesc.lengths[0] = fileHdr->attrLength;
+        keyDesc.includeLength = 0;
+    }
+    
+    // 按键的组成选定键比较和节点内查找函数
+    indexHandle.keyOps = IX_GetKeyOps(keyDesc);
+    
+    // 哈希索引（旧索引文件的头页其余部分为0，即B+树）
+    PageNum dirPage = IX_INVALID_PAGE;
+    if (fileHdr->indexType == IX_HASH) {
+        indexHandle.hashTable = new IX_HashTable;
+        indexHandle.hashTable->globalDepth = fileHdr->globalDepth;
+        dirPage = fileHdr->dirPage;
+    }
+    bool bBuffered = (fileHdr->indexType == IX_BUFFERED);
+    
+    // 运行统计，旧索引文件没有统计时稍后重新统计
+    indexHandle.counters = new IX_StatCounters;
+    bool bRecount = (fileHdr->statsValid == 0);
+    if (!bRecount) {
+        indexHandle.counters->Load(fileHdr->stats);
+    }
+    
+    // Bloom过滤器的位图在统计就绪后读入（可能需要按条目数重新建立）
+    bool bBloom = (fileHdr->bloomFilter != 0);
+    IX_FileHdr bloomHdr = *fileHdr;
+    
     // 解除文件头页面的固定
     PageNum pageNum;
     if ((rc = pageHandle.GetPageNum(pageNum)) ||
@@ -180,12 +270,44 @@ RC IX_Manager::OpenIndex(const char *fileName, int indexNo,
         pfManager->CloseFile(*(indexHandle.pfh));
         delete indexHandle.pfh;
         indexHandle.pfh = NULL;
+        delete indexHandle.hashTable;
+        indexHandle.hashTable = NULL;
+        delete indexHandle.counters;
+        indexHandle.counters = NULL;
         return rc;
     }
     
-    // 设置索引句柄状态
+    // 设置索引句柄状态，节点的乐观锁随句柄创建
+    indexHandle.latches = new IX_LatchTable;
+    if (bBuffered) {
+        IX_MsgLess less = { indexHandle.keyOps, &indexHandle.keyDesc };
+        indexHandle.msgBuffer = new IX_MsgBuffer(less, msgBufferSize);
+    }
     indexHandle.isOpenHandle = true;
     
+    // 哈希索引的目录读入内存
+    if (indexHandle.hashTable != NULL && (rc = indexHandle.LoadHashDirectory(dirPage))) {
+        CloseIndex(indexHandle);
+        return rc;
+    }
+    
+    if (bRecount && (rc = indexHandle.RecountStats())) {
+        CloseIndex(indexHandle);
+        return rc;
+    }
+    
+    if (bBloom && (rc = indexHandle.OpenBloomFilter(bloomHdr))) {
+        CloseIndex(indexHandle);
+        return rc;
+    }
+    
+    // 把根和上面几层内部节点复制到内存中
+    indexHandle.topCacheBudget = topCacheBudget;
+    if ((rc = indexHandle.RefreshTopCache())) {
+        CloseIndex(indexHandle);
+        return rc;
+    }
+    
     return OK;
 }
 
@@ -200,6 +322,12 @@ RC IX_Manager::CloseIndex(IX_IndexHandle &indexHandle) {
         return IX_INDEXNOTOPEN;
     }
     
+    // 缓冲的消息先写入B+树，Bloom过滤器的位图写回它的页链
+    if ((rc = indexHandle.FlushMessages()) ||
+        (indexHandle.bloom != NULL && (rc = indexHandle.WriteBloomFilter()))) {
+        return rc;
+    }
+    
     // 写回文件头信息
     PF_PageHandle pageHandle;
     char* pageData;
@@ -217,6 +345,10 @@ RC IX_Manager::CloseIndex(IX_IndexHandle &indexHandle) {
     fileHdr->rootPage = indexHandle.indexHdr.rootPage;
     fileHdr->numPages = indexHandle.indexHdr.numPages;
     fileHdr->firstFreePage = indexHandle.indexHdr.firstFreePage;
+    indexHandle.SaveStats(fileHdr);
+    if (indexHandle.bloom != NULL) {
+        indexHandle.SaveBloomHeader(fileHdr);
+    }
     
     // 标记为脏页并解除固定
     PageNum pageNum;
@@ -232,6 +364,17 @@ RC IX_Manager::CloseIndex(IX_IndexHandle &indexHandle) {
     // 清理索引句柄
     delete indexHandle.pfh;
     indexHandle.pfh = NULL;
+    delete indexHandle.latches;
+    indexHandle.latches = NULL;
+    delete indexHandle.hashTable;
+    indexHandle.hashTable = NULL;
+    delete indexHandle.msgBuffer;
+    indexHandle.msgBuffer = NULL;
+    delete indexHandle.counters;
+    indexHandle.counters = NULL;
+    delete indexHandle.bloom;
+    indexHandle.bloom = NULL;
+    indexHandle.topCache.reset();
     indexHandle.isOpenHandle = false;
     
     return rc;
@@ -0,0 +1,315 @@
+//
+// ix_node.cc: B+树节点的存储格式
+//
+// 字符串键往往很长，但相邻的键通常有很长的公共前缀（URL、路径、带编号的名字），
+// 区分两个子树也只需要前几个字符。单属性字符串索引的节点做两种压缩：
+//
+//   叶子节点：  [节点头][公共前缀][后缀|RID|附带数据][后缀|RID|附带数据]...
+//   内部节点：  [节点头][子节点0][分隔键0|子节点1][分隔键1|子节点2]...
+//
+// 叶子中所有键的公共前缀（prefixLength字节）只存一份，条目中只保存其余部分；
+// 内部节点的分隔键是左边子树最大的键和右边子树最小的键之间最短的前缀，
+// 每个分隔键按本节点最长的分隔键（sepLength字节）定长存放，截掉的部分视为'\0'。
+// 条目仍然定长，节点内照常二分查找。
+//
+// 插入只在新键带有叶子的公共前缀、分隔键不超过sepLength并且放得下时原地进行，
+// 否则把节点整个解开，按新的前缀和分隔键长度重新写入，放不下时再分裂
+//
+
+#include <algorithm>
+#include <cstring>
+#include "ix_internal.h"
+
+using namespace std;
+
+//
+// TruncateKeys: 是否对键做前缀压缩和分隔键截断（只用于单属性字符串索引）
+//
+bool IX_IndexHandle::TruncateKeys() const {
+    return keyDesc.nParts == 1 && keyDesc.types[0] == STRING;
+}
+
+//
+// CommonPrefix: 两个键的公共前缀长度，到'\0'为止（不截断时为0）
+//
+int IX_IndexHandle::CommonPrefix(const char *key1, const char *key2) const {
+    if (!TruncateKeys()) {
+        return 0;
+    }
+    int i = 0;
+    while (i < indexHdr.attrLength && key1[i] == key2[i] && key1[i] != '\0') {
+        i++;
+    }
+    return i;
+}
+
+//
+// SeparatorLength: 内部节点中保存分隔键key需要的字节数
+//
+int IX_IndexHandle::SeparatorLength(const char *key) const {
+    if (!TruncateKeys()) {
+        return indexHdr.attrLength;
+    }
+    const char *end = (const char *)memchr(key, '\0', indexHdr.attrLength);
+    return (end != NULL) ? (int)(end - key) : indexHdr.attrLength;
+}
+
+//
+// MakeSeparator: 左边子树最大的键leftKey和右边子树最小的键rightKey之间的分隔键
+// 取rightKey的最短前缀，使它大于leftKey（两者相等时就是rightKey），写入sep并补零
+//
+void IX_IndexHandle::MakeSeparator(const char *leftKey, const char *rightKey, char *sep) const {
+    int attrLength = indexHdr.attrLength;
+    if (!TruncateKeys()) {
+        memcpy(sep, rightKey, attrLength);
+        return;
+    }
+
+    int length = CommonPrefix(leftKey, rightKey);
+    if (length < attrLength && rightKey[length] != '\0') {
+        length++;
+    }
+    memset(sep, 0, attrLength);
+    memcpy(sep, rightKey, length);
+}
+
+//
+// LeafSpace: 从firstKey到lastKey的nEntries个有序条目写入一个叶子需要的空间
+//
+int IX_IndexHandle::LeafSpace(const char *firstKey, const char *lastKey, int nEntries) const {
+    int prefixLength = (nEntries > 0) ? CommonPrefix(firstKey, lastKey) : 0;
+    return prefixLength + nEntries * (GetLeafEntrySize() - prefixLength);
+}
+
+//
+// LeafHasRoom: 键key带有叶子的公共前缀，并且叶子还能原地放下一个条目
+//
+bool IX_IndexHandle::LeafHasRoom(const char *nodeData, const char *key) const {
+    const IX_NodeHdr *nodeHdr = (const IX_NodeHdr *)nodeData;
+    int prefixLength = nodeHdr->prefixLength;
+    if (prefixLength > 0 && memcmp(key, nodeData + sizeof(IX_NodeHdr), prefixLength) != 0) {
+        return false;
+    }
+    int stride = GetLeafEntrySize() - prefixLength;
+    return prefixLength + (nodeHdr->numKeys + 1) * stride <= IX_NODE_SPACE;
+}
+
+//
+// LeafEntry: 叶子中第slot个条目（键的后缀）的位置
+//
+char *IX_IndexHandle::LeafEntry(char *nodeData, int slot) const {
+    int prefixLength = ((IX_NodeHdr *)nodeData)->prefixLength;
+    int stride = GetLeafEntrySize() - prefixLength;
+    return nodeData + sizeof(IX_NodeHdr) + prefixLength + slot * stride;
+}
+
+//
+// LeafRidField: 叶子中第slot个条目的RID（或IX_PostingRef）的位置，附带数据紧跟在后面
+//
+char *IX_IndexHandle::LeafRidField(char *nodeData, int slot) const {
+    int prefixLength = ((IX_NodeHdr *)nodeData)->prefixLength;
+    return LeafEntry(nodeData, slot) + indexHdr.attrLength - prefixLength;
+}
+
+//
+// GetLeafKey: 还原叶子中第slot个条目的完整键值
+//
+void IX_IndexHandle::GetLeafKey(const char *nodeData, int slot, char *key) const {
+    int prefixLength = ((const IX_NodeHdr *)nodeData)->prefixLength;
+    memcpy(key, nodeData + sizeof(IX_NodeHdr), prefixLength);
+    memcpy(key + prefixLength, LeafEntry((char *)nodeData, slot), indexHdr.attrLength - prefixLength);
+}
+
+//
+// CompareLeafKey: 比较键key与叶子中第slot个条目的键（<0、0、>0表示key更小、相等、更大）
+//
+int IX_IndexHandle::CompareLeafKey(const void *key, const char *nodeData, int slot) const {
+    int prefixLength = ((const IX_NodeHdr *)nodeData)->prefixLength;
+    const char *entry = LeafEntry((char *)nodeData, slot);
+    if (prefixLength == 0) {
+        return keyOps->compare(key, entry, &keyDesc);
+    }
+
+    // 公共前缀中没有'\0'，前缀不同时就决定了结果
+    int cmp = strncmp((const char *)key, nodeData + sizeof(IX_NodeHdr), prefixLength);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return strncmp((const char *)key + prefixLength, entry, indexHdr.attrLength - prefixLength);
+}
+
+//
+// ReadLeaf: 把叶子中的条目还原为完整的条目（键值 + RID + 附带数据）
+//
+void IX_IndexHandle::ReadLeaf(const char *nodeData, vector<char> &entries) const {
+    const IX_NodeHdr *nodeHdr = (const IX_NodeHdr *)nodeData;
+    int entrySize = GetLeafEntrySize();
+    int prefixLength = nodeHdr->prefixLength;
+
+    entries.resize((size_t)nodeHdr->numKeys * entrySize);
+    for (int i = 0; i < nodeHdr->numKeys; i++) {
+        char *entry = &entries[(size_t)i * entrySize];
+        memcpy(entry, nodeData + sizeof(IX_NodeHdr), prefixLength);
+        memcpy(entry + prefixLength, LeafEntry((char *)nodeData, i), entrySize - prefixLength);
+    }
+}
+
+//
+// WriteLeaf: 用nEntries个有序的完整条目重写叶子，重新计算公共前缀
+// 返回: 放不下时返回false，叶子保持不变
+//
+bool IX_IndexHandle::WriteLeaf(char *nodeData, const char *entries, int nEntries) const {
+    IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
+    int entrySize = GetLeafEntrySize();
+    const char *lastEntry = entries + (nEntries - 1) * entrySize;
+
+    if (LeafSpace(entries, lastEntry, nEntries) > IX_NODE_SPACE) {
+        return false;
+    }
+
+    int prefixLength = (nEntries > 0) ? CommonPrefix(entries, lastEntry) : 0;
+    int stride = entrySize - prefixLength;
+    nodeHdr->numKeys = nEntries;
+    nodeHdr->prefixLength = prefixLength;
+    memcpy(nodeData + sizeof(IX_NodeHdr), entries, prefixLength);
+    for (int i = 0; i < nEntries; i++) {
+        memcpy(LeafEntry(nodeData, i), entries + i * entrySize + prefixLength, stride);
+    }
+    return true;
+}
+
+//
+// InternalSpace: nKeys个分隔键按sepLength字节存放时内部节点需要的空间
+//
+int IX_IndexHandle::InternalSpace(int sepLength, int nKeys) const {
+    return (int)sizeof(PageNum) + nKeys * (sepLength + (int)sizeof(PageNum));
+}
+
+//
+// ReadInternal: 把内部节点的分隔键还原为完整的键（补零），连同numKeys + 1个子节点一起读出
+//
+void IX_IndexHandle::ReadInternal(const char *nodeData, vector<char> &keys,
+                                  vector<PageNum> &children) const {
+    const IX_NodeHdr *nodeHdr = (const IX_NodeHdr *)nodeData;
+    int attrLength = indexHdr.attrLength;
+    int sepLength = nodeHdr->sepLength;
+    const char *entries = nodeData + sizeof(IX_NodeHdr) + sizeof(PageNum);
+
+    keys.assign((size_t)nodeHdr->numKeys * attrLength, 0);
+    children.resize(nodeHdr->numKeys + 1);
+    for (int i = 0; i < nodeHdr->numKeys; i++) {
+        memcpy(&keys[(size_t)i * attrLength], entries + i * (sepLength + sizeof(PageNum)), sepLength);
+    }
+    for (int i = 0; i <= nodeHdr->numKeys; i++) {
+        children[i] = GetChildPage(nodeData, i);
+    }
+}
+
+//
+// WriteInternal: 用nKeys个完整的分隔键和nKeys + 1个子节点重写内部节点，
+// sepLength取其中最长的分隔键
+// 返回: 放不下时返回false，节点保持不变
+//
+bool IX_IndexHandle::WriteInternal(char *nodeData, const char *keys, const PageNum *children,
+                                   int nKeys) const {
+    IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
+    int attrLength = indexHdr.attrLength;
+
+    int sepLength = TruncateKeys() ? 0 : attrLength;
+    for (int i = 0; i < nKeys; i++) {
+        sepLength = max(sepLength, SeparatorLength(keys + i * attrLength));
+    }
+    if (InternalSpace(sepLength, nKeys) > IX_NODE_SPACE) {
+        return false;
+    }
+
+    nodeHdr->numKeys = nKeys;
+    nodeHdr->sepLength = sepLength;
+    char *entries = nodeData + sizeof(IX_NodeHdr);
+    memcpy(entries, &children[0], sizeof(PageNum));
+    entries += sizeof(PageNum);
+    for (int i = 0; i < nKeys; i++) {
+        memcpy(entries, keys + i * attrLength, sepLength);
+        memcpy(entries + sepLength, &children[i + 1], sizeof(PageNum));
+        entries += sepLength + sizeof(PageNum);
+    }
+    return true;
+}
+
+//
+// CompareSeparator: 比较键key与内部节点的第sepNo个分隔键
+//
+int IX_IndexHandle::CompareSeparator(const void *key, const char *nodeData, int sepNo) const {
+    int sepLength = ((const IX_NodeHdr *)nodeData)->sepLength;
+    const char *sep = nodeData + sizeof(IX_NodeHdr) + sizeof(PageNum) +
+                      sepNo * (sepLength + sizeof(PageNum));
+    if (TruncateKeys()) {
+        return IX_CompareSeparator(key, sep, sepLength, indexHdr.attrLength);
+    }
+    return keyOps->compare(key, sep, &keyDesc);
+}
+
+//
+// NodeSpace: 节点头之后已经使用的空间
+//
+int IX_IndexHandle::NodeSpace(const char *nodeData) const {
+    const IX_NodeHdr *nodeHdr = (const IX_NodeHdr *)nodeData;
+    if (nodeHdr->isLeaf) {
+        return nodeHdr->prefixLength + nodeHdr->numKeys * (GetLeafEntrySize() - nodeHdr->prefixLength);
+    }
+    return InternalSpace(nodeHdr->sepLength, nodeHdr->numKeys);
+}
+
+//
+// ChooseLeafSplit: 把nEntries个有序的完整条目分成两个叶子，返回右边叶子的第一个条目
+// 分裂点尽量靠近中间，但两边都要能按各自的公共前缀放下
+// 返回: 找不到这样的分裂点时返回-1
+//
+int IX_IndexHandle::ChooseLeafSplit(const char *entries, int nEntries) const {
+    int entrySize = GetLeafEntrySize();
+    for (int d = 0; d <= nEntries / 2; d++) {
+        int candidates[2] = { nEntries / 2 - d, nEntries / 2 + d };
+        for (int k = 0; k < 2; k++) {
+            int s = candidates[k];
+            if (s >= 1 && s < nEntries &&
+                LeafSpace(entries, entries + (s - 1) * entrySize, s) <= IX_NODE_SPACE &&
+                LeafSpace(entries + s * entrySize, entries + (nEntries - 1) * entrySize,
+                          nEntries - s) <= IX_NODE_SPACE) {
+                return s;
+            }
+        }
+    }
+    return -1;
+}
+
+//
+// ChooseInternalSplit: 把nKeys个完整的分隔键分到两个内部节点，返回移到上一层的键
+// 中间键尽量靠近中间，但两边都要能按各自最长的分隔键放下
+// 返回: 找不到这样的分裂点时返回-1
+//
+int IX_IndexHandle::ChooseInternalSplit(const char *keys, int nKeys) const {
+    int attrLength = indexHdr.attrLength;
+
+    // 前i个键和第i个键之后的键中最长的分隔键
+    vector<int> leftMax(nKeys + 1, 0);
+    vector<int> rightMax(nKeys + 1, 0);
+    for (int i = 0; i < nKeys; i++) {
+        leftMax[i + 1] = max(leftMax[i], SeparatorLength(keys + i * attrLength));
+    }
+    for (int i = nKeys - 1; i >= 0; i--) {
+        rightMax[i] = max(rightMax[i + 1], SeparatorLength(keys + i * attrLength));
+    }
+
+    for (int d = 0; d <= nKeys / 2; d++) {
+        int candidates[2] = { nKeys / 2 - d, nKeys / 2 + d };
+        for (int k = 0; k < 2; k++) {
+            int s = candidates[k];
+            if (s >= 0 && s < nKeys &&
+                InternalSpace(leftMax[s], s) <= IX_NODE_SPACE &&
+                InternalSpace(rightMax[s + 1], nKeys - s - 1) <= IX_NODE_SPACE) {
+                return s;
+            }
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,468 @@
+//
+// ix_posting.cc: 重复键的压缩RID列表
+//
+// 低基数属性（状态、国家等）的每个键值会重复成千上万次，逐条存放时
+// 每个RID都要带一份完整的键值。一个叶子中同一键值的条目足够多时，
+// 把它们合并为一个条目，RID按顺序存放在bucket页链表中，
+// 每个RID只记与前一个RID的差值（varint编码），同一页面上的相邻记录通常只占一个字节。
+//
+// bucket链表中的RID整体有序，每个bucket页头记有最后一个RID：
+// 插入时沿链表找到第一个最后RID不小于新RID的bucket，追加到末尾时不必解码；
+// 插在中间时解码该页、插入后重新编码，放不下时对半分裂成两页。
+//
+
+#include <algorithm>
+#include <cstring>
+#include "ix_internal.h"
+
+using namespace std;
+
+static_assert(sizeof(IX_PostingRef) <= sizeof(RID), "IX_PostingRef must fit in a RID slot");
+
+// 一个RID编码后的最大字节数（两个varint）
+#define IX_MAX_RID_BYTES 10
+
+//
+// IX_PutVarint: 按7位一组写入无符号整数，返回写入的字节数
+//
+static int IX_PutVarint(char *out, unsigned int value) {
+    int n = 0;
+    while (value >= 0x80) {
+        out[n++] = (char)((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (char)value;
+    return n;
+}
+
+//
+// IX_GetVarint: 读出一个varint，p移到其后
+//
+static unsigned int IX_GetVarint(const char *&p) {
+    unsigned int value = 0;
+    int shift = 0;
+    unsigned char byte;
+    do {
+        byte = (unsigned char)*p++;
+        value |= (unsigned int)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+//
+// IX_EncodeRid: 把RID编码为与(prevPage, prevSlot)的差值，并更新prevPage/prevSlot
+// 同一页面：varint(槽号差 << 1)；换页：varint(页号差 << 1 | 1)、varint(槽号)
+//
+static int IX_EncodeRid(char *out, PageNum &prevPage, SlotNum &prevSlot,
+                        PageNum pageNum, SlotNum slotNum) {
+    int n;
+    if (pageNum == prevPage) {
+        n = IX_PutVarint(out, (unsigned int)(slotNum - prevSlot) << 1);
+    } else {
+        n = IX_PutVarint(out, ((unsigned int)(pageNum - prevPage) << 1) | 1);
+        n += IX_PutVarint(out + n, (unsigned int)slotNum);
+    }
+    prevPage = pageNum;
+    prevSlot = slotNum;
+    return n;
+}
+
+//
+// IX_DecodeRids: 解码bucket页中的nRids个RID，追加到rids
+//
+static void IX_DecodeRids(const char *data, int nRids, vector<RID> &rids) {
+    PageNum pageNum = IX_NO_PAGE;
+    SlotNum slotNum = 0;
+    for (int i = 0; i < nRids; i++) {
+        unsigned int delta = IX_GetVarint(data);
+        if (delta & 1) {
+            pageNum += (PageNum)(delta >> 1);
+            slotNum = (SlotNum)IX_GetVarint(data);
+        } else {
+            slotNum += (SlotNum)(delta >> 1);
+        }
+        rids.push_back(RID(pageNum, slotNum));
+    }
+}
+
+//
+// IX_RidParts: RID的页号和槽号
+//
+static void IX_RidParts(const RID &rid, PageNum &pageNum, SlotNum &slotNum) {
+    rid.GetPageNum(pageNum);
+    rid.GetSlotNum(slotNum);
+}
+
+//
+// IX_WriteBucket: 从rids[first]开始把尽量多的RID编码进bucket页，返回下一个未写入的位置
+//
+static size_t IX_WriteBucket(char *pageData, const vector<RID> &rids, size_t first) {
+    IX_BucketHdr *hdr = (IX_BucketHdr *)pageData;
+    char *data = pageData + sizeof(IX_BucketHdr);
+    char encoded[IX_MAX_RID_BYTES];
+    PageNum prevPage = IX_NO_PAGE;
+    SlotNum prevSlot = 0;
+    int nBytes = 0;
+
+    size_t i = first;
+    for (; i < rids.size(); i++) {
+        PageNum pageNum;
+        SlotNum slotNum;
+        IX_RidParts(rids[i], pageNum, slotNum);
+        PageNum savePage = prevPage;
+        SlotNum saveSlot = prevSlot;
+        int n = IX_EncodeRid(encoded, prevPage, prevSlot, pageNum, slotNum);
+        if (nBytes + n > (int)IX_BUCKET_DATA_SIZE) {
+            prevPage = savePage;
+            prevSlot = saveSlot;
+            break;
+        }
+        memcpy(data + nBytes, encoded, n);
+        nBytes += n;
+    }
+
+    hdr->numRIDs = (int)(i - first);
+    hdr->numBytes = nBytes;
+    hdr->lastPage = prevPage;
+    hdr->lastSlot = prevSlot;
+    return i;
+}
+
+//
+// IX_RidAfterLast: rid是否排在bucket的最后一个RID之后
+//
+static bool IX_RidAfterLast(const IX_BucketHdr *hdr, const RID &rid) {
+    PageNum pageNum;
+    SlotNum slotNum;
+    IX_RidParts(rid, pageNum, slotNum);
+    return pageNum > hdr->lastPage || (pageNum == hdr->lastPage && slotNum > hdr->lastSlot);
+}
+
+//
+// UsePostings: 叶子条目没有附带数据时才合并重复键
+//
+bool IX_IndexHandle::UsePostings() const {
+    return keyDesc.includeLength == 0;
+}
+
+//
+// GetPostingThreshold: 一个叶子中同一键值的条目达到这个数目时合并为RID列表
+// 重复条目至少要占IX_POSTING_MIN_BYTES的叶子空间，但不超过叶子容量的一半
+//
+int IX_IndexHandle::GetPostingThreshold() {
+    int threshold = max(IX_POSTING_MIN_RIDS, (int)IX_POSTING_MIN_BYTES / GetLeafEntrySize());
+    return min(threshold, max(2, GetMaxLeafEntries() / 2));
+}
+
+//
+// IsPostingRef: 叶子条目的RID位置（LeafRidField）存放的是否为RID列表
+//
+bool IX_IndexHandle::IsPostingRef(const char *ridField) const {
+    IX_PostingRef ref;
+    memcpy(&ref, ridField, sizeof(IX_PostingRef));
+    return ref.marker == IX_POSTING_MARKER;
+}
+
+//
+// CreatePostingList: 把有序的rids写入新的bucket链表
+//
+RC IX_IndexHandle::CreatePostingList(const vector<RID> &rids, PageNum &headPage) {
+    RC rc;
+    PageNum prevPage = IX_NO_PAGE;
+    char *prevData = NULL;
+
+    headPage = IX_NO_PAGE;
+    size_t next = 0;
+    while (next < rids.size()) {
+        PF_PageHandle ph;
+        PageNum pageNum;
+        char *pageData;
+        if ((rc = AllocatePage(ph)) ||
+            (rc = ph.GetPageNum(pageNum)) ||
+            (rc = ph.GetData(pageData))) {
+            if (prevPage != IX_NO_PAGE) {
+                pfh->UnpinPage(prevPage);
+            }
+            return rc;
+        }
+
+        next = IX_WriteBucket(pageData, rids, next);
+        ((IX_BucketHdr *)pageData)->nextBucket = IX_NO_PAGE;
+        pfh->MarkDirty(pageNum);
+
+        if (prevPage == IX_NO_PAGE) {
+            headPage = pageNum;
+        } else {
+            ((IX_BucketHdr *)prevData)->nextBucket = pageNum;
+            pfh->UnpinPage(prevPage);
+        }
+        prevPage = pageNum;
+        prevData = pageData;
+    }
+
+    if (prevPage != IX_NO_PAGE) {
+        pfh->UnpinPage(prevPage);
+    }
+    return 0;
+}
+
+//
+// ConvertToPosting: 把叶子中从firstPos开始的nDups个相等键的条目和新的rid合并为一个RID列表条目
+//
+RC IX_IndexHandle::ConvertToPosting(char *nodeData, int firstPos, int nDups, const RID &rid) {
+    RC rc;
+    IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
+    int stride = GetLeafEntrySize() - nodeHdr->prefixLength;
+
+    vector<RID> rids;
+    rids.reserve(nDups + 1);
+    for (int i = 0; i < nDups; i++) {
+        RID dupRid;
+        memcpy((char *)&dupRid, LeafRidField(nodeData, firstPos + i), sizeof(RID));
+        rids.push_back(dupRid);
+    }
+    rids.push_back(rid);
+    sort(rids.begin(), rids.end());
+    rids.erase(unique(rids.begin(), rids.end()), rids.end());
+
+    IX_PostingRef ref;
+    ref.marker = IX_POSTING_MARKER;
+    ref.numRIDs = (int)rids.size();
+    if ((rc = CreatePostingList(rids, ref.headPage))) {
+        return rc;
+    }
+
+    // 第一个条目改为RID列表，去掉其余的重复条目
+    char *first = LeafEntry(nodeData, firstPos);
+    memcpy(LeafRidField(nodeData, firstPos), &ref, sizeof(IX_PostingRef));
+    int moveSize = (nodeHdr->numKeys - firstPos - nDups) * stride;
+    if (moveSize > 0) {
+        memmove(first + stride, first + nDups * stride, moveSize);
+    }
+    nodeHdr->numKeys -= nDups - 1;
+
+    return 0;
+}
+
+//
+// InsertIntoPosting: 把rid加入叶子条目的RID列表（ridField为条目中IX_PostingRef的位置），
+// 列表中已有时不重复加入
+//
+RC IX_IndexHandle::InsertIntoPosting(char *ridField, const RID &rid) {
+    RC rc;
+    IX_PostingRef ref;
+    memcpy(&ref, ridField, sizeof(IX_PostingRef));
+
+    // 找到第一个最后RID不小于rid的bucket（没有时为最后一个bucket）
+    PageNum pageNum = ref.headPage;
+    PF_PageHandle ph;
+    char *pageData;
+    while (true) {
+        if ((rc = pfh->GetThisPage(pageNum, ph)) ||
+            (rc = ph.GetData(pageData))) {
+            return rc;
+        }
+        IX_BucketHdr *hdr = (IX_BucketHdr *)pageData;
+        if (!IX_RidAfterLast(hdr, rid) || hdr->nextBucket == IX_NO_PAGE) {
+            break;
+        }
+        PageNum nextPage = hdr->nextBucket;
+        pfh->UnpinPage(pageNum);
+        pageNum = nextPage;
+    }
+
+    IX_BucketHdr *hdr = (IX_BucketHdr *)pageData;
+    PageNum ridPage;
+    SlotNum ridSlot;
+    IX_RidParts(rid, ridPage, ridSlot);
+
+    if (IX_RidAfterLast(hdr, rid)) {
+        // 追加到整个列表的末尾：放得下时直接编码差值，否则在后面接一个新bucket
+        char encoded[IX_MAX_RID_BYTES];
+        PageNum prevPage = hdr->lastPage;
+        SlotNum prevSlot = hdr->lastSlot;
+        int n = IX_EncodeRid(encoded, prevPage, prevSlot, ridPage, ridSlot);
+        if (hdr->numBytes + n <= (int)IX_BUCKET_DATA_SIZE) {
+            memcpy(pageData + sizeof(IX_BucketHdr) + hdr->numBytes, encoded, n);
+            hdr->numBytes += n;
+            hdr->numRIDs++;
+            hdr->lastPage = ridPage;
+            hdr->lastSlot = ridSlot;
+        } else {
+            PageNum newPage;
+            vector<RID> single(1, rid);
+            if ((rc = CreatePostingList(single, newPage))) {
+                pfh->UnpinPage(pageNum);
+                return rc;
+            }
+            hdr->nextBucket = newPage;
+        }
+    } else {
+        // 插在bucket中间：解码、插入、重新编码，放不下时后一半移到新的bucket
+        vector<RID> rids;
+        IX_DecodeRids(pageData + sizeof(IX_BucketHdr), hdr->numRIDs, rids);
+        vector<RID>::iterator it = lower_bound(rids.begin(), rids.end(), rid);
+        if (it != rids.end() && *it == rid) {
+            pfh->UnpinPage(pageNum);
+            return 0;
+        }
+        rids.insert(it, rid);
+
+        PageNum nextBucket = hdr->nextBucket;
+        if (IX_WriteBucket(pageData, rids, 0) < rids.size()) {
+            size_t half = rids.size() / 2;
+            vector<RID> upper(rids.begin() + half, rids.end());
+            rids.resize(half);
+            PageNum newPage;
+            if ((rc = CreatePostingList(upper, newPage))) {
+                pfh->UnpinPage(pageNum);
+                return rc;
+            }
+            IX_WriteBucket(pageData, rids, 0);
+
+            // 新bucket接在当前bucket之后
+            PF_PageHandle newPh;
+            char *newData;
+            if ((rc = pfh->GetThisPage(newPage, newPh)) ||
+                (rc = newPh.GetData(newData))) {
+                pfh->UnpinPage(pageNum);
+                return rc;
+            }
+            ((IX_BucketHdr *)newData)->nextBucket = nextBucket;
+            pfh->MarkDirty(newPage);
+            pfh->UnpinPage(newPage);
+            nextBucket = newPage;
+        }
+        hdr->nextBucket = nextBucket;
+    }
+
+    pfh->MarkDirty(pageNum);
+    pfh->UnpinPage(pageNum);
+
+    ref.numRIDs++;
+    memcpy(ridField, &ref, sizeof(IX_PostingRef));
+    return 0;
+}
+
+//
+// DeleteFromPosting: 从叶子条目的RID列表中删除rid（ridField为条目中IX_PostingRef的位置）
+// 列表变空时释放所有bucket，bEmpty置为true，调用者应当删除该叶子条目
+//
+RC IX_IndexHandle::DeleteFromPosting(char *ridField, const RID &rid, bool &bEmpty) {
+    RC rc;
+    IX_PostingRef ref;
+    memcpy(&ref, ridField, sizeof(IX_PostingRef));
+    bEmpty = false;
+
+    // 找到第一个最后RID不小于rid的bucket
+    PageNum prevPage = IX_NO_PAGE;
+    PageNum pageNum = ref.headPage;
+    PF_PageHandle ph;
+    char *pageData;
+    while (true) {
+        if ((rc = pfh->GetThisPage(pageNum, ph)) ||
+            (rc = ph.GetData(pageData))) {
+            return rc;
+        }
+        IX_BucketHdr *hdr = (IX_BucketHdr *)pageData;
+        if (!IX_RidAfterLast(hdr, rid)) {
+            break;
+        }
+        PageNum nextPage = hdr->nextBucket;
+        pfh->UnpinPage(pageNum);
+        if (nextPage == IX_NO_PAGE) {
+            return IX_ENTRYNOTFOUND;
+        }
+        prevPage = pageNum;
+        pageNum = nextPage;
+    }
+
+    IX_BucketHdr *hdr = (IX_BucketHdr *)pageData;
+    vector<RID> rids;
+    IX_DecodeRids(pageData + sizeof(IX_BucketHdr), hdr->numRIDs, rids);
+    vector<RID>::iterator it = lower_bound(rids.begin(), rids.end(), rid);
+    if (it == rids.end() || !(*it == rid)) {
+        pfh->UnpinPage(pageNum);
+        return IX_ENTRYNOTFOUND;
+    }
+    rids.erase(it);
+    ref.numRIDs--;
+
+    if (!rids.empty()) {
+        PageNum nextBucket = hdr->nextBucket;
+        if (IX_WriteBucket(pageData, rids, 0) < rids.size()) {
+            pfh->UnpinPage(pageNum);
+            return IX_BUCKETFULL;
+        }
+        hdr->nextBucket = nextBucket;
+        memcpy(ridField, &ref, sizeof(IX_PostingRef));
+        pfh->MarkDirty(pageNum);
+        return pfh->UnpinPage(pageNum);
+    }
+    memcpy(ridField, &ref, sizeof(IX_PostingRef));
+
+    // bucket变空：从链表中摘下并释放。第一个bucket的页号记在叶子条目中，
+    // 它变空时把第二个bucket的内容搬过来，释放第二个bucket
+    PageNum nextBucket = hdr->nextBucket;
+    PageNum freePage = pageNum;
+    if (prevPage == IX_NO_PAGE && nextBucket != IX_NO_PAGE) {
+        PF_PageHandle nextPh;
+        char *nextData;
+        if ((rc = pfh->GetThisPage(nextBucket, nextPh)) ||
+            (rc = nextPh.GetData(nextData))) {
+            pfh->UnpinPage(pageNum);
+            return rc;
+        }
+        memcpy(pageData, nextData, PF_PAGE_SIZE);
+        pfh->UnpinPage(nextBucket);
+        pfh->MarkDirty(pageNum);
+        freePage = nextBucket;
+    } else if (prevPage != IX_NO_PAGE) {
+        PF_PageHandle prevPh;
+        char *prevData;
+        if ((rc = pfh->GetThisPage(prevPage, prevPh)) ||
+            (rc = prevPh.GetData(prevData))) {
+            pfh->UnpinPage(pageNum);
+            return rc;
+        }
+        ((IX_BucketHdr *)prevData)->nextBucket = nextBucket;
+        pfh->MarkDirty(prevPage);
+        pfh->UnpinPage(prevPage);
+    } else {
+        bEmpty = true;
+    }
+
+    pfh->UnpinPage(pageNum);
+    return DisposePage(freePage);
+}
+
+//
+// ReadPostingPage: 解码一个bucket页中的RID，nextPage为链表中的下一页
+//
+RC IX_IndexHandle::ReadPostingPage(PageNum pageNum, vector<RID> &rids, PageNum &nextPage) {
+    RC rc;
+    PF_PageHandle ph;
+    char *pageData;
+
+    if ((rc = pfh->GetThisPage(pageNum, ph)) ||
+        (rc = ph.GetData(pageData))) {
+        return rc;
+    }
+
+    rids.clear();
+    DecodePostingPage(pageData, rids, nextPage);
+
+    return pfh->UnpinPage(pageNum);
+}
+
+//
+// DecodePostingPage: 解码bucket页（或它的副本）中的RID，追加到rids
+//
+void IX_IndexHandle::DecodePostingPage(const char *pageData, vector<RID> &rids,
+                                       PageNum &nextPage) const {
+    const IX_BucketHdr *hdr = (const IX_BucketHdr *)pageData;
+    rids.reserve(rids.size() + hdr->numRIDs);
+    IX_DecodeRids(pageData + sizeof(IX_BucketHdr), hdr->numRIDs, rids);
+    nextPage = hdr->nextBucket;
+}
@@ -0,0 +1,155 @@
+//
+// ix_stats.cc: 索引的运行统计
+//
+// 高度、叶子页数和条目数在分裂、合并、插入和删除时增量修改，不需要遍历索引；
+// 查找和扫描的计数在下降和关闭扫描时累加。统计保存在索引文件头中，
+// 没有统计的旧索引文件在打开时遍历一次叶子层（或全部bucket）重新统计形状
+//
+
+#include <algorithm>
+#include <cstring>
+#include "ix_internal.h"
+
+using namespace std;
+
+//
+// Load/Save: 在原子计数器和文件头中的统计之间复制
+//
+void IX_StatCounters::Load(const IX_IndexStats &stats) {
+    height = stats.height;
+    nLeafPages = stats.nLeafPages;
+    nEntries = stats.nEntries;
+    nSplits = stats.nSplits;
+    nMerges = stats.nMerges;
+    nProbes = stats.nProbes;
+    nProbePages = stats.nProbePages;
+    nScanReturned = stats.nScanReturned;
+    nScanFiltered = stats.nScanFiltered;
+    nFilterSkips = stats.nFilterSkips;
+}
+
+void IX_StatCounters::Save(IX_IndexStats &stats) const {
+    stats.height = height;
+    stats.nLeafPages = nLeafPages;
+    stats.nEntries = nEntries;
+    stats.nSplits = nSplits;
+    stats.nMerges = nMerges;
+    stats.nProbes = nProbes;
+    stats.nProbePages = nProbePages;
+    stats.nScanReturned = nScanReturned;
+    stats.nScanFiltered = nScanFiltered;
+    stats.nFilterSkips = nFilterSkips;
+    stats.leafFill = 0;
+}
+
+//
+// GetStats: 索引的运行统计
+// 叶子的平均填充率 = 条目数 / (叶子页数 * 每页最多的条目数)，
+// 前缀压缩和重复键的RID列表使一页放下更多条目，此时估算值偏高（不超过1）
+//
+RC IX_IndexHandle::GetStats(IX_IndexStats &stats) const {
+    if (!isOpenHandle) {
+        return IX_INDEXNOTOPEN;
+    }
+
+    counters->Save(stats);
+    int perPage = hashTable ? GetHashBucketCapacity() : GetMaxLeafEntries();
+    if (stats.nLeafPages > 0 && perPage > 0) {
+        stats.leafFill = min(1.0, (double)stats.nEntries / ((double)stats.nLeafPages * perPage));
+    }
+    return 0;
+}
+
+//
+// SaveStats: 把统计写入文件头（调用者已固定头页）
+//
+void IX_IndexHandle::SaveStats(IX_FileHdr *fileHdr) const {
+    counters->Save(fileHdr->stats);
+    fileHdr->statsValid = 1;
+}
+
+//
+// RecountStats: 遍历索引重新统计高度、叶子页数和条目数，操作计数清零
+// B+树沿最左边的路径下降后顺着叶子链表读取，RID列表条目按其中的RID个数计；
+// 哈希索引读出每个bucket链的页头
+//
+RC IX_IndexHandle::RecountStats() {
+    RC rc;
+    IX_IndexStats stats;
+    memset(&stats, 0, sizeof(stats));
+
+    PageNum pageNum = IX_NO_PAGE;
+    if (hashTable != NULL) {
+        vector<PageNum> buckets(hashTable->directory);
+        sort(buckets.begin(), buckets.end());
+        buckets.erase(unique(buckets.begin(), buckets.end()), buckets.end());
+        for (size_t i = 0; i < buckets.size(); i++) {
+            pageNum = buckets[i];
+            while (pageNum != IX_NO_PAGE) {
+                PF_PageHandle ph;
+                char *data;
+                if ((rc = pfh->GetThisPage(pageNum, ph))) {
+                    return rc;
+                }
+                if ((rc = ph.GetData(data))) {
+                    pfh->UnpinPage(pageNum);
+                    return rc;
+                }
+                const IX_HashBucketHdr *bucketHdr = (const IX_HashBucketHdr *)data;
+                stats.nLeafPages++;
+                stats.nEntries += bucketHdr->numEntries;
+                PageNum nextPage = bucketHdr->overflow;
+                if ((rc = pfh->UnpinPage(pageNum))) {
+                    return rc;
+                }
+                pageNum = nextPage;
+            }
+        }
+        counters->Load(stats);
+        return 0;
+    }
+
+    if ((rc = GetTreeHeight(stats.height))) {
+        return rc;
+    }
+
+    // 最左边的叶子
+    pageNum = indexHdr.rootPage;
+    while (pageNum != IX_NO_PAGE) {
+        PF_PageHandle ph;
+        char *nodeData;
+        if ((rc = pfh->GetThisPage(pageNum, ph))) {
+            return rc;
+        }
+        if ((rc = ph.GetData(nodeData))) {
+            pfh->UnpinPage(pageNum);
+            return rc;
+        }
+
+        IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
+        PageNum nextPage;
+        if (nodeHdr->isLeaf) {
+            stats.nLeafPages++;
+            for (int slot = 0; slot < nodeHdr->numKeys; slot++) {
+                const char *ridField = LeafRidField(nodeData, slot);
+                if (UsePostings() && IsPostingRef(ridField)) {
+                    IX_PostingRef ref;
+                    memcpy(&ref, ridField, sizeof(IX_PostingRef));
+                    stats.nEntries += ref.numRIDs;
+                } else {
+                    stats.nEntries++;
+                }
+            }
+            nextPage = nodeHdr->right;
+        } else {
+            nextPage = GetChildPage(nodeData, 0);
+        }
+        if ((rc = pfh->UnpinPage(pageNum))) {
+            return rc;
+        }
+        pageNum = nextPage;
+    }
+
+    counters->Load(stats);
+    return 0;
+}
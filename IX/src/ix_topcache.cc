@@ -0,0 +1,184 @@
+//
+// ix_topcache.cc: 打开的索引常驻内存的上层节点
+//
+// 查找、插入、删除和扫描的起始定位都从根下降到叶子，每一层都要在缓冲区管理器中
+// 查找并固定页面，内部节点还可能被换出。打开索引时把根和上面几层内部节点复制到内存中，
+// 子节点的页号换成指向其副本的指针，下降时只有叶子经过缓冲区管理器。
+// 副本是否有效由节点的版本号（ix_latch.cc）判断，结构修改结束时由RefreshTopCache换上新的副本
+//
+
+#include <cstring>
+#include <map>
+#include "ix_internal.h"
+
+using namespace std;
+
+//
+// IX_CacheEntry: 重建副本时按层排列的一个内部节点
+//
+struct IX_CacheEntry {
+    PageNum pageNum;
+    int depth;                                // 根为0
+    int parent;                               // 父节点在数组中的位置，根为-1
+    int childNo;                              // 在父节点中是第几个子节点
+    shared_ptr<const IX_CachedNode> old;      // 仍然有效的旧副本
+    uint64_t version;
+    vector<char> data;                        // 没有旧副本时从页面复制的内容
+};
+
+//
+// GetTreeHeight: 树的高度（根为叶子时为1，空索引为0），沿最左边的路径下降
+//
+RC IX_IndexHandle::GetTreeHeight(int &height) {
+    RC rc;
+    PageNum pageNum = indexHdr.rootPage;
+
+    height = 0;
+    while (pageNum != IX_NO_PAGE) {
+        PF_PageHandle ph;
+        char *nodeData;
+
+        if ((rc = pfh->GetThisPage(pageNum, ph))) {
+            return rc;
+        }
+        if ((rc = ph.GetData(nodeData))) {
+            pfh->UnpinPage(pageNum);
+            return rc;
+        }
+
+        height++;
+        IX_NodeHdr *nodeHdr = (IX_NodeHdr *)nodeData;
+        PageNum childPage = nodeHdr->isLeaf ? IX_NO_PAGE : GetChildPage(nodeData, 0);
+        pfh->UnpinPage(pageNum);
+        pageNum = childPage;
+    }
+    return 0;
+}
+
+//
+// RefreshTopCache: 按层复制根和上面的内部节点，直到用完topCacheBudget
+// 页面版本号没有变化的旧副本直接沿用（子节点的副本也没有变化时连同指针一起沿用），
+// 其余的节点从缓冲区复制。调用者保证期间没有别的结构修改（持有文件头页的写锁，
+// 或者在打开索引、批量建立时单线程执行），只修改叶子的写者不影响内部节点
+//
+RC IX_IndexHandle::RefreshTopCache() {
+    RC rc;
+    shared_ptr<const IX_CachedNode> oldRoot = atomic_load(&topCache);
+
+    // 旧副本中页面没有修改过的节点
+    map<PageNum, shared_ptr<const IX_CachedNode> > fresh;
+    vector<shared_ptr<const IX_CachedNode> > stack;
+    if (oldRoot) {
+        stack.push_back(oldRoot);
+    }
+    while (!stack.empty()) {
+        shared_ptr<const IX_CachedNode> node = stack.back();
+        stack.pop_back();
+        if (ValidateLatch(node->pageNum, node->version)) {
+            fresh[node->pageNum] = node;
+        }
+        for (size_t i = 0; i < node->children.size(); i++) {
+            if (node->children[i]) {
+                stack.push_back(node->children[i]);
+            }
+        }
+    }
+
+    // 叶子不放在内存中，根为叶子时没有可以复制的节点
+    int height;
+    if ((rc = GetTreeHeight(height))) {
+        return rc;
+    }
+    if (height < 2 || topCacheBudget <= 0) {
+        atomic_store(&topCache, shared_ptr<const IX_CachedNode>());
+        return 0;
+    }
+
+    // 从根开始按层加入内部节点，直到超出内存预算
+    vector<IX_CacheEntry> entries(1);
+    entries[0].pageNum = indexHdr.rootPage;
+    entries[0].depth = 0;
+    entries[0].parent = -1;
+    entries[0].childNo = 0;
+    size_t used = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        const char *nodeData;
+        map<PageNum, shared_ptr<const IX_CachedNode> >::iterator it = fresh.find(entries[i].pageNum);
+        if (it != fresh.end()) {
+            entries[i].old = it->second;
+            entries[i].version = it->second->version;
+            nodeData = it->second->data.data();
+        } else {
+            PF_PageHandle ph;
+            char *pageData;
+            PageNum pageNum = entries[i].pageNum;
+            if ((rc = pfh->GetThisPage(pageNum, ph))) {
+                return rc;
+            }
+            if ((rc = ph.GetData(pageData))) {
+                pfh->UnpinPage(pageNum);
+                return rc;
+            }
+            IX_NodeHdr *nodeHdr = (IX_NodeHdr *)pageData;
+            size_t dataSize = sizeof(IX_NodeHdr) + sizeof(PageNum) +
+                              (size_t)nodeHdr->numKeys * (nodeHdr->sepLength + sizeof(PageNum));
+            entries[i].data.assign(pageData, pageData + dataSize);
+            entries[i].version = ReadLatch(pageNum);
+            pfh->UnpinPage(pageNum);
+            nodeData = entries[i].data.data();
+        }
+
+        int numKeys = ((const IX_NodeHdr *)nodeData)->numKeys;
+        size_t dataSize = entries[i].old ? entries[i].old->data.size() : entries[i].data.size();
+        size_t nodeSize = sizeof(IX_CachedNode) + dataSize +
+                          (numKeys + 1) * sizeof(shared_ptr<const IX_CachedNode>);
+        if (used + nodeSize > (size_t)topCacheBudget) {
+            entries.resize(i);
+            break;
+        }
+        used += nodeSize;
+
+        // 子节点仍是内部节点时排在后面
+        if (entries[i].depth + 2 < height) {
+            for (int c = 0; c <= numKeys; c++) {
+                IX_CacheEntry child;
+                child.pageNum = GetChildPage(nodeData, c);
+                child.depth = entries[i].depth + 1;
+                child.parent = (int)i;
+                child.childNo = c;
+                entries.push_back(child);
+            }
+        }
+    }
+
+    // 从下往上建立副本，子节点指针都没有变化的旧副本直接沿用
+    vector<vector<shared_ptr<const IX_CachedNode> > > children(entries.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        const char *nodeData = entries[i].old ? entries[i].old->data.data() : entries[i].data.data();
+        children[i].resize(((const IX_NodeHdr *)nodeData)->numKeys + 1);
+    }
+    shared_ptr<const IX_CachedNode> root;
+    for (int i = (int)entries.size() - 1; i >= 0; i--) {
+        IX_CacheEntry &entry = entries[i];
+        shared_ptr<const IX_CachedNode> built;
+        if (entry.old && entry.old->children == children[i]) {
+            built = entry.old;
+        } else {
+            shared_ptr<IX_CachedNode> node = make_shared<IX_CachedNode>();
+            node->pageNum = entry.pageNum;
+            node->version = entry.version;
+            node->data = entry.old ? entry.old->data : entry.data;
+            node->children.swap(children[i]);
+            built = node;
+        }
+
+        if (entry.parent >= 0) {
+            children[entry.parent][entry.childNo] = built;
+        } else {
+            root = built;
+        }
+    }
+
+    atomic_store(&topCache, root);
+    return 0;
+}
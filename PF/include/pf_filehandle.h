@@ -23,6 +23,7 @@ public:
                                                           // Get a specific page
     RC AllocatePage   (PF_PageHandle &pageHandle);        // Allocate a new page
     RC DisposePage    (PageNum pageNum);                  // Dispose of a page
+    RC TruncateFile   (PageNum numPages);                 // Drop pages at the end
     RC MarkDirty      (PageNum pageNum) const;            // Mark a page as dirty
     RC UnpinPage      (PageNum pageNum) const;            // Unpin a page
     RC ForcePages     (PageNum pageNum = ALL_PAGES) const;// Write dirty page(s)
@@ -35,6 +36,8 @@ public:
     RC WriteHeader();                                   // 写回文件头到磁盘
 
 private:
+    RC LinkFreePage(PageNum prevFree, PageNum pageNum);  // 设置空闲链表中prevFree的后继
+
     int fd;                                             // 文件描述符
     PF_FileHeader hdr;                                  // 文件头信息
     bool headerChanged;                                 // 文件头是否被修改
@@ -1,6 +1,7 @@
 #ifndef PF_STATISTICS_H
 #define PF_STATISTICS_H
 
+#include <atomic>
 #include <cstddef>
 #include <iostream>
 
@@ -10,6 +11,7 @@
  *
  * 该模块用于记录缓冲池的使用情况，比如页面访问次数、
  * 缓冲池命中率、磁盘 I/O 统计等。
+ * 计数器是原子变量，并行扫描的工作线程可以同时更新。
  */
 
 class PF_Statistics {
@@ -28,15 +30,15 @@ public:
 
     // 打印统计信息
     static void PrintStats(std::ostream &os = std::cout) {
-        size_t totalAccesses = bufferHits + bufferMisses;
+        size_t totalAccesses = bufferHits.load() + bufferMisses.load();
         double hitRate = (totalAccesses == 0) ? 0.0 :
-                         (static_cast<double>(bufferHits) / totalAccesses) * 100.0;
+                         (static_cast<double>(bufferHits.load()) / totalAccesses) * 100.0;
 
         os << "==== PF Statistics ====" << std::endl;
-        os << "Disk Reads     : " << diskReads << std::endl;
-        os << "Disk Writes    : " << diskWrites << std::endl;
-        os << "Buffer Hits    : " << bufferHits << std::endl;
-        os << "Buffer Misses  : " << bufferMisses << std::endl;
+        os << "Disk Reads     : " << diskReads.load() << std::endl;
+        os << "Disk Writes    : " << diskWrites.load() << std::endl;
+        os << "Buffer Hits    : " << bufferHits.load() << std::endl;
+        os << "Buffer Misses  : " << bufferMisses.load() << std::endl;
         os << "Hit Rate       : " << hitRate << "%" << std::endl;
         os << "========================" << std::endl;
     }
@@ -50,10 +52,10 @@ public:
     }
 
 private:
-    static size_t diskReads;
-    static size_t diskWrites;
-    static size_t bufferHits;
-    static size_t bufferMisses;
+    static std::atomic<size_t> diskReads;
+    static std::atomic<size_t> diskWrites;
+    static std::atomic<size_t> bufferHits;
+    static std::atomic<size_t> bufferMisses;
 };
 
 #endif // PF_STATISTICS_H
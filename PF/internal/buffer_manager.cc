@@ -10,7 +10,7 @@
  * @param poolSize 缓冲池大小（最多缓存多少页）
  */
 BufferManager::BufferManager(size_t poolSize) 
-    : poolSize(poolSize), frames(poolSize), pageTable(97) {
+    : poolSize(poolSize), frames(poolSize), lruPos(poolSize), pageTable(97) {
     
     // 初始化所有frame
     for (size_t i = 0; i < poolSize; ++i) {
@@ -18,10 +18,12 @@ BufferManager::BufferManager(size_t poolSize)
         frames[i].pageNum = -1;
         frames[i].dirty = false;
         frames[i].pinCount = 0;
+        frames[i].ioInProgress = false;
+        frames[i].writeFileDesc = -1;
         frames[i].data = new char[sizeof(PF_PageHeader) + PF_PAGE_SIZE];
         
         // 将frame索引加入LRU列表
-        lruList.push_back(static_cast<int>(i));
+        lruPos[i] = lruList.insert(lruList.end(), static_cast<int>(i));
     }
 }
 
@@ -42,25 +44,31 @@ BufferManager::~BufferManager() {
 
 /**
  * @brief 获取一个页面（可能命中缓冲池，也可能从磁盘加载到缓冲池再返回）
+ *
+ * 未命中时先在 latch 保护下选出 victim frame，把新页面以"读写中"的状态登记到
+ * 哈希表（需要写回的旧页面也暂时保留映射），然后释放 latch 进行磁盘读写，
+ * 其他线程请求这两个页面时等待读写完成。
  * @param fileDesc  文件描述符
  * @param pageNum   页号
  * @param pageData  返回指向页面数据的指针
  * @return RC 错误码
  */
 RC BufferManager::FetchPage(int fileDesc, PageNum pageNum, char **pageData) {
+    std::unique_lock<std::mutex> guard(latch);
     int frameID;
     
-    // 首先在哈希表中查找
-    if (pageTable.Find(fileDesc, pageNum, frameID) == 0) {
+    // 首先在哈希表中查找，页面正在读写时等待完成后重新查找
+    while (pageTable.Find(fileDesc, pageNum, frameID) == 0) {
+        if (frames[frameID].ioInProgress) {
+            ioDone.wait(guard);
+            continue;
+        }
+        
         // 缓冲池命中
         PF_Statistics::AddHit();
         
         // 更新LRU：将该frame移到列表末尾
-        auto it = std::find(lruList.begin(), lruList.end(), frameID);
-        if (it != lruList.end()) {
-            lruList.erase(it);
-            lruList.push_back(frameID);
-        }
+        TouchFrame(frameID);
         
         // 固定页面
         frames[frameID].pinCount++;
@@ -79,46 +87,68 @@ RC BufferManager::FetchPage(int fileDesc, PageNum pageNum, char **pageData) {
         return rc;
     }
     
-    // 如果victim frame是脏的，先写回磁盘
-    if (frames[frameID].dirty) {
-        rc = WriteFrameToDisk(frameID);
-        if (rc != 0) {
-            return rc;
-        }
-    }
-    
-    // 从哈希表中移除旧的映射
-    if (frames[frameID].fileDesc != -1) {
-        pageTable.Remove(frames[frameID].fileDesc, frames[frameID].pageNum);
+    // 脏的旧页面在写回完成前保留映射，其余情况直接移除
+    Frame& frame = frames[frameID];
+    int oldFileDesc = frame.fileDesc;
+    PageNum oldPageNum = frame.pageNum;
+    bool bWriteBack = (oldFileDesc != -1 && frame.dirty);
+    if (oldFileDesc != -1 && !bWriteBack) {
+        pageTable.Remove(oldFileDesc, oldPageNum);
     }
     
-    // 从磁盘读取新页面
-    rc = ReadPageFromDisk(fileDesc, pageNum, frameID);
+    // 登记新页面，frame在读写完成前不能被其他线程使用
+    rc = pageTable.Insert(fileDesc, pageNum, frameID);
     if (rc != 0) {
+        if (bWriteBack) {
+            return rc;
+        }
+        frame.fileDesc = -1;
+        frame.pageNum = -1;
         return rc;
     }
-    
-    // 更新frame信息
-    frames[frameID].fileDesc = fileDesc;
-    frames[frameID].pageNum = pageNum;
-    frames[frameID].dirty = false;
-    frames[frameID].pinCount = 1;
-    
-    // 插入到哈希表
-    rc = pageTable.Insert(fileDesc, pageNum, frameID);
+    frame.fileDesc = fileDesc;
+    frame.pageNum = pageNum;
+    frame.dirty = false;
+    frame.pinCount = 1;
+    frame.ioInProgress = true;
+    frame.writeFileDesc = bWriteBack ? oldFileDesc : -1;
+    TouchFrame(frameID);
+    
+    // 释放latch，写回旧页面并读入新页面
+    guard.unlock();
+    RC writeRC = bWriteBack ? WritePageToDisk(oldFileDesc, oldPageNum, frame.data) : 0;
+    if (writeRC == 0) {
+        rc = ReadPageFromDisk(fileDesc, pageNum, frameID);
+    }
+    guard.lock();
+    
+    if (writeRC != 0) {
+        // 写回失败：frame恢复为原来的脏页
+        pageTable.Remove(fileDesc, pageNum);
+        frame.fileDesc = oldFileDesc;
+        frame.pageNum = oldPageNum;
+        frame.dirty = true;
+        rc = writeRC;
+    } else {
+        if (bWriteBack) {
+            pageTable.Remove(oldFileDesc, oldPageNum);
+        }
+        if (rc != 0) {
+            pageTable.Remove(fileDesc, pageNum);
+            frame.fileDesc = -1;
+            frame.pageNum = -1;
+        }
+    }
+    frame.ioInProgress = false;
+    frame.writeFileDesc = -1;
+    ioDone.notify_all();
     if (rc != 0) {
+        frame.pinCount = 0;
         return rc;
     }
     
-    // 更新LRU：将该frame移到列表末尾
-    auto it = std::find(lruList.begin(), lruList.end(), frameID);
-    if (it != lruList.end()) {
-        lruList.erase(it);
-        lruList.push_back(frameID);
-    }
-    
     // 返回数据指针
-    *pageData = frames[frameID].data;
+    *pageData = frame.data;
     return 0;
 }
 
@@ -126,11 +156,12 @@ RC BufferManager::FetchPage(int fileDesc, PageNum pageNum, char **pageData) {
  * @brief 固定页面（增加 pinCount），防止被替换
  */
 RC BufferManager::PinPage(int fileDesc, PageNum pageNum) {
+    std::lock_guard<std::mutex> guard(latch);
     int frameID;
     
-    // 在哈希表中查找
+    // 在哈希表中查找（正在读写的页面还不能使用）
     RC rc = pageTable.Find(fileDesc, pageNum, frameID);
-    if (rc != 0) {
+    if (rc != 0 || frames[frameID].ioInProgress) {
         return PF_PAGENOTINBUF;  // 页面不在缓冲池中
     }
     
@@ -144,11 +175,12 @@ RC BufferManager::PinPage(int fileDesc, PageNum pageNum) {
  * @brief 释放页面（减少 pinCount），pinCount 为 0 时可被替换
  */
 RC BufferManager::UnpinPage(int fileDesc, PageNum pageNum) {
+    std::lock_guard<std::mutex> guard(latch);
     int frameID;
     
-    // 在哈希表中查找
+    // 在哈希表中查找（正在读写的页面没有被调用者固定）
     RC rc = pageTable.Find(fileDesc, pageNum, frameID);
-    if (rc != 0) {
+    if (rc != 0 || frames[frameID].ioInProgress) {
         return PF_PAGENOTINBUF;  // 页面不在缓冲池中
     }
     
@@ -167,11 +199,12 @@ RC BufferManager::UnpinPage(int fileDesc, PageNum pageNum) {
  * @brief 标记页面已修改，替换前需写回磁盘
  */
 RC BufferManager::MarkDirty(int fileDesc, PageNum pageNum) {
+    std::lock_guard<std::mutex> guard(latch);
     int frameID;
     
-    // 在哈希表中查找
+    // 在哈希表中查找（正在读写的页面没有被调用者固定）
     RC rc = pageTable.Find(fileDesc, pageNum, frameID);
-    if (rc != 0) {
+    if (rc != 0 || frames[frameID].ioInProgress) {
         return PF_PAGENOTINBUF;  // 页面不在缓冲池中
     }
     
@@ -185,6 +218,15 @@ RC BufferManager::MarkDirty(int fileDesc, PageNum pageNum) {
  * @brief 将所有脏页写回磁盘
  */
 RC BufferManager::FlushAllPages(int fileDesc) {
+    std::unique_lock<std::mutex> guard(latch);
+    ioDone.wait(guard, [this, fileDesc] { return !IoInProgress(fileDesc); });
+    return FlushFrames(fileDesc);
+}
+
+/**
+ * @brief 写回指定文件的所有脏页（调用者持有 latch）
+ */
+RC BufferManager::FlushFrames(int fileDesc) {
     RC rc = 0;
     
     // 遍历所有frame，写回指定文件的脏页
@@ -210,10 +252,12 @@ RC BufferManager::FlushAllPages(int fileDesc) {
 // 返回: RC 错误码
 //
 RC BufferManager::ClearFilePages(int fileDesc) {
+    std::unique_lock<std::mutex> guard(latch);
+    ioDone.wait(guard, [this, fileDesc] { return !IoInProgress(fileDesc); });
     RC rc = 0;
     
     // 先刷新该文件的所有脏页
-    rc = FlushAllPages(fileDesc);
+    rc = FlushFrames(fileDesc);
     if (rc != 0) {
         return rc;
     }
@@ -243,6 +287,39 @@ RC BufferManager::ClearFilePages(int fileDesc) {
     return 0;
 }
 
+//
+// DiscardPages - 丢弃指定文件中页号不小于firstPage的缓冲区页面
+//
+// 描述: 用于截断文件，被丢弃的页面即使是脏页也不写回磁盘
+// 输入:  fileDesc  - 文件描述符
+//        firstPage - 第一个要丢弃的页号
+// 返回: RC 错误码（有页面仍被固定时返回PF_PAGEPINNED，不丢弃任何页面）
+//
+RC BufferManager::DiscardPages(int fileDesc, PageNum firstPage) {
+    std::unique_lock<std::mutex> guard(latch);
+    ioDone.wait(guard, [this, fileDesc] { return !IoInProgress(fileDesc); });
+    
+    // 先检查是否有页面仍被固定
+    for (size_t i = 0; i < poolSize; ++i) {
+        if (frames[i].fileDesc == fileDesc && frames[i].pageNum >= firstPage &&
+            frames[i].pinCount > 0) {
+            return PF_PAGEPINNED;
+        }
+    }
+    
+    for (size_t i = 0; i < poolSize; ++i) {
+        if (frames[i].fileDesc == fileDesc && frames[i].pageNum >= firstPage) {
+            pageTable.Remove(frames[i].fileDesc, frames[i].pageNum);
+            frames[i].fileDesc = -1;
+            frames[i].pageNum = -1;
+            frames[i].dirty = false;
+            frames[i].pinCount = 0;
+        }
+    }
+    
+    return 0;
+}
+
 /**
  * @brief 选择一个 frame 替换
  * @param victim 返回被替换的 frame 索引
@@ -253,7 +330,7 @@ RC BufferManager::SelectVictimFrame(int &victim) {
     for (auto it = lruList.begin(); it != lruList.end(); ++it) {
         int frameID = *it;
         
-        // 如果frame没有被pin，则可以作为victim
+        // 如果frame没有被pin，则可以作为victim（读写中的frame总是被固定）
         if (frames[frameID].pinCount == 0) {
             victim = frameID;
             return 0;
@@ -264,6 +341,27 @@ RC BufferManager::SelectVictimFrame(int &victim) {
     return PF_NOBUF;
 }
 
+/**
+ * @brief 将 frame 移到 LRU 队列末尾（最近使用）
+ */
+void BufferManager::TouchFrame(int frameID) {
+    lruList.splice(lruList.end(), lruList, lruPos[frameID]);
+}
+
+/**
+ * @brief 文件是否有正在进行的 frame 读写（fileDesc 为 -1 时检查所有文件，调用者持有 latch）
+ */
+bool BufferManager::IoInProgress(int fileDesc) const {
+    for (size_t i = 0; i < poolSize; ++i) {
+        if (frames[i].ioInProgress &&
+            (fileDesc == -1 || frames[i].fileDesc == fileDesc ||
+             frames[i].writeFileDesc == fileDesc)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 /**
  * @brief 将 frame 写回磁盘
  */
@@ -277,18 +375,24 @@ RC BufferManager::WriteFrameToDisk(int frameID) {
         return PF_INVALIDPAGE;
     }
     
+    return WritePageToDisk(frame.fileDesc, frame.pageNum, frame.data);
+}
+
+/**
+ * @brief 将页面数据写到文件中的指定页（不访问 frame 状态，可以不持有 latch）
+ */
+RC BufferManager::WritePageToDisk(int fileDesc, PageNum pageNum, const char *data) {
     // 计算页面在文件中的偏移位置
-    long offset = static_cast<long>(frame.pageNum) * (sizeof(PF_PageHeader) + PF_PAGE_SIZE) 
+    long offset = static_cast<long>(pageNum) * (sizeof(PF_PageHeader) + PF_PAGE_SIZE) 
                   + sizeof(PF_FileHeader);
     
-    // 定位到文件位置
-    if (lseek(frame.fileDesc, offset, SEEK_SET) < 0) {
+    // 写入页面数据（包括页头和页面内容）
+    // 使用pwrite，不依赖（也不改变）文件的当前偏移
+    ssize_t bytesWritten = pwrite(fileDesc, data, 
+                                  sizeof(PF_PageHeader) + PF_PAGE_SIZE, offset);
+    if (bytesWritten < 0) {
         return PF_UNIX;
     }
-    
-    // 写入页面数据（包括页头和页面内容）
-    ssize_t bytesWritten = write(frame.fileDesc, frame.data, 
-                                sizeof(PF_PageHeader) + PF_PAGE_SIZE);
     if (bytesWritten != static_cast<ssize_t>(sizeof(PF_PageHeader) + PF_PAGE_SIZE)) {
         return PF_INCOMPLETEWRITE;
     }
@@ -311,14 +415,10 @@ RC BufferManager::ReadPageFromDisk(int fileDesc, PageNum pageNum, int frameID) {
     long offset = static_cast<long>(pageNum) * (sizeof(PF_PageHeader) + PF_PAGE_SIZE) 
                   + sizeof(PF_FileHeader);
     
-    // 定位到文件位置
-    if (lseek(fileDesc, offset, SEEK_SET) < 0) {
-        return PF_UNIX;
-    }
-    
     // 读取页面数据（包括页头和页面内容）
-    ssize_t bytesRead = read(fileDesc, frames[frameID].data, 
-                            sizeof(PF_PageHeader) + PF_PAGE_SIZE);
+    // 使用pread，不依赖（也不改变）文件的当前偏移
+    ssize_t bytesRead = pread(fileDesc, frames[frameID].data, 
+                              sizeof(PF_PageHeader) + PF_PAGE_SIZE, offset);
     if (bytesRead != static_cast<ssize_t>(sizeof(PF_PageHeader) + PF_PAGE_SIZE)) {
         // 如果是新页面（读取失败），则初始化为空页面
         if (bytesRead < 0) {
@@ -397,6 +497,7 @@ size_t BufferManager::SetBufferSizeFromMemory(size_t memoryKB) {
  * @brief 获取当前缓冲池统计信息
  */
 void BufferManager::GetBufferStats(size_t& totalFrames, size_t& usedFrames, size_t& memoryUsageKB) const {
+    std::lock_guard<std::mutex> guard(latch);
     totalFrames = poolSize;
     usedFrames = 0;
     
@@ -443,6 +544,8 @@ void BufferManager::PrintBufferStatus() const {
  * @brief 重新初始化缓冲池（用于动态调整大小）
  */
 RC BufferManager::ReinitializeBuffer(size_t newPoolSize) {
+    std::unique_lock<std::mutex> guard(latch);
+    ioDone.wait(guard, [this] { return !IoInProgress(-1); });
     if (newPoolSize == poolSize) {
         return 0;  // 大小没有变化
     }
@@ -464,6 +567,7 @@ RC BufferManager::ReinitializeBuffer(size_t newPoolSize) {
     // 3. 重新设置大小并初始化
     poolSize = newPoolSize;
     frames.resize(poolSize);
+    lruPos.resize(poolSize);
     lruList.clear();
     pageTable = HashTable(97);  // 重新初始化哈希表
     
@@ -494,9 +598,11 @@ void BufferManager::InitializeFrames() {
         frames[i].pageNum = -1;
         frames[i].dirty = false;
         frames[i].pinCount = 0;
+        frames[i].ioInProgress = false;
+        frames[i].writeFileDesc = -1;
         frames[i].data = new char[sizeof(PF_PageHeader) + PF_PAGE_SIZE];
         
         // 将frame索引加入LRU列表
-        lruList.push_back(static_cast<int>(i));
+        lruPos[i] = lruList.insert(lruList.end(), static_cast<int>(i));
     }
 }
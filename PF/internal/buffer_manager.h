@@ -4,6 +4,8 @@
 #include <cstddef>
 #include <vector>
 #include <list>
+#include <mutex>
+#include <condition_variable>
 #include "pf.h"
 #include "hash_table.h"
 
@@ -16,6 +18,12 @@
  * 提供高效的页面定位功能。
  * 
  * 增强功能：支持根据用户输入的主存大小动态分配缓冲区
+ *
+ * 线程安全：公开接口由 latch 互斥保护，并行扫描的工作线程可以同时
+ * 获取和释放页面。页面被固定期间 frame 不会被替换，因此调用者
+ * 在持有 pin 时可以不加锁地读取页面数据。
+ * 未命中时的磁盘读写在释放 latch 后进行：frame 先以"读写中"的状态登记到
+ * 哈希表，同一页面的其他请求在 ioDone 上等待，读写完成后再取回 latch 发布页面。
  */
 
 class BufferManager {
@@ -92,6 +100,7 @@ public:
      */
     RC FlushAllPages(int fileDesc);
     RC ClearFilePages(int fileDesc);  // 清空指定文件的所有缓冲区页面
+    RC DiscardPages(int fileDesc, PageNum firstPage);  // 丢弃页号不小于firstPage的页面（不写回）
 
     /**
      * @brief 获取当前缓冲池大小
@@ -108,13 +117,18 @@ private:
         PageNum pageNum;    // 页号
         bool dirty;         // 是否被修改过
         int pinCount;       // 是否被固定，固定则不可替换
+        bool ioInProgress;  // 正在（不持有 latch 地）写回旧页面或读入新页面
+        int writeFileDesc;  // 正在写回的旧页面所属文件（没有时为 -1）
         char *data;         // 指向页面数据的内存
     };
 
     size_t poolSize;                         // 缓冲池大小
     std::vector<Frame> frames;               // 所有 Frame
     std::list<int> lruList;                  // LRU 队列，存 frame 索引
+    std::vector<std::list<int>::iterator> lruPos;  // 每个 frame 在 LRU 队列中的位置
     HashTable pageTable;                      // Hash 映射：(fileDesc,pageNum)->frame
+    mutable std::mutex latch;                // 保护以上所有结构
+    std::condition_variable ioDone;          // frame 的磁盘读写完成时通知
 
     /**
      * @brief 选择一个 frame 替换
@@ -123,13 +137,33 @@ private:
      */
     RC SelectVictimFrame(int &victim);
 
+    /**
+     * @brief 将 frame 移到 LRU 队列末尾（最近使用）
+     */
+    void TouchFrame(int frameID);
+
+    /**
+     * @brief 写回指定文件的所有脏页（调用者持有 latch）
+     */
+    RC FlushFrames(int fileDesc);
+
+    /**
+     * @brief 文件是否有正在进行的 frame 读写（fileDesc 为 -1 时检查所有文件，调用者持有 latch）
+     */
+    bool IoInProgress(int fileDesc) const;
+
     /**
      * @brief 将 frame 写回磁盘
      */
     RC WriteFrameToDisk(int frameID);
 
     /**
-     * @brief 将页面从磁盘读取到 frame
+     * @brief 将页面数据写到文件中的指定页（不访问 frame 状态，可以不持有 latch）
+     */
+    RC WritePageToDisk(int fileDesc, PageNum pageNum, const char *data);
+
+    /**
+     * @brief 将页面从磁盘读取到 frame（调用者已独占该 frame，可以不持有 latch）
      */
     RC ReadPageFromDisk(int fileDesc, PageNum pageNum, int frameID);
 
@@ -1,5 +1,6 @@
 #include <unistd.h>
 #include <sys/types.h>
+#include <cstring>
 #include "pf_internal.h"
 #include "pf_filehandle.h"
 #include "pf_pagehandle.h"
@@ -215,32 +216,39 @@ RC PF_FileHandle::GetThisPage(PageNum pageNum, PF_PageHandle &pageHandle) const
 //
 // 流程：
 // 1. 检查文件是否打开
-// 2. 使用BufferManager分配新页面，页号为当前文件的页面总数：调用FetchPage从缓冲区获取页面，FetchPage调用ReadPageFromDisk在缓冲区中选一个Frame来存放新页面的数据
-// 3. 初始化页面头
-// 4. 更新文件头的页面总数和空闲链表
-// 5. 初始化页面句柄
-// 6. 标记页面为脏
-// 7. 更新磁盘使用统计
+// 2. 空闲链表不为空时取出第一个空闲页面（DisposePage释放的页面），内容清零后重新使用
+// 3. 否则使用BufferManager分配新页面，页号为当前文件的页面总数：调用FetchPage从缓冲区获取页面，FetchPage调用ReadPageFromDisk在缓冲区中选一个Frame来存放新页面的数据
+// 4. 初始化页面头
+// 5. 更新文件头的页面总数和空闲链表
+// 6. 初始化页面句柄
+// 7. 标记页面为脏
+// 8. 更新磁盘使用统计
 //
 RC PF_FileHandle::AllocatePage(PF_PageHandle &pageHandle) {
     // 检查文件是否打开
     if (!this->open)
         return PF_CLOSEDFILE;
 
-    // 分配新页面
+    // 优先重用空闲链表中的页面，否则在文件末尾分配新页面
     char *pageData;
     BufferManager& bufMgr = BufferManager::Instance();
-    PageNum pageNum = this->hdr.numPages;  // 页号是文件的页号，而不是缓冲区的页框号
+    bool reuse = (this->hdr.firstFree != PF_PAGE_LIST_END);
+    PageNum pageNum = reuse ? this->hdr.firstFree : this->hdr.numPages;  // 页号是文件的页号，而不是缓冲区的页框号
     RC rc = bufMgr.FetchPage(this->fd, pageNum, &pageData);  //this->hdr.numPages 是当前文件的页面总数，新页面的页号就是当前页面数（从0开始计数）
     if (rc != 0)
         return rc;
 
-    // 初始化页头
+    // 初始化页头（重用的页面先从空闲链表中摘下，并像新页面一样清零）
     PF_PageHeader *pageHeader = reinterpret_cast<PF_PageHeader*>(pageData);
+    if (reuse) {
+        this->hdr.firstFree = pageHeader->nextFree;
+        memset(pageData, 0, sizeof(PF_PageHeader) + PF_PAGE_SIZE);
+    }
     pageHeader->nextFree = PF_PAGE_LIST_END;
 
     // 更新文件头
-    this->hdr.numPages++;
+    if (!reuse)
+        this->hdr.numPages++;
     this->headerChanged = true;
 
     // 初始化页面句柄
@@ -308,6 +316,114 @@ RC PF_FileHandle::DisposePage(PageNum pageNum) {
     return 0;
 }
 
+//
+// TruncateFile
+//
+// 描述: 截断文件，只保留前numPages个页面
+// 输入参数:
+//     numPages - 截断后的页面总数
+// 返回值:
+//     PF return code（被截掉的页面仍被固定时返回PF_PAGEPINNED）
+//
+// 空闲链表中被截掉的页面先从链表中摘下，保留的空闲页面按原来的顺序重新链接
+//
+RC PF_FileHandle::TruncateFile(PageNum numPages) {
+    // 检查文件是否打开
+    if (!this->open)
+        return PF_CLOSEDFILE;
+
+    // 检查页面数是否有效
+    if (numPages < 0 || numPages > this->hdr.numPages)
+        return PF_INVALIDPAGE;
+    if (numPages == this->hdr.numPages)
+        return 0;
+
+    // 从空闲链表中摘掉被截掉的页面（这些页面释放时已经计入磁盘使用统计）
+    BufferManager& bufMgr = BufferManager::Instance();
+    char *pageData;
+    RC rc;
+    int droppedFree = 0;
+    PageNum prevFree = PF_PAGE_LIST_END;
+    PageNum pageNum = this->hdr.firstFree;
+    while (pageNum != PF_PAGE_LIST_END) {
+        if ((rc = bufMgr.FetchPage(this->fd, pageNum, &pageData)) != 0)
+            return rc;
+        PageNum nextFree = reinterpret_cast<PF_PageHeader*>(pageData)->nextFree;
+        if ((rc = bufMgr.UnpinPage(this->fd, pageNum)) != 0)
+            return rc;
+
+        if (pageNum >= numPages) {
+            droppedFree++;
+        } else {
+            if ((rc = LinkFreePage(prevFree, pageNum)) != 0)
+                return rc;
+            prevFree = pageNum;
+        }
+        pageNum = nextFree;
+    }
+    if (droppedFree > 0 && (rc = LinkFreePage(prevFree, PF_PAGE_LIST_END)) != 0)
+        return rc;
+
+    // 丢弃缓冲区中被截掉的页面
+    rc = bufMgr.DiscardPages(this->fd, numPages);
+    if (rc != 0)
+        return rc;
+
+    // 截断磁盘文件
+    off_t length = static_cast<off_t>(numPages) * (sizeof(PF_PageHeader) + PF_PAGE_SIZE)
+                   + sizeof(PF_FileHeader);
+    if (ftruncate(this->fd, length) < 0)
+        return PF_UNIX;
+
+    // 更新磁盘使用统计
+    int freedPages = this->hdr.numPages - numPages - droppedFree;
+    if (pManager != nullptr && pManager->GetDiskSpaceLimit() > 0) {
+        pManager->DeallocateDiskPages(freedPages);
+    }
+
+    // 更新文件头
+    this->hdr.numPages = numPages;
+    this->headerChanged = true;
+
+    return 0;
+}
+
+//
+// LinkFreePage
+//
+// 描述: 把空闲链表中prevFree之后的页面设为pageNum，prevFree为PF_PAGE_LIST_END时修改链表头
+// 输入参数:
+//     prevFree - 链表中的前一个空闲页面
+//     pageNum  - 新的后继页面（PF_PAGE_LIST_END表示链表结束）
+// 返回值:
+//     PF return code
+//
+RC PF_FileHandle::LinkFreePage(PageNum prevFree, PageNum pageNum) {
+    if (prevFree == PF_PAGE_LIST_END) {
+        if (this->hdr.firstFree != pageNum) {
+            this->hdr.firstFree = pageNum;
+            this->headerChanged = true;
+        }
+        return 0;
+    }
+
+    char *pageData;
+    BufferManager& bufMgr = BufferManager::Instance();
+    RC rc = bufMgr.FetchPage(this->fd, prevFree, &pageData);
+    if (rc != 0)
+        return rc;
+
+    PF_PageHeader *pageHeader = reinterpret_cast<PF_PageHeader*>(pageData);
+    if (pageHeader->nextFree != pageNum) {
+        pageHeader->nextFree = pageNum;
+        if ((rc = bufMgr.MarkDirty(this->fd, prevFree)) != 0) {
+            bufMgr.UnpinPage(this->fd, prevFree);
+            return rc;
+        }
+    }
+    return bufMgr.UnpinPage(this->fd, prevFree);
+}
+
 //
 // MarkDirty
 //
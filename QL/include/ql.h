@@ -21,11 +21,14 @@ class RM_Manager;
 enum NodeType {
     NODE_FILESCAN,      // 文件扫描
     NODE_INDEXSCAN,     // 索引扫描
+    NODE_BITMAPHEAPSCAN, // 位图堆扫描
     NODE_FILTER,        // 过滤条件
     NODE_PROJECTION,    // 投影
     NODE_NESTLOOP,      // 嵌套循环连接
     NODE_UPDATE,        // 更新
-    NODE_DELETE         // 删除
+    NODE_DELETE,        // 删除
+    NODE_SORT,          // 排序
+    NODE_LIMIT          // 限制输出的元组数
 };
 
 // 比较操作符类型（扩展redbase.h中的CompOp）
@@ -66,6 +69,14 @@ struct Condition {
     Condition() : op(NO_OP), bRhsIsAttr(0) {}
 };
 
+// ORDER BY中的一个排序属性
+struct OrderAttr {
+    RelAttr attr;
+    bool    bDescending;  // 从大到小
+    
+    OrderAttr() : bDescending(false) {}
+};
+
 // 查询计划节点基类
 class PlanNode {
 public:
@@ -99,31 +110,6 @@ public:
     void Print(int indent = 0) override;
 };
 
-// 索引扫描节点
-class IndexScanNode : public PlanNode {
-private:
-    char *relName;
-    char *attrName;
-    CompOp op;
-    Value value;
-    IX_Manager *ixManager;
-    RM_Manager *rmManager;
-    IX_IndexHandle indexHandle;
-    IX_IndexScan indexScan;
-    RM_FileHandle fileHandle;
-    bool isOpen;
-    
-public:
-    IndexScanNode(const char *relation, const char *attribute, 
-                  CompOp operation, const Value &val,
-                  IX_Manager *ixm, RM_Manager *rmm);
-    ~IndexScanNode();
-    RC Open() override;
-    RC GetNext(char *data) override;
-    RC Close() override;
-    void Print(int indent = 0) override;
-};
-
 // 过滤节点
 class FilterNode : public PlanNode {
 private:
@@ -204,7 +190,10 @@ public:
               int nRelations,                   // From子句中关系数量
               const char * const relations[],  // From子句中的关系
               int nConditions,                  // Where子句中条件数量
-              const Condition conditions[]);   // Where子句中的条件
+              const Condition conditions[],    // Where子句中的条件
+              int nOrderAttrs = 0,              // Order By子句中属性数量
+              const OrderAttr orderAttrs[] = nullptr,  // Order By子句中的属性
+              int limit = -1);                  // Limit子句中的元组数（-1表示没有）
               
     RC Insert(const char *relName,              // 要插入的关系
               int nValues,                      // 插入值的数量
@@ -238,7 +227,8 @@ private:
     std::unique_ptr<PlanNode> BuildQueryPlan(
         int nSelAttrs, const RelAttr selAttrs[],
         int nRelations, const char * const relations[],
-        int nConditions, const Condition conditions[]);
+        int nConditions, const Condition conditions[],
+        int nOrderAttrs, const OrderAttr orderAttrs[], int limit);
         
     std::unique_ptr<PlanNode> OptimizePlan(std::unique_ptr<PlanNode> plan);
     
@@ -278,8 +268,25 @@ public:
     RM_FileScan fileScan;
     bool isOpen;
     
+    // 下推到RM扫描的条件，RM扫描据此利用区域映射跳过页面
+    bool hasScanCond;
+    DataAttrInfo scanAttr;
+    CompOp scanOp;
+    Value scanValue;
+    
+    // 并行扫描：工作线程按morsel扫描文件，并检查交给扫描节点的条件
+    int nWorkers;                            // 大于0时使用并行扫描
+    std::vector<Condition> scanPreds;        // 工作线程检查的条件（属性 op 常量）
+    std::vector<DataAttrInfo> scanPredAttrs; // 条件左侧的属性
+    RM_ParallelScan parallelScan;
+    RM_ScanBatch batch;                      // 当前批次
+    int batchPos;                            // 当前批次中下一条记录
+    
     ScanNode(const std::string &relationName, SM_Manager *sm, RM_Manager *rm);
     ~ScanNode();
+    void SetScanCondition(const DataAttrInfo &attr, CompOp op, const Value &value);
+    bool AddScanPredicate(const Condition &cond);  // 条件能否交给工作线程检查
+    void SetParallel(int workers);
     RC Open() override;
     RC GetNext(char *data) override;
     RC Close() override;
@@ -287,6 +294,82 @@ public:
     int GetTupleLength() override;
 };
 
+// 索引扫描节点：按索引范围取出RID，再从堆文件读取元组
+// 范围由建有索引的属性上的 "属性 op 常量" 条件合并而来，上层的SelectNode仍然保留
+class IndexScanNode : public PlanNode {
+public:
+    std::string relation;
+    SM_IndexDesc index;                      // 使用的索引（单属性或组合）
+    IX_Manager *ixManager;
+    RM_Manager *rmManager;
+    IX_IndexHandle indexHandle;
+    IX_IndexScan indexScan;
+    RM_FileHandle fileHandle;
+    bool isOpen;
+    
+    // 键中每个属性上的范围，hasLow/hasHigh为false时该侧无界
+    bool hasLow[IX_MAX_KEY_PARTS], hasHigh[IX_MAX_KEY_PARTS];
+    bool lowInclusive[IX_MAX_KEY_PARTS], highInclusive[IX_MAX_KEY_PARTS];
+    Value lowValue[IX_MAX_KEY_PARTS], highValue[IX_MAX_KEY_PARTS];
+    std::vector<Condition> rangeConds;       // 合并进范围的条件
+    
+    // 仅索引扫描：查询用到的属性都在键或INCLUDE属性中时，元组直接由索引条目拼出，
+    // 不读取堆文件，未覆盖的属性填0
+    bool bIndexOnly;
+    IX_ScanBatch batch;                      // 当前叶子中已取出的条目
+    int batchPos;
+    
+    // 输出按索引键排序，bReverse时从大到小（满足ORDER BY ... DESC）
+    bool bReverse;
+    
+    IndexScanNode(const std::string &relationName, const SM_IndexDesc &idx,
+                  SM_Manager *sm, IX_Manager *ixm, RM_Manager *rmm);
+    ~IndexScanNode();
+    bool AddRangeCondition(const Condition &cond);  // 把条件合并进扫描范围
+    bool HasRange() const;                   // 键的第一个属性上有条件时索引才能限定范围（哈希索引要求全部属性等值）
+    int EqualityPrefix() const;              // 键的前面有等值条件的属性个数
+    bool MatchesOrder(const std::vector<OrderAttr> &orderAttrs,  // 按键的顺序输出能否满足ORDER BY，
+                      bool &bDescending) const;                  // bDescending时需要反向扫描
+    RC OpenIndexScan(IX_IndexHandle &handle, IX_IndexScan &scan);  // 按范围打开索引扫描
+    RC Open() override;
+    RC GetNext(char *data) override;
+    RC Close() override;
+    void Print(int indent = 0) override;
+    int GetTupleLength() override;
+};
+
+// 位图堆扫描节点：先把索引范围内的RID全部收集到按页面组织的RID集合，
+// 再按页号顺序逐页读取元组，每个堆页面只固定一次。输出不再按索引键排序。
+// 有多个索引范围时，各自的RID集合按bUnion求交集（AND）或并集（OR）
+class BitmapHeapScanNode : public PlanNode {
+public:
+    std::string relation;
+    std::vector<std::unique_ptr<IndexScanNode>> indexSources;  // 提供扫描范围的索引扫描（不直接打开）
+    bool bUnion;                             // 多个索引范围求并集（否则求交集）
+    RM_Manager *rmManager;
+    RM_FileHandle fileHandle;
+    RM_RidBitmap ridBitmap;
+    bool isOpen;
+    
+    // 当前页面已读出的元组
+    PageNum curPage;
+    std::vector<SlotNum> pageSlots;
+    std::vector<char> pageTuples;
+    int nPageTuples, pagePos;
+    
+    BitmapHeapScanNode(std::unique_ptr<IndexScanNode> source, RM_Manager *rmm);
+    ~BitmapHeapScanNode();
+    void AddSource(std::unique_ptr<IndexScanNode> source);  // 再加入一个索引范围
+    RC Open() override;
+    RC GetNext(char *data) override;
+    RC Close() override;
+    void Print(int indent = 0) override;
+    int GetTupleLength() override;
+    
+private:
+    RC CollectRids(IndexScanNode *source, RM_RidBitmap &bitmap);  // 扫描索引范围，收集RID
+};
+
 class SelectNode : public PlanNode {
 public:
     std::unique_ptr<PlanNode> childNode;
@@ -325,6 +408,45 @@ private:
     RC GetAttributeFromTuple(const char *tupleData, const RelAttr &attr, void *&value, AttrType &type, int &length);
 };
 
+// 排序节点：打开时读出子节点的全部元组，按ORDER BY的属性排好序后逐个输出
+class SortNode : public PlanNode {
+public:
+    std::unique_ptr<PlanNode> childNode;
+    std::vector<OrderAttr> orderAttrs;
+    std::vector<int> sortAttrs;              // 排序属性在outputAttrs中的位置，找不到为-1
+    std::vector<char> tuples;                // 子节点的全部元组
+    std::vector<int> order;                  // 排好序的元组编号
+    int tupleLength;
+    size_t nextPos;
+    
+    SortNode(std::unique_ptr<PlanNode> child, const std::vector<OrderAttr> &attrs);
+    ~SortNode();
+    RC Open() override;
+    RC GetNext(char *data) override;
+    RC Close() override;
+    void Print(int indent = 0) override;
+    int GetTupleLength() override;
+    
+private:
+    bool TupleLess(int a, int b) const;
+};
+
+// 限制节点：只输出子节点的前limit个元组，之后不再从子节点读取
+class LimitNode : public PlanNode {
+public:
+    std::unique_ptr<PlanNode> childNode;
+    int limit;
+    int nReturned;
+    
+    LimitNode(std::unique_ptr<PlanNode> child, int n);
+    ~LimitNode();
+    RC Open() override;
+    RC GetNext(char *data) override;
+    RC Close() override;
+    void Print(int indent = 0) override;
+    int GetTupleLength() override;
+};
+
 class JoinNode : public PlanNode {
 public:
     std::unique_ptr<PlanNode> leftChild;
@@ -24,10 +24,14 @@ enum SQLType {
     SQL_UPDATE,
     SQL_CREATE_INDEX,
     SQL_DROP_INDEX,
+    SQL_CREATE_ZONEMAP,
+    SQL_VACUUM,
+    SQL_REINDEX,
     // 系统命令
     SQL_USE_DATABASE,
     SQL_CREATE_DATABASE,
     SQL_SHOW_TABLES,
+    SQL_SHOW_INDEX_STATS,
     SQL_DESC_TABLE,
     // 特殊命令
     SQL_HELP,
@@ -35,6 +39,12 @@ enum SQLType {
     SQL_UNKNOWN
 };
 
+// 排序子句
+struct OrderByClause {
+    std::string columnName;
+    bool isDescending;  // true 表示 DESC, false 表示 ASC
+};
+
 // SQL解析结果
 struct ParsedSQL {
     SQLType type;
@@ -46,13 +56,19 @@ struct ParsedSQL {
     std::vector<Value> values;
     std::vector<Condition> conditions;
     std::string indexName;
+    std::vector<std::string> includeColumns;  // CREATE INDEX ... INCLUDE (col, ...)
+    std::string indexMethod;    // CREATE INDEX ... USING <BTREE|HASH|BUFFERED>
+    bool bloomFilter;           // CREATE INDEX ... WITH BLOOM
+    std::string tableLayout;    // CREATE TABLE ... LAYOUT <ROW|PAX|SLOTTED>
+    std::vector<OrderByClause> orderByClauses;  // SELECT ... ORDER BY <列> [ASC|DESC], ...
+    int limit;                  // SELECT ... LIMIT <n>，-1表示没有
     
     // UPDATE专用字段
     std::string updateColumn;     // 要更新的列名
     std::string updateValueStr;   // 更新值的字符串表示
     AttrType updateValueType;     // 更新值的类型
     
-    ParsedSQL() : type(SQL_UNKNOWN), updateValueType(INT) {}
+    ParsedSQL() : type(SQL_UNKNOWN), bloomFilter(false), limit(-1), updateValueType(INT) {}
 };
 
 class SQLParser {
@@ -77,11 +93,15 @@ private:
     ParsedSQL ParseUpdate(const std::vector<std::string> &tokens);
     ParsedSQL ParseCreateIndex(const std::vector<std::string> &tokens);
     ParsedSQL ParseDropIndex(const std::vector<std::string> &tokens);
+    ParsedSQL ParseCreateZoneMap(const std::vector<std::string> &tokens);
+    ParsedSQL ParseVacuum(const std::vector<std::string> &tokens);
+    ParsedSQL ParseReindex(const std::vector<std::string> &tokens);
     
     // 系统命令解析
     ParsedSQL ParseUseDatabase(const std::vector<std::string> &tokens);
     ParsedSQL ParseCreateDatabase(const std::vector<std::string> &tokens);
     ParsedSQL ParseShowTables(const std::vector<std::string> &tokens);
+    ParsedSQL ParseShowIndexStats(const std::vector<std::string> &tokens);
     ParsedSQL ParseDescTable(const std::vector<std::string> &tokens);
     ParsedSQL ParseHelp(const std::vector<std::string> &tokens);
     ParsedSQL ParseQuit(const std::vector<std::string> &tokens);
@@ -95,14 +115,7 @@ private:
     void RemoveParentheses(std::vector<std::string> &tokens);
 };
 
-// 排序子句
-struct OrderByClause {
-    std::string columnName;
-    bool isDescending;  // true 表示 DESC, false 表示 ASC
-};
-
 // 注意: ParsedSQL 需要扩展以支持以下字段
-// std::vector<OrderByClause> orderByClauses;
 // std::vector<std::string> tableAliases;
 
 #endif // SQL_PARSER_UNIFIED_H
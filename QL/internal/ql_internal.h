@@ -12,6 +12,8 @@ extern int bQueryPlans;
 #define MAX_QUERY_ATTRS    100    // 查询中最大属性数
 #define MAX_JOIN_RELATIONS 10     // 最大连接关系数
 #define MAX_CONDITIONS     50     // 最大条件数
+#define QL_PARALLEL_MIN_PAGES 32  // 数据页数不少于此值的单表扫描才并行执行
+#define QL_BITMAP_MIN_ROWS    8   // 索引范围内的条目数超过此值时使用位图堆扫描
 
 // 属性解析结果
 struct AttrDesc {
@@ -35,8 +37,10 @@ struct QueryContext {
     std::vector<AttrDesc> allAttrs;           // 所有涉及的属性
     std::vector<Condition> conditions;        // 查询条件
     std::vector<RelAttr> selectAttrs;         // 选择的属性
+    std::vector<OrderAttr> orderAttrs;        // 排序属性（ORDER BY）
+    int limit;                                // 输出的元组数上限（-1表示没有）
     
-    QueryContext() {}
+    QueryContext() : limit(-1) {}
 };
 
 // 条件分类
@@ -132,8 +136,14 @@ private:
     
     std::unique_ptr<PlanNode> SelectAccessPathsRecursive(std::unique_ptr<PlanNode> plan, const QueryContext &context);
     std::unique_ptr<PlanNode> ConsiderIndexScan(ScanNode *scanNode, const QueryContext &context);
-    
-    bool HasIndexForCondition(const std::string &relation, const Condition &cond);
+    bool IndexCoversQuery(const SM_IndexDesc &index, const QueryContext &context);
+    bool PredicateImplied(const SM_IndexDesc &index, const QueryContext &context);
+    void ConsiderZoneMapScan(ScanNode *scanNode, const Condition &cond);
+    std::unique_ptr<PlanNode> ConsiderParallelScan(std::unique_ptr<PlanNode> plan);
+    std::unique_ptr<PlanNode> ApplyOrderBy(std::unique_ptr<PlanNode> plan, const QueryContext &context);
+    std::unique_ptr<IndexScanNode> ConsiderOrderedIndexScan(const std::string &relation, const QueryContext &context);
+    
+    int EstimateIndexRows(IndexScanNode *node, int limit);
     int EstimateRelationSize(const std::string &relation);
     double EstimateSelectivity(const Condition &cond);
     double EstimateJoinCost(const PlanNode *left, const PlanNode *right, const Condition &joinCond);
@@ -142,6 +152,9 @@ private:
     void PrintQueryContext(const QueryContext &context);
 };
 
+// 比较操作符的字符串表示（ql_error.cc）
+const char* QL_ConvertCompOpToString(CompOp op);
+
 // 工具函数
 namespace QLUtils {
     // 字符串比较（支持不同长度）
@@ -223,7 +223,8 @@ RC QL_CheckSystemCatalog(const char *relName)
     }
     
     // 检查是否为系统目录表
-    if (strcmp(relName, "relcat") == 0 || strcmp(relName, "attrcat") == 0) {
+    if (strcmp(relName, "relcat") == 0 || strcmp(relName, "attrcat") == 0 ||
+        strcmp(relName, "indexcat") == 0) {
         return QL_SYSTEMCATALOG;
     }
     
@@ -142,11 +142,15 @@ QL_Manager::~QL_Manager() {
  * @param relations 关系名数组
  * @param nConditions 条件数量
  * @param conditions 条件数组
+ * @param nOrderAttrs 排序属性数量
+ * @param orderAttrs 排序属性数组（ORDER BY）
+ * @param limit 输出的元组数上限，-1表示没有（LIMIT）
  * @return RC 错误码
  */
 RC QL_Manager::Select(int nSelAttrs, const RelAttr selAttrs[],
                      int nRelations, const char * const relations[],
-                     int nConditions, const Condition conditions[]) {
+                     int nConditions, const Condition conditions[],
+                     int nOrderAttrs, const OrderAttr orderAttrs[], int limit) {
     RC rc;
     
     // 1. 验证查询
@@ -159,7 +163,8 @@ RC QL_Manager::Select(int nSelAttrs, const RelAttr selAttrs[],
     // 2. 构建查询计划
     auto plan = BuildQueryPlan(nSelAttrs, selAttrs,
                               nRelations, relations, 
-                              nConditions, conditions);
+                              nConditions, conditions,
+                              nOrderAttrs, orderAttrs, limit);
     if (!plan) {
         return QL_INVALIDCONDITION;
     }
@@ -242,7 +247,8 @@ RC QL_Manager::ValidateSelectQuery(int nSelAttrs, const RelAttr selAttrs[],
 unique_ptr<PlanNode> QL_Manager::BuildQueryPlan(
     int nSelAttrs, const RelAttr selAttrs[],
     int nRelations, const char * const relations[],
-    int nConditions, const Condition conditions[]) {
+    int nConditions, const Condition conditions[],
+    int nOrderAttrs, const OrderAttr orderAttrs[], int limit) {
     
     // 构建查询上下文
     QueryContext context;
@@ -262,6 +268,12 @@ unique_ptr<PlanNode> QL_Manager::BuildQueryPlan(
         context.conditions.push_back(conditions[i]);
     }
     
+    // 排序属性和输出的元组数上限
+    for (int i = 0; i < nOrderAttrs; i++) {
+        context.orderAttrs.push_back(orderAttrs[i]);
+    }
+    context.limit = limit;
+    
     // 使用查询优化器构建计划
     QueryOptimizer optimizer(smManager, ixManager, rmManager);
     return optimizer.OptimizeQuery(context);
@@ -317,7 +329,8 @@ RC QL_Manager::Insert(const char *relName, int nValues, const Value values[]) {
     RC rc;
     
     // 检查是否为系统目录
-    if (strcmp(relName, "relcat") == 0 || strcmp(relName, "attrcat") == 0) {
+    if (strcmp(relName, "relcat") == 0 || strcmp(relName, "attrcat") == 0 ||
+        strcmp(relName, "indexcat") == 0) {
         return QL_SYSTEMCATALOG;
     }
     
@@ -375,13 +388,19 @@ RC QL_Manager::Insert(const char *relName, int nValues, const Value values[]) {
         return rc;
     }
     
-    // 更新索引
-    for (int i = 0; i < nAttrs; i++) {
-        if (attrs[i].indexNo != -1) {
+    // 更新索引（包括组合索引，部分索引只加入满足条件的记录）
+    vector<SM_IndexDesc> indexes;
+    if (smManager->GetIndexes(relName, indexes) == OK) {
+        for (const SM_IndexDesc &index : indexes) {
+            if (!index.Matches(tupleData)) {
+                continue;
+            }
             IX_IndexHandle indexHandle;
-            if ((rc = ixManager->OpenIndex(relName, attrs[i].indexNo, indexHandle)) == OK) {
-                void *keyValue = tupleData + attrs[i].offset;
-                indexHandle.InsertEntry(keyValue, rid);
+            if ((rc = ixManager->OpenIndex(relName, index.indexNo, indexHandle)) == OK) {
+                vector<char> key(index.KeyLength() + index.IncludeLength());
+                index.BuildKey(tupleData, key.data());
+                index.BuildPayload(tupleData, key.data() + index.KeyLength());
+                indexHandle.InsertEntry(key.data(), rid, key.data() + index.KeyLength());
                 ixManager->CloseIndex(indexHandle);
             }
         }
@@ -564,7 +583,8 @@ RC QL_Manager::Delete(const char *relName, int nConditions, const Condition cond
     RC rc;
     
     // 检查是否为系统目录
-    if (strcmp(relName, "relcat") == 0 || strcmp(relName, "attrcat") == 0) {
+    if (strcmp(relName, "relcat") == 0 || strcmp(relName, "attrcat") == 0 ||
+        strcmp(relName, "indexcat") == 0) {
         return QL_SYSTEMCATALOG;
     }
     
@@ -689,23 +709,28 @@ RC QL_Manager::Delete(const char *relName, int nConditions, const Condition cond
     // 关闭扫描
     fileScan.CloseScan();
     
+    // 打开关系上的所有索引
+    vector<SM_IndexDesc> indexes;
+    smManager->GetIndexes(relName, indexes);
+    vector<IX_IndexHandle> indexHandles(indexes.size());
+    vector<bool> indexOpen(indexes.size(), false);
+    for (size_t i = 0; i < indexes.size(); i++) {
+        indexOpen[i] = (ixManager->OpenIndex(relName, indexes[i].indexNo, indexHandles[i]) == OK);
+    }
+    
     // 删除记录
     int deletedCount = 0;
     for (const RID &rid : ridsToDelete) {
-        // 删除索引条目
-        for (int i = 0; i < nAttrs; i++) {
-            if (attrs[i].indexNo != -1) {
-                IX_IndexHandle indexHandle;
-                if (ixManager->OpenIndex(relName, attrs[i].indexNo, indexHandle) == OK) {
-                    // 需要先获取记录数据以获取key值
-                    RM_Record rec;
-                    if (fileHandle.GetRec(rid, rec) == OK) {
-                        char *data;
-                        rec.GetData(data);
-                        void *keyValue = data + attrs[i].offset;
-                        indexHandle.DeleteEntry(keyValue, rid);
-                    }
-                    ixManager->CloseIndex(indexHandle);
+        // 删除索引条目，需要先获取记录数据以构造键
+        RM_Record rec;
+        if (!indexes.empty() && fileHandle.GetRec(rid, rec) == OK) {
+            char *data;
+            rec.GetData(data);
+            for (size_t i = 0; i < indexes.size(); i++) {
+                if (indexOpen[i] && indexes[i].Matches(data)) {
+                    vector<char> key(indexes[i].KeyLength());
+                    indexes[i].BuildKey(data, key.data());
+                    indexHandles[i].DeleteEntry(key.data(), rid);
                 }
             }
         }
@@ -716,6 +741,12 @@ RC QL_Manager::Delete(const char *relName, int nConditions, const Condition cond
         }
     }
     
+    for (size_t i = 0; i < indexes.size(); i++) {
+        if (indexOpen[i]) {
+            ixManager->CloseIndex(indexHandles[i]);
+        }
+    }
+    
     // 关闭文件
     rmManager->CloseFile(fileHandle);
     
@@ -743,7 +774,8 @@ RC QL_Manager::Update(const char *relName,
     RC rc;
     
     // 检查系统目录
-    if (strcmp(relName, "relcat") == 0 || strcmp(relName, "attrcat") == 0) {
+    if (strcmp(relName, "relcat") == 0 || strcmp(relName, "attrcat") == 0 ||
+        strcmp(relName, "indexcat") == 0) {
         return QL_SYSTEMCATALOG;
     }
     
@@ -775,9 +807,29 @@ RC QL_Manager::Update(const char *relName,
         return rc;
     }
     
+    // 打开键或INCLUDE属性中包含被更新属性的索引，以及条件用到被更新属性的部分索引
+    vector<SM_IndexDesc> allIndexes, indexes;
+    smManager->GetIndexes(relName, allIndexes);
+    for (const SM_IndexDesc &index : allIndexes) {
+        if (index.Covers(attrs[updateAttrIndex].attrName) ||
+            index.PredicateUses(attrs[updateAttrIndex].attrName)) {
+            indexes.push_back(index);
+        }
+    }
+    vector<IX_IndexHandle> indexHandles(indexes.size());
+    vector<bool> indexOpen(indexes.size(), false);
+    for (size_t i = 0; i < indexes.size(); i++) {
+        indexOpen[i] = (ixManager->OpenIndex(relName, indexes[i].indexNo, indexHandles[i]) == OK);
+    }
+    
     // 扫描并更新
     RM_FileScan fileScan;
     if ((rc = fileScan.OpenScan(fileHandle, INT, 4, 0, NO_OP, nullptr))) {
+        for (size_t i = 0; i < indexes.size(); i++) {
+            if (indexOpen[i]) {
+                ixManager->CloseIndex(indexHandles[i]);
+            }
+        }
         rmManager->CloseFile(fileHandle);
         delete[] attrs;
         return rc;
@@ -825,6 +877,16 @@ RC QL_Manager::Update(const char *relName,
         }
         
         if (shouldUpdate) {
+            // 记下更新前的索引键（后接附带数据）和记录是否在部分索引中
+            vector<vector<char> > oldKeys(indexes.size());
+            vector<bool> oldIn(indexes.size());
+            for (size_t i = 0; i < indexes.size(); i++) {
+                oldIn[i] = indexes[i].Matches(recordData);
+                oldKeys[i].resize(indexes[i].KeyLength() + indexes[i].IncludeLength());
+                indexes[i].BuildKey(recordData, oldKeys[i].data());
+                indexes[i].BuildPayload(recordData, oldKeys[i].data() + indexes[i].KeyLength());
+            }
+            
             // 更新值
             memcpy(recordData + attrs[updateAttrIndex].offset, 
                    rhsValue.data, 
@@ -833,11 +895,37 @@ RC QL_Manager::Update(const char *relName,
             // 更新记录
             if ((rc = fileHandle.UpdateRec(record)) == OK) {
                 updatedCount++;
+                
+                // 键或附带数据改变的索引删除旧条目、插入新条目；
+                // 部分索引中更新前后满足条件的情况不同时只删除或只插入
+                RID rid;
+                record.GetRid(rid);
+                for (size_t i = 0; i < indexes.size(); i++) {
+                    int keyLength = indexes[i].KeyLength();
+                    vector<char> newKey(keyLength + indexes[i].IncludeLength());
+                    indexes[i].BuildKey(recordData, newKey.data());
+                    indexes[i].BuildPayload(recordData, newKey.data() + keyLength);
+                    bool newIn = indexes[i].Matches(recordData);
+                    if (!indexOpen[i] || (oldIn[i] == newIn && (!newIn || newKey == oldKeys[i]))) {
+                        continue;
+                    }
+                    if (oldIn[i]) {
+                        indexHandles[i].DeleteEntry(oldKeys[i].data(), rid);
+                    }
+                    if (newIn) {
+                        indexHandles[i].InsertEntry(newKey.data(), rid, newKey.data() + keyLength);
+                    }
+                }
             }
         }
     }
     
     fileScan.CloseScan();
+    for (size_t i = 0; i < indexes.size(); i++) {
+        if (indexOpen[i]) {
+            ixManager->CloseIndex(indexHandles[i]);
+        }
+    }
     rmManager->CloseFile(fileHandle);
     delete[] attrs;
     
@@ -32,6 +32,14 @@ unique_ptr<PlanNode> QueryOptimizer::OptimizeQuery(const QueryContext &context)
     // 3. 选择最佳访问路径
     plan = SelectAccessPaths(std::move(plan), context);
     
+    // 4. 排序和限制输出的元组数
+    plan = ApplyOrderBy(std::move(plan), context);
+    
+    // 5. 大表的单表查询改为并行扫描（只取前几个元组且不排序时不需要读完整个表）
+    if (context.limit < 0 || !context.orderAttrs.empty()) {
+        plan = ConsiderParallelScan(std::move(plan));
+    }
+    
     return plan;
 }
 
@@ -369,52 +377,471 @@ unique_ptr<PlanNode> QueryOptimizer::SelectAccessPathsRecursive(
     // 处理其他类型的节点
     if (auto selectNode = dynamic_cast<SelectNode*>(plan.get())) {
         // 递归处理子节点
-        // 注意：这里需要小心处理unique_ptr的所有权转移
+        selectNode->childNode = SelectAccessPathsRecursive(std::move(selectNode->childNode), context);
+        
+        // 找到选择链底部的扫描节点，考虑把条件下推给RM扫描
+        PlanNode *bottom = selectNode->childNode.get();
+        while (auto childSelect = dynamic_cast<SelectNode*>(bottom)) {
+            bottom = childSelect->childNode.get();
+        }
+        if (auto scanNode = dynamic_cast<ScanNode*>(bottom)) {
+            ConsiderZoneMapScan(scanNode, selectNode->condition);
+        }
+    } else if (auto projectNode = dynamic_cast<ProjectNode*>(plan.get())) {
+        projectNode->childNode = SelectAccessPathsRecursive(std::move(projectNode->childNode), context);
+    } else if (auto joinNode = dynamic_cast<JoinNode*>(plan.get())) {
+        joinNode->leftChild = SelectAccessPathsRecursive(std::move(joinNode->leftChild), context);
+        joinNode->rightChild = SelectAccessPathsRecursive(std::move(joinNode->rightChild), context);
     }
     
-    // 其他节点类型的处理...
+    return plan;
+}
+
+//
+// 考虑利用区域映射：把 "属性 op 常量" 条件下推到扫描节点
+// 有多个候选条件时，选择区域映射估算需要读取页数最少的那个
+//
+void QueryOptimizer::ConsiderZoneMapScan(ScanNode *scanNode, const Condition &cond) {
+    if (cond.bRhsIsAttr || cond.op == NO_OP || cond.rhsValue.data == nullptr ||
+        cond.lhsAttr.attrName == nullptr) {
+        return;
+    }
+    
+    // 查找条件左侧属性
+    const DataAttrInfo *attr = nullptr;
+    for (const auto &attrInfo : scanNode->outputAttrs) {
+        if (strcmp(attrInfo.attrName, cond.lhsAttr.attrName) == 0 &&
+            (!cond.lhsAttr.relName || strcmp(attrInfo.relName, cond.lhsAttr.relName) == 0)) {
+            attr = &attrInfo;
+            break;
+        }
+    }
+    if (!attr || attr->attrType != cond.rhsValue.type ||
+        (attr->attrType != INT && attr->attrType != FLOAT)) {
+        return;
+    }
+    
+    // 通过区域映射估算需要读取的页数
+    RM_FileHandle fileHandle;
+    if (rmManager->OpenFile(scanNode->relation.c_str(), fileHandle) != OK) {
+        return;
+    }
+    
+    int nPages = 0;
+    int bestPages = 0;
+    bool usable = fileHandle.HasZoneMap(attr->offset) &&
+                  fileHandle.EstimateScanPages(attr->attrType, attr->offset, cond.op,
+                                               cond.rhsValue.data, nPages) == OK;
+    if (usable && scanNode->hasScanCond) {
+        usable = fileHandle.EstimateScanPages(scanNode->scanAttr.attrType, scanNode->scanAttr.offset,
+                                              scanNode->scanOp, scanNode->scanValue.data,
+                                              bestPages) == OK && nPages < bestPages;
+    }
+    rmManager->CloseFile(fileHandle);
+    
+    if (usable) {
+        scanNode->SetScanCondition(*attr, cond.op, cond.rhsValue);
+    }
+}
+
+//
+// 考虑并行扫描：单表查询（投影 -> 选择链 -> 扫描）的数据页数足够多时，
+// 扫描节点改为并行扫描，"属性 op 常量" 的选择条件交给工作线程检查，
+// 对应的SelectNode从计划中去掉。连接中的扫描会被反复打开，保持串行
+//
+unique_ptr<PlanNode> QueryOptimizer::ConsiderParallelScan(unique_ptr<PlanNode> plan) {
+    if (!plan) {
+        return plan;
+    }
+    
+    if (auto projectNode = dynamic_cast<ProjectNode*>(plan.get())) {
+        projectNode->childNode = ConsiderParallelScan(std::move(projectNode->childNode));
+        return plan;
+    }
+    if (auto limitNode = dynamic_cast<LimitNode*>(plan.get())) {
+        limitNode->childNode = ConsiderParallelScan(std::move(limitNode->childNode));
+        return plan;
+    }
+    if (auto sortNode = dynamic_cast<SortNode*>(plan.get())) {
+        sortNode->childNode = ConsiderParallelScan(std::move(sortNode->childNode));
+        return plan;
+    }
+    
+    // 找到选择链底部的扫描节点
+    PlanNode *bottom = plan.get();
+    while (auto selectNode = dynamic_cast<SelectNode*>(bottom)) {
+        bottom = selectNode->childNode.get();
+    }
+    auto scanNode = dynamic_cast<ScanNode*>(bottom);
+    if (!scanNode) {
+        return plan;
+    }
+    
+    int nWorkers = RM_ParallelScan::DefaultWorkers();
+    if (nWorkers < 2) {
+        return plan;
+    }
+    
+    RM_FileHandle fileHandle;
+    if (rmManager->OpenFile(scanNode->relation.c_str(), fileHandle) != OK) {
+        return plan;
+    }
+    PageNum nDataPages = fileHandle.GetNumPages() - 1;
+    rmManager->CloseFile(fileHandle);
+    if (nDataPages < QL_PARALLEL_MIN_PAGES) {
+        return plan;
+    }
     
+    // 把能交给工作线程的条件从选择链中摘下
+    unique_ptr<PlanNode> *link = &plan;
+    while (auto selectNode = dynamic_cast<SelectNode*>(link->get())) {
+        if (scanNode->AddScanPredicate(selectNode->condition)) {
+            unique_ptr<PlanNode> child = std::move(selectNode->childNode);
+            *link = std::move(child);
+        } else {
+            link = &selectNode->childNode;
+        }
+    }
+    
+    scanNode->SetParallel(nWorkers);
     return plan;
 }
 
 //
-// 考虑索引扫描
+// 处理ORDER BY和LIMIT：选择链底部的索引扫描按键的顺序输出能满足ORDER BY时
+// 不再排序（DESC时反向扫描），否则在投影之下加SortNode；LIMIT在整个计划之上加LimitNode。
+// 有LIMIT时全表扫描或位图堆扫描可以换成顺序合适的索引扫描，只读前面的若干条目
+//
+unique_ptr<PlanNode> QueryOptimizer::ApplyOrderBy(unique_ptr<PlanNode> plan, const QueryContext &context) {
+    if (!plan) {
+        return plan;
+    }
+    
+    if (!context.orderAttrs.empty()) {
+        // 排序放在投影之下，排序属性不必出现在选择的属性中
+        unique_ptr<PlanNode> *link = &plan;
+        if (auto projectNode = dynamic_cast<ProjectNode*>(plan.get())) {
+            link = &projectNode->childNode;
+        }
+        
+        // 找到选择链底部的节点
+        unique_ptr<PlanNode> *bottom = link;
+        while (auto selectNode = dynamic_cast<SelectNode*>(bottom->get())) {
+            bottom = &selectNode->childNode;
+        }
+        
+        if (context.limit >= 0) {
+            string relation;
+            if (auto scanNode = dynamic_cast<ScanNode*>(bottom->get())) {
+                relation = scanNode->relation;
+            } else if (auto bitmapScan = dynamic_cast<BitmapHeapScanNode*>(bottom->get())) {
+                relation = bitmapScan->relation;
+            }
+            if (!relation.empty()) {
+                auto indexScan = ConsiderOrderedIndexScan(relation, context);
+                if (indexScan) {
+                    *bottom = std::move(indexScan);
+                }
+            }
+        }
+        
+        bool bDescending = false;
+        auto indexScan = dynamic_cast<IndexScanNode*>(bottom->get());
+        if (indexScan && indexScan->MatchesOrder(context.orderAttrs, bDescending)) {
+            indexScan->bReverse = bDescending;
+        } else {
+            *link = make_unique<SortNode>(std::move(*link), context.orderAttrs);
+        }
+    }
+    
+    if (context.limit >= 0) {
+        plan = make_unique<LimitNode>(std::move(plan), context.limit);
+    }
+    
+    return plan;
+}
+
+//
+// 考虑按顺序的索引扫描：找一个键的顺序满足ORDER BY的索引（条件中的范围照样使用，
+// 优先选有范围的索引），LIMIT小于数据页数（每个条目大约读一次堆页面）或者可以仅索引扫描时使用。
+// 不在索引范围中的条件由上层的SelectNode检查，满足条件的元组很少时可能读到更多条目
+//
+unique_ptr<IndexScanNode> QueryOptimizer::ConsiderOrderedIndexScan(
+    const string &relation,
+    const QueryContext &context) {
+    
+    RM_FileHandle fileHandle;
+    if (rmManager->OpenFile(relation.c_str(), fileHandle) != OK) {
+        return nullptr;
+    }
+    int nDataPages = fileHandle.GetNumPages() - 1;
+    rmManager->CloseFile(fileHandle);
+    
+    vector<SM_IndexDesc> indexes;
+    if (smManager->GetIndexes(relation.c_str(), indexes) != OK) {
+        return nullptr;
+    }
+    
+    unique_ptr<IndexScanNode> best;
+    for (const SM_IndexDesc &index : indexes) {
+        if (index.indexType == IX_HASH || !PredicateImplied(index, context)) {
+            continue;
+        }
+        auto indexScan = make_unique<IndexScanNode>(relation, index,
+                                                    smManager, ixManager, rmManager);
+        for (const Condition &cond : context.conditions) {
+            indexScan->AddRangeCondition(cond);
+        }
+        
+        bool bDescending = false;
+        if (!indexScan->MatchesOrder(context.orderAttrs, bDescending)) {
+            continue;
+        }
+        bool bIndexOnly = IndexCoversQuery(index, context);
+        if (!bIndexOnly && context.limit >= nDataPages) {
+            continue;
+        }
+        
+        indexScan->bIndexOnly = bIndexOnly;
+        indexScan->bReverse = bDescending;
+        if (indexScan->HasRange()) {
+            return indexScan;
+        }
+        if (!best) {
+            best = std::move(indexScan);
+        }
+    }
+    
+    return best;
+}
+
+//
+// 考虑索引扫描：扫描的关系上的每个索引（单属性或组合），把键中属性上的 "属性 op 常量"
+// 条件合并成一个索引范围，下降到范围起点数出范围内的条目数（数到数据页数为止）。
+// 每个条目大约需要读一次堆页面，条目数少于数据页数的范围才有用。
+// 条目数最少的范围不超过QL_BITMAP_MIN_ROWS时直接用索引扫描；否则同一堆页面
+// 很可能被多次读取，改为位图堆扫描，按页号顺序每页只读一次，
+// 其他有用的范围也加入位图堆扫描，RID集合求交集后再读堆页面。
+// 哈希索引只在键的全部属性上都有等值条件时使用，数条目只读一个bucket。
+// 单表查询用到的属性都在某个索引中时优先用仅索引扫描，完全不读堆页面。
+// 部分索引只在查询条件蕴含其条件时考虑，键上没有条件时按整个索引的条目数比较
 //
 unique_ptr<PlanNode> QueryOptimizer::ConsiderIndexScan(
     ScanNode *scanNode,
     const QueryContext &context) {
     
-    // 检查是否有合适的索引可以用于选择条件
-    for (const Condition &cond : context.conditions) {
-        if (HasIndexForCondition(scanNode->relation, cond)) {
-            // 创建索引扫描节点
-            // 这里需要实现IndexScanNode类
-            // return make_unique<IndexScanNode>(...);
+    RM_FileHandle fileHandle;
+    if (rmManager->OpenFile(scanNode->relation.c_str(), fileHandle) != OK) {
+        return nullptr;
+    }
+    int nDataPages = fileHandle.GetNumPages() - 1;
+    rmManager->CloseFile(fileHandle);
+    
+    // 条目数少于数据页数的索引范围，按条目数从少到多排列
+    vector<SM_IndexDesc> indexes;
+    if (smManager->GetIndexes(scanNode->relation.c_str(), indexes) != OK) {
+        return nullptr;
+    }
+    
+    vector<pair<int, unique_ptr<IndexScanNode>>> candidates;
+    unique_ptr<IndexScanNode> bestIndexOnly;
+    double bestLeafPages = 0;
+    for (const SM_IndexDesc &index : indexes) {
+        if (!PredicateImplied(index, context)) {
+            continue;
         }
+        auto indexScan = make_unique<IndexScanNode>(scanNode->relation, index,
+                                                    smManager, ixManager, rmManager);
+        for (const Condition &cond : context.conditions) {
+            indexScan->AddRangeCondition(cond);
+        }
+        // 部分索引只包含满足条件的记录，没有范围时扫描整个索引也可能比读全部数据页少
+        if (!indexScan->HasRange() && !index.IsPartial()) {
+            continue;
+        }
+        
+        // 覆盖查询的索引只读叶子页面，范围内条目所占的叶子页数少于数据页数即可使用。
+        // 每个叶子的条目数取索引统计中的实际值（含前缀压缩、RID列表和未填满的叶子），
+        // 没有统计时按条目长度估算叶子填满一半
+        if (IndexCoversQuery(index, context)) {
+            int entrySize = index.KeyLength() + (int)sizeof(RID) + index.IncludeLength();
+            double perLeaf = (double)(PF_PAGE_SIZE / entrySize) / 2;
+            IX_IndexStats stats;
+            if (smManager->GetIndexStats(scanNode->relation.c_str(), index, stats) == OK &&
+                stats.nLeafPages > 0 && stats.nEntries > 0) {
+                perLeaf = (double)stats.nEntries / stats.nLeafPages;
+            }
+            int limit = (int)(nDataPages * perLeaf);
+            int nRows = EstimateIndexRows(indexScan.get(), limit);
+            double leafPages = nRows / perLeaf;
+            if (nRows < limit && (!bestIndexOnly || leafPages < bestLeafPages)) {
+                indexScan->bIndexOnly = true;
+                bestLeafPages = leafPages;
+                bestIndexOnly = std::move(indexScan);
+            }
+            if (!indexScan) {
+                continue;
+            }
+        }
+        
+        int nRows = EstimateIndexRows(indexScan.get(), nDataPages);
+        if (nRows < nDataPages) {
+            candidates.push_back(make_pair(nRows, std::move(indexScan)));
+        }
+    }
+    if (bestIndexOnly) {
+        return std::move(bestIndexOnly);
+    }
+    if (candidates.empty()) {
+        return nullptr;
+    }
+    stable_sort(candidates.begin(), candidates.end(),
+                [](const pair<int, unique_ptr<IndexScanNode>> &a,
+                   const pair<int, unique_ptr<IndexScanNode>> &b) {
+                    return a.first < b.first;
+                });
+    
+    if (candidates[0].first <= QL_BITMAP_MIN_ROWS) {
+        return std::move(candidates[0].second);
     }
     
-    return nullptr; // 没有找到合适的索引
+    auto bitmapScan = make_unique<BitmapHeapScanNode>(std::move(candidates[0].second), rmManager);
+    for (size_t i = 1; i < candidates.size(); i++) {
+        bitmapScan->AddSource(std::move(candidates[i].second));
+    }
+    return std::move(bitmapScan);
 }
 
 //
-// 检查是否有索引用于条件
+// 单表查询中选择的属性、条件和排序用到的属性是否都在索引的键或INCLUDE属性中
 //
-bool QueryOptimizer::HasIndexForCondition(const string &relation, const Condition &cond) {
-    // 检查关系的指定属性是否有索引
-    // 需要查询系统目录
+bool QueryOptimizer::IndexCoversQuery(const SM_IndexDesc &index, const QueryContext &context) {
+    if (context.relations.size() != 1 || context.selectAttrs.empty()) {
+        return false;
+    }
     
-    if (cond.bRhsIsAttr) {
-        return false; // 连接条件暂不考虑索引
+    for (const RelAttr &attr : context.selectAttrs) {
+        if (attr.attrName == nullptr || strcmp(attr.attrName, "*") == 0 ||
+            !index.Covers(attr.attrName)) {
+            return false;
+        }
+    }
+    for (const Condition &cond : context.conditions) {
+        if (cond.lhsAttr.attrName == nullptr || !index.Covers(cond.lhsAttr.attrName)) {
+            return false;
+        }
+        if (cond.bRhsIsAttr &&
+            (cond.rhsAttr.attrName == nullptr || !index.Covers(cond.rhsAttr.attrName))) {
+            return false;
+        }
+    }
+    for (const OrderAttr &orderAttr : context.orderAttrs) {
+        if (orderAttr.attr.attrName == nullptr || !index.Covers(orderAttr.attr.attrName)) {
+            return false;
+        }
     }
     
-    // 检查左属性是否有索引
-    if (cond.lhsAttr.attrName) {
-        // 这里需要访问SM模块查询索引信息
-        // 临时返回false
+    return true;
+}
+
+//
+// 查询的一个 "属性 op 常量" 条件是否蕴含部分索引的一个条件：
+// 满足前者的值都满足后者。两个常量按部分索引中属性的类型比较
+//
+static bool ConditionImplies(const Condition &cond, const SM_IndexPred &pred) {
+    if (cond.bRhsIsAttr || cond.rhsValue.data == nullptr || cond.lhsAttr.attrName == nullptr ||
+        strcmp(cond.lhsAttr.attrName, pred.attr.attrName) != 0 ||
+        (cond.lhsAttr.relName && strlen(cond.lhsAttr.relName) > 0 &&
+         strcmp(cond.lhsAttr.relName, pred.attr.relName) != 0) ||
+        cond.rhsValue.type != pred.attr.attrType) {
         return false;
     }
     
-    return false;
+    // cmp: 查询中的常量q与索引条件中的常量c比较
+    int cmp = 0;
+    switch (pred.attr.attrType) {
+        case INT: {
+            int q = *(const int*)cond.rhsValue.data, c;
+            memcpy(&c, pred.value, sizeof(int));
+            cmp = (q < c) ? -1 : (q > c) ? 1 : 0;
+            break;
+        }
+        case FLOAT: {
+            float q = *(const float*)cond.rhsValue.data, c;
+            memcpy(&c, pred.value, sizeof(float));
+            cmp = (q < c) ? -1 : (q > c) ? 1 : 0;
+            break;
+        }
+        case STRING:
+            cmp = strncmp((const char*)cond.rhsValue.data, pred.value, pred.attr.attrLength);
+            break;
+    }
+    
+    // 查询条件 x qop q 下x的范围包含在索引条件 x op c 的范围中
+    switch (pred.op) {
+        case EQ_OP:
+            return cond.op == EQ_OP && cmp == 0;
+        case NE_OP:
+            return (cond.op == EQ_OP && cmp != 0) || (cond.op == NE_OP && cmp == 0) ||
+                   (cond.op == LT_OP && cmp <= 0) || (cond.op == LE_OP && cmp < 0) ||
+                   (cond.op == GT_OP && cmp >= 0) || (cond.op == GE_OP && cmp > 0);
+        case LT_OP:
+            return ((cond.op == EQ_OP || cond.op == LE_OP) && cmp < 0) ||
+                   (cond.op == LT_OP && cmp <= 0);
+        case LE_OP:
+            return (cond.op == EQ_OP || cond.op == LT_OP || cond.op == LE_OP) && cmp <= 0;
+        case GT_OP:
+            return ((cond.op == EQ_OP || cond.op == GE_OP) && cmp > 0) ||
+                   (cond.op == GT_OP && cmp >= 0);
+        case GE_OP:
+            return (cond.op == EQ_OP || cond.op == GT_OP || cond.op == GE_OP) && cmp >= 0;
+        default:
+            return false;
+    }
+}
+
+//
+// 部分索引只能用于查询条件蕴含其全部条件的查询（否则会漏掉不在索引中的记录）：
+// 索引的每个条件都要被查询中同一属性上的某个 "属性 op 常量" 条件蕴含
+//
+bool QueryOptimizer::PredicateImplied(const SM_IndexDesc &index, const QueryContext &context) {
+    for (int i = 0; i < index.predCount; i++) {
+        bool implied = false;
+        for (const Condition &cond : context.conditions) {
+            if (ConditionImplies(cond, index.preds[i])) {
+                implied = true;
+                break;
+            }
+        }
+        if (!implied) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//
+// 估算索引扫描返回的条目数：实际扫描索引范围，数到limit为止
+// 出错时返回limit（不选用该索引）
+//
+int QueryOptimizer::EstimateIndexRows(IndexScanNode *node, int limit) {
+    IX_IndexHandle indexHandle;
+    IX_IndexScan indexScan;
+    if (node->OpenIndexScan(indexHandle, indexScan) != OK) {
+        return limit;
+    }
+    
+    int nRows = 0;
+    IX_ScanBatch batch;
+    RC rc = OK;
+    while (nRows < limit && (rc = indexScan.GetNextBatch(batch)) == OK) {
+        nRows += batch.nEntries;
+    }
+    
+    indexScan.CloseScan();
+    ixManager->CloseIndex(indexHandle);
+    
+    return (rc == OK || rc == IX_EOF) ? nRows : limit;
 }
 
 //
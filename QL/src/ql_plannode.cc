@@ -4,6 +4,8 @@
 #include <iomanip>
 #include <algorithm>
 #include <memory>
+#include <climits>
+#include <cmath>
 
 using namespace std;
 
@@ -15,7 +17,8 @@ using namespace std;
 // ScanNode 实现
 //
 ScanNode::ScanNode(const string &relationName, SM_Manager *sm, RM_Manager *rm) 
-    : PlanNode(NODE_FILESCAN), relation(relationName), smManager(sm), rmManager(rm), isOpen(false) {
+    : PlanNode(NODE_FILESCAN), relation(relationName), smManager(sm), rmManager(rm), isOpen(false),
+      hasScanCond(false), scanOp(NO_OP), nWorkers(0), batchPos(0) {
     // 获取关系的属性信息
     DataAttrInfo *attrs = nullptr;
     int nAttrs = 0;
@@ -38,6 +41,50 @@ ScanNode::~ScanNode() {
     }
 }
 
+//
+// 设置下推到RM扫描的条件（上层的SelectNode仍然保留）
+//
+void ScanNode::SetScanCondition(const DataAttrInfo &attr, CompOp op, const Value &value) {
+    scanAttr = attr;
+    scanOp = op;
+    scanValue = value;
+    hasScanCond = true;
+}
+
+//
+// 把 "属性 op 常量" 条件交给扫描节点，由并行扫描的工作线程检查
+// 属性类型与常量类型不同的条件留给SelectNode（报告类型不兼容）
+//
+bool ScanNode::AddScanPredicate(const Condition &cond) {
+    if (cond.bRhsIsAttr || cond.op == NO_OP || cond.rhsValue.data == nullptr ||
+        cond.lhsAttr.attrName == nullptr) {
+        return false;
+    }
+    
+    for (const auto &attrInfo : outputAttrs) {
+        bool nameMatches = (strcmp(attrInfo.attrName, cond.lhsAttr.attrName) == 0);
+        bool relMatches = (!cond.lhsAttr.relName || strlen(cond.lhsAttr.relName) == 0 ||
+                           strcmp(attrInfo.relName, cond.lhsAttr.relName) == 0);
+        if (nameMatches && relMatches) {
+            if (attrInfo.attrType != cond.rhsValue.type) {
+                return false;
+            }
+            scanPreds.push_back(cond);
+            scanPredAttrs.push_back(attrInfo);
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+//
+// 使用并行扫描
+//
+void ScanNode::SetParallel(int workers) {
+    nWorkers = workers;
+}
+
 RC ScanNode::Open() {
     RC rc;
     
@@ -50,8 +97,28 @@ RC ScanNode::Open() {
         return rc;
     }
     
-    // 初始化文件扫描
-    if ((rc = fileScan.OpenScan(fileHandle, INT, 4, 0, NO_OP, nullptr))) {
+    // 初始化文件扫描，有下推条件时由RM按区域映射跳过页面
+    if (nWorkers > 0) {
+        vector<RM_ScanPredicate> preds;
+        for (size_t i = 0; i < scanPreds.size(); i++) {
+            RM_ScanPredicate pred;
+            pred.attrType = scanPredAttrs[i].attrType;
+            pred.attrLength = scanPredAttrs[i].attrLength;
+            pred.attrOffset = scanPredAttrs[i].offset;
+            pred.compOp = scanPreds[i].op;
+            pred.value = scanPreds[i].rhsValue.data;
+            preds.push_back(pred);
+        }
+        rc = parallelScan.OpenScan(fileHandle, preds.size(), preds.data(), nWorkers);
+        batch = RM_ScanBatch();
+        batchPos = 0;
+    } else if (hasScanCond) {
+        rc = fileScan.OpenScan(fileHandle, scanAttr.attrType, scanAttr.attrLength,
+                               scanAttr.offset, scanOp, scanValue.data);
+    } else {
+        rc = fileScan.OpenScan(fileHandle, INT, 4, 0, NO_OP, nullptr);
+    }
+    if (rc) {
         rmManager->CloseFile(fileHandle);
         return rc;
     }
@@ -67,6 +134,18 @@ RC ScanNode::GetNext(char *data) {
         return QL_PLANNOTOPEN;
     }
     
+    // 并行扫描：从当前批次中取记录，取完后等待下一批
+    if (nWorkers > 0) {
+        while (batchPos >= batch.nRecords) {
+            if ((rc = parallelScan.GetNextBatch(batch))) {
+                return rc;
+            }
+            batchPos = 0;
+        }
+        memcpy(data, batch.GetRecord(batchPos++), GetTupleLength());
+        return OK;
+    }
+    
     RM_Record record;
     if ((rc = fileScan.GetNextRec(record))) {
         return rc;
@@ -91,7 +170,7 @@ RC ScanNode::Close() {
     }
     
     // 关闭扫描
-    RC rc1 = fileScan.CloseScan();
+    RC rc1 = (nWorkers > 0) ? parallelScan.CloseScan() : fileScan.CloseScan();
     RC rc2 = rmManager->CloseFile(fileHandle);
     
     isOpen = false;
@@ -101,7 +180,18 @@ RC ScanNode::Close() {
 
 void ScanNode::Print(int indent) {
     PrintIndent(indent);
-    cout << "Scan(" << relation << ")" << endl;
+    if (nWorkers > 0) {
+        cout << "ParallelScan(" << relation << ", " << nWorkers << " workers";
+        for (const auto &attr : scanPredAttrs) {
+            cout << ", filter on " << attr.attrName;
+        }
+    } else {
+        cout << "Scan(" << relation;
+        if (hasScanCond) {
+            cout << ", zonemap on " << scanAttr.attrName;
+        }
+    }
+    cout << ")" << endl;
 }
 
 int ScanNode::GetTupleLength() {
@@ -122,6 +212,537 @@ int ScanNode::GetTupleLength() {
 }
 
 
+//
+// IndexScanNode 实现
+//
+IndexScanNode::IndexScanNode(const string &relationName, const SM_IndexDesc &idx,
+                             SM_Manager *sm, IX_Manager *ixm, RM_Manager *rmm)
+    : PlanNode(NODE_INDEXSCAN), relation(relationName), index(idx),
+      ixManager(ixm), rmManager(rmm), isOpen(false), bIndexOnly(false), batchPos(0),
+      bReverse(false) {
+    for (int k = 0; k < IX_MAX_KEY_PARTS; k++) {
+        hasLow[k] = hasHigh[k] = false;
+        lowInclusive[k] = highInclusive[k] = false;
+    }
+    
+    // 输出整个元组，与ScanNode相同
+    DataAttrInfo *attrs = nullptr;
+    int nAttrs = 0;
+    
+    RC rc = sm->GetRelInfo(relation.c_str(), attrs, nAttrs);
+    if (rc == OK && attrs != nullptr && nAttrs > 0) {
+        for (int i = 0; i < nAttrs; i++) {
+            outputAttrs.push_back(attrs[i]);
+        }
+        delete[] attrs;
+    }
+}
+
+IndexScanNode::~IndexScanNode() {
+    if (isOpen) {
+        Close();
+    }
+}
+
+//
+// 比较两个同类型的常量
+//
+static int CompareConstants(AttrType type, const void *v1, const void *v2) {
+    switch (type) {
+        case INT: {
+            int a = *(const int*)v1, b = *(const int*)v2;
+            return (a < b) ? -1 : (a > b) ? 1 : 0;
+        }
+        case FLOAT: {
+            float a = *(const float*)v1, b = *(const float*)v2;
+            return (a < b) ? -1 : (a > b) ? 1 : 0;
+        }
+        case STRING:
+            return strcmp((const char*)v1, (const char*)v2);
+    }
+    return 0;
+}
+
+//
+// 把键中某个属性上的 "属性 op 常量" 条件合并进该属性的范围，多个条件取交集
+// NE_OP等不能表示为一个范围的条件返回false
+//
+bool IndexScanNode::AddRangeCondition(const Condition &cond) {
+    if (cond.bRhsIsAttr || cond.rhsValue.data == nullptr || cond.lhsAttr.attrName == nullptr) {
+        return false;
+    }
+    
+    int k = 0;
+    while (k < index.keyCount && strcmp(cond.lhsAttr.attrName, index.keyAttrs[k].attrName) != 0) {
+        k++;
+    }
+    if (k == index.keyCount ||
+        (cond.lhsAttr.relName && strlen(cond.lhsAttr.relName) > 0 &&
+         strcmp(cond.lhsAttr.relName, index.keyAttrs[k].relName) != 0) ||
+        cond.rhsValue.type != index.keyAttrs[k].attrType) {
+        return false;
+    }
+    
+    AttrType type = index.keyAttrs[k].attrType;
+    const void *v = cond.rhsValue.data;
+    bool tightenLow = (cond.op == EQ_OP || cond.op == GT_OP || cond.op == GE_OP);
+    bool tightenHigh = (cond.op == EQ_OP || cond.op == LT_OP || cond.op == LE_OP);
+    if (!tightenLow && !tightenHigh) {
+        return false;
+    }
+    
+    if (tightenLow) {
+        bool incl = (cond.op != GT_OP);
+        int cmp = hasLow[k] ? CompareConstants(type, v, lowValue[k].data) : 1;
+        if (cmp > 0 || (cmp == 0 && !incl)) {
+            lowValue[k] = cond.rhsValue;
+            lowInclusive[k] = incl;
+            hasLow[k] = true;
+        }
+    }
+    if (tightenHigh) {
+        bool incl = (cond.op != LT_OP);
+        int cmp = hasHigh[k] ? CompareConstants(type, v, highValue[k].data) : -1;
+        if (cmp < 0 || (cmp == 0 && !incl)) {
+            highValue[k] = cond.rhsValue;
+            highInclusive[k] = incl;
+            hasHigh[k] = true;
+        }
+    }
+    
+    rangeConds.push_back(cond);
+    return true;
+}
+
+bool IndexScanNode::HasRange() const {
+    if (index.indexType == IX_HASH) {
+        return EqualityPrefix() == index.keyCount;
+    }
+    return hasLow[0] || hasHigh[0];
+}
+
+int IndexScanNode::EqualityPrefix() const {
+    int nEq = 0;
+    while (nEq < index.keyCount && hasLow[nEq] && hasHigh[nEq] &&
+           lowInclusive[nEq] && highInclusive[nEq] &&
+           CompareConstants(index.keyAttrs[nEq].attrType,
+                            lowValue[nEq].data, highValue[nEq].data) == 0) {
+        nEq++;
+    }
+    return nEq;
+}
+
+//
+// 按键的顺序输出能否满足ORDER BY：排序属性依次是键中的属性（前面有等值条件的属性可以跳过），
+// 方向都相同。哈希索引没有顺序
+//
+bool IndexScanNode::MatchesOrder(const vector<OrderAttr> &orderAttrs, bool &bDescending) const {
+    if (index.indexType == IX_HASH || orderAttrs.empty()) {
+        return false;
+    }
+    
+    int nEq = EqualityPrefix();
+    int k = 0;
+    bDescending = orderAttrs[0].bDescending;
+    for (const OrderAttr &orderAttr : orderAttrs) {
+        const RelAttr &attr = orderAttr.attr;
+        if (orderAttr.bDescending != bDescending || attr.attrName == nullptr) {
+            return false;
+        }
+        auto matches = [&](int part) {
+            return strcmp(attr.attrName, index.keyAttrs[part].attrName) == 0 &&
+                   (!attr.relName || strlen(attr.relName) == 0 ||
+                    strcmp(attr.relName, index.keyAttrs[part].relName) == 0);
+        };
+        while (k < nEq && !matches(k)) {
+            k++;
+        }
+        if (k >= index.keyCount || !matches(k)) {
+            return false;
+        }
+        k++;
+    }
+    
+    return true;
+}
+
+//
+// 把键中一个属性的值写入key，value为NULL时写入该类型的最小值（bMax时为最大值）
+//
+static void FillKeyPart(const DataAttrInfo &attr, const void *value, bool bMax, char *key) {
+    switch (attr.attrType) {
+        case INT: {
+            int v = value ? *(const int*)value : (bMax ? INT_MAX : INT_MIN);
+            memcpy(key, &v, sizeof(int));
+            break;
+        }
+        case FLOAT: {
+            float v = value ? *(const float*)value : (bMax ? HUGE_VALF : -HUGE_VALF);
+            memcpy(key, &v, sizeof(float));
+            break;
+        }
+        case STRING:
+            if (value) {
+                memset(key, 0, attr.attrLength);
+                strncpy(key, (const char*)value, attr.attrLength);
+            } else {
+                memset(key, bMax ? 0xFF : 0x00, attr.attrLength);
+            }
+            break;
+    }
+}
+
+//
+// 打开索引并按扫描范围开始索引扫描（优化器估算结果行数时也使用）
+// 组合索引的范围由前面连续的等值属性和其后一个属性上的范围组成，
+// 之后的属性按边界是否包含填入最小值或最大值。更后面属性上的条件不限定范围，
+// 仍由上层的选择节点检查
+//
+RC IndexScanNode::OpenIndexScan(IX_IndexHandle &handle, IX_IndexScan &scan) {
+    RC rc;
+    
+    if ((rc = ixManager->OpenIndex(relation.c_str(), index.indexNo, handle))) {
+        return rc;
+    }
+    
+    // 前面连续的等值属性个数（哈希索引总是全部属性，上下界相同）
+    int nEq = EqualityPrefix();
+    
+    vector<char> lowKey(index.KeyLength()), highKey(index.KeyLength());
+    bool lowIncl = true, highIncl = true;
+    bool lowBounded = (nEq > 0), highBounded = (nEq > 0);
+    char *lowPos = lowKey.data(), *highPos = highKey.data();
+    for (int k = 0; k < index.keyCount; k++) {
+        const DataAttrInfo &attr = index.keyAttrs[k];
+        if (k < nEq) {
+            FillKeyPart(attr, lowValue[k].data, false, lowPos);
+            FillKeyPart(attr, lowValue[k].data, false, highPos);
+        } else if (k == nEq) {
+            if (hasLow[k]) {
+                lowIncl = lowInclusive[k];
+                lowBounded = true;
+            }
+            if (hasHigh[k]) {
+                highIncl = highInclusive[k];
+                highBounded = true;
+            }
+            FillKeyPart(attr, hasLow[k] ? lowValue[k].data : nullptr, false, lowPos);
+            FillKeyPart(attr, hasHigh[k] ? highValue[k].data : nullptr, true, highPos);
+        } else {
+            // 包含下界时从最小值开始，不包含时跳过等于边界的所有键；上界相反
+            FillKeyPart(attr, nullptr, !lowIncl, lowPos);
+            FillKeyPart(attr, nullptr, highIncl, highPos);
+        }
+        lowPos += attr.attrLength;
+        highPos += attr.attrLength;
+    }
+    
+    if ((rc = scan.OpenRangeScan(handle,
+                                 lowBounded ? lowKey.data() : nullptr, lowIncl,
+                                 highBounded ? highKey.data() : nullptr, highIncl,
+                                 NO_HINT, bReverse))) {
+        ixManager->CloseIndex(handle);
+        return rc;
+    }
+    
+    return OK;
+}
+
+RC IndexScanNode::Open() {
+    RC rc;
+    
+    if (isOpen) {
+        return QL_PLANOPEN;
+    }
+    
+    if (!bIndexOnly && (rc = rmManager->OpenFile(relation.c_str(), fileHandle))) {
+        return rc;
+    }
+    
+    if ((rc = OpenIndexScan(indexHandle, indexScan))) {
+        if (!bIndexOnly) {
+            rmManager->CloseFile(fileHandle);
+        }
+        return rc;
+    }
+    
+    batch.nEntries = 0;
+    batchPos = 0;
+    isOpen = true;
+    return OK;
+}
+
+RC IndexScanNode::GetNext(char *data) {
+    RC rc;
+    
+    if (!isOpen) {
+        return QL_PLANNOTOPEN;
+    }
+    
+    if (bIndexOnly) {
+        // 按叶子批量取出条目，用键和附带数据拼出元组
+        while (batchPos >= batch.nEntries) {
+            if ((rc = indexScan.GetNextBatch(batch))) {
+                return (rc == IX_EOF) ? QL_EOF : rc;
+            }
+            batchPos = 0;
+        }
+        
+        memset(data, 0, GetTupleLength());
+        const char *key = batch.GetKey(batchPos);
+        for (int k = 0; k < index.keyCount; k++) {
+            memcpy(data + index.keyAttrs[k].offset, key, index.keyAttrs[k].attrLength);
+            key += index.keyAttrs[k].attrLength;
+        }
+        const char *payload = (index.includeCount > 0) ? batch.GetPayload(batchPos) : NULL;
+        for (int k = 0; k < index.includeCount; k++) {
+            memcpy(data + index.includeAttrs[k].offset, payload, index.includeAttrs[k].attrLength);
+            payload += index.includeAttrs[k].attrLength;
+        }
+        batchPos++;
+        
+        return OK;
+    }
+    
+    // 从索引取下一个RID，再从堆文件读取元组
+    RID rid;
+    if ((rc = indexScan.GetNextEntry(rid))) {
+        return (rc == IX_EOF) ? QL_EOF : rc;
+    }
+    
+    RM_Record record;
+    char *recordData;
+    if ((rc = fileHandle.GetRec(rid, record)) ||
+        (rc = record.GetData(recordData))) {
+        return rc;
+    }
+    
+    memcpy(data, recordData, GetTupleLength());
+    
+    return OK;
+}
+
+RC IndexScanNode::Close() {
+    if (!isOpen) {
+        return QL_PLANNOTOPEN;
+    }
+    
+    RC rc1 = indexScan.CloseScan();
+    RC rc2 = ixManager->CloseIndex(indexHandle);
+    RC rc3 = bIndexOnly ? OK : rmManager->CloseFile(fileHandle);
+    
+    isOpen = false;
+    
+    return (rc1 != OK) ? rc1 : (rc2 != OK) ? rc2 : rc3;
+}
+
+void IndexScanNode::Print(int indent) {
+    PrintIndent(indent);
+    cout << (bIndexOnly ? "IndexOnlyScan(" : "IndexScan(") << relation << ", index on ";
+    if (index.keyCount == 1) {
+        cout << index.keyAttrs[0].attrName;
+    } else {
+        cout << "(";
+        for (int k = 0; k < index.keyCount; k++) {
+            cout << (k > 0 ? ", " : "") << index.keyAttrs[k].attrName;
+        }
+        cout << ")";
+    }
+    if (index.includeCount > 0) {
+        cout << " include (";
+        for (int k = 0; k < index.includeCount; k++) {
+            cout << (k > 0 ? ", " : "") << index.includeAttrs[k].attrName;
+        }
+        cout << ")";
+    }
+    if (index.indexType == IX_HASH) {
+        cout << " using hash";
+    } else if (index.indexType == IX_BUFFERED) {
+        cout << " using buffered";
+    }
+    if (index.IsPartial()) {
+        cout << " partial";
+    }
+    if (bReverse) {
+        cout << " desc";
+    }
+    for (const auto &cond : rangeConds) {
+        cout << ", " << cond.lhsAttr.attrName << " " << QL_ConvertCompOpToString(cond.op) << " ";
+        switch (cond.rhsValue.type) {
+            case INT: cout << *(int*)cond.rhsValue.data; break;
+            case FLOAT: cout << *(float*)cond.rhsValue.data; break;
+            case STRING: cout << "'" << (char*)cond.rhsValue.data << "'"; break;
+        }
+    }
+    cout << ")" << endl;
+}
+
+int IndexScanNode::GetTupleLength() {
+    int maxEnd = 0;
+    for (const auto &attr : outputAttrs) {
+        int attrEnd = attr.offset + attr.attrLength;
+        if (attrEnd > maxEnd) {
+            maxEnd = attrEnd;
+        }
+    }
+    
+    return maxEnd;
+}
+
+//
+// BitmapHeapScanNode 实现
+//
+BitmapHeapScanNode::BitmapHeapScanNode(unique_ptr<IndexScanNode> source, RM_Manager *rmm)
+    : PlanNode(NODE_BITMAPHEAPSCAN), relation(source->relation), bUnion(false),
+      rmManager(rmm), isOpen(false), curPage(0), nPageTuples(0), pagePos(0) {
+    outputAttrs = source->outputAttrs;
+    indexSources.push_back(std::move(source));
+}
+
+BitmapHeapScanNode::~BitmapHeapScanNode() {
+    if (isOpen) {
+        Close();
+    }
+}
+
+void BitmapHeapScanNode::AddSource(unique_ptr<IndexScanNode> source) {
+    indexSources.push_back(std::move(source));
+}
+
+//
+// 扫描一个索引范围，把所有RID加入bitmap
+//
+RC BitmapHeapScanNode::CollectRids(IndexScanNode *source, RM_RidBitmap &bitmap) {
+    RC rc;
+    IX_IndexHandle indexHandle;
+    IX_IndexScan indexScan;
+    
+    if ((rc = source->OpenIndexScan(indexHandle, indexScan))) {
+        return rc;
+    }
+    
+    IX_ScanBatch batch;
+    while ((rc = indexScan.GetNextBatch(batch)) == OK) {
+        for (int i = 0; i < batch.nEntries; i++) {
+            if ((rc = bitmap.Add(batch.rids[i]))) {
+                break;
+            }
+        }
+        if (rc != OK) {
+            break;
+        }
+    }
+    if (rc == IX_EOF) {
+        rc = OK;
+    }
+    
+    RC rc1 = indexScan.CloseScan();
+    RC rc2 = source->ixManager->CloseIndex(indexHandle);
+    
+    return (rc != OK) ? rc : (rc1 != OK) ? rc1 : rc2;
+}
+
+RC BitmapHeapScanNode::Open() {
+    RC rc;
+    
+    if (isOpen) {
+        return QL_PLANOPEN;
+    }
+    
+    if ((rc = rmManager->OpenFile(relation.c_str(), fileHandle))) {
+        return rc;
+    }
+    
+    // 第一个索引范围直接收集到ridBitmap，其余的收集后与之合并
+    // 求交集时结果为空就不必再扫描后面的索引
+    ridBitmap.Clear();
+    rc = CollectRids(indexSources[0].get(), ridBitmap);
+    for (size_t i = 1; rc == OK && i < indexSources.size(); i++) {
+        if (!bUnion && ridBitmap.Count() == 0) {
+            break;
+        }
+        RM_RidBitmap other;
+        if ((rc = CollectRids(indexSources[i].get(), other))) {
+            break;
+        }
+        if (bUnion) {
+            ridBitmap.Or(other);
+        } else {
+            ridBitmap.And(other);
+        }
+    }
+    if (rc != OK) {
+        ridBitmap.Clear();
+        rmManager->CloseFile(fileHandle);
+        return rc;
+    }
+    
+    curPage = 0;
+    nPageTuples = 0;
+    pagePos = 0;
+    isOpen = true;
+    return OK;
+}
+
+RC BitmapHeapScanNode::GetNext(char *data) {
+    RC rc;
+    
+    if (!isOpen) {
+        return QL_PLANNOTOPEN;
+    }
+    
+    // 当前页面的元组取完后，读取下一个有RID的页面
+    if (pagePos >= nPageTuples) {
+        if ((rc = ridBitmap.GetNextPage(curPage, curPage, pageSlots))) {
+            return (rc == RM_EOF) ? QL_EOF : rc;
+        }
+        
+        pageTuples.resize(pageSlots.size() * fileHandle.GetRecordSize());
+        if ((rc = fileHandle.GetRecsOnPage(curPage, (int)pageSlots.size(),
+                                           pageSlots.data(), pageTuples.data()))) {
+            return rc;
+        }
+        nPageTuples = (int)pageSlots.size();
+        pagePos = 0;
+    }
+    
+    memcpy(data, pageTuples.data() + (size_t)pagePos * fileHandle.GetRecordSize(),
+           GetTupleLength());
+    pagePos++;
+    
+    return OK;
+}
+
+RC BitmapHeapScanNode::Close() {
+    if (!isOpen) {
+        return QL_PLANNOTOPEN;
+    }
+    
+    ridBitmap.Clear();
+    pageTuples.clear();
+    isOpen = false;
+    
+    return rmManager->CloseFile(fileHandle);
+}
+
+void BitmapHeapScanNode::Print(int indent) {
+    PrintIndent(indent);
+    cout << "BitmapHeapScan(" << relation << ")" << endl;
+    if (indexSources.size() == 1) {
+        indexSources[0]->Print(indent + 1);
+        return;
+    }
+    PrintIndent(indent + 1);
+    cout << (bUnion ? "BitmapOr" : "BitmapAnd") << endl;
+    for (const auto &source : indexSources) {
+        source->Print(indent + 2);
+    }
+}
+
+int BitmapHeapScanNode::GetTupleLength() {
+    return indexSources[0]->GetTupleLength();
+}
+
 //
 // SelectNode 实现
 //
@@ -663,6 +1284,189 @@ void JoinNode::PrintJoinCondition(const Condition &cond) {
     }
 }
 
+//
+// SortNode 实现
+//
+SortNode::SortNode(unique_ptr<PlanNode> child, const vector<OrderAttr> &attrs)
+    : PlanNode(NODE_SORT), childNode(std::move(child)), orderAttrs(attrs),
+      tupleLength(0), nextPos(0) {
+    outputAttrs = childNode->outputAttrs;
+    
+    // 在子节点的输出属性中找到排序属性（没有给出关系名时匹配第一个同名属性）
+    for (const OrderAttr &orderAttr : orderAttrs) {
+        int found = -1;
+        for (size_t i = 0; i < outputAttrs.size() && found < 0; i++) {
+            const RelAttr &attr = orderAttr.attr;
+            if (attr.attrName && strcmp(outputAttrs[i].attrName, attr.attrName) == 0 &&
+                (!attr.relName || strlen(attr.relName) == 0 ||
+                 strcmp(outputAttrs[i].relName, attr.relName) == 0)) {
+                found = (int)i;
+            }
+        }
+        sortAttrs.push_back(found);
+    }
+}
+
+SortNode::~SortNode() {
+    // unique_ptr会自动清理childNode
+}
+
+RC SortNode::Open() {
+    RC rc;
+    
+    for (int attrNo : sortAttrs) {
+        if (attrNo < 0) {
+            return QL_ATTRNOTFOUND;
+        }
+    }
+    
+    // 读出子节点的全部元组
+    if ((rc = childNode->Open())) {
+        return rc;
+    }
+    tupleLength = childNode->GetTupleLength();
+    tuples.clear();
+    vector<char> tuple(max(tupleLength, 4096));
+    while ((rc = childNode->GetNext(tuple.data())) == OK) {
+        tuples.insert(tuples.end(), tuple.begin(), tuple.begin() + tupleLength);
+    }
+    RC rcClose = childNode->Close();
+    if (rc != QL_EOF && rc != RM_EOF) {    // 扫描节点直接返回RM_EOF
+        return rc;
+    }
+    if (rcClose != OK) {
+        return rcClose;
+    }
+    
+    // 排序元组编号，相等的元组保持子节点的输出顺序
+    int nTuples = (tupleLength > 0) ? (int)(tuples.size() / tupleLength) : 0;
+    order.resize(nTuples);
+    for (int i = 0; i < nTuples; i++) {
+        order[i] = i;
+    }
+    stable_sort(order.begin(), order.end(), [this](int a, int b) { return TupleLess(a, b); });
+    nextPos = 0;
+    
+    return OK;
+}
+
+bool SortNode::TupleLess(int a, int b) const {
+    const char *tupleA = &tuples[(size_t)a * tupleLength];
+    const char *tupleB = &tuples[(size_t)b * tupleLength];
+    
+    for (size_t i = 0; i < sortAttrs.size(); i++) {
+        const DataAttrInfo &attr = outputAttrs[sortAttrs[i]];
+        const char *valueA = tupleA + attr.offset;
+        const char *valueB = tupleB + attr.offset;
+        int cmp = 0;
+        switch (attr.attrType) {
+            case INT: {
+                int x, y;
+                memcpy(&x, valueA, sizeof(int));
+                memcpy(&y, valueB, sizeof(int));
+                cmp = (x < y) ? -1 : (x > y) ? 1 : 0;
+                break;
+            }
+            case FLOAT: {
+                float x, y;
+                memcpy(&x, valueA, sizeof(float));
+                memcpy(&y, valueB, sizeof(float));
+                cmp = (x < y) ? -1 : (x > y) ? 1 : 0;
+                break;
+            }
+            case STRING:
+                cmp = strncmp(valueA, valueB, attr.attrLength);
+                break;
+        }
+        if (cmp != 0) {
+            return orderAttrs[i].bDescending ? cmp > 0 : cmp < 0;
+        }
+    }
+    
+    return false;
+}
+
+RC SortNode::GetNext(char *data) {
+    if (nextPos >= order.size()) {
+        return QL_EOF;
+    }
+    
+    memcpy(data, &tuples[(size_t)order[nextPos++] * tupleLength], tupleLength);
+    return OK;
+}
+
+RC SortNode::Close() {
+    // 子节点在Open中已经关闭
+    tuples.clear();
+    order.clear();
+    nextPos = 0;
+    return OK;
+}
+
+void SortNode::Print(int indent) {
+    PrintIndent(indent);
+    cout << "Sort(";
+    for (size_t i = 0; i < orderAttrs.size(); i++) {
+        if (i > 0) cout << ", ";
+        if (orderAttrs[i].attr.relName) {
+            cout << orderAttrs[i].attr.relName << ".";
+        }
+        cout << orderAttrs[i].attr.attrName << (orderAttrs[i].bDescending ? " DESC" : "");
+    }
+    cout << ")" << endl;
+    
+    childNode->Print(indent + 1);
+}
+
+int SortNode::GetTupleLength() {
+    return childNode->GetTupleLength();
+}
+
+//
+// LimitNode 实现
+//
+LimitNode::LimitNode(unique_ptr<PlanNode> child, int n)
+    : PlanNode(NODE_LIMIT), childNode(std::move(child)), limit(n), nReturned(0) {
+    outputAttrs = childNode->outputAttrs;
+}
+
+LimitNode::~LimitNode() {
+    // unique_ptr会自动清理childNode
+}
+
+RC LimitNode::Open() {
+    nReturned = 0;
+    return childNode->Open();
+}
+
+RC LimitNode::GetNext(char *data) {
+    RC rc;
+    
+    if (nReturned >= limit) {
+        return QL_EOF;
+    }
+    if ((rc = childNode->GetNext(data))) {
+        return rc;
+    }
+    nReturned++;
+    return OK;
+}
+
+RC LimitNode::Close() {
+    return childNode->Close();
+}
+
+void LimitNode::Print(int indent) {
+    PrintIndent(indent);
+    cout << "Limit(" << limit << ")" << endl;
+    
+    childNode->Print(indent + 1);
+}
+
+int LimitNode::GetTupleLength() {
+    return childNode->GetTupleLength();
+}
+
 //
 // 工具函数实现
 //
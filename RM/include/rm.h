@@ -3,13 +3,27 @@
 
 #include "redbase.h"
 #include "rm_rid.h"
+#include <cstdint>
+#include <map>
+#include <vector>
 
 // Forward declarations
 class RM_Record;
 class RM_FileHandle;
 class RM_FileScan;
+class RM_ParallelScan;
 class PF_Manager;
 class PF_FileHandle;
+class PF_PageHandle;
+
+// 页面布局
+enum RM_PageLayout {
+    RM_LAYOUT_ROW = 0,                     // 按行存储（NSM），记录连续存放
+    RM_LAYOUT_PAX = 1,                     // 按属性分区存储（PAX），每个属性一个minipage
+    RM_LAYOUT_SLOTTED = 2                  // 槽目录+变长记录，STRING属性只存实际长度
+};
+
+#define RM_MAX_COLUMNS     40              // PAX/SLOTTED布局下最多的属性（列）数
 
 //
 // RM_Manager: 记录管理器类
@@ -21,14 +35,31 @@ public:
     ~RM_Manager();                         // 析构函数
     
     RC CreateFile(const char *fileName, int recordSize);  // 创建文件
+    RC CreateFile(const char *fileName, int recordSize,   // 按指定布局创建文件
+                  RM_PageLayout layout, int attrCount,
+                  const int attrLengths[],
+                  const AttrType attrTypes[] = NULL);
     RC DestroyFile(const char *fileName);                 // 删除文件
     RC OpenFile(const char *fileName, RM_FileHandle &fileHandle);  // 打开文件
     RC CloseFile(RM_FileHandle &fileHandle);              // 关闭文件
 
 private:
+    RC UpgradeFile(PF_FileHandle &pfFileHandle, char *hdrData);  // 版本0 -> 当前格式
+    RC WriteFileHdr(RM_FileHandle &fileHandle);           // 写回文件头和空闲空间映射
+    
     PF_Manager *pfManager;                 // PF管理器指针
 };
 
+//
+// RM_MoveListener: VACUUM移动记录时的回调接口
+// 记录从oldRid移到newRid后调用，用于维护引用RID的结构（如索引）
+//
+class RM_MoveListener {
+public:
+    virtual ~RM_MoveListener() {}
+    virtual RC RecordMoved(const char *pData, const RID &oldRid, const RID &newRid) = 0;
+};
+
 //
 // RM_FileHandle: 记录文件句柄类
 // 用于操作打开文件中的记录
@@ -43,18 +74,97 @@ public:
     RC DeleteRec(const RID &rid);                          // 删除记录
     RC UpdateRec(const RM_Record &rec);                    // 更新记录
     RC ForcePages(PageNum pageNum = ALL_PAGES) const;      // 强制写入页面
+    
+    // 一次固定页面读取其上的多条记录，按slots的顺序连续存放到pData
+    // （pData至少nSlots * 记录大小字节），任一槽位没有记录时返回RM_RECORDNOTFOUND
+    RC GetRecsOnPage(PageNum pageNum, int nSlots, const SlotNum slots[], char *pData) const;
+    
+    // 把记录移到前面的空闲页面并截断末尾的空页，每移动一条记录调用一次listener
+    RC Vacuum(RM_MoveListener *listener, int &nMoved, int &nFreedPages);
+    
+    // 区域映射（每组数据页上某属性的最小/最大值）
+    RC CreateZoneMap(AttrType attrType, int attrLength, int attrOffset);  // 跟踪属性并重建
+    RC DropZoneMap(int attrOffset);                        // 停止跟踪属性
+    RC RebuildZoneMaps();                                  // 扫描全文件重建区域映射
+    bool HasZoneMap(int attrOffset) const;                 // 属性是否被跟踪
+    RC EstimateScanPages(AttrType attrType, int attrOffset,
+                         CompOp compOp, void *value,
+                         int &nPages) const;               // 估算需要读取的数据页数
+    
+    // 列访问：固定页面并返回某属性在页内第0个槽位的指针和相邻槽位的间隔
+    // 槽位i的属性值位于 pColumn + i * stride，slotBitmap的第i位表示槽位i是否有记录
+    // ROW布局的间隔为记录长度，PAX布局的间隔为属性长度（值连续存放）
+    // SLOTTED布局的记录是变长的，不支持列访问（返回RM_BADLAYOUT）
+    RC GetColumn(PageNum pageNum, int attrOffset, char *&pColumn, int &stride,
+                 const char *&slotBitmap, int &nSlots) const;
+    RC ReleaseColumn(PageNum pageNum) const;               // 解除GetColumn固定的页面
+    RM_PageLayout GetLayout() const { return pageLayout; } // 页面布局
+    PageNum GetNumPages() const { return numPages; }       // 总页数（含头页）
+    int GetRecordSize() const { return recordSize; }       // 记录大小
 
 private:
     friend class RM_Manager;
     friend class RM_FileScan;
+    friend class RM_ParallelScan;
+    
+    bool PageMayMatch(PageNum pageNum, AttrType attrType, int attrOffset,
+                      CompOp compOp, void *value) const;   // 页面是否可能有匹配记录
+    void WidenZoneMaps(PageNum pageNum, const char *pData); // 用记录扩展页面所在区
+    void ResetZoneMaps(PageNum pageNum);                   // 页面变空时清除所在区
+    
+    // 空闲空间映射（rm_fsm.cc）
+    int GetFreeSpace(PageNum pageNum) const;               // 页面的填充等级
+    void SetFreeSpace(PageNum pageNum, int level);
+    int CalcFreeSpace(char *pageData) const;               // 根据页面内容计算填充等级
+    void UpdateFreeSpace(PageNum pageNum, char *pageData); // 页面内容变化后更新映射
+    bool IsDataPage(PageNum pageNum) const;                // 页号是否是文件中的数据页
+    PageNum FindFreePage(PageNum limit);                   // 页号小于limit的第一个有空间的页面
+    RC LoadFsm(PageNum firstFsmPage);                      // 打开文件时读入映射页
+    RC FlushFsm();                                         // 写回修改过的映射页
+    RC RebuildFsm();                                       // 根据页面内容重建映射
+    RC ExtendFsm();                                        // 为新增的页面分配映射页
+    RC MoveFsmPage(int g, PageNum pageNum);                // 把映射页移到空页
+    void InitDataPage(char *pageData) const;               // 初始化为空的数据页
+    RC AllocateDataPage(PageNum &pageNum, PF_PageHandle &pageHandle, char *&pageData);
+    RC InsertIntoPage(PageNum pageNum, const char *pData, RID &rid);  // RM_INVALID_PAGE表示新页面
+    RC ListPageSlots(PageNum pageNum, bool bForwardedOnly, SlotNum *slots, int &nSlots) const;
+    RC RelocateRec(const RID &rid, PageNum limit, char *pData, RID &newRid);
+    RC TruncateEmptyPages(int &nFreedPages);
+    
+    // 按页面布局定位和读写记录
+    char *GetColumnPtr(char *pageData, int attrOffset, int &stride) const;
+    RC ReadRecord(char *pageData, int slotNum, char *pData) const;
+    void WriteRecord(char *pageData, int slotNum, const char *pData) const;
+    int GetSlotCount(char *pageData) const;                // 页面上的槽位数
+    bool SlotInUse(char *pageData, int slotNum) const;     // 槽位上是否有记录
+    
+    // SLOTTED布局（rm_slotted.cc）
+    int EncodeRecord(const char *pData, char *buf) const;  // 定长记录 -> 变长格式
+    void DecodeRecord(const char *buf, char *pData) const; // 变长格式 -> 定长记录
+    RC InsertSlottedRec(PageNum pageNum, const char *pData, RID &rid);
+    RC DeleteSlottedRec(PageNum pageNum, SlotNum slotNum);
+    RC UpdateSlottedRec(PageNum pageNum, SlotNum slotNum, const char *pData);
+    RC PlaceSlotted(PageNum pageNum, const char *data, int len, int flags, RID &rid);
+    RC RemoveForwarded(const char *stub);                  // 删除转发指针指向的记录
+    RC ReadForwarded(const char *stub, char *pData) const; // 读取转发指针指向的记录
     
     PF_FileHandle *pfFileHandle;           // PF文件句柄
     int recordSize;                        // 记录大小
     int recordsPerPage;                    // 每页记录数
     PageNum numPages;                      // 总页数
-    PageNum firstFree;                     // 第一个空闲页
     bool bFileOpen;                        // 文件是否打开
     bool bHdrChanged;                      // 头部是否被修改
+    char *zoneMap;                         // 区域映射（头页对应区域的副本）
+    std::vector<char> fsm;                 // 空闲空间映射（各映射页的内容依次相连）
+    std::vector<PageNum> fsmPages;         // 每组的映射页页号
+    std::vector<char> fsmDirty;            // 映射页是否被修改
+    PageNum fsmHint;                       // 页号小于它的数据页都没有空间
+    RM_PageLayout pageLayout;              // 页面布局
+    int numColumns;                        // PAX/SLOTTED布局的列数
+    int colOffset[RM_MAX_COLUMNS];         // 每列在记录中的偏移
+    int colLength[RM_MAX_COLUMNS];         // 每列的长度
+    AttrType colType[RM_MAX_COLUMNS];      // 每列的类型（SLOTTED布局压缩STRING列）
+    int maxEncodedSize;                    // SLOTTED布局下一条记录编码后的最大长度
 };
 
 //
@@ -91,6 +201,112 @@ private:
     int recordSize;                        // 记录大小
     int recordsPerPage;                    // 每页记录数
     PageNum numPages;                      // 总页数
+    const RM_FileHandle *fileHandle;       // 所属文件句柄（用于查询区域映射）
+    char *recordBuf;                       // SLOTTED布局下解码记录的缓冲区
+};
+
+//
+// RM_ScanPredicate: 并行扫描的条件（属性 compOp 常量），含义与RM_FileScan的扫描条件相同
+//
+struct RM_ScanPredicate {
+    AttrType attrType;                     // 属性类型
+    int attrLength;                        // 属性长度
+    int attrOffset;                        // 属性偏移
+    CompOp compOp;                         // 比较操作
+    void *value;                           // 比较值（扫描期间必须有效）
+};
+
+//
+// RM_ScanBatch: 并行扫描返回的一批记录
+// 记录按recordSize连续存放，第i条记录的RID为rids[i]
+//
+struct RM_ScanBatch {
+    std::vector<char> data;                // 记录数据
+    std::vector<RID> rids;                 // 记录ID
+    int recordSize;                        // 记录大小
+    int nRecords;                          // 记录条数
+    
+    RM_ScanBatch() : recordSize(0), nRecords(0) {}
+    const char *GetRecord(int i) const { return data.data() + (size_t)i * recordSize; }
+};
+
+struct RM_ParallelScanState;
+
+//
+// RM_ParallelScan: 并行文件扫描类
+// 把数据页划分为固定页数的块（morsel），工作线程每次领取一个块，
+// 按条件过滤后把匹配的记录打包成一批交给调用者。批次之间没有顺序保证。
+// 扫描期间文件不能被修改。
+//
+class RM_ParallelScan {
+public:
+    RM_ParallelScan();                     // 构造函数
+    ~RM_ParallelScan();                    // 析构函数
+    
+    RC OpenScan(const RM_FileHandle &fileHandle,
+                int nPredicates,
+                const RM_ScanPredicate predicates[],
+                int nWorkers = 0);                         // 开始扫描，nWorkers为0时按CPU核数
+    RC GetNextBatch(RM_ScanBatch &batch);                  // 获取下一批记录，结束时返回RM_EOF
+    RC CloseScan();                                        // 结束扫描（等待工作线程退出）
+    
+    static int DefaultWorkers();                           // 默认的工作线程数
+    int GetNumWorkers() const;                             // 本次扫描的工作线程数
+
+private:
+    void RunWorker();                                      // 工作线程主循环
+    RC ScanMorsel(PageNum firstPage, PageNum lastPage,
+                  char *recordBuf, RM_ScanBatch &batch);   // 扫描[firstPage, lastPage)
+    
+    RM_ParallelScanState *state;           // 扫描期间的共享状态（rm_parallelscan.cc）
+};
+
+//
+// RM_RidContainer: RM_RidBitmap中一个页面上的槽位集合
+// 槽位少时保存为有序的槽号数组，超过RM_RIDSET_ARRAY_MAX个后改为位图（每个字64个槽位）
+//
+#define RM_RIDSET_ARRAY_MAX 64
+
+struct RM_RidContainer {
+    std::vector<uint16_t> slots;           // 有序槽号（bBitmap为false时）
+    std::vector<uint64_t> bits;            // 槽位位图（bBitmap为true时）
+    int count;                             // 槽位个数
+    bool bBitmap;
+    
+    RM_RidContainer() : count(0), bBitmap(false) {}
+    bool Add(SlotNum slot);                // 加入槽位，原来没有时返回true
+    bool Contains(SlotNum slot) const;
+    void ToBitmap();                       // 数组 -> 位图
+    void Compact();                        // 槽位变少后位图 -> 数组
+    void GetSlots(std::vector<SlotNum> &out) const;
+};
+
+//
+// RM_RidBitmap: 按页面组织的压缩RID集合（类似roaring bitmap，以页号为高位）
+// 每个数据页一个槽位容器，GetNextPage按页号从小到大取出页面及其上的槽号，
+// 用于把索引扫描得到的RID按文件顺序访问，每个页面只固定一次。
+// 多个索引扫描的结果可以用And/Or按页面求交集或并集
+//
+class RM_RidBitmap {
+public:
+    RM_RidBitmap();                        // 构造函数
+    ~RM_RidBitmap();                       // 析构函数
+    
+    RC Add(const RID &rid);                                // 加入一个RID
+    bool Contains(const RID &rid) const;                   // RID是否在集合中
+    void Clear();                                          // 清空集合
+    void And(const RM_RidBitmap &other);                   // 与other求交集
+    void Or(const RM_RidBitmap &other);                    // 与other求并集
+    int Count() const { return nRids; }                    // RID个数
+    int NumPages() const { return (int)pages.size(); }     // 涉及的页面数
+    
+    // 页号大于prevPage的第一个页面及其上按槽号排序的槽位，没有时返回RM_EOF
+    // prevPage为0时从第一个数据页开始
+    RC GetNextPage(PageNum prevPage, PageNum &pageNum, std::vector<SlotNum> &slots) const;
+
+private:
+    std::map<PageNum, RM_RidContainer> pages;              // 页号 -> 槽位容器
+    int nRids;                             // RID个数
 };
 
 //
@@ -125,13 +341,17 @@ void RM_PrintError(RC rc);
 #define RM_RECORDNOTFOUND  (START_RM_WARN + 1)  // 记录未找到
 #define RM_EOF             (START_RM_WARN + 2)  // 文件结束
 #define RM_INVALIDRECORD   (START_RM_WARN + 3)  // 无效记录
-#define RM_LASTWARN        RM_INVALIDRECORD
+#define RM_NOFREEPAGE      (START_RM_WARN + 4)  // 没有可以放入记录的页面
+#define RM_LASTWARN        RM_NOFREEPAGE
 
 #define RM_RECORDSIZETOOBIG (START_RM_ERR - 0)  // 记录太大
 #define RM_FILENOTOPEN      (START_RM_ERR - 1)  // 文件未打开
 #define RM_SCANALREADYOPEN  (START_RM_ERR - 2)  // 扫描已经打开
 #define RM_SCANNOTOPEN      (START_RM_ERR - 3)  // 扫描未打开
 #define RM_INVALIDFILE      (START_RM_ERR - 4)  // 无效文件
-#define RM_LASTERROR        RM_INVALIDFILE
+#define RM_BADZONEATTR      (START_RM_ERR - 5)  // 属性不能建立区域映射
+#define RM_BADLAYOUT        (START_RM_ERR - 6)  // 无效的页面布局
+#define RM_BADVERSION       (START_RM_ERR - 7)  // 不支持的文件格式版本
+#define RM_LASTERROR        RM_BADVERSION
 
 #endif // RM_H
\ No newline at end of file
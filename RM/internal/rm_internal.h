@@ -16,6 +16,15 @@
 #define RM_INVALID_PAGE       -1                      // 无效页号
 #define RM_INVALID_SLOT       -1                      // 无效槽号
 
+//
+// 文件格式版本
+// 文件头以RM_FILE_MAGIC标识带版本号的格式。最初的格式（版本0）在同一位置保存
+// 空闲页链表的表头firstFree（-1或页号），不会等于RM_FILE_MAGIC；打开这样的文件时
+// 就地升级为当前格式，其他版本号的文件拒绝打开。
+//
+#define RM_FILE_MAGIC         0x524d4631              // "RMF1"
+#define RM_FILE_VERSION       1                       // 当前的文件格式版本
+
 //
 // 文件头结构
 // 存储在文件的第一页（页号0）
@@ -24,7 +33,11 @@ struct RM_FileHdr {
     int recordSize;           // 记录大小（字节）
     int recordsPerPage;       // 每页最大记录数
     PageNum numPages;         // 文件中的总页数
-    PageNum firstFree;        // 第一个有空闲空间的页号（-1表示没有）
+    int magic;                // RM_FILE_MAGIC
+    int version;              // 文件格式版本（RM_FILE_VERSION）
+    int pageLayout;           // 页面布局（RM_PageLayout）
+    int numColumns;           // PAX/SLOTTED布局的列数，列信息保存在 RM_COLUMNS_OFFSET
+    PageNum firstFsmPage;     // 第一个空闲空间映射页（RM_INVALID_PAGE表示还没有数据页）
 };
 
 //
@@ -33,10 +46,128 @@ struct RM_FileHdr {
 //
 struct RM_PageHdr {
     int numRecords;           // 当前页面中的记录数
-    PageNum nextFree;         // 下一个有空闲空间的页号（-1表示没有）
     // 注意：位图紧跟在页头后面
 };
 
+//
+// 版本0的文件头和页头（只用于升级旧文件）
+// 数据页按行存储，页头比现在多一个空闲页链表指针
+//
+struct RM_FileHdrV0 {
+    int recordSize;           // 记录大小（字节）
+    int recordsPerPage;       // 每页最大记录数
+    PageNum numPages;         // 文件中的总页数
+    PageNum firstFree;        // 第一个有空闲空间的页号（-1表示没有）
+};
+
+struct RM_PageHdrV0 {
+    int numRecords;           // 当前页面中的记录数
+    PageNum nextFree;         // 下一个有空闲空间的页号（-1表示没有）
+};
+
+//
+// 区域映射（zone map）
+// 存放在文件头页（页号0）中 RM_FileHdr 之后的固定区域，按"区"（连续的若干数据页）
+// 记录被跟踪属性的最小/最大值，扫描时据此跳过不可能满足条件的页面。
+// 区的数量受区域大小限制，数据页增多时相邻两个区合并，每区页数翻倍。
+//
+#define RM_ZONEMAP_OFFSET     64                      // 区域映射在头页中的偏移
+#define RM_ZONEMAP_SIZE       3072                    // 区域映射占用的字节数
+#define RM_ZM_MAX_ATTRS       4                       // 最多跟踪的属性数
+#define RM_ZM_VALUE_SIZE      4                       // 只跟踪INT/FLOAT属性
+
+struct RM_ZoneAttr {
+    AttrType attrType;        // 属性类型
+    int attrLength;           // 属性长度
+    int attrOffset;           // 属性在记录中的偏移
+};
+
+struct RM_ZoneEntry {
+    int bValid;                             // 区内是否有过记录
+    char minValue[RM_ZM_VALUE_SIZE];        // 最小值
+    char maxValue[RM_ZM_VALUE_SIZE];        // 最大值
+};
+
+struct RM_ZoneMapHdr {
+    int numAttrs;                           // 跟踪的属性数（0表示未启用）
+    int pagesPerZone;                       // 每个区包含的数据页数
+    int numZones;                           // 已使用的区数
+    RM_ZoneAttr attrs[RM_ZM_MAX_ATTRS];     // 跟踪的属性
+    // 注意：RM_ZoneEntry数组紧跟在后面，第z个区第a个属性位于下标 z * numAttrs + a
+};
+
+#define RM_ZM_MAX_ENTRIES  ((int)((RM_ZONEMAP_SIZE - sizeof(RM_ZoneMapHdr)) / sizeof(RM_ZoneEntry)))
+
+//
+// PAX布局
+// 数据页为：页头 + 位图 + 每列一个minipage。列按记录中的顺序排列，第c列的minipage
+// 从 recordsPerPage * colOffset[c] 开始，槽位i的值位于其中 i * colLength[c] 处。
+// 列长度数组存放在头页的 RM_COLUMNS_OFFSET 处，列偏移由长度累加得到。
+//
+#define RM_COLUMNS_OFFSET     (RM_ZONEMAP_OFFSET + RM_ZONEMAP_SIZE)
+#define RM_COLTYPES_OFFSET    (RM_COLUMNS_OFFSET + RM_MAX_COLUMNS * sizeof(int))
+
+//
+// SLOTTED布局
+// 数据页为：页头 + 槽目录（向后增长），记录从页尾向前存放。RID中的槽号是槽目录
+// 的下标，记录在页内移动（压缩）时只修改槽目录中的偏移，RID保持不变。
+// 记录按变长格式存放：定长属性原样存放，STRING属性存1字节长度 + 去掉末尾'\0'的内容。
+// 更新后记录变长且本页放不下时，记录移到其他页面（标记为RM_SLOT_MOVED），
+// 原槽位改为指向新位置的转发指针（RM_SLOT_FORWARD），RID仍然不变。
+//
+#define RM_SLOT_FORWARD       0x1                     // 槽位保存的是转发指针
+#define RM_SLOT_MOVED         0x2                     // 从其他页面转发过来的记录
+
+struct RM_SlottedPageHdr {
+    int numRecords;           // 页面中的记录数（含转发指针，不含转入的记录）
+    int numSlots;             // 槽目录的项数
+    int freeEnd;              // 记录区的起始偏移（空闲区在槽目录与它之间）
+    int usedBytes;            // 所有记录占用的字节数
+};
+
+struct RM_Slot {
+    short offset;             // 记录在页面中的偏移（-1表示空槽）
+    short length;             // 记录长度
+    short flags;              // RM_SLOT_FORWARD / RM_SLOT_MOVED
+};
+
+struct RM_ForwardPtr {
+    PageNum pageNum;          // 记录的实际页号
+    SlotNum slotNum;          // 记录的实际槽号
+};
+
+#define RM_SLOTTED_MIN_RECORD ((int)sizeof(RM_ForwardPtr))  // 记录至少占用的字节数
+
+//
+// 空闲空间映射（free space map）
+// 每个数据页用4位记录页面的填充程度：0表示放不下新记录，RM_FSM_EMPTY表示页面为空，
+// 1..RM_FSM_MAPPAGE-1 的值越大空闲空间越多。映射保存在文件内单独的映射页中，
+// 第g个映射页覆盖页号 [1 + g * RM_FSM_PAGE_ENTRIES, 1 + (g + 1) * RM_FSM_PAGE_ENTRIES)，
+// 文件增长时随数据页一起分配。映射页按组号链接，第一个映射页记录在文件头中，
+// 映射页自身在映射中标记为RM_FSM_MAPPAGE，扫描时和空页一样跳过。
+// 插入时选择页号最小的有空间的页面，使数据集中在文件前部，VACUUM后可以截断末尾的空页。
+//
+struct RM_FsmPageHdr {
+    PageNum nextFsmPage;      // 下一组的映射页（RM_INVALID_PAGE表示没有）
+    // 注意：每页4位的映射紧跟在页头后面
+};
+
+#define RM_FSM_PAGE_BYTES     ((int)(PF_PAGE_SIZE - sizeof(RM_FsmPageHdr)))
+#define RM_FSM_PAGE_ENTRIES   (RM_FSM_PAGE_BYTES * 2)  // 每个映射页覆盖的页数
+#define RM_FSM_FULL           0                       // 页面放不下新记录
+#define RM_FSM_MAPPAGE        14                      // 页面是空闲空间映射页
+#define RM_FSM_EMPTY          15                      // 页面为空
+
+//
+// 并行扫描
+// 每个morsel包含RM_MORSEL_PAGES个数据页，每个工作线程同时最多固定两个页面
+// （SLOTTED布局读取转发的记录时），工作线程数不超过RM_MAX_SCAN_WORKERS，
+// 以免占满缓冲池。已完成但未被取走的批次不超过每个线程两批。
+//
+#define RM_MORSEL_PAGES       16                      // 每个morsel的数据页数
+#define RM_MAX_SCAN_WORKERS   8                       // 最多的工作线程数
+#define RM_MAX_QUEUED_BATCHES 2                       // 每个工作线程最多排队的批次
+
 //
 // 内部辅助函数声明
 //
@@ -64,4 +195,19 @@ bool RM_CompareAttr(void* attr1, void* attr2, AttrType attrType, int attrLength,
 // 获取记录在页面中的偏移量
 int RM_GetRecordOffset(int slotNum, int recordSize);
 
+// SLOTTED页面辅助函数
+void RM_SlottedInitPage(char* pageData);
+RM_Slot* RM_SlottedGetSlot(char* pageData, int slotNum);
+int RM_SlottedTotalFree(char* pageData);
+bool RM_SlottedPut(char* pageData, int slotNum, const char* data, int len, int flags,
+                   int maxSlots, int &outSlot);
+void RM_SlottedRemove(char* pageData, int slotNum, bool bKeepSlot);
+void RM_SlottedCompact(char* pageData);
+
+// 区域映射辅助函数
+RM_ZoneEntry* RM_GetZoneEntries(char* zoneMap);
+void RM_ZoneWiden(RM_ZoneEntry* entry, const char* value, AttrType attrType);
+void RM_ZoneMerge(RM_ZoneEntry* dst, const RM_ZoneEntry* src, AttrType attrType);
+bool RM_ZoneMayMatch(const RM_ZoneEntry* entry, AttrType attrType, CompOp compOp, const void* value);
+
 #endif // RM_INTERNAL_H
\ No newline at end of file
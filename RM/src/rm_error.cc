@@ -24,6 +24,9 @@ void RM_PrintError(RC rc) {
         case RM_INVALIDRECORD:
             std::cerr << "RM: Invalid record" << std::endl;
             break;
+        case RM_NOFREEPAGE:
+            std::cerr << "RM: No page with enough free space" << std::endl;
+            break;
             
         // 错误信息（负数）
         case RM_RECORDSIZETOOBIG:
@@ -41,6 +44,15 @@ void RM_PrintError(RC rc) {
         case RM_INVALIDFILE:
             std::cerr << "RM: Invalid file" << std::endl;
             break;
+        case RM_BADZONEATTR:
+            std::cerr << "RM: Attribute cannot have a zone map" << std::endl;
+            break;
+        case RM_BADLAYOUT:
+            std::cerr << "RM: Invalid page layout" << std::endl;
+            break;
+        case RM_BADVERSION:
+            std::cerr << "RM: Unsupported file format version" << std::endl;
+            break;
             
         case RM_INVALIDRID_PAGENUM:
             std::cerr << "RM: Invalid RID page number" << std::endl;
@@ -10,9 +10,13 @@ RM_FileHandle::RM_FileHandle() {
     recordSize = 0;
     recordsPerPage = 0;
     numPages = 0;
-    firstFree = RM_INVALID_PAGE;
     bFileOpen = false;
     bHdrChanged = false;
+    zoneMap = NULL;
+    fsmHint = 1;
+    pageLayout = RM_LAYOUT_ROW;
+    numColumns = 0;
+    maxEncodedSize = 0;
 }
 
 //
@@ -25,6 +29,8 @@ RM_FileHandle::~RM_FileHandle() {
         delete pfFileHandle;
         pfFileHandle = NULL;
     }
+    delete[] zoneMap;
+    zoneMap = NULL;
 }
 
 //
@@ -47,7 +53,7 @@ RC RM_FileHandle::GetRec(const RID &rid, RM_Record &rec) const {
     }
     
     // 检查页号是否有效
-    if (pageNum < 1 || pageNum >= numPages) {
+    if (!IsDataPage(pageNum)) {
         return RM_INVALIDRID;
     }
     
@@ -64,46 +70,78 @@ RC RM_FileHandle::GetRec(const RID &rid, RM_Record &rec) const {
         return rc;
     }
     
-    // 获取页头和位图
-    RM_PageHdr* pageHdr = (RM_PageHdr*)pageData;
-    char* bitmap = RM_GetBitmap(pageData);
-    
     // 检查槽位是否被使用
-    if (!RM_TestBit(bitmap, slotNum)) {
+    if (!SlotInUse(pageData, slotNum)) {
         pfFileHandle->UnpinPage(pageNum);
         return RM_RECORDNOTFOUND;
     }
     
-    // 计算记录在页面中的位置
-    int recordOffset = RM_GetRecordOffset(slotNum, recordSize);
-    char* recordData = pageData + RM_PAGE_HDR_SIZE + 
-                       RM_CalcBitmapSize(recordsPerPage) + 
-                       recordOffset;
-    
     // 复制记录数据到RM_Record对象
     if (rec.pData != NULL) {
         delete[] rec.pData;
     }
     rec.pData = new char[recordSize];
-    memcpy(rec.pData, recordData, recordSize);
+    if ((rc = ReadRecord(pageData, slotNum, rec.pData))) {
+        pfFileHandle->UnpinPage(pageNum);
+        return rc;
+    }
     rec.rid = rid;
     rec.recordSize = recordSize;
     rec.bValidRecord = true;
-    
+
     // 解除页面固定
     if ((rc = pfFileHandle->UnpinPage(pageNum))) {
         return rc;
     }
-    
+
     return OK;
 }
 
+//
+// 一次固定页面，读取其上多个槽位的记录
+//
+RC RM_FileHandle::GetRecsOnPage(PageNum pageNum, int nSlots, const SlotNum slots[],
+                                char *pData) const {
+    RC rc;
+
+    // 检查文件是否打开
+    if (!bFileOpen) {
+        return RM_FILENOTOPEN;
+    }
+
+    // 检查页号是否有效
+    if (!IsDataPage(pageNum) || nSlots < 0) {
+        return RM_INVALIDRID;
+    }
+
+    // 获取页面
+    PF_PageHandle pageHandle;
+    char* pageData;
+    if ((rc = pfFileHandle->GetThisPage(pageNum, pageHandle)) ||
+        (rc = pageHandle.GetData(pageData))) {
+        return rc;
+    }
+
+    int nPageSlots = GetSlotCount(pageData);
+    for (int i = 0; i < nSlots; i++) {
+        if (slots[i] < 0 || slots[i] >= nPageSlots || !SlotInUse(pageData, slots[i])) {
+            pfFileHandle->UnpinPage(pageNum);
+            return RM_RECORDNOTFOUND;
+        }
+        if ((rc = ReadRecord(pageData, slots[i], pData + (size_t)i * recordSize))) {
+            pfFileHandle->UnpinPage(pageNum);
+            return rc;
+        }
+    }
+
+    // 解除页面固定
+    return pfFileHandle->UnpinPage(pageNum);
+}
+
 //
 // 插入记录
 //
 RC RM_FileHandle::InsertRec(const char *pData, RID &rid) {
-    RC rc;
-    
     // 检查文件是否打开
     if (!bFileOpen) {
         return RM_FILENOTOPEN;
@@ -114,38 +152,31 @@ RC RM_FileHandle::InsertRec(const char *pData, RID &rid) {
         return RM_INVALIDRECORD;
     }
     
-    PageNum pageNum;
+    // 按空闲空间映射选择页号最小的有空间的页面，没有时分配新页面
+    return InsertIntoPage(FindFreePage(numPages), pData, rid);
+}
+
+//
+// 把记录插入指定页面，pageNum为RM_INVALID_PAGE时分配新页面
+//
+RC RM_FileHandle::InsertIntoPage(PageNum pageNum, const char *pData, RID &rid) {
+    RC rc;
+    
+    // SLOTTED布局按空闲空间放置变长记录
+    if (pageLayout == RM_LAYOUT_SLOTTED) {
+        return InsertSlottedRec(pageNum, pData, rid);
+    }
+    
     PF_PageHandle pageHandle;
     char* pageData;
     
-    // 查找有空闲空间的页面
-    if (firstFree != RM_INVALID_PAGE) {
-        pageNum = firstFree;
+    if (pageNum != RM_INVALID_PAGE) {
         if ((rc = pfFileHandle->GetThisPage(pageNum, pageHandle)) ||
             (rc = pageHandle.GetData(pageData))) {
             return rc;
         }
-    } else {
-        // 没有空闲页面，创建新页面
-        if ((rc = pfFileHandle->AllocatePage(pageHandle)) ||
-            (rc = pageHandle.GetData(pageData)) ||
-            (rc = pageHandle.GetPageNum(pageNum))) {
-            return rc;
-        }
-        
-        // 初始化新页面的页头
-        RM_PageHdr* pageHdr = (RM_PageHdr*)pageData;
-        pageHdr->numRecords = 0;
-        pageHdr->nextFree = RM_INVALID_PAGE;
-        
-        // 清空位图
-        char* bitmap = RM_GetBitmap(pageData);
-        memset(bitmap, 0, RM_CalcBitmapSize(recordsPerPage));
-        
-        // 更新文件信息
-        numPages++;
-        firstFree = pageNum;
-        bHdrChanged = true;
+    } else if ((rc = AllocateDataPage(pageNum, pageHandle, pageData))) {
+        return rc;
     }
     
     // 获取页头和位图
@@ -155,37 +186,23 @@ RC RM_FileHandle::InsertRec(const char *pData, RID &rid) {
     // 查找空闲槽位
     int slotNum = RM_FindFreeSlot(bitmap, recordsPerPage);
     if (slotNum == -1) {
-        // 页面已满，从空闲链表中移除
-        firstFree = pageHdr->nextFree;
-        bHdrChanged = true;
-        
+        // 映射与页面内容不一致（页面实际已满），改用新页面
         pfFileHandle->UnpinPage(pageNum);
-        
-        // 递归调用自己查找其他页面
-        return InsertRec(pData, rid);
+        return InsertIntoPage(RM_INVALID_PAGE, pData, rid);
     }
     
     // 设置位图中对应位
     RM_SetBit(bitmap, slotNum);
     
-    // 计算记录插入位置： 页头 + 位图 + 记录偏移
-    int recordOffset = RM_GetRecordOffset(slotNum, recordSize);
-    char* recordData = pageData + RM_PAGE_HDR_SIZE + 
-                       RM_CalcBitmapSize(recordsPerPage) + 
-                       recordOffset;
+    // 按页面布局复制记录数据
+    WriteRecord(pageData, slotNum, pData);
     
-    // 复制记录数据
-    memcpy(recordData, pData, recordSize);
+    // 维护区域映射
+    WidenZoneMaps(pageNum, pData);
     
-    // 更新页头信息
+    // 更新页头信息和空闲空间映射
     pageHdr->numRecords++;
-    
-    // 如果页面满了，从空闲链表中移除
-    if (pageHdr->numRecords >= recordsPerPage) {
-        firstFree = pageHdr->nextFree;
-        pageHdr->nextFree = RM_INVALID_PAGE;
-        bHdrChanged = true;
-    }
+    UpdateFreeSpace(pageNum, pageData);
     
     // 设置返回的RID
     rid = RID(pageNum, slotNum);
@@ -219,7 +236,7 @@ RC RM_FileHandle::DeleteRec(const RID &rid) {
     }
     
     // 检查页号是否有效
-    if (pageNum < 1 || pageNum >= numPages) {
+    if (!IsDataPage(pageNum)) {
         return RM_INVALIDRID;
     }
     
@@ -228,6 +245,10 @@ RC RM_FileHandle::DeleteRec(const RID &rid) {
         return RM_INVALIDRID;
     }
     
+    if (pageLayout == RM_LAYOUT_SLOTTED) {
+        return DeleteSlottedRec(pageNum, slotNum);
+    }
+    
     // 获取页面
     PF_PageHandle pageHandle;
     char* pageData;
@@ -250,19 +271,15 @@ RC RM_FileHandle::DeleteRec(const RID &rid) {
     // 只有位图是1才读取数据，所以旧数据永远不会被误读
     RM_ClearBit(bitmap, slotNum);
     
-    // 更新页头信息
+    // 更新页头信息和空闲空间映射
     pageHdr->numRecords--;
+    UpdateFreeSpace(pageNum, pageData);
     
-    // 如果页面之前是满的，现在需要加入空闲链表
-    if (pageHdr->numRecords == recordsPerPage - 1) {
-        pageHdr->nextFree = firstFree;
-        firstFree = pageNum;
-        bHdrChanged = true;
+    // 页面变空时保留页面（扫描根据空闲空间映射跳过），由VACUUM截断末尾的空页
+    if (pageHdr->numRecords == 0) {
+        ResetZoneMaps(pageNum);
     }
     
-    // 如果页面变空，可以选择保留或释放页面
-    // 这里选择保留页面以便将来使用
-    
     // 标记页面为脏页并解除固定
     if ((rc = pfFileHandle->MarkDirty(pageNum)) ||
         (rc = pfFileHandle->UnpinPage(pageNum))) {
@@ -307,11 +324,16 @@ RC RM_FileHandle::UpdateRec(const RM_Record &rec) {
     }
     
     // 检查页号和槽号是否有效
-    if (pageNum < 1 || pageNum >= numPages || 
+    if (!IsDataPage(pageNum) || 
         slotNum < 0 || slotNum >= recordsPerPage) {
         return RM_INVALIDRID;
     }
     
+    // SLOTTED布局的记录长度可能变化
+    if (pageLayout == RM_LAYOUT_SLOTTED) {
+        return UpdateSlottedRec(pageNum, slotNum, rec.pData);
+    }
+    
     // 获取页面
     PF_PageHandle pageHandle;
     char* pageData;
@@ -329,14 +351,11 @@ RC RM_FileHandle::UpdateRec(const RM_Record &rec) {
         return RM_RECORDNOTFOUND;
     }
     
-    // 计算记录位置并更新数据
-    int recordOffset = RM_GetRecordOffset(slotNum, recordSize);
-    char* recordData = pageData + RM_PAGE_HDR_SIZE + 
-                       RM_CalcBitmapSize(recordsPerPage) + 
-                       recordOffset;
-    
     // 覆盖原记录数据
-    memcpy(recordData, rec.pData, recordSize);
+    WriteRecord(pageData, slotNum, rec.pData);
+    
+    // 维护区域映射（旧值留下的范围不收缩）
+    WidenZoneMaps(pageNum, rec.pData);
     
     // 标记页面为脏页并解除固定
     if ((rc = pfFileHandle->MarkDirty(pageNum)) ||
@@ -358,4 +377,150 @@ RC RM_FileHandle::ForcePages(PageNum pageNum) const {
     
     // 调用PF文件句柄的ForcePages方法
     return pfFileHandle->ForcePages(pageNum);
-}
\ No newline at end of file
+}
+
+//
+// 获取页面上某属性第0个槽位的位置，stride返回相邻槽位之间的间隔
+// ROW布局：记录连续存放，间隔为记录长度
+// PAX布局：属性所在列的minipage中值连续存放，间隔为列长度
+//
+char* RM_FileHandle::GetColumnPtr(char *pageData, int attrOffset, int &stride) const {
+    char* slotData = pageData + RM_PAGE_HDR_SIZE + RM_CalcBitmapSize(recordsPerPage);
+    
+    if (pageLayout == RM_LAYOUT_PAX) {
+        for (int c = 0; c < numColumns; c++) {
+            if (attrOffset >= colOffset[c] && attrOffset < colOffset[c] + colLength[c]) {
+                stride = colLength[c];
+                return slotData + recordsPerPage * colOffset[c] + (attrOffset - colOffset[c]);
+            }
+        }
+    }
+    
+    stride = recordSize;
+    return slotData + attrOffset;
+}
+
+//
+// 按页面布局把槽位上的记录复制到pData
+// SLOTTED布局的记录被转发时需要读取另一个页面
+//
+RC RM_FileHandle::ReadRecord(char *pageData, int slotNum, char *pData) const {
+    if (pageLayout == RM_LAYOUT_SLOTTED) {
+        RM_Slot* slot = RM_SlottedGetSlot(pageData, slotNum);
+        if (slot->flags & RM_SLOT_FORWARD) {
+            return ReadForwarded(pageData + slot->offset, pData);
+        }
+        DecodeRecord(pageData + slot->offset, pData);
+        return OK;
+    }
+    
+    char* slotData = pageData + RM_PAGE_HDR_SIZE + RM_CalcBitmapSize(recordsPerPage);
+    
+    if (pageLayout != RM_LAYOUT_PAX) {
+        memcpy(pData, slotData + RM_GetRecordOffset(slotNum, recordSize), recordSize);
+        return OK;
+    }
+    
+    // 从各列的minipage中收集属性值
+    for (int c = 0; c < numColumns; c++) {
+        memcpy(pData + colOffset[c],
+               slotData + recordsPerPage * colOffset[c] + slotNum * colLength[c],
+               colLength[c]);
+    }
+    return OK;
+}
+
+//
+// 按页面布局把pData写入槽位
+//
+void RM_FileHandle::WriteRecord(char *pageData, int slotNum, const char *pData) const {
+    char* slotData = pageData + RM_PAGE_HDR_SIZE + RM_CalcBitmapSize(recordsPerPage);
+    
+    if (pageLayout != RM_LAYOUT_PAX) {
+        memcpy(slotData + RM_GetRecordOffset(slotNum, recordSize), pData, recordSize);
+        return;
+    }
+    
+    // 把属性值分散到各列的minipage
+    for (int c = 0; c < numColumns; c++) {
+        memcpy(slotData + recordsPerPage * colOffset[c] + slotNum * colLength[c],
+               pData + colOffset[c],
+               colLength[c]);
+    }
+}
+
+//
+// 页面上的槽位数：SLOTTED布局为槽目录的项数，其他布局为每页记录数
+//
+int RM_FileHandle::GetSlotCount(char *pageData) const {
+    if (pageLayout == RM_LAYOUT_SLOTTED) {
+        return ((RM_SlottedPageHdr*)pageData)->numSlots;
+    }
+    return recordsPerPage;
+}
+
+//
+// 槽位上是否有记录
+// SLOTTED布局中转入的记录通过原页面的转发指针访问，不单独计为记录
+//
+bool RM_FileHandle::SlotInUse(char *pageData, int slotNum) const {
+    if (pageLayout == RM_LAYOUT_SLOTTED) {
+        if (slotNum >= ((RM_SlottedPageHdr*)pageData)->numSlots) {
+            return false;
+        }
+        RM_Slot* slot = RM_SlottedGetSlot(pageData, slotNum);
+        return slot->offset >= 0 && !(slot->flags & RM_SLOT_MOVED);
+    }
+    return RM_TestBit(RM_GetBitmap(pageData), slotNum);
+}
+
+//
+// 列访问：固定页面，返回属性在页内的列指针
+// 调用者使用完毕后必须调用ReleaseColumn解除固定
+//
+RC RM_FileHandle::GetColumn(PageNum pageNum, int attrOffset, char *&pColumn, int &stride,
+                            const char *&slotBitmap, int &nSlots) const {
+    RC rc;
+    
+    // 检查文件是否打开
+    if (!bFileOpen) {
+        return RM_FILENOTOPEN;
+    }
+    
+    // 检查页号和属性偏移
+    if (!IsDataPage(pageNum)) {
+        return RM_INVALIDRID;
+    }
+    if (attrOffset < 0 || attrOffset >= recordSize) {
+        return RM_INVALIDRECORD;
+    }
+    
+    // 变长记录没有固定的列位置
+    if (pageLayout == RM_LAYOUT_SLOTTED) {
+        return RM_BADLAYOUT;
+    }
+    
+    PF_PageHandle pageHandle;
+    char* pageData;
+    if ((rc = pfFileHandle->GetThisPage(pageNum, pageHandle)) ||
+        (rc = pageHandle.GetData(pageData))) {
+        return rc;
+    }
+    
+    pColumn = GetColumnPtr(pageData, attrOffset, stride);
+    slotBitmap = RM_GetBitmap(pageData);
+    nSlots = recordsPerPage;
+    return OK;
+}
+
+//
+// 解除GetColumn固定的页面
+//
+RC RM_FileHandle::ReleaseColumn(PageNum pageNum) const {
+    // 检查文件是否打开
+    if (!bFileOpen) {
+        return RM_FILENOTOPEN;
+    }
+    
+    return pfFileHandle->UnpinPage(pageNum);
+}
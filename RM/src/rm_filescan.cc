@@ -15,6 +15,8 @@ RM_FileScan::RM_FileScan() {
     recordsPerPage = 0;
     numPages = 0;
     pinHint = NO_HINT;
+    fileHandle = NULL;
+    recordBuf = NULL;
 }
 
 //
@@ -66,6 +68,12 @@ RC RM_FileScan::OpenScan(const RM_FileHandle &fileHandle,
     this->recordSize = fileHandle.recordSize;
     this->recordsPerPage = fileHandle.recordsPerPage;
     this->numPages = fileHandle.numPages;
+    this->fileHandle = &fileHandle;
+    
+    // SLOTTED布局需要先解码记录再比较属性
+    if (fileHandle.pageLayout == RM_LAYOUT_SLOTTED) {
+        this->recordBuf = new char[recordSize];
+    }
     
     // 初始化扫描位置
     this->currentPage = 1;  // 从第一个数据页开始（页0是文件头）
@@ -88,6 +96,17 @@ RC RM_FileScan::GetNextRec(RM_Record &rec) {
     
     // 扫描所有页面
     while (currentPage < numPages) {
+        // 根据空闲空间映射跳过空页和映射页，根据区域映射跳过不可能有匹配记录的页面
+        if (currentSlot == 0) {
+            int level = fileHandle->GetFreeSpace(currentPage);
+            if (level == RM_FSM_EMPTY || level == RM_FSM_MAPPAGE ||
+                (value != NULL &&
+                 !fileHandle->PageMayMatch(currentPage, attrType, attrOffset, compOp, value))) {
+                currentPage++;
+                continue;
+            }
+        }
+        
         // 获取当前页面
         PF_PageHandle pageHandle;
         char* pageData;
@@ -97,34 +116,44 @@ RC RM_FileScan::GetNextRec(RM_Record &rec) {
             return rc;
         }
         
-        // 获取页头和位图
-        RM_PageHdr* pageHdr = (RM_PageHdr*)pageData;
-        char* bitmap = RM_GetBitmap(pageData);
+        // 比较属性所在的列：PAX布局下属性值在页内连续存放
+        // SLOTTED布局的记录是变长的，解码到recordBuf后再比较
+        int stride = 0;
+        char* attrColumn = NULL;
+        if (recordBuf == NULL) {
+            attrColumn = fileHandle->GetColumnPtr(pageData, attrOffset, stride);
+        }
         
         // 扫描当前页面的所有槽位
-        while (currentSlot < recordsPerPage) {
+        int nSlots = fileHandle->GetSlotCount(pageData);
+        while (currentSlot < nSlots) {
             // 检查槽位是否被使用
-            if (RM_TestBit(bitmap, currentSlot)) {
-                // 获取记录数据
-                int recordOffset = RM_GetRecordOffset(currentSlot, recordSize);
-                char* recordData = pageData + RM_PAGE_HDR_SIZE + 
-                                   RM_CalcBitmapSize(recordsPerPage) + 
-                                   recordOffset;
+            if (fileHandle->SlotInUse(pageData, currentSlot)) {
+                if (recordBuf != NULL &&
+                    (rc = fileHandle->ReadRecord(pageData, currentSlot, recordBuf))) {
+                    pfFileHandle->UnpinPage(currentPage);
+                    return rc;
+                }
                 
                 // 检查条件匹配
                 bool matches = true;
                 if (value != NULL) {
-                    char* attrData = recordData + attrOffset;
+                    char* attrData = (recordBuf != NULL) ? recordBuf + attrOffset
+                                                         : attrColumn + currentSlot * stride;
                     matches = RM_CompareAttr(attrData, value, attrType, attrLength, compOp);
                 }
                 
                 if (matches) {
-                    // 找到匹配记录，复制到结果中
+                    // 找到匹配记录，按页面布局复制到结果中
                     if (rec.pData != NULL) {
                         delete[] rec.pData;
                     }
                     rec.pData = new char[recordSize];
-                    memcpy(rec.pData, recordData, recordSize);
+                    if (recordBuf != NULL) {
+                        memcpy(rec.pData, recordBuf, recordSize);
+                    } else {
+                        fileHandle->ReadRecord(pageData, currentSlot, rec.pData);
+                    }
                     rec.rid = RID(currentPage, currentSlot);
                     rec.recordSize = recordSize;
                     rec.bValidRecord = true;
@@ -169,6 +198,9 @@ RC RM_FileScan::CloseScan() {
     currentPage = 0;
     currentSlot = 0;
     value = NULL;
+    fileHandle = NULL;
+    delete[] recordBuf;
+    recordBuf = NULL;
     
     return OK;
 }
\ No newline at end of file
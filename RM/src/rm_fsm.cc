@@ -0,0 +1,559 @@
+#include "../include/rm.h"
+#include "../internal/rm_internal.h"
+#include <cstring>
+
+//
+// rm_fsm.cc: RM文件的空闲空间映射（free space map）和VACUUM
+//
+// 空闲空间映射保存在文件内单独的映射页中，每个映射页覆盖RM_FSM_PAGE_ENTRIES个页号，
+// 文件增长时随数据页一起分配。文件打开期间映射缓存在 RM_FileHandle::fsm，
+// 关闭时写回修改过的映射页。插入记录时从fsmHint开始查找页号最小的有空间的页面，
+// 扫描时跳过空页和映射页。VACUUM从文件末尾开始把记录移到前面有空间的页面，
+// 然后截断末尾的空页。
+//
+
+//
+// RM_FsmGroups: 覆盖页号 1..numPages-1 需要的映射页数
+//
+static int RM_FsmGroups(PageNum numPages) {
+    return (numPages - 1 + RM_FSM_PAGE_ENTRIES - 1) / RM_FSM_PAGE_ENTRIES;
+}
+
+//
+// GetFreeSpace: 页面的填充等级，没有映射的页号返回RM_FSM_FULL
+//
+int RM_FileHandle::GetFreeSpace(PageNum pageNum) const {
+    int index = pageNum - 1;
+    if (index < 0 || index / 2 >= (int)fsm.size()) {
+        return RM_FSM_FULL;
+    }
+
+    unsigned char entry = (unsigned char)fsm[index / 2];
+    return (index % 2) ? (entry >> 4) : (entry & 0xF);
+}
+
+//
+// SetFreeSpace: 设置页面的填充等级，没有映射的页号忽略
+// 页面有了空间且页号小于fsmHint时把提示前移
+//
+void RM_FileHandle::SetFreeSpace(PageNum pageNum, int level) {
+    int index = pageNum - 1;
+    if (index < 0 || index / 2 >= (int)fsm.size()) {
+        return;
+    }
+
+    unsigned char entry = (unsigned char)fsm[index / 2];
+    unsigned char newEntry = (index % 2) ? ((entry & 0x0F) | (level << 4))
+                                         : ((entry & 0xF0) | level);
+    if (newEntry != entry) {
+        fsm[index / 2] = (char)newEntry;
+        fsmDirty[index / RM_FSM_PAGE_ENTRIES] = 1;
+    }
+    if (level != RM_FSM_FULL && level != RM_FSM_MAPPAGE && pageNum < fsmHint) {
+        fsmHint = pageNum;
+    }
+}
+
+//
+// IsDataPage: 页号是否是文件中的数据页（不是头页和映射页）
+//
+bool RM_FileHandle::IsDataPage(PageNum pageNum) const {
+    return pageNum >= 1 && pageNum < numPages && GetFreeSpace(pageNum) != RM_FSM_MAPPAGE;
+}
+
+//
+// CalcFreeSpace: 根据页面内容计算填充等级
+// 非零等级保证页面能放下任意一条记录：ROW/PAX布局有空闲槽位，
+// SLOTTED布局剩余空间不小于最长的编码记录加一个槽目录项
+//
+int RM_FileHandle::CalcFreeSpace(char *pageData) const {
+    if (pageLayout == RM_LAYOUT_SLOTTED) {
+        RM_SlottedPageHdr* pageHdr = (RM_SlottedPageHdr*)pageData;
+        if (pageHdr->numSlots == 0) {
+            return RM_FSM_EMPTY;
+        }
+
+        int freeBytes = RM_SlottedTotalFree(pageData);
+        if (freeBytes < maxEncodedSize + (int)sizeof(RM_Slot)) {
+            return RM_FSM_FULL;
+        }
+        int space = PF_PAGE_SIZE - (int)sizeof(RM_SlottedPageHdr);
+        int level = 1 + freeBytes * (RM_FSM_MAPPAGE - 2) / space;
+        return (level < RM_FSM_MAPPAGE) ? level : RM_FSM_MAPPAGE - 1;
+    }
+
+    int numRecords = ((RM_PageHdr*)pageData)->numRecords;
+    if (numRecords == 0) {
+        return RM_FSM_EMPTY;
+    }
+    if (numRecords >= recordsPerPage) {
+        return RM_FSM_FULL;
+    }
+    return 1 + (recordsPerPage - numRecords) * (RM_FSM_MAPPAGE - 1) / recordsPerPage;
+}
+
+//
+// UpdateFreeSpace: 页面内容变化后更新映射
+//
+void RM_FileHandle::UpdateFreeSpace(PageNum pageNum, char *pageData) {
+    SetFreeSpace(pageNum, CalcFreeSpace(pageData));
+}
+
+//
+// FindFreePage: 查找页号小于limit的第一个有空间的页面，没有时返回RM_INVALID_PAGE
+// 从fsmHint开始查找，经过的放满的页面不再重复检查
+//
+PageNum RM_FileHandle::FindFreePage(PageNum limit) {
+    if (limit > numPages) {
+        limit = numPages;
+    }
+
+    PageNum pageNum = fsmHint;
+    for (; pageNum < limit; pageNum++) {
+        int level = GetFreeSpace(pageNum);
+        if (level != RM_FSM_FULL && level != RM_FSM_MAPPAGE) {
+            break;
+        }
+    }
+
+    fsmHint = pageNum;
+    return (pageNum < limit) ? pageNum : RM_INVALID_PAGE;
+}
+
+//
+// LoadFsm: 打开文件时沿链表读入映射页
+//
+RC RM_FileHandle::LoadFsm(PageNum firstFsmPage) {
+    RC rc;
+
+    fsm.clear();
+    fsmPages.clear();
+    fsmDirty.clear();
+    fsmHint = 1;
+
+    PageNum fsmPage = firstFsmPage;
+    int nGroups = RM_FsmGroups(numPages);
+    for (int g = 0; g < nGroups; g++) {
+        if (fsmPage < 1 || fsmPage >= numPages) {
+            return RM_INVALIDFILE;
+        }
+
+        PF_PageHandle pageHandle;
+        char* pageData;
+        if ((rc = pfFileHandle->GetThisPage(fsmPage, pageHandle)) ||
+            (rc = pageHandle.GetData(pageData))) {
+            return rc;
+        }
+        fsm.insert(fsm.end(), pageData + sizeof(RM_FsmPageHdr), pageData + PF_PAGE_SIZE);
+        fsmPages.push_back(fsmPage);
+        fsmDirty.push_back(0);
+        PageNum nextPage = ((RM_FsmPageHdr*)pageData)->nextFsmPage;
+        if ((rc = pfFileHandle->UnpinPage(fsmPage))) {
+            return rc;
+        }
+        fsmPage = nextPage;
+    }
+
+    return OK;
+}
+
+//
+// RebuildFsm: 根据各数据页的内容重建映射（升级旧格式的文件时使用）
+//
+RC RM_FileHandle::RebuildFsm() {
+    RC rc;
+
+    fsm.clear();
+    fsmPages.clear();
+    fsmDirty.clear();
+    fsmHint = 1;
+
+    PageNum nDataPages = numPages;
+    if ((rc = ExtendFsm())) {
+        return rc;
+    }
+
+    for (PageNum pageNum = 1; pageNum < nDataPages; pageNum++) {
+        PF_PageHandle pageHandle;
+        char* pageData;
+        if ((rc = pfFileHandle->GetThisPage(pageNum, pageHandle)) ||
+            (rc = pageHandle.GetData(pageData))) {
+            return rc;
+        }
+        SetFreeSpace(pageNum, CalcFreeSpace(pageData));
+        if ((rc = pfFileHandle->UnpinPage(pageNum))) {
+            return rc;
+        }
+    }
+
+    return OK;
+}
+
+//
+// FlushFsm: 把修改过的映射写回映射页
+//
+RC RM_FileHandle::FlushFsm() {
+    RC rc;
+
+    for (int g = 0; g < (int)fsmPages.size(); g++) {
+        if (!fsmDirty[g]) {
+            continue;
+        }
+
+        PF_PageHandle pageHandle;
+        char* pageData;
+        if ((rc = pfFileHandle->GetThisPage(fsmPages[g], pageHandle)) ||
+            (rc = pageHandle.GetData(pageData))) {
+            return rc;
+        }
+        RM_FsmPageHdr* fsmHdr = (RM_FsmPageHdr*)pageData;
+        fsmHdr->nextFsmPage = (g + 1 < (int)fsmPages.size()) ? fsmPages[g + 1] : RM_INVALID_PAGE;
+        memcpy(pageData + sizeof(RM_FsmPageHdr), &fsm[(size_t)g * RM_FSM_PAGE_BYTES],
+               RM_FSM_PAGE_BYTES);
+        if ((rc = pfFileHandle->MarkDirty(fsmPages[g])) ||
+            (rc = pfFileHandle->UnpinPage(fsmPages[g]))) {
+            return rc;
+        }
+        fsmDirty[g] = 0;
+    }
+
+    return OK;
+}
+
+//
+// ExtendFsm: 文件增长后为还没有映射页的组分配映射页
+// 新的映射页也占用页号，可能需要再分配下一组的映射页
+//
+RC RM_FileHandle::ExtendFsm() {
+    RC rc;
+    int firstNew = (int)fsmPages.size();
+
+    while ((int)fsmPages.size() < RM_FsmGroups(numPages)) {
+        PF_PageHandle pageHandle;
+        char* pageData;
+        PageNum fsmPage;
+        if ((rc = pfFileHandle->AllocatePage(pageHandle)) ||
+            (rc = pageHandle.GetData(pageData)) ||
+            (rc = pageHandle.GetPageNum(fsmPage))) {
+            return rc;
+        }
+        memset(pageData, 0, PF_PAGE_SIZE);
+        ((RM_FsmPageHdr*)pageData)->nextFsmPage = RM_INVALID_PAGE;
+        if ((rc = pfFileHandle->MarkDirty(fsmPage)) ||
+            (rc = pfFileHandle->UnpinPage(fsmPage))) {
+            return rc;
+        }
+        numPages++;
+
+        // 前一个映射页的链接随之改变
+        if (!fsmPages.empty()) {
+            fsmDirty.back() = 1;
+        }
+        fsmPages.push_back(fsmPage);
+        fsmDirty.push_back(1);
+        fsm.resize(fsm.size() + RM_FSM_PAGE_BYTES, 0);
+        bHdrChanged = true;
+    }
+
+    for (int g = firstNew; g < (int)fsmPages.size(); g++) {
+        SetFreeSpace(fsmPages[g], RM_FSM_MAPPAGE);
+    }
+    return OK;
+}
+
+//
+// InitDataPage: 按页面布局把页面初始化为空的数据页
+//
+void RM_FileHandle::InitDataPage(char *pageData) const {
+    if (pageLayout == RM_LAYOUT_SLOTTED) {
+        RM_SlottedInitPage(pageData);
+    } else {
+        ((RM_PageHdr*)pageData)->numRecords = 0;
+        memset(RM_GetBitmap(pageData), 0, RM_CalcBitmapSize(recordsPerPage));
+    }
+}
+
+//
+// AllocateDataPage: 分配并按页面布局初始化新的数据页（页面保持固定）
+//
+RC RM_FileHandle::AllocateDataPage(PageNum &pageNum, PF_PageHandle &pageHandle, char *&pageData) {
+    RC rc;
+
+    if ((rc = pfFileHandle->AllocatePage(pageHandle)) ||
+        (rc = pageHandle.GetData(pageData)) ||
+        (rc = pageHandle.GetPageNum(pageNum))) {
+        return rc;
+    }
+
+    InitDataPage(pageData);
+
+    // 更新文件信息，新页面超出映射范围时分配映射页
+    numPages++;
+    bHdrChanged = true;
+    if ((rc = ExtendFsm())) {
+        pfFileHandle->UnpinPage(pageNum);
+        return rc;
+    }
+    SetFreeSpace(pageNum, RM_FSM_EMPTY);
+
+    return OK;
+}
+
+//
+// ListPageSlots: 列出页面上有记录的槽位
+// bForwardedOnly为true时只列出SLOTTED布局中已被转发的记录
+//
+RC RM_FileHandle::ListPageSlots(PageNum pageNum, bool bForwardedOnly,
+                                SlotNum *slots, int &nSlots) const {
+    RC rc;
+    PF_PageHandle pageHandle;
+    char* pageData;
+    if ((rc = pfFileHandle->GetThisPage(pageNum, pageHandle)) ||
+        (rc = pageHandle.GetData(pageData))) {
+        return rc;
+    }
+
+    nSlots = 0;
+    int slotCount = GetSlotCount(pageData);
+    for (int slot = 0; slot < slotCount; slot++) {
+        if (!SlotInUse(pageData, slot)) {
+            continue;
+        }
+        if (bForwardedOnly &&
+            (pageLayout != RM_LAYOUT_SLOTTED ||
+             !(RM_SlottedGetSlot(pageData, slot)->flags & RM_SLOT_FORWARD))) {
+            continue;
+        }
+        slots[nSlots++] = slot;
+    }
+
+    return pfFileHandle->UnpinPage(pageNum);
+}
+
+//
+// RelocateRec: 把记录移到页号小于limit的有空间的页面
+// pData返回记录内容，newRid返回新位置；没有合适的页面时返回RM_NOFREEPAGE
+//
+RC RM_FileHandle::RelocateRec(const RID &rid, PageNum limit, char *pData, RID &newRid) {
+    RC rc;
+
+    PageNum target = FindFreePage(limit);
+    if (target == RM_INVALID_PAGE) {
+        return RM_NOFREEPAGE;
+    }
+
+    RM_Record rec;
+    if ((rc = GetRec(rid, rec))) {
+        return rc;
+    }
+    memcpy(pData, rec.pData, recordSize);
+
+    if ((rc = InsertIntoPage(target, pData, newRid)) ||
+        (rc = DeleteRec(rid))) {
+        return rc;
+    }
+
+    return OK;
+}
+
+//
+// TruncateEmptyPages: 截断文件末尾的空页
+// 末尾的映射页在它覆盖的组不再需要时一起截断。仍然需要的映射页位于截断位置之后时
+// （例如升级旧格式文件时映射页分配在所有数据页之后），先移到页号更小的空页中，
+// 再保留到最后一个映射页为止
+//
+RC RM_FileHandle::TruncateEmptyPages(int &nFreedPages) {
+    RC rc;
+    nFreedPages = 0;
+
+    PageNum newNumPages = numPages;
+    while (newNumPages > 1) {
+        int level = GetFreeSpace(newNumPages - 1);
+        if (level != RM_FSM_EMPTY && level != RM_FSM_MAPPAGE) {
+            break;
+        }
+        newNumPages--;
+    }
+
+    // 仍然需要的映射页位于截断位置之后时，移到页号更小的空页中
+    // （截断位置之前没有空页时，用截断位置之后的第一个空页）
+    PageNum emptyPage = 1;
+    for (int g = 0; g < RM_FsmGroups(newNumPages); g++) {
+        if (fsmPages[g] < newNumPages) {
+            continue;
+        }
+        while (emptyPage < fsmPages[g] && GetFreeSpace(emptyPage) != RM_FSM_EMPTY) {
+            emptyPage++;
+        }
+        if (emptyPage < fsmPages[g] && (rc = MoveFsmPage(g, emptyPage))) {
+            return rc;
+        }
+    }
+
+    // 没能移动的映射页不能截断
+    for (;;) {
+        PageNum keepPages = newNumPages;
+        for (int g = 0; g < RM_FsmGroups(newNumPages); g++) {
+            if (fsmPages[g] >= keepPages) {
+                keepPages = fsmPages[g] + 1;
+            }
+        }
+        if (keepPages == newNumPages) {
+            break;
+        }
+        newNumPages = keepPages;
+    }
+
+    if (newNumPages == numPages) {
+        return OK;
+    }
+
+    if ((rc = pfFileHandle->TruncateFile(newNumPages))) {
+        return rc;
+    }
+
+    for (PageNum pageNum = newNumPages; pageNum < numPages; pageNum++) {
+        SetFreeSpace(pageNum, RM_FSM_FULL);
+    }
+    int nGroups = RM_FsmGroups(newNumPages);
+    if (nGroups < (int)fsmPages.size()) {
+        fsmPages.resize(nGroups);
+        fsmDirty.resize(nGroups);
+        fsm.resize((size_t)nGroups * RM_FSM_PAGE_BYTES);
+        if (nGroups > 0) {
+            fsmDirty.back() = 1;
+        }
+    }
+    nFreedPages = numPages - newNumPages;
+    numPages = newNumPages;
+    bHdrChanged = true;
+
+    return OK;
+}
+
+//
+// MoveFsmPage: 把第g组的映射页移到空页pageNum
+// 映射内容缓存在fsm中，关闭文件时写到新的映射页；前一个映射页的链接
+// （第0组时是文件头的firstFsmPage）随之改变。原来的映射页初始化为空的数据页
+//
+RC RM_FileHandle::MoveFsmPage(int g, PageNum pageNum) {
+    RC rc;
+    PageNum oldPage = fsmPages[g];
+
+    PF_PageHandle pageHandle;
+    char* pageData;
+    if ((rc = pfFileHandle->GetThisPage(oldPage, pageHandle)) ||
+        (rc = pageHandle.GetData(pageData))) {
+        return rc;
+    }
+    InitDataPage(pageData);
+    if ((rc = pfFileHandle->MarkDirty(oldPage)) ||
+        (rc = pfFileHandle->UnpinPage(oldPage))) {
+        return rc;
+    }
+
+    fsmPages[g] = pageNum;
+    fsmDirty[g] = 1;
+    if (g > 0) {
+        fsmDirty[g - 1] = 1;
+    } else {
+        bHdrChanged = true;
+    }
+    SetFreeSpace(pageNum, RM_FSM_MAPPAGE);
+    SetFreeSpace(oldPage, RM_FSM_EMPTY);
+
+    return OK;
+}
+
+//
+// Vacuum: 压缩文件
+// 1. SLOTTED布局先把被转发的记录重新放置，消除转发指针
+// 2. 从最后一页开始把记录移到前面有空间的页面，直到前面没有空间为止
+// 3. 截断末尾的空页，并重建区域映射（移动记录后区的范围偏大）
+// 每移动一条记录调用一次listener，由调用者更新索引中的RID
+//
+RC RM_FileHandle::Vacuum(RM_MoveListener *listener, int &nMoved, int &nFreedPages) {
+    RC rc = OK;
+    nMoved = 0;
+    nFreedPages = 0;
+
+    // 检查文件是否打开
+    if (!bFileOpen) {
+        return RM_FILENOTOPEN;
+    }
+
+    char* recordData = new char[recordSize];
+    SlotNum* slots = new SlotNum[recordsPerPage];
+    int nSlots;
+
+    // 消除转发指针
+    if (pageLayout == RM_LAYOUT_SLOTTED) {
+        for (PageNum pageNum = 1; pageNum < numPages && rc == OK; pageNum++) {
+            if (!IsDataPage(pageNum)) {
+                continue;
+            }
+            if ((rc = ListPageSlots(pageNum, true, slots, nSlots))) {
+                break;
+            }
+            for (int i = 0; i < nSlots; i++) {
+                RID oldRid(pageNum, slots[i]);
+                RID newRid;
+                rc = RelocateRec(oldRid, numPages, recordData, newRid);
+                if (rc == RM_NOFREEPAGE) {
+                    rc = OK;
+                    break;
+                }
+                if (rc) {
+                    break;
+                }
+                nMoved++;
+                if (listener != NULL &&
+                    (rc = listener->RecordMoved(recordData, oldRid, newRid))) {
+                    break;
+                }
+            }
+        }
+    }
+
+    // 从末尾开始把记录移到前面的页面
+    bool bDone = false;
+    for (PageNum pageNum = numPages - 1; pageNum >= 1 && rc == OK && !bDone; pageNum--) {
+        int level = GetFreeSpace(pageNum);
+        if (level == RM_FSM_EMPTY || level == RM_FSM_MAPPAGE) {
+            continue;
+        }
+        if ((rc = ListPageSlots(pageNum, false, slots, nSlots))) {
+            break;
+        }
+        for (int i = 0; i < nSlots; i++) {
+            RID oldRid(pageNum, slots[i]);
+            RID newRid;
+            rc = RelocateRec(oldRid, pageNum, recordData, newRid);
+            if (rc == RM_NOFREEPAGE) {
+                // 前面的页面已经放满
+                rc = OK;
+                bDone = true;
+                break;
+            }
+            if (rc) {
+                break;
+            }
+            nMoved++;
+            if (listener != NULL &&
+                (rc = listener->RecordMoved(recordData, oldRid, newRid))) {
+                break;
+            }
+        }
+    }
+
+    delete[] slots;
+    delete[] recordData;
+    if (rc || (rc = TruncateEmptyPages(nFreedPages))) {
+        return rc;
+    }
+
+    if (zoneMap != NULL && ((RM_ZoneMapHdr*)zoneMap)->numAttrs > 0) {
+        return RebuildZoneMaps();
+    }
+    return OK;
+}
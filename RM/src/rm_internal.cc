@@ -1,6 +1,8 @@
 #include "../internal/rm_internal.h"
 #include <cstring>
 #include <cstdlib>
+#include <vector>
+#include <algorithm>
 
 //
 // 计算给定记录大小下每页能存储的记录数
@@ -144,4 +146,216 @@ bool RM_CompareAttr(void* attr1, void* attr2, AttrType attrType, int attrLength,
 //
 int RM_GetRecordOffset(int slotNum, int recordSize) {
     return slotNum * recordSize;
-}
\ No newline at end of file
+}
+//
+// 获取区域映射中区条目数组的起始位置
+//
+RM_ZoneEntry* RM_GetZoneEntries(char* zoneMap) {
+    return (RM_ZoneEntry*)(zoneMap + sizeof(RM_ZoneMapHdr));
+}
+
+//
+// 比较区域映射中保存的值与给定值，返回负数、0或正数
+// 值可能未对齐，因此先复制出来再比较
+//
+static int RM_ZoneCompare(const char* zoneValue, const void* value, AttrType attrType) {
+    if (attrType == INT) {
+        int v1, v2;
+        memcpy(&v1, zoneValue, sizeof(int));
+        memcpy(&v2, value, sizeof(int));
+        return (v1 < v2) ? -1 : (v1 > v2) ? 1 : 0;
+    } else {
+        float v1, v2;
+        memcpy(&v1, zoneValue, sizeof(float));
+        memcpy(&v2, value, sizeof(float));
+        return (v1 < v2) ? -1 : (v1 > v2) ? 1 : 0;
+    }
+}
+
+//
+// 用一个属性值扩展区的[min, max]范围
+//
+void RM_ZoneWiden(RM_ZoneEntry* entry, const char* value, AttrType attrType) {
+    if (!entry->bValid) {
+        memcpy(entry->minValue, value, RM_ZM_VALUE_SIZE);
+        memcpy(entry->maxValue, value, RM_ZM_VALUE_SIZE);
+        entry->bValid = 1;
+        return;
+    }
+    
+    if (RM_ZoneCompare(entry->minValue, value, attrType) > 0) {
+        memcpy(entry->minValue, value, RM_ZM_VALUE_SIZE);
+    }
+    if (RM_ZoneCompare(entry->maxValue, value, attrType) < 0) {
+        memcpy(entry->maxValue, value, RM_ZM_VALUE_SIZE);
+    }
+}
+
+//
+// 把src区的范围合并到dst区
+//
+void RM_ZoneMerge(RM_ZoneEntry* dst, const RM_ZoneEntry* src, AttrType attrType) {
+    if (!src->bValid) {
+        return;
+    }
+    RM_ZoneWiden(dst, src->minValue, attrType);
+    RM_ZoneWiden(dst, src->maxValue, attrType);
+}
+
+//
+// 判断区内是否可能存在满足 "attr compOp value" 的记录
+// 返回false时可以安全地跳过整个区
+//
+bool RM_ZoneMayMatch(const RM_ZoneEntry* entry, AttrType attrType, CompOp compOp, const void* value) {
+    // 区内从未有过记录
+    if (!entry->bValid) {
+        return false;
+    }
+    
+    int cmpMin = RM_ZoneCompare(entry->minValue, value, attrType);
+    int cmpMax = RM_ZoneCompare(entry->maxValue, value, attrType);
+    
+    switch (compOp) {
+        case EQ_OP: return cmpMin <= 0 && cmpMax >= 0;
+        case LT_OP: return cmpMin < 0;
+        case LE_OP: return cmpMin <= 0;
+        case GT_OP: return cmpMax > 0;
+        case GE_OP: return cmpMax >= 0;
+        case NE_OP: return !(cmpMin == 0 && cmpMax == 0);
+        default:    return true;
+    }
+}
+
+
+//
+// 初始化SLOTTED布局的数据页：空槽目录，记录区为空
+//
+void RM_SlottedInitPage(char* pageData) {
+    RM_SlottedPageHdr* hdr = (RM_SlottedPageHdr*)pageData;
+    hdr->numRecords = 0;
+    hdr->numSlots = 0;
+    hdr->freeEnd = PF_PAGE_SIZE;
+    hdr->usedBytes = 0;
+}
+
+//
+// 获取槽目录中的第slotNum项
+//
+RM_Slot* RM_SlottedGetSlot(char* pageData, int slotNum) {
+    return (RM_Slot*)(pageData + sizeof(RM_SlottedPageHdr)) + slotNum;
+}
+
+//
+// 页面的空闲字节总数（包括记录之间的空洞）
+//
+int RM_SlottedTotalFree(char* pageData) {
+    RM_SlottedPageHdr* hdr = (RM_SlottedPageHdr*)pageData;
+    return PF_PAGE_SIZE - (int)sizeof(RM_SlottedPageHdr)
+           - hdr->numSlots * (int)sizeof(RM_Slot) - hdr->usedBytes;
+}
+
+//
+// 页内压缩：把记录依次移到页尾，消除删除和更新留下的空洞
+// 只修改槽目录中的偏移，槽号（RID）不变
+//
+void RM_SlottedCompact(char* pageData) {
+    RM_SlottedPageHdr* hdr = (RM_SlottedPageHdr*)pageData;
+    
+    // 按偏移从大到小移动，目标位置不会覆盖尚未移动的记录
+    std::vector<int> order;
+    for (int i = 0; i < hdr->numSlots; i++) {
+        if (RM_SlottedGetSlot(pageData, i)->offset >= 0) {
+            order.push_back(i);
+        }
+    }
+    std::sort(order.begin(), order.end(), [pageData](int a, int b) {
+        return RM_SlottedGetSlot(pageData, a)->offset > RM_SlottedGetSlot(pageData, b)->offset;
+    });
+    
+    int end = PF_PAGE_SIZE;
+    for (size_t i = 0; i < order.size(); i++) {
+        RM_Slot* slot = RM_SlottedGetSlot(pageData, order[i]);
+        end -= slot->length;
+        memmove(pageData + end, pageData + slot->offset, slot->length);
+        slot->offset = end;
+    }
+    hdr->freeEnd = end;
+}
+
+//
+// 把长度为len的记录放入页面
+// slotNum为-1时使用第一个空槽（没有则追加新槽），否则放入指定的空槽
+// 连续空闲空间不够但总空闲空间足够时先压缩页面；放不下返回false
+//
+bool RM_SlottedPut(char* pageData, int slotNum, const char* data, int len, int flags,
+                   int maxSlots, int &outSlot) {
+    RM_SlottedPageHdr* hdr = (RM_SlottedPageHdr*)pageData;
+    
+    int target = slotNum;
+    if (target < 0) {
+        target = hdr->numSlots;
+        for (int i = 0; i < hdr->numSlots; i++) {
+            if (RM_SlottedGetSlot(pageData, i)->offset < 0) {
+                target = i;
+                break;
+            }
+        }
+    }
+    if (target >= maxSlots) {
+        return false;
+    }
+    
+    int newSlots = (target >= hdr->numSlots) ? target - hdr->numSlots + 1 : 0;
+    int need = len + newSlots * (int)sizeof(RM_Slot);
+    if (RM_SlottedTotalFree(pageData) < need) {
+        return false;
+    }
+    
+    int contiguous = hdr->freeEnd - (int)sizeof(RM_SlottedPageHdr)
+                     - hdr->numSlots * (int)sizeof(RM_Slot);
+    if (contiguous < need) {
+        RM_SlottedCompact(pageData);
+    }
+    
+    // 扩展槽目录
+    for (int i = hdr->numSlots; i < hdr->numSlots + newSlots; i++) {
+        RM_Slot* slot = RM_SlottedGetSlot(pageData, i);
+        slot->offset = -1;
+        slot->length = 0;
+        slot->flags = 0;
+    }
+    hdr->numSlots += newSlots;
+    
+    hdr->freeEnd -= len;
+    memcpy(pageData + hdr->freeEnd, data, len);
+    
+    RM_Slot* slot = RM_SlottedGetSlot(pageData, target);
+    slot->offset = hdr->freeEnd;
+    slot->length = len;
+    slot->flags = flags;
+    hdr->usedBytes += len;
+    
+    outSlot = target;
+    return true;
+}
+
+//
+// 释放槽位上的记录
+// bKeepSlot为false时回收槽目录末尾的空槽
+//
+void RM_SlottedRemove(char* pageData, int slotNum, bool bKeepSlot) {
+    RM_SlottedPageHdr* hdr = (RM_SlottedPageHdr*)pageData;
+    RM_Slot* slot = RM_SlottedGetSlot(pageData, slotNum);
+    
+    hdr->usedBytes -= slot->length;
+    slot->offset = -1;
+    slot->length = 0;
+    slot->flags = 0;
+    
+    if (!bKeepSlot) {
+        while (hdr->numSlots > 0 &&
+               RM_SlottedGetSlot(pageData, hdr->numSlots - 1)->offset < 0) {
+            hdr->numSlots--;
+        }
+    }
+}
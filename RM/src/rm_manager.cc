@@ -20,9 +20,21 @@ RM_Manager::~RM_Manager() {
 }
 
 //
-// 创建记录文件
+// 创建记录文件（按行存储）
 //
 RC RM_Manager::CreateFile(const char *fileName, int recordSize) {
+    return CreateFile(fileName, recordSize, RM_LAYOUT_ROW, 0, NULL);
+}
+
+//
+// 按指定页面布局创建记录文件
+// PAX/SLOTTED布局需要给出各属性的长度，属性按顺序连续排列并恰好覆盖整条记录
+// SLOTTED布局还需要属性类型，STRING属性按实际长度存放
+//
+RC RM_Manager::CreateFile(const char *fileName, int recordSize,
+                          RM_PageLayout layout, int attrCount,
+                          const int attrLengths[],
+                          const AttrType attrTypes[]) {
     RC rc;
     
     // 参数检查
@@ -30,11 +42,58 @@ RC RM_Manager::CreateFile(const char *fileName, int recordSize) {
         return RM_INVALIDFILE;
     }
     
+    // 检查布局参数
+    if (layout == RM_LAYOUT_PAX || layout == RM_LAYOUT_SLOTTED) {
+        if (attrLengths == NULL || attrCount <= 0 || attrCount > RM_MAX_COLUMNS) {
+            return RM_BADLAYOUT;
+        }
+        if (layout == RM_LAYOUT_SLOTTED && attrTypes == NULL) {
+            return RM_BADLAYOUT;
+        }
+        int totalLength = 0;
+        for (int i = 0; i < attrCount; i++) {
+            if (attrLengths[i] <= 0) {
+                return RM_BADLAYOUT;
+            }
+            totalLength += attrLengths[i];
+        }
+        if (totalLength != recordSize) {
+            return RM_BADLAYOUT;
+        }
+    } else if (layout != RM_LAYOUT_ROW) {
+        return RM_BADLAYOUT;
+    }
+    
     // 检查记录大小是否过大
     if (recordSize > PF_PAGE_SIZE - RM_PAGE_HDR_SIZE - 10) {  // 预留一些空间给位图
         return RM_RECORDSIZETOOBIG;
     }
     
+    // SLOTTED布局：每页槽数上限按最短的编码长度计算，最长的记录必须能放入空页
+    int recordsPerPage = RM_CalcRecordsPerPage(recordSize);
+    if (layout == RM_LAYOUT_SLOTTED) {
+        int minEncoded = 0;
+        int maxEncoded = 0;
+        for (int i = 0; i < attrCount; i++) {
+            if (attrTypes[i] == STRING && attrLengths[i] <= 255) {
+                minEncoded += 1;
+                maxEncoded += 1 + attrLengths[i];
+            } else {
+                minEncoded += attrLengths[i];
+                maxEncoded += attrLengths[i];
+            }
+        }
+        if (minEncoded < RM_SLOTTED_MIN_RECORD) {
+            minEncoded = RM_SLOTTED_MIN_RECORD;
+        }
+        
+        int pageSpace = PF_PAGE_SIZE - (int)sizeof(RM_SlottedPageHdr);
+        if (maxEncoded + (int)sizeof(RM_Slot) > pageSpace) {
+            return RM_RECORDSIZETOOBIG;
+        }
+        recordsPerPage = pageSpace / (minEncoded + (int)sizeof(RM_Slot));
+    }
+    
     // 调用PF管理器创建文件
     if ((rc = pfManager->CreateFile(fileName))) {
         return rc;  // 传递PF错误码
@@ -58,9 +117,26 @@ RC RM_Manager::CreateFile(const char *fileName, int recordSize) {
     // 初始化文件头
     RM_FileHdr* fileHdr = (RM_FileHdr*)pageData;
     fileHdr->recordSize = recordSize;
-    fileHdr->recordsPerPage = RM_CalcRecordsPerPage(recordSize);
+    fileHdr->recordsPerPage = recordsPerPage;
     fileHdr->numPages = 1;  // 只有头页面
-    fileHdr->firstFree = RM_INVALID_PAGE;  // 暂时没有数据页
+    fileHdr->magic = RM_FILE_MAGIC;
+    fileHdr->version = RM_FILE_VERSION;
+    
+    fileHdr->pageLayout = layout;
+    fileHdr->numColumns = (layout == RM_LAYOUT_ROW) ? 0 : attrCount;
+    fileHdr->firstFsmPage = RM_INVALID_PAGE;  // 分配第一个数据页时建立空闲空间映射
+    
+    // 初始化区域映射（未跟踪任何属性）
+    memset(pageData + RM_ZONEMAP_OFFSET, 0, RM_ZONEMAP_SIZE);
+    
+    // 保存PAX/SLOTTED布局的列长度和列类型
+    if (layout != RM_LAYOUT_ROW) {
+        memcpy(pageData + RM_COLUMNS_OFFSET, attrLengths, attrCount * sizeof(int));
+        memset(pageData + RM_COLTYPES_OFFSET, 0, RM_MAX_COLUMNS * sizeof(int));
+        if (attrTypes != NULL) {
+            memcpy(pageData + RM_COLTYPES_OFFSET, attrTypes, attrCount * sizeof(AttrType));
+        }
+    }
     
     // 标记页面为脏页并解除固定
     PageNum pageNum;
@@ -134,20 +210,74 @@ RC RM_Manager::OpenFile(const char *fileName, RM_FileHandle &fileHandle) {
         return rc;
     }
     
-    // 复制文件头信息到文件句柄
+    // 检查文件格式版本，版本0的文件就地升级
     RM_FileHdr* fileHdr = (RM_FileHdr*)pageData;
+    bool bUpgrade = (fileHdr->magic != RM_FILE_MAGIC);
+    if (bUpgrade) {
+        rc = UpgradeFile(*(fileHandle.pfFileHandle), pageData);
+    } else if (fileHdr->version != RM_FILE_VERSION) {
+        rc = RM_BADVERSION;
+    }
+    if (rc) {
+        fileHandle.pfFileHandle->UnpinPage(0);
+        pfManager->CloseFile(*(fileHandle.pfFileHandle));
+        delete fileHandle.pfFileHandle;
+        fileHandle.pfFileHandle = NULL;
+        return rc;
+    }
+    
+    // 复制文件头信息到文件句柄
     fileHandle.recordSize = fileHdr->recordSize;
     fileHandle.recordsPerPage = fileHdr->recordsPerPage;
     fileHandle.numPages = fileHdr->numPages;
-    fileHandle.firstFree = fileHdr->firstFree;
     
-    // 解除文件头页面的固定
+    // 读取页面布局，PAX/SLOTTED布局的列偏移由列长度累加得到
+    fileHandle.pageLayout = RM_LAYOUT_ROW;
+    if (fileHdr->pageLayout == RM_LAYOUT_PAX || fileHdr->pageLayout == RM_LAYOUT_SLOTTED) {
+        fileHandle.pageLayout = (RM_PageLayout)fileHdr->pageLayout;
+    }
+    fileHandle.numColumns = 0;
+    fileHandle.maxEncodedSize = 0;
+    if (fileHandle.pageLayout != RM_LAYOUT_ROW) {
+        fileHandle.numColumns = fileHdr->numColumns;
+        memcpy(fileHandle.colLength, pageData + RM_COLUMNS_OFFSET,
+               fileHandle.numColumns * sizeof(int));
+        memcpy(fileHandle.colType, pageData + RM_COLTYPES_OFFSET,
+               fileHandle.numColumns * sizeof(AttrType));
+        int offset = 0;
+        for (int i = 0; i < fileHandle.numColumns; i++) {
+            fileHandle.colOffset[i] = offset;
+            offset += fileHandle.colLength[i];
+            
+            // SLOTTED布局编码后的最大长度：STRING属性多1字节长度
+            fileHandle.maxEncodedSize += fileHandle.colLength[i];
+            if (fileHandle.colType[i] == STRING && fileHandle.colLength[i] <= 255) {
+                fileHandle.maxEncodedSize += 1;
+            }
+        }
+        if (fileHandle.maxEncodedSize < RM_SLOTTED_MIN_RECORD) {
+            fileHandle.maxEncodedSize = RM_SLOTTED_MIN_RECORD;
+        }
+    }
+    
+    // 缓存区域映射
+    fileHandle.zoneMap = new char[RM_ZONEMAP_SIZE];
+    memcpy(fileHandle.zoneMap, pageData + RM_ZONEMAP_OFFSET, RM_ZONEMAP_SIZE);
+    PageNum firstFsmPage = fileHdr->firstFsmPage;
+    
+    // 解除文件头页面的固定，读入空闲空间映射
+    // 升级的文件根据页面内容建立映射，并立即把升级结果写回磁盘
     PageNum pageNum;
     if ((rc = pageHandle.GetPageNum(pageNum)) ||
-        (rc = fileHandle.pfFileHandle->UnpinPage(pageNum))) {
+        (rc = fileHandle.pfFileHandle->UnpinPage(pageNum)) ||
+        (rc = bUpgrade ? fileHandle.RebuildFsm() : fileHandle.LoadFsm(firstFsmPage)) ||
+        (bUpgrade && ((rc = WriteFileHdr(fileHandle)) ||
+                      (rc = fileHandle.pfFileHandle->ForcePages())))) {
         pfManager->CloseFile(*(fileHandle.pfFileHandle));
         delete fileHandle.pfFileHandle;
         fileHandle.pfFileHandle = NULL;
+        delete[] fileHandle.zoneMap;
+        fileHandle.zoneMap = NULL;
         return rc;
     }
     
@@ -169,31 +299,9 @@ RC RM_Manager::CloseFile(RM_FileHandle &fileHandle) {
         return RM_FILENOTOPEN;
     }
     
-    // 如果文件头被修改，需要写回
-    if (fileHandle.bHdrChanged) {
-        PF_PageHandle pageHandle;
-        char* pageData;
-        
-        // 获取文件头页面
-        if ((rc = fileHandle.pfFileHandle->GetFirstPage(pageHandle)) ||
-            (rc = pageHandle.GetData(pageData))) {
-            return rc;
-        }
-        
-        // 更新文件头信息
-        RM_FileHdr* fileHdr = (RM_FileHdr*)pageData;
-        fileHdr->recordSize = fileHandle.recordSize;
-        fileHdr->recordsPerPage = fileHandle.recordsPerPage;
-        fileHdr->numPages = fileHandle.numPages;
-        fileHdr->firstFree = fileHandle.firstFree;
-        
-        // 标记为脏页并解除固定
-        PageNum pageNum;
-        if ((rc = pageHandle.GetPageNum(pageNum)) ||
-            (rc = fileHandle.pfFileHandle->MarkDirty(pageNum)) ||
-            (rc = fileHandle.pfFileHandle->UnpinPage(pageNum))) {
-            return rc;
-        }
+    // 写回文件头和空闲空间映射
+    if ((rc = WriteFileHdr(fileHandle))) {
+        return rc;
     }
     
     // 关闭PF文件
@@ -202,8 +310,101 @@ RC RM_Manager::CloseFile(RM_FileHandle &fileHandle) {
     // 清理文件句柄
     delete fileHandle.pfFileHandle;
     fileHandle.pfFileHandle = NULL;
+    delete[] fileHandle.zoneMap;
+    fileHandle.zoneMap = NULL;
+    fileHandle.fsm.clear();
+    fileHandle.fsmPages.clear();
+    fileHandle.fsmDirty.clear();
     fileHandle.bFileOpen = false;
     fileHandle.bHdrChanged = false;
     
     return rc;
-}
\ No newline at end of file
+}
+
+//
+// 写回修改过的空闲空间映射页，文件头被修改时一并写回
+//
+RC RM_Manager::WriteFileHdr(RM_FileHandle &fileHandle) {
+    RC rc;
+    
+    if ((rc = fileHandle.FlushFsm())) {
+        return rc;
+    }
+    if (!fileHandle.bHdrChanged) {
+        return OK;
+    }
+    
+    // 获取文件头页面
+    PF_PageHandle pageHandle;
+    char* pageData;
+    if ((rc = fileHandle.pfFileHandle->GetFirstPage(pageHandle)) ||
+        (rc = pageHandle.GetData(pageData))) {
+        return rc;
+    }
+    
+    // 更新文件头信息
+    RM_FileHdr* fileHdr = (RM_FileHdr*)pageData;
+    fileHdr->recordSize = fileHandle.recordSize;
+    fileHdr->recordsPerPage = fileHandle.recordsPerPage;
+    fileHdr->numPages = fileHandle.numPages;
+    fileHdr->firstFsmPage = fileHandle.fsmPages.empty() ? RM_INVALID_PAGE
+                                                         : fileHandle.fsmPages[0];
+    memcpy(pageData + RM_ZONEMAP_OFFSET, fileHandle.zoneMap, RM_ZONEMAP_SIZE);
+    
+    // 标记为脏页并解除固定
+    PageNum pageNum;
+    if ((rc = pageHandle.GetPageNum(pageNum)) ||
+        (rc = fileHandle.pfFileHandle->MarkDirty(pageNum)) ||
+        (rc = fileHandle.pfFileHandle->UnpinPage(pageNum))) {
+        return rc;
+    }
+    
+    fileHandle.bHdrChanged = false;
+    return OK;
+}
+
+//
+// 把版本0的文件升级为当前格式
+// 数据页去掉页头中的nextFree（位图和记录整体前移），文件头改为按行存储的当前格式，
+// 空闲空间映射由调用者根据页面内容重建。hdrData是已固定的文件头页面
+//
+RC RM_Manager::UpgradeFile(PF_FileHandle &pfFileHandle, char *hdrData) {
+    RC rc;
+    
+    // 检查旧文件头是否合理
+    RM_FileHdrV0 oldHdr = *(RM_FileHdrV0*)hdrData;
+    int oldSpace = PF_PAGE_SIZE - (int)sizeof(RM_PageHdrV0);
+    if (oldHdr.recordSize <= 0 || oldHdr.recordsPerPage <= 0 || oldHdr.numPages < 1 ||
+        oldHdr.recordsPerPage * oldHdr.recordSize +
+            RM_CalcBitmapSize(oldHdr.recordsPerPage) > oldSpace) {
+        return RM_INVALIDFILE;
+    }
+    
+    for (PageNum pageNum = 1; pageNum < oldHdr.numPages; pageNum++) {
+        PF_PageHandle pageHandle;
+        char* pageData;
+        if ((rc = pfFileHandle.GetThisPage(pageNum, pageHandle)) ||
+            (rc = pageHandle.GetData(pageData))) {
+            return rc;
+        }
+        memmove(pageData + RM_PAGE_HDR_SIZE, pageData + sizeof(RM_PageHdrV0), oldSpace);
+        if ((rc = pfFileHandle.MarkDirty(pageNum)) ||
+            (rc = pfFileHandle.UnpinPage(pageNum))) {
+            return rc;
+        }
+    }
+    
+    // 重写文件头：按行存储，没有区域映射，映射页稍后分配
+    memset(hdrData, 0, PF_PAGE_SIZE);
+    RM_FileHdr* fileHdr = (RM_FileHdr*)hdrData;
+    fileHdr->recordSize = oldHdr.recordSize;
+    fileHdr->recordsPerPage = oldHdr.recordsPerPage;
+    fileHdr->numPages = oldHdr.numPages;
+    fileHdr->magic = RM_FILE_MAGIC;
+    fileHdr->version = RM_FILE_VERSION;
+    fileHdr->pageLayout = RM_LAYOUT_ROW;
+    fileHdr->numColumns = 0;
+    fileHdr->firstFsmPage = RM_INVALID_PAGE;
+    
+    return pfFileHandle.MarkDirty(0);
+}
@@ -0,0 +1,325 @@
+#include "../include/rm.h"
+#include "../internal/rm_internal.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+//
+// rm_parallelscan.cc: 按morsel划分的并行文件扫描
+//
+// 工作线程从共享的页号计数器中领取下一个morsel，扫描其中的数据页并
+// 把匹配的记录放入一个批次，放入就绪队列后再领取下一个morsel。
+// 调用者（执行器）从就绪队列中取批次。队列满时工作线程等待，
+// 因此即使调用者消费得慢，内存占用也是有界的。
+//
+
+//
+// RM_ParallelScanState: 扫描期间工作线程与调用者共享的状态
+//
+struct RM_ParallelScanState {
+    const RM_FileHandle *fileHandle;
+    std::vector<RM_ScanPredicate> predicates;
+    PageNum numPages;
+    std::atomic<PageNum> nextPage;         // 下一个待领取的morsel的首页
+
+    std::mutex mutex;                      // 保护以下成员
+    std::condition_variable batchReady;    // 有新批次或工作线程退出
+    std::condition_variable queueSpace;    // 就绪队列有空位或扫描被关闭
+    std::deque<RM_ScanBatch> readyBatches;
+    size_t maxQueued;
+    int nRunning;                          // 仍在运行的工作线程数
+    bool bStop;                            // 扫描被关闭或出错
+    RC rc;                                 // 第一个出错的工作线程的返回码
+
+    std::vector<std::thread> workers;
+};
+
+//
+// 构造函数
+//
+RM_ParallelScan::RM_ParallelScan() {
+    state = NULL;
+}
+
+//
+// 析构函数
+//
+RM_ParallelScan::~RM_ParallelScan() {
+    if (state != NULL) {
+        CloseScan();
+    }
+}
+
+//
+// DefaultWorkers: 默认的工作线程数（CPU核数，不超过RM_MAX_SCAN_WORKERS）
+//
+int RM_ParallelScan::DefaultWorkers() {
+    int nCores = (int)std::thread::hardware_concurrency();
+    if (nCores < 1) {
+        nCores = 1;
+    }
+    return (nCores < RM_MAX_SCAN_WORKERS) ? nCores : RM_MAX_SCAN_WORKERS;
+}
+
+//
+// GetNumWorkers: 本次扫描的工作线程数
+//
+int RM_ParallelScan::GetNumWorkers() const {
+    return (state != NULL) ? (int)state->workers.size() : 0;
+}
+
+//
+// 开始扫描
+//
+RC RM_ParallelScan::OpenScan(const RM_FileHandle &fileHandle,
+                             int nPredicates,
+                             const RM_ScanPredicate predicates[],
+                             int nWorkers) {
+    // 检查文件句柄是否打开
+    if (!fileHandle.bFileOpen) {
+        return RM_FILENOTOPEN;
+    }
+
+    // 检查扫描是否已经打开
+    if (state != NULL) {
+        return RM_SCANALREADYOPEN;
+    }
+
+    // 参数检查
+    if (nPredicates < 0 || (nPredicates > 0 && predicates == NULL)) {
+        return RM_INVALIDRECORD;
+    }
+    for (int i = 0; i < nPredicates; i++) {
+        if (predicates[i].attrLength <= 0 || predicates[i].attrOffset < 0 ||
+            predicates[i].attrOffset + predicates[i].attrLength > fileHandle.recordSize) {
+            return RM_INVALIDRECORD;
+        }
+    }
+
+    // 工作线程数不超过morsel数
+    int nMorsels = (fileHandle.numPages - 1 + RM_MORSEL_PAGES - 1) / RM_MORSEL_PAGES;
+    if (nWorkers <= 0) {
+        nWorkers = DefaultWorkers();
+    }
+    if (nWorkers > RM_MAX_SCAN_WORKERS) {
+        nWorkers = RM_MAX_SCAN_WORKERS;
+    }
+    if (nWorkers > nMorsels) {
+        nWorkers = nMorsels;
+    }
+
+    state = new RM_ParallelScanState;
+    state->fileHandle = &fileHandle;
+    state->predicates.assign(predicates, predicates + nPredicates);
+    state->numPages = fileHandle.numPages;
+    state->nextPage = 1;  // 从第一个数据页开始（页0是文件头）
+    state->maxQueued = (size_t)nWorkers * RM_MAX_QUEUED_BATCHES;
+    state->nRunning = nWorkers;
+    state->bStop = false;
+    state->rc = OK;
+
+    for (int i = 0; i < nWorkers; i++) {
+        state->workers.push_back(std::thread(&RM_ParallelScan::RunWorker, this));
+    }
+
+    return OK;
+}
+
+//
+// 获取下一批记录
+//
+RC RM_ParallelScan::GetNextBatch(RM_ScanBatch &batch) {
+    // 检查扫描是否打开
+    if (state == NULL) {
+        return RM_SCANNOTOPEN;
+    }
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->batchReady.wait(lock, [this] {
+        return !state->readyBatches.empty() || state->nRunning == 0 || state->rc != OK;
+    });
+
+    if (state->rc != OK) {
+        return state->rc;
+    }
+    if (state->readyBatches.empty()) {
+        // 所有工作线程都已退出
+        return RM_EOF;
+    }
+
+    batch = std::move(state->readyBatches.front());
+    state->readyBatches.pop_front();
+    state->queueSpace.notify_one();
+
+    return OK;
+}
+
+//
+// 关闭扫描
+//
+RC RM_ParallelScan::CloseScan() {
+    // 检查扫描是否打开
+    if (state == NULL) {
+        return RM_SCANNOTOPEN;
+    }
+
+    // 通知工作线程停止，并等待它们退出（退出前会解除固定的页面）
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->bStop = true;
+    }
+    state->queueSpace.notify_all();
+    for (size_t i = 0; i < state->workers.size(); i++) {
+        state->workers[i].join();
+    }
+
+    delete state;
+    state = NULL;
+
+    return OK;
+}
+
+//
+// RunWorker: 工作线程主循环，领取morsel直到文件扫描完或扫描被关闭
+//
+void RM_ParallelScan::RunWorker() {
+    const RM_FileHandle *fileHandle = state->fileHandle;
+    char* recordBuf = new char[fileHandle->recordSize];
+    RC rc = OK;
+
+    while (rc == OK) {
+        PageNum firstPage = state->nextPage.fetch_add(RM_MORSEL_PAGES);
+        if (firstPage >= state->numPages) {
+            break;
+        }
+        PageNum lastPage = firstPage + RM_MORSEL_PAGES;
+        if (lastPage > state->numPages) {
+            lastPage = state->numPages;
+        }
+
+        RM_ScanBatch batch;
+        if ((rc = ScanMorsel(firstPage, lastPage, recordBuf, batch))) {
+            break;
+        }
+
+        // 把批次放入就绪队列，队列满时等待
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->queueSpace.wait(lock, [this] {
+            return state->bStop || state->readyBatches.size() < state->maxQueued;
+        });
+        if (state->bStop) {
+            break;
+        }
+        if (batch.nRecords > 0) {
+            state->readyBatches.push_back(std::move(batch));
+            state->batchReady.notify_one();
+        }
+    }
+
+    delete[] recordBuf;
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (rc != OK && state->rc == OK) {
+        // 出错后其余工作线程也停止
+        state->rc = rc;
+        state->bStop = true;
+        state->queueSpace.notify_all();
+    }
+    state->nRunning--;
+    state->batchReady.notify_all();
+}
+
+//
+// ScanMorsel: 扫描[firstPage, lastPage)中的数据页，把匹配的记录追加到batch
+// recordBuf是线程私有的缓冲区，SLOTTED布局在其中解码记录后再比较
+//
+RC RM_ParallelScan::ScanMorsel(PageNum firstPage, PageNum lastPage,
+                               char *recordBuf, RM_ScanBatch &batch) {
+    RC rc;
+    const RM_FileHandle *fileHandle = state->fileHandle;
+    const std::vector<RM_ScanPredicate> &predicates = state->predicates;
+    int nPredicates = (int)predicates.size();
+    int recordSize = fileHandle->recordSize;
+    bool bDecode = (fileHandle->pageLayout == RM_LAYOUT_SLOTTED);
+
+    batch.recordSize = recordSize;
+
+    std::vector<char*> columns(nPredicates);
+    std::vector<int> strides(nPredicates);
+
+    for (PageNum pageNum = firstPage; pageNum < lastPage; pageNum++) {
+        // 根据空闲空间映射跳过空页和映射页，根据区域映射跳过不可能有匹配记录的页面
+        int level = fileHandle->GetFreeSpace(pageNum);
+        if (level == RM_FSM_EMPTY || level == RM_FSM_MAPPAGE) {
+            continue;
+        }
+        bool bMayMatch = true;
+        for (int p = 0; p < nPredicates && bMayMatch; p++) {
+            bMayMatch = fileHandle->PageMayMatch(pageNum, predicates[p].attrType,
+                                                 predicates[p].attrOffset,
+                                                 predicates[p].compOp, predicates[p].value);
+        }
+        if (!bMayMatch) {
+            continue;
+        }
+
+        // 获取页面
+        PF_PageHandle pageHandle;
+        char* pageData;
+        if ((rc = fileHandle->pfFileHandle->GetThisPage(pageNum, pageHandle)) ||
+            (rc = pageHandle.GetData(pageData))) {
+            return rc;
+        }
+
+        // 条件属性所在的列（PAX布局下属性值在页内连续存放）
+        if (!bDecode) {
+            for (int p = 0; p < nPredicates; p++) {
+                columns[p] = fileHandle->GetColumnPtr(pageData, predicates[p].attrOffset, strides[p]);
+            }
+        }
+
+        int nSlots = fileHandle->GetSlotCount(pageData);
+        for (int slot = 0; slot < nSlots; slot++) {
+            if (!fileHandle->SlotInUse(pageData, slot)) {
+                continue;
+            }
+            if (bDecode && (rc = fileHandle->ReadRecord(pageData, slot, recordBuf))) {
+                fileHandle->pfFileHandle->UnpinPage(pageNum);
+                return rc;
+            }
+
+            // 检查所有条件
+            bool matches = true;
+            for (int p = 0; p < nPredicates && matches; p++) {
+                char* attrData = bDecode ? recordBuf + predicates[p].attrOffset
+                                         : columns[p] + slot * strides[p];
+                matches = RM_CompareAttr(attrData, predicates[p].value, predicates[p].attrType,
+                                         predicates[p].attrLength, predicates[p].compOp);
+            }
+            if (!matches) {
+                continue;
+            }
+
+            // 追加到批次
+            batch.data.resize((size_t)(batch.nRecords + 1) * recordSize);
+            char* dst = &batch.data[(size_t)batch.nRecords * recordSize];
+            if (bDecode) {
+                memcpy(dst, recordBuf, recordSize);
+            } else {
+                fileHandle->ReadRecord(pageData, slot, dst);
+            }
+            batch.rids.push_back(RID(pageNum, slot));
+            batch.nRecords++;
+        }
+
+        // 解除页面固定
+        if ((rc = fileHandle->pfFileHandle->UnpinPage(pageNum))) {
+            return rc;
+        }
+    }
+
+    return OK;
+}
@@ -0,0 +1,310 @@
+//
+// rm_ridbitmap.cc: 按页面组织的压缩RID集合
+//
+// 索引按键的顺序返回RID，对应的记录散布在堆文件的各个页面上。
+// 先把RID收集到按页号排序的集合中，再按页号顺序逐页读取，
+// 每个页面只固定一次，页面的访问顺序也与文件顺序一致。
+//
+// 与roaring bitmap类似，RID的页号相当于高位，每个页面的槽位放在一个容器中：
+// 槽位少时是有序数组，多时是位图。求交集/并集时逐页面处理，
+// 只在一方出现的页面在交集中直接跳过。
+//
+
+#include "../include/rm.h"
+#include "../internal/rm_internal.h"
+#include <algorithm>
+#include <iterator>
+
+//
+// RM_RidContainer
+//
+
+//
+// Add: 加入槽位，原来没有时返回true
+//
+bool RM_RidContainer::Add(SlotNum slot) {
+    if (bBitmap) {
+        size_t word = (size_t)slot / 64;
+        uint64_t mask = (uint64_t)1 << (slot % 64);
+        if (bits.size() <= word) {
+            bits.resize(word + 1, 0);
+        }
+        if (bits[word] & mask) {
+            return false;
+        }
+        bits[word] |= mask;
+        count++;
+        return true;
+    }
+
+    std::vector<uint16_t>::iterator it = std::lower_bound(slots.begin(), slots.end(), (uint16_t)slot);
+    if (it != slots.end() && *it == (uint16_t)slot) {
+        return false;
+    }
+    slots.insert(it, (uint16_t)slot);
+    count++;
+    if (count > RM_RIDSET_ARRAY_MAX) {
+        ToBitmap();
+    }
+    return true;
+}
+
+//
+// Contains: 槽位是否在容器中
+//
+bool RM_RidContainer::Contains(SlotNum slot) const {
+    if (bBitmap) {
+        size_t word = (size_t)slot / 64;
+        return word < bits.size() && (bits[word] & ((uint64_t)1 << (slot % 64))) != 0;
+    }
+    return std::binary_search(slots.begin(), slots.end(), (uint16_t)slot);
+}
+
+//
+// ToBitmap: 数组 -> 位图
+//
+void RM_RidContainer::ToBitmap() {
+    if (bBitmap) {
+        return;
+    }
+    bits.assign(slots.empty() ? 0 : (size_t)slots.back() / 64 + 1, 0);
+    for (size_t i = 0; i < slots.size(); i++) {
+        bits[slots[i] / 64] |= (uint64_t)1 << (slots[i] % 64);
+    }
+    slots.clear();
+    slots.shrink_to_fit();
+    bBitmap = true;
+}
+
+//
+// Compact: 槽位不超过RM_RIDSET_ARRAY_MAX个时位图 -> 数组
+//
+void RM_RidContainer::Compact() {
+    if (!bBitmap || count > RM_RIDSET_ARRAY_MAX) {
+        return;
+    }
+    std::vector<uint16_t> array;
+    array.reserve(count);
+    for (size_t w = 0; w < bits.size(); w++) {
+        uint64_t word = bits[w];
+        while (word != 0) {
+            array.push_back((uint16_t)(w * 64 + __builtin_ctzll(word)));
+            word &= word - 1;
+        }
+    }
+    slots.swap(array);
+    bits.clear();
+    bits.shrink_to_fit();
+    bBitmap = false;
+}
+
+//
+// GetSlots: 按槽号顺序取出所有槽位
+//
+void RM_RidContainer::GetSlots(std::vector<SlotNum> &out) const {
+    out.clear();
+    if (!bBitmap) {
+        out.assign(slots.begin(), slots.end());
+        return;
+    }
+    for (size_t w = 0; w < bits.size(); w++) {
+        uint64_t word = bits[w];
+        while (word != 0) {
+            out.push_back((SlotNum)(w * 64 + __builtin_ctzll(word)));
+            word &= word - 1;
+        }
+    }
+}
+
+//
+// RM_ContainerAnd: a = a ∩ b
+//
+static void RM_ContainerAnd(RM_RidContainer &a, const RM_RidContainer &b) {
+    if (a.bBitmap && b.bBitmap) {
+        // 位图 ∩ 位图：逐字求与
+        if (a.bits.size() > b.bits.size()) {
+            a.bits.resize(b.bits.size());
+        }
+        a.count = 0;
+        for (size_t w = 0; w < a.bits.size(); w++) {
+            a.bits[w] &= b.bits[w];
+            a.count += __builtin_popcountll(a.bits[w]);
+        }
+        a.Compact();
+        return;
+    }
+
+    // 有一方是数组时结果不会多于数组的元素个数，逐个检查数组中的槽位
+    const RM_RidContainer &array = a.bBitmap ? b : a;
+    const RM_RidContainer &other = a.bBitmap ? a : b;
+    std::vector<uint16_t> result;
+    for (size_t i = 0; i < array.slots.size(); i++) {
+        if (other.Contains(array.slots[i])) {
+            result.push_back(array.slots[i]);
+        }
+    }
+    a.slots.swap(result);
+    a.bits.clear();
+    a.count = (int)a.slots.size();
+    a.bBitmap = false;
+}
+
+//
+// RM_ContainerOr: a = a ∪ b
+//
+static void RM_ContainerOr(RM_RidContainer &a, const RM_RidContainer &b) {
+    if (!a.bBitmap && !b.bBitmap) {
+        // 数组 ∪ 数组：归并
+        std::vector<uint16_t> result;
+        result.reserve(a.slots.size() + b.slots.size());
+        std::set_union(a.slots.begin(), a.slots.end(), b.slots.begin(), b.slots.end(),
+                       std::back_inserter(result));
+        a.slots.swap(result);
+        a.count = (int)a.slots.size();
+        if (a.count > RM_RIDSET_ARRAY_MAX) {
+            a.ToBitmap();
+        }
+        return;
+    }
+
+    a.ToBitmap();
+    if (b.bBitmap) {
+        if (a.bits.size() < b.bits.size()) {
+            a.bits.resize(b.bits.size(), 0);
+        }
+        a.count = 0;
+        for (size_t w = 0; w < a.bits.size(); w++) {
+            if (w < b.bits.size()) {
+                a.bits[w] |= b.bits[w];
+            }
+            a.count += __builtin_popcountll(a.bits[w]);
+        }
+    } else {
+        for (size_t i = 0; i < b.slots.size(); i++) {
+            a.Add(b.slots[i]);
+        }
+    }
+}
+
+//
+// RM_RidBitmap
+//
+
+//
+// 构造函数
+//
+RM_RidBitmap::RM_RidBitmap() {
+    nRids = 0;
+}
+
+//
+// 析构函数
+//
+RM_RidBitmap::~RM_RidBitmap() {
+}
+
+//
+// Add: 加入一个RID，已经在集合中时不重复计数
+//
+RC RM_RidBitmap::Add(const RID &rid) {
+    RC rc;
+    PageNum pageNum;
+    SlotNum slotNum;
+
+    if ((rc = rid.GetPageNum(pageNum)) ||
+        (rc = rid.GetSlotNum(slotNum))) {
+        return rc;
+    }
+    if (pageNum < 1 || slotNum < 0 || slotNum > 0xFFFF) {
+        return RM_INVALIDRID;
+    }
+
+    if (pages[pageNum].Add(slotNum)) {
+        nRids++;
+    }
+
+    return OK;
+}
+
+//
+// Contains: RID是否在集合中
+//
+bool RM_RidBitmap::Contains(const RID &rid) const {
+    PageNum pageNum;
+    SlotNum slotNum;
+
+    if (rid.GetPageNum(pageNum) || rid.GetSlotNum(slotNum) || slotNum < 0 || slotNum > 0xFFFF) {
+        return false;
+    }
+
+    std::map<PageNum, RM_RidContainer>::const_iterator it = pages.find(pageNum);
+    return it != pages.end() && it->second.Contains(slotNum);
+}
+
+//
+// Clear: 清空集合
+//
+void RM_RidBitmap::Clear() {
+    pages.clear();
+    nRids = 0;
+}
+
+//
+// And: 与other求交集，只在一方出现的页面直接去掉
+//
+void RM_RidBitmap::And(const RM_RidBitmap &other) {
+    std::map<PageNum, RM_RidContainer>::iterator it = pages.begin();
+    std::map<PageNum, RM_RidContainer>::const_iterator oit = other.pages.begin();
+
+    nRids = 0;
+    while (it != pages.end()) {
+        while (oit != other.pages.end() && oit->first < it->first) {
+            ++oit;
+        }
+        if (oit == other.pages.end() || oit->first != it->first) {
+            it = pages.erase(it);
+            continue;
+        }
+        RM_ContainerAnd(it->second, oit->second);
+        if (it->second.count == 0) {
+            it = pages.erase(it);
+            continue;
+        }
+        nRids += it->second.count;
+        ++it;
+    }
+}
+
+//
+// Or: 与other求并集
+//
+void RM_RidBitmap::Or(const RM_RidBitmap &other) {
+    std::map<PageNum, RM_RidContainer>::const_iterator oit;
+    for (oit = other.pages.begin(); oit != other.pages.end(); ++oit) {
+        std::map<PageNum, RM_RidContainer>::iterator it = pages.find(oit->first);
+        if (it == pages.end()) {
+            pages.insert(*oit);
+            nRids += oit->second.count;
+            continue;
+        }
+        nRids -= it->second.count;
+        RM_ContainerOr(it->second, oit->second);
+        nRids += it->second.count;
+    }
+}
+
+//
+// GetNextPage: 页号大于prevPage的第一个页面及其上的槽位（按槽号排序）
+//
+RC RM_RidBitmap::GetNextPage(PageNum prevPage, PageNum &pageNum,
+                             std::vector<SlotNum> &slots) const {
+    std::map<PageNum, RM_RidContainer>::const_iterator it = pages.upper_bound(prevPage);
+    if (it == pages.end()) {
+        return RM_EOF;
+    }
+
+    pageNum = it->first;
+    it->second.GetSlots(slots);
+
+    return OK;
+}
@@ -0,0 +1,325 @@
+#include "../include/rm.h"
+#include "../internal/rm_internal.h"
+#include <cstring>
+
+//
+// rm_slotted.cc: SLOTTED布局（槽目录 + 变长记录）
+//
+// 对外接口仍然是定长记录：写入时把记录编码为变长格式（STRING属性去掉末尾的'\0'），
+// 读取时解码回定长记录。空闲空间映射中非零的等级表示页面剩余空间足以放下任意
+// 一条记录，因此按映射选出的页面（必要时压缩后）一定能放下新记录。
+//
+
+//
+// 属性是否按变长格式存放：STRING属性用1字节保存实际长度
+//
+static bool RM_IsVarColumn(AttrType attrType, int attrLength) {
+    return attrType == STRING && attrLength <= 255;
+}
+
+//
+// EncodeRecord: 把定长记录编码为变长格式，返回编码后的长度
+// buf至少要有maxEncodedSize字节
+//
+int RM_FileHandle::EncodeRecord(const char *pData, char *buf) const {
+    int len = 0;
+    for (int c = 0; c < numColumns; c++) {
+        const char* value = pData + colOffset[c];
+        if (RM_IsVarColumn(colType[c], colLength[c])) {
+            int n = colLength[c];
+            while (n > 0 && value[n - 1] == '\0') {
+                n--;
+            }
+            buf[len++] = (char)(unsigned char)n;
+            memcpy(buf + len, value, n);
+            len += n;
+        } else {
+            memcpy(buf + len, value, colLength[c]);
+            len += colLength[c];
+        }
+    }
+
+    // 记录至少要能容纳一个转发指针，更新时才能原地改为转发
+    while (len < RM_SLOTTED_MIN_RECORD) {
+        buf[len++] = 0;
+    }
+    return len;
+}
+
+//
+// DecodeRecord: 把变长格式解码为定长记录
+//
+void RM_FileHandle::DecodeRecord(const char *buf, char *pData) const {
+    memset(pData, 0, recordSize);
+
+    int pos = 0;
+    for (int c = 0; c < numColumns; c++) {
+        if (RM_IsVarColumn(colType[c], colLength[c])) {
+            int n = (unsigned char)buf[pos++];
+            memcpy(pData + colOffset[c], buf + pos, n);
+            pos += n;
+        } else {
+            memcpy(pData + colOffset[c], buf + pos, colLength[c]);
+            pos += colLength[c];
+        }
+    }
+}
+
+//
+// InsertSlottedRec: 插入记录，pageNum为RM_INVALID_PAGE时分配新页面
+//
+RC RM_FileHandle::InsertSlottedRec(PageNum pageNum, const char *pData, RID &rid) {
+    RC rc;
+
+    char* buf = new char[maxEncodedSize];
+    int len = EncodeRecord(pData, buf);
+    rc = PlaceSlotted(pageNum, buf, len, 0, rid);
+    delete[] buf;
+    if (rc || (rc = rid.GetPageNum(pageNum))) {
+        return rc;
+    }
+
+    // 维护区域映射
+    WidenZoneMaps(pageNum, pData);
+
+    return OK;
+}
+
+//
+// PlaceSlotted: 把编码后的记录放入页面，pageNum为RM_INVALID_PAGE时分配新页面
+// 页面放不下时（映射与页面内容不一致）改用新页面
+//
+RC RM_FileHandle::PlaceSlotted(PageNum pageNum, const char *data, int len, int flags, RID &rid) {
+    RC rc;
+    PF_PageHandle pageHandle;
+    char* pageData;
+
+    if (pageNum != RM_INVALID_PAGE) {
+        if ((rc = pfFileHandle->GetThisPage(pageNum, pageHandle)) ||
+            (rc = pageHandle.GetData(pageData))) {
+            return rc;
+        }
+    } else if ((rc = AllocateDataPage(pageNum, pageHandle, pageData))) {
+        return rc;
+    }
+
+    int slotNum;
+    if (!RM_SlottedPut(pageData, -1, data, len, flags, recordsPerPage, slotNum)) {
+        pfFileHandle->UnpinPage(pageNum);
+        return PlaceSlotted(RM_INVALID_PAGE, data, len, flags, rid);
+    }
+
+    if (!(flags & RM_SLOT_MOVED)) {
+        ((RM_SlottedPageHdr*)pageData)->numRecords++;
+    }
+    UpdateFreeSpace(pageNum, pageData);
+
+    // 标记页面为脏页并解除固定
+    if ((rc = pfFileHandle->MarkDirty(pageNum)) ||
+        (rc = pfFileHandle->UnpinPage(pageNum))) {
+        return rc;
+    }
+
+    rid = RID(pageNum, slotNum);
+    return OK;
+}
+
+//
+// DeleteSlottedRec: 删除记录，记录已被转发时一并删除转入其他页面的记录
+//
+RC RM_FileHandle::DeleteSlottedRec(PageNum pageNum, SlotNum slotNum) {
+    RC rc;
+
+    // 获取页面
+    PF_PageHandle pageHandle;
+    char* pageData;
+    if ((rc = pfFileHandle->GetThisPage(pageNum, pageHandle)) ||
+        (rc = pageHandle.GetData(pageData))) {
+        return rc;
+    }
+
+    // 检查记录是否存在
+    if (!SlotInUse(pageData, slotNum)) {
+        pfFileHandle->UnpinPage(pageNum);
+        return RM_RECORDNOTFOUND;
+    }
+
+    RM_Slot* slot = RM_SlottedGetSlot(pageData, slotNum);
+    if ((slot->flags & RM_SLOT_FORWARD) &&
+        (rc = RemoveForwarded(pageData + slot->offset))) {
+        pfFileHandle->UnpinPage(pageNum);
+        return rc;
+    }
+
+    RM_SlottedRemove(pageData, slotNum, false);
+
+    RM_SlottedPageHdr* pageHdr = (RM_SlottedPageHdr*)pageData;
+    pageHdr->numRecords--;
+    UpdateFreeSpace(pageNum, pageData);
+
+    if (pageHdr->numRecords == 0) {
+        ResetZoneMaps(pageNum);
+    }
+
+    // 标记页面为脏页并解除固定
+    if ((rc = pfFileHandle->MarkDirty(pageNum)) ||
+        (rc = pfFileHandle->UnpinPage(pageNum))) {
+        return rc;
+    }
+
+    return OK;
+}
+
+//
+// UpdateSlottedRec: 更新记录，RID保持不变
+// 新记录不比原来长时原地覆盖；否则先尝试在本页重新放置（必要时压缩），
+// 本页放不下时把记录移到其他页面并在原槽位保存转发指针
+//
+RC RM_FileHandle::UpdateSlottedRec(PageNum pageNum, SlotNum slotNum, const char *pData) {
+    RC rc = OK;
+
+    // 获取页面
+    PF_PageHandle pageHandle;
+    char* pageData;
+    if ((rc = pfFileHandle->GetThisPage(pageNum, pageHandle)) ||
+        (rc = pageHandle.GetData(pageData))) {
+        return rc;
+    }
+
+    // 检查记录是否存在
+    if (!SlotInUse(pageData, slotNum)) {
+        pfFileHandle->UnpinPage(pageNum);
+        return RM_RECORDNOTFOUND;
+    }
+
+    char* buf = new char[maxEncodedSize];
+    int len = EncodeRecord(pData, buf);
+    RM_Slot* slot = RM_SlottedGetSlot(pageData, slotNum);
+    bool bDone = false;
+
+    if (slot->flags & RM_SLOT_FORWARD) {
+        // 记录已被转发：先尝试在转入的页面中原地覆盖
+        RM_ForwardPtr fwd;
+        memcpy(&fwd, pageData + slot->offset, sizeof(RM_ForwardPtr));
+
+        PF_PageHandle fwdHandle;
+        char* fwdData;
+        if ((rc = pfFileHandle->GetThisPage(fwd.pageNum, fwdHandle)) ||
+            (rc = fwdHandle.GetData(fwdData))) {
+            delete[] buf;
+            pfFileHandle->UnpinPage(pageNum);
+            return rc;
+        }
+
+        RM_Slot* fwdSlot = RM_SlottedGetSlot(fwdData, fwd.slotNum);
+        if (len <= fwdSlot->length) {
+            memcpy(fwdData + fwdSlot->offset, buf, len);
+            ((RM_SlottedPageHdr*)fwdData)->usedBytes -= fwdSlot->length - len;
+            fwdSlot->length = len;
+            UpdateFreeSpace(fwd.pageNum, fwdData);
+            bDone = true;
+        }
+
+        if ((rc = pfFileHandle->MarkDirty(fwd.pageNum)) ||
+            (rc = pfFileHandle->UnpinPage(fwd.pageNum)) ||
+            (!bDone && (rc = RemoveForwarded(pageData + slot->offset)))) {
+            delete[] buf;
+            pfFileHandle->UnpinPage(pageNum);
+            return rc;
+        }
+    } else if (len <= slot->length) {
+        // 原地覆盖，多出的空间留给压缩回收
+        memcpy(pageData + slot->offset, buf, len);
+        ((RM_SlottedPageHdr*)pageData)->usedBytes -= slot->length - len;
+        slot->length = len;
+        bDone = true;
+    }
+
+    if (!bDone) {
+        // 释放原记录（或转发指针），保留槽号后重新放置
+        RM_SlottedRemove(pageData, slotNum, true);
+
+        int placed;
+        if (!RM_SlottedPut(pageData, slotNum, buf, len, 0, recordsPerPage, placed)) {
+            // 本页放不下：原记录至少占用一个转发指针的空间，转发指针一定放得下
+            RM_ForwardPtr fwd;
+            fwd.pageNum = RM_INVALID_PAGE;
+            fwd.slotNum = RM_INVALID_SLOT;
+            RM_SlottedPut(pageData, slotNum, (const char*)&fwd, sizeof(RM_ForwardPtr),
+                          RM_SLOT_FORWARD, recordsPerPage, placed);
+
+            RID newRid;
+            if ((rc = PlaceSlotted(FindFreePage(numPages), buf, len, RM_SLOT_MOVED, newRid)) ||
+                (rc = newRid.GetPageNum(fwd.pageNum)) ||
+                (rc = newRid.GetSlotNum(fwd.slotNum))) {
+                delete[] buf;
+                pfFileHandle->UnpinPage(pageNum);
+                return rc;
+            }
+
+            slot = RM_SlottedGetSlot(pageData, slotNum);
+            memcpy(pageData + slot->offset, &fwd, sizeof(RM_ForwardPtr));
+        }
+    }
+    delete[] buf;
+
+    UpdateFreeSpace(pageNum, pageData);
+
+    // 维护区域映射（转发的记录仍然归属原页面）
+    WidenZoneMaps(pageNum, pData);
+
+    // 标记页面为脏页并解除固定
+    if ((rc = pfFileHandle->MarkDirty(pageNum)) ||
+        (rc = pfFileHandle->UnpinPage(pageNum))) {
+        return rc;
+    }
+
+    return OK;
+}
+
+//
+// RemoveForwarded: 删除转发指针指向的记录
+//
+RC RM_FileHandle::RemoveForwarded(const char *stub) {
+    RC rc;
+    RM_ForwardPtr fwd;
+    memcpy(&fwd, stub, sizeof(RM_ForwardPtr));
+
+    PF_PageHandle pageHandle;
+    char* pageData;
+    if ((rc = pfFileHandle->GetThisPage(fwd.pageNum, pageHandle)) ||
+        (rc = pageHandle.GetData(pageData))) {
+        return rc;
+    }
+
+    RM_SlottedRemove(pageData, fwd.slotNum, false);
+    UpdateFreeSpace(fwd.pageNum, pageData);
+
+    if ((rc = pfFileHandle->MarkDirty(fwd.pageNum)) ||
+        (rc = pfFileHandle->UnpinPage(fwd.pageNum))) {
+        return rc;
+    }
+
+    return OK;
+}
+
+//
+// ReadForwarded: 读取转发指针指向的记录
+//
+RC RM_FileHandle::ReadForwarded(const char *stub, char *pData) const {
+    RC rc;
+    RM_ForwardPtr fwd;
+    memcpy(&fwd, stub, sizeof(RM_ForwardPtr));
+
+    PF_PageHandle pageHandle;
+    char* pageData;
+    if ((rc = pfFileHandle->GetThisPage(fwd.pageNum, pageHandle)) ||
+        (rc = pageHandle.GetData(pageData))) {
+        return rc;
+    }
+
+    RM_Slot* slot = RM_SlottedGetSlot(pageData, fwd.slotNum);
+    DecodeRecord(pageData + slot->offset, pData);
+
+    return pfFileHandle->UnpinPage(fwd.pageNum);
+}
@@ -0,0 +1,281 @@
+#include "../include/rm.h"
+#include "../internal/rm_internal.h"
+#include <cstring>
+
+//
+// rm_zonemap.cc: RM文件的区域映射（zone map）
+//
+// 区域映射保存在文件头页中，文件打开期间缓存在 RM_FileHandle::zoneMap，
+// 由 InsertRec/UpdateRec/DeleteRec 维护，关闭文件时随文件头一起写回。
+// 删除记录不会收缩区的范围（范围只会偏大，不影响正确性），需要精确范围时
+// 调用 RebuildZoneMaps 重新扫描文件。
+//
+
+//
+// CreateZoneMap: 为属性建立区域映射并扫描全文件初始化
+//
+RC RM_FileHandle::CreateZoneMap(AttrType attrType, int attrLength, int attrOffset) {
+    // 检查文件是否打开
+    if (!bFileOpen || zoneMap == NULL) {
+        return RM_FILENOTOPEN;
+    }
+
+    // 只支持定长4字节的INT/FLOAT属性
+    if ((attrType != INT && attrType != FLOAT) ||
+        attrLength != RM_ZM_VALUE_SIZE ||
+        attrOffset < 0 || attrOffset + attrLength > recordSize) {
+        return RM_BADZONEATTR;
+    }
+
+    // 已经跟踪该属性
+    if (HasZoneMap(attrOffset)) {
+        return OK;
+    }
+
+    RM_ZoneMapHdr* zmHdr = (RM_ZoneMapHdr*)zoneMap;
+    if (zmHdr->numAttrs >= RM_ZM_MAX_ATTRS) {
+        return RM_BADZONEATTR;
+    }
+
+    RM_ZoneAttr& attr = zmHdr->attrs[zmHdr->numAttrs++];
+    attr.attrType = attrType;
+    attr.attrLength = attrLength;
+    attr.attrOffset = attrOffset;
+
+    // 属性数变化后条目布局也随之变化，需要重建
+    return RebuildZoneMaps();
+}
+
+//
+// DropZoneMap: 停止跟踪属性
+//
+RC RM_FileHandle::DropZoneMap(int attrOffset) {
+    // 检查文件是否打开
+    if (!bFileOpen || zoneMap == NULL) {
+        return RM_FILENOTOPEN;
+    }
+
+    RM_ZoneMapHdr* zmHdr = (RM_ZoneMapHdr*)zoneMap;
+    for (int i = 0; i < zmHdr->numAttrs; i++) {
+        if (zmHdr->attrs[i].attrOffset == attrOffset) {
+            // 后面的属性前移
+            for (int j = i; j < zmHdr->numAttrs - 1; j++) {
+                zmHdr->attrs[j] = zmHdr->attrs[j + 1];
+            }
+            zmHdr->numAttrs--;
+
+            if (zmHdr->numAttrs == 0) {
+                memset(zoneMap, 0, RM_ZONEMAP_SIZE);
+                bHdrChanged = true;
+                return OK;
+            }
+            return RebuildZoneMaps();
+        }
+    }
+
+    return OK;
+}
+
+//
+// RebuildZoneMaps: 扫描全部数据页，重新计算每个区的最小/最大值
+//
+RC RM_FileHandle::RebuildZoneMaps() {
+    RC rc;
+
+    // 检查文件是否打开
+    if (!bFileOpen || zoneMap == NULL) {
+        return RM_FILENOTOPEN;
+    }
+
+    RM_ZoneMapHdr* zmHdr = (RM_ZoneMapHdr*)zoneMap;
+    if (zmHdr->numAttrs == 0) {
+        return OK;
+    }
+
+    // 按当前数据页数选择每区页数，避免重建过程中反复合并
+    int maxZones = RM_ZM_MAX_ENTRIES / zmHdr->numAttrs;
+    int dataPages = numPages - 1;
+    zmHdr->pagesPerZone = 1;
+    while (dataPages > maxZones * zmHdr->pagesPerZone) {
+        zmHdr->pagesPerZone *= 2;
+    }
+    zmHdr->numZones = 0;
+    memset(RM_GetZoneEntries(zoneMap), 0, RM_ZONEMAP_SIZE - sizeof(RM_ZoneMapHdr));
+    bHdrChanged = true;
+
+    char* recordData = new char[recordSize];
+    for (PageNum pageNum = 1; pageNum < numPages; pageNum++) {
+        if (!IsDataPage(pageNum)) {
+            continue;
+        }
+        PF_PageHandle pageHandle;
+        char* pageData;
+        if ((rc = pfFileHandle->GetThisPage(pageNum, pageHandle)) ||
+            (rc = pageHandle.GetData(pageData))) {
+            delete[] recordData;
+            return rc;
+        }
+
+        int nSlots = GetSlotCount(pageData);
+        for (int slot = 0; slot < nSlots; slot++) {
+            if (SlotInUse(pageData, slot)) {
+                if ((rc = ReadRecord(pageData, slot, recordData))) {
+                    pfFileHandle->UnpinPage(pageNum);
+                    delete[] recordData;
+                    return rc;
+                }
+                WidenZoneMaps(pageNum, recordData);
+            }
+        }
+
+        if ((rc = pfFileHandle->UnpinPage(pageNum))) {
+            delete[] recordData;
+            return rc;
+        }
+    }
+
+    delete[] recordData;
+    return OK;
+}
+
+//
+// HasZoneMap: 属性是否被区域映射跟踪
+//
+bool RM_FileHandle::HasZoneMap(int attrOffset) const {
+    if (zoneMap == NULL) {
+        return false;
+    }
+
+    const RM_ZoneMapHdr* zmHdr = (const RM_ZoneMapHdr*)zoneMap;
+    for (int i = 0; i < zmHdr->numAttrs; i++) {
+        if (zmHdr->attrs[i].attrOffset == attrOffset) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//
+// EstimateScanPages: 估算满足 "attr compOp value" 的扫描需要读取的数据页数
+// 属性没有区域映射时返回全部数据页数
+//
+RC RM_FileHandle::EstimateScanPages(AttrType attrType, int attrOffset,
+                                    CompOp compOp, void *value,
+                                    int &nPages) const {
+    // 检查文件是否打开
+    if (!bFileOpen) {
+        return RM_FILENOTOPEN;
+    }
+
+    nPages = 0;
+    for (PageNum pageNum = 1; pageNum < numPages; pageNum++) {
+        if (IsDataPage(pageNum) &&
+            PageMayMatch(pageNum, attrType, attrOffset, compOp, value)) {
+            nPages++;
+        }
+    }
+
+    return OK;
+}
+
+//
+// PageMayMatch: 根据区域映射判断页面上是否可能有满足条件的记录
+//
+bool RM_FileHandle::PageMayMatch(PageNum pageNum, AttrType attrType, int attrOffset,
+                                 CompOp compOp, void *value) const {
+    if (zoneMap == NULL || value == NULL || compOp == NO_OP) {
+        return true;
+    }
+
+    const RM_ZoneMapHdr* zmHdr = (const RM_ZoneMapHdr*)zoneMap;
+    for (int a = 0; a < zmHdr->numAttrs; a++) {
+        if (zmHdr->attrs[a].attrOffset != attrOffset ||
+            zmHdr->attrs[a].attrType != attrType) {
+            continue;
+        }
+
+        // 区号超出已使用的区，说明建立映射后该页从未插入过记录
+        int zoneNo = (pageNum - 1) / zmHdr->pagesPerZone;
+        if (zoneNo >= zmHdr->numZones) {
+            return false;
+        }
+
+        const RM_ZoneEntry* entry = RM_GetZoneEntries(zoneMap) + zoneNo * zmHdr->numAttrs + a;
+        return RM_ZoneMayMatch(entry, attrType, compOp, value);
+    }
+
+    return true;
+}
+
+//
+// WidenZoneMaps: 用记录中被跟踪属性的值扩展页面所在区的范围
+// 区数不够时把相邻两个区合并，每区页数翻倍
+//
+void RM_FileHandle::WidenZoneMaps(PageNum pageNum, const char *pData) {
+    if (zoneMap == NULL) {
+        return;
+    }
+
+    RM_ZoneMapHdr* zmHdr = (RM_ZoneMapHdr*)zoneMap;
+    int numAttrs = zmHdr->numAttrs;
+    if (numAttrs == 0) {
+        return;
+    }
+
+    RM_ZoneEntry* entries = RM_GetZoneEntries(zoneMap);
+    int maxZones = RM_ZM_MAX_ENTRIES / numAttrs;
+    int zoneNo = (pageNum - 1) / zmHdr->pagesPerZone;
+
+    while (zoneNo >= maxZones) {
+        int newZones = (zmHdr->numZones + 1) / 2;
+        for (int z = 0; z < newZones; z++) {
+            for (int a = 0; a < numAttrs; a++) {
+                RM_ZoneEntry merged = entries[(2 * z) * numAttrs + a];
+                if (2 * z + 1 < zmHdr->numZones) {
+                    RM_ZoneMerge(&merged, &entries[(2 * z + 1) * numAttrs + a],
+                                 zmHdr->attrs[a].attrType);
+                }
+                entries[z * numAttrs + a] = merged;
+            }
+        }
+        memset(entries + newZones * numAttrs, 0,
+               (zmHdr->numZones - newZones) * numAttrs * sizeof(RM_ZoneEntry));
+
+        zmHdr->numZones = newZones;
+        zmHdr->pagesPerZone *= 2;
+        zoneNo = (pageNum - 1) / zmHdr->pagesPerZone;
+    }
+
+    if (zoneNo >= zmHdr->numZones) {
+        zmHdr->numZones = zoneNo + 1;
+    }
+
+    for (int a = 0; a < numAttrs; a++) {
+        RM_ZoneWiden(&entries[zoneNo * numAttrs + a],
+                     pData + zmHdr->attrs[a].attrOffset,
+                     zmHdr->attrs[a].attrType);
+    }
+    bHdrChanged = true;
+}
+
+//
+// ResetZoneMaps: 页面变空时清除所在区
+// 只有每区一页时才能确定整个区为空，否则保留原范围
+//
+void RM_FileHandle::ResetZoneMaps(PageNum pageNum) {
+    if (zoneMap == NULL) {
+        return;
+    }
+
+    RM_ZoneMapHdr* zmHdr = (RM_ZoneMapHdr*)zoneMap;
+    if (zmHdr->numAttrs == 0 || zmHdr->pagesPerZone != 1) {
+        return;
+    }
+
+    int zoneNo = pageNum - 1;
+    if (zoneNo < zmHdr->numZones) {
+        memset(RM_GetZoneEntries(zoneMap) + zoneNo * zmHdr->numAttrs, 0,
+               zmHdr->numAttrs * sizeof(RM_ZoneEntry));
+        bHdrChanged = true;
+    }
+}
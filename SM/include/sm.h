@@ -7,6 +7,7 @@
 #include "../../IX/include/ix.h"
 #include <iostream>
 #include <fstream>
+#include <vector>
 
 // Forward declarations
 class PF_Manager;
@@ -35,6 +36,49 @@ struct DataAttrInfo {
     int      indexNo;               // 索引号 (-1表示无索引)
 };
 
+//
+// SM_IndexDesc: 关系上的一个索引
+// 单属性B+树索引记录在attrcat的indexNo中，组合索引、带INCLUDE列的索引和哈希索引记录在indexcat中，
+// 键由keyAttrs中的属性值按顺序拼接而成，includeAttrs的值作为附带数据存放在叶子条目中。
+// 部分索引（有preds）只包含满足全部条件的记录，也记录在indexcat中
+//
+#define SM_MAX_INCLUDE_ATTRS 4
+#define SM_MAX_INDEX_PREDS   4
+
+//
+// SM_IndexPred: 部分索引的一个条件 "属性 op 常量"
+// 调用CreateIndex时填attrName、常量的类型attrType、op和value，属性的其余信息由CreateIndex填入
+//
+struct SM_IndexPred {
+    DataAttrInfo attr;                      // 条件中的属性
+    CompOp op;                              // 比较操作符
+    char value[MAXSTRINGLEN+1];             // 常量（按属性的类型和长度存放）
+};
+
+struct SM_IndexDesc {
+    char indexName[MAXNAME+1];              // 索引名（单属性索引为属性名）
+    int indexNo;                            // 索引号
+    int keyCount;                           // 键包含的属性数
+    DataAttrInfo keyAttrs[IX_MAX_KEY_PARTS];  // 键包含的属性，按键中的顺序
+    int includeCount;                       // INCLUDE属性数
+    DataAttrInfo includeAttrs[SM_MAX_INCLUDE_ATTRS];  // INCLUDE属性，按附带数据中的顺序
+    int indexType;                          // 存取方法（IX_BTREE、IX_HASH或IX_BUFFERED）
+    int predCount;                          // 部分索引的条件数（0表示包含所有记录）
+    SM_IndexPred preds[SM_MAX_INDEX_PREDS]; // 部分索引的条件，全部满足的记录才加入索引
+    int bloomFilter;                        // 是否带Bloom过滤器
+    
+    int KeyLength() const;                              // 键的总长度
+    int IncludeLength() const;                          // 附带数据的总长度
+    void GetKeyDesc(IX_KeyDesc &keyDesc) const;         // 创建索引时的键组成
+    void BuildKey(const char *tuple, char *key) const;  // 从元组中取出键
+    void BuildPayload(const char *tuple, char *payload) const;  // 从元组中取出附带数据
+    bool IsCatalogued() const;                          // 是否登记在indexcat中
+    bool Covers(const char *attrName) const;            // 属性是否在键或附带数据中
+    bool IsPartial() const { return predCount > 0; }    // 是否为部分索引
+    bool Matches(const char *tuple) const;              // 元组是否满足部分索引的条件
+    bool PredicateUses(const char *attrName) const;     // 部分索引的条件是否用到属性
+};
+
 //
 // SM_Manager: 系统管理器类
 //
@@ -49,16 +93,34 @@ public:
     // DDL 命令
     RC CreateTable(const char *relName,                 // 创建表
                    int attrCount,
-                   AttrInfo *attributes);
+                   AttrInfo *attributes,
+                   RM_PageLayout layout = RM_LAYOUT_ROW);
     RC DropTable(const char *relName);                  // 删除表
     RC CreateIndex(const char *relName,                 // 创建索引
                    const char *attrName);
-    RC DropIndex(const char *relName,                   // 删除索引
+    RC CreateIndex(const char *relName,                 // 创建组合索引
+                   int attrCount,
+                   const char * const attrNames[],
+                   const char *indexName,
+                   int includeCount = 0,
+                   const char * const includeNames[] = NULL,
+                   IX_IndexType indexType = IX_BTREE,
+                   int predCount = 0,
+                   const SM_IndexPred preds[] = NULL,
+                   bool bBloomFilter = false);
+    RC DropIndex(const char *relName,                   // 删除索引（组合索引名或属性名）
                  const char *attrName);
+    RC CreateZoneMap(const char *relName,               // 建立区域映射
+                     const char *attrName);
     
     // 系统工具命令
     RC Load(const char *relName,                        // 加载数据
             const char *fileName);
+    RC Vacuum(const char *relName,                      // 压缩关系文件并更新索引
+              int &nMoved, int &nFreedPages);
+    RC Reindex(const char *relName,                     // 重建索引（indexName为NULL时重建所有索引）
+               const char *indexName, int &nRebuilt);
+    RC ShowIndexStats(const char *relName);             // 显示索引的运行统计（relName为NULL时显示所有关系）
     RC Help();                                          // 显示所有关系
     RC Help(const char *relName);                       // 显示关系信息
     RC Print(const char *relName);                      // 打印关系内容
@@ -68,11 +130,15 @@ public:
     // 系统目录初始化（公共方法，用于dbcreate）
     RC SetupRelcat();                                   // 设置relcat表
     RC SetupAttrcat();                                  // 设置attrcat表
+    RC SetupIndexcat();                                 // 设置indexcat表
 
 
     // 查询接口（供QL层使用）
     RC GetRelInfo(const char *relName, DataAttrInfo *&attributes, int &attrCount);
     RC GetAttrInfo(const char *relName, const char *attrName, DataAttrInfo &attr);
+    RC GetIndexes(const char *relName, std::vector<SM_IndexDesc> &indexes);  // 关系上的所有索引
+    RC GetIndexStats(const char *relName, const SM_IndexDesc &index,         // 索引的运行统计
+                     IX_IndexStats &stats);
 
 private:
     // 私有成员变量
@@ -84,6 +150,7 @@ private:
     // 系统目录文件句柄
     RM_FileHandle relcatFH;                             // relcat文件句柄
     RM_FileHandle attrcatFH;                            // attrcat文件句柄
+    RM_FileHandle indexcatFH;                           // indexcat文件句柄
     
     bool bDbOpen;                                       // 数据库是否打开
     char dbName[MAXNAME+1];                            // 当前数据库名
@@ -96,6 +163,18 @@ private:
     RC DeleteFromRelcat(const char *relName);
     RC DeleteFromAttrcat(const char *relName);
     RC UpdateAttrIndexNo(const char *relName, const char *attrName, int indexNo);
+    RC InsertIntoIndexcat(const SM_IndexDesc &index);
+    RC DeleteFromIndexcat(const char *relName, const char *indexName);  // indexName为NULL时删除关系的所有组合索引
+    RC AdjustIndexCount(const char *relName, int delta); // 修改relcat中的索引计数
+    
+    // 目录版本
+    RC ReadCatalogVersion(int &version);                // 读取目录版本号（没有版本文件时为0）
+    RC WriteCatalogVersion();                           // 写入当前的目录版本号
+    RC UpgradeCatalog();                                // 把旧版本的目录升级为当前版本
+    
+    // 索引
+    RC NextIndexNo(const char *relName, int &indexNo);  // 关系上未使用的索引号
+    RC BuildIndex(const char *relName, const SM_IndexDesc &index);  // 创建索引文件并批量加入现有记录
     
     // 辅助计算方法
     int CalculateOffset(AttrInfo *attributes, int attrNum);
@@ -158,6 +237,8 @@ void SM_PrintError(RC rc);
 #define SM_INVALIDDB           (START_SM_ERR - 6)    // 无效数据库
 #define SM_SYSTEMCATALOG       (START_SM_ERR - 7)    // 不能操作系统目录
 #define SM_BADFILENAME         (START_SM_ERR - 8)    // 无效文件名
-#define SM_LASTERROR           SM_BADFILENAME
+#define SM_BADINDEXNAME        (START_SM_ERR - 9)    // 索引名与属性名冲突
+#define SM_BADCATALOG          (START_SM_ERR - 10)   // 不支持的目录版本
+#define SM_LASTERROR           SM_BADCATALOG
 
 #endif // SM_H
\ No newline at end of file
@@ -6,6 +6,13 @@
 // 系统目录表名
 #define RELCAT_RELNAME    "relcat"
 #define ATTRCAT_RELNAME   "attrcat"
+#define INDEXCAT_RELNAME  "indexcat"
+
+// 目录版本：版本号保存在数据库目录下的版本文件中。
+// 加入版本号之前创建的数据库没有版本文件，按版本0处理，打开时升级。
+// indexcat的记录格式改变时增加版本号
+#define SM_CATALOG_VERSION    1
+#define SM_VERSION_FILENAME   "catversion"
 
 // 使用packed属性确保结构体没有填充
 #pragma pack(push, 1)
@@ -28,6 +35,23 @@ struct AttrcatRecord {
     int indexNo;                    // 索引号 (-1表示无索引)
 };
 
+// indexcat 表的结构（组合索引、带INCLUDE属性的索引和哈希索引，单属性B+树索引记录在attrcat的indexNo中）
+struct IndexcatRecord {
+    char relName[MAXNAME+1];        // 关系名
+    char indexName[MAXNAME+1];      // 索引名
+    int indexNo;                    // 索引号
+    int keyCount;                   // 键包含的属性数
+    char keyAttrs[IX_MAX_KEY_PARTS][MAXNAME+1];  // 键包含的属性名，按键中的顺序
+    int includeCount;               // INCLUDE属性数
+    char includeAttrs[SM_MAX_INCLUDE_ATTRS][MAXNAME+1];  // INCLUDE属性名
+    int indexType;                  // 存取方法（IX_BTREE、IX_HASH或IX_BUFFERED）
+    int predCount;                  // 部分索引的条件数
+    char predAttrs[SM_MAX_INDEX_PREDS][MAXNAME+1];      // 条件中的属性名
+    int predOps[SM_MAX_INDEX_PREDS];                    // 条件的比较操作符
+    char predValues[SM_MAX_INDEX_PREDS][MAXSTRINGLEN+1];  // 条件中的常量
+    int bloomFilter;                // 是否带Bloom过滤器
+};
+
 #pragma pack(pop)
 
 // relcat 表的属性偏移量
@@ -46,6 +70,23 @@ struct AttrcatRecord {
 #define ATTRCAT_INDEXNO_OFFSET   (ATTRCAT_ATTRLENGTH_OFFSET + sizeof(int))
 #define ATTRCAT_RECORD_SIZE      (ATTRCAT_INDEXNO_OFFSET + sizeof(int))
 
+// indexcat 表的属性偏移量
+#define INDEXCAT_RELNAME_OFFSET   0
+#define INDEXCAT_INDEXNAME_OFFSET (INDEXCAT_RELNAME_OFFSET + MAXNAME + 1)
+#define INDEXCAT_INDEXNO_OFFSET   (INDEXCAT_INDEXNAME_OFFSET + MAXNAME + 1)
+#define INDEXCAT_KEYCOUNT_OFFSET  (INDEXCAT_INDEXNO_OFFSET + sizeof(int))
+#define INDEXCAT_KEYATTRS_OFFSET  (INDEXCAT_KEYCOUNT_OFFSET + sizeof(int))
+#define INDEXCAT_INCLUDECOUNT_OFFSET (INDEXCAT_KEYATTRS_OFFSET + IX_MAX_KEY_PARTS * (MAXNAME + 1))
+#define INDEXCAT_INCLUDEATTRS_OFFSET (INDEXCAT_INCLUDECOUNT_OFFSET + sizeof(int))
+#define INDEXCAT_INDEXTYPE_OFFSET (INDEXCAT_INCLUDEATTRS_OFFSET + SM_MAX_INCLUDE_ATTRS * (MAXNAME + 1))
+#define INDEXCAT_PREDCOUNT_OFFSET (INDEXCAT_INDEXTYPE_OFFSET + sizeof(int))
+#define INDEXCAT_PREDATTRS_OFFSET (INDEXCAT_PREDCOUNT_OFFSET + sizeof(int))
+#define INDEXCAT_PREDOPS_OFFSET   (INDEXCAT_PREDATTRS_OFFSET + SM_MAX_INDEX_PREDS * (MAXNAME + 1))
+#define INDEXCAT_PREDVALUES_OFFSET (INDEXCAT_PREDOPS_OFFSET + SM_MAX_INDEX_PREDS * sizeof(int))
+#define INDEXCAT_BLOOMFILTER_OFFSET (INDEXCAT_PREDVALUES_OFFSET + SM_MAX_INDEX_PREDS * (MAXSTRINGLEN + 1))
+#define INDEXCAT_RECORD_SIZE      (INDEXCAT_BLOOMFILTER_OFFSET + sizeof(int))
+#define INDEXCAT_ATTR_COUNT       (8 + IX_MAX_KEY_PARTS + SM_MAX_INCLUDE_ATTRS + 3 * SM_MAX_INDEX_PREDS)
+
 // 工具函数声明
 bool IsValidName(const char *name);
 bool IsSystemCatalog(const char *relName);
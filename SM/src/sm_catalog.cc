@@ -1,6 +1,13 @@
 #include "../include/sm.h"
 #include "../internal/sm_internal.h"
 #include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using namespace std;
 
 //
 // 设置relcat表
@@ -152,3 +159,286 @@ RC SM_Manager::SetupAttrcat() {
     
     return OK;
 }
+
+//
+// 设置indexcat表（组合索引目录）
+//
+RC SM_Manager::SetupIndexcat() {
+    RC rc;
+    
+    // 创建indexcat文件
+    if ((rc = rmManager->CreateFile(INDEXCAT_RELNAME, INDEXCAT_RECORD_SIZE))) {
+        return rc;
+    }
+    
+    if ((rc = rmManager->OpenFile(INDEXCAT_RELNAME, indexcatFH))) {
+        rmManager->DestroyFile(INDEXCAT_RELNAME);
+        return rc;
+    }
+    
+    // 需要重新打开relcat和attrcat文件以便登记indexcat本身
+    if ((rc = rmManager->OpenFile(RELCAT_RELNAME, relcatFH))) {
+        rmManager->CloseFile(indexcatFH);
+        rmManager->DestroyFile(INDEXCAT_RELNAME);
+        return rc;
+    }
+    
+    if ((rc = rmManager->OpenFile(ATTRCAT_RELNAME, attrcatFH))) {
+        rmManager->CloseFile(relcatFH);
+        rmManager->CloseFile(indexcatFH);
+        rmManager->DestroyFile(INDEXCAT_RELNAME);
+        return rc;
+    }
+    
+    // 为indexcat本身插入记录
+    if ((rc = InsertIntoRelcat(INDEXCAT_RELNAME, INDEXCAT_RECORD_SIZE, INDEXCAT_ATTR_COUNT, 0)) ||
+        (rc = InsertIntoAttrcat(INDEXCAT_RELNAME, "relName",
+                                INDEXCAT_RELNAME_OFFSET, STRING, MAXNAME+1, -1)) ||
+        (rc = InsertIntoAttrcat(INDEXCAT_RELNAME, "indexName",
+                                INDEXCAT_INDEXNAME_OFFSET, STRING, MAXNAME+1, -1)) ||
+        (rc = InsertIntoAttrcat(INDEXCAT_RELNAME, "indexNo",
+                                INDEXCAT_INDEXNO_OFFSET, INT, sizeof(int), -1)) ||
+        (rc = InsertIntoAttrcat(INDEXCAT_RELNAME, "keyCount",
+                                INDEXCAT_KEYCOUNT_OFFSET, INT, sizeof(int), -1))) {
+        rmManager->CloseFile(attrcatFH);
+        rmManager->CloseFile(relcatFH);
+        rmManager->CloseFile(indexcatFH);
+        return rc;
+    }
+    
+    for (int i = 0; i < IX_MAX_KEY_PARTS; i++) {
+        char attrName[MAXNAME+1];
+        sprintf(attrName, "keyAttr%d", i + 1);
+        if ((rc = InsertIntoAttrcat(INDEXCAT_RELNAME, attrName,
+                                    INDEXCAT_KEYATTRS_OFFSET + i * (MAXNAME + 1),
+                                    STRING, MAXNAME+1, -1))) {
+            rmManager->CloseFile(attrcatFH);
+            rmManager->CloseFile(relcatFH);
+            rmManager->CloseFile(indexcatFH);
+            return rc;
+        }
+    }
+    
+    if ((rc = InsertIntoAttrcat(INDEXCAT_RELNAME, "includeCount",
+                                INDEXCAT_INCLUDECOUNT_OFFSET, INT, sizeof(int), -1))) {
+        rmManager->CloseFile(attrcatFH);
+        rmManager->CloseFile(relcatFH);
+        rmManager->CloseFile(indexcatFH);
+        return rc;
+    }
+    
+    for (int i = 0; i < SM_MAX_INCLUDE_ATTRS; i++) {
+        char attrName[MAXNAME+1];
+        sprintf(attrName, "includeAttr%d", i + 1);
+        if ((rc = InsertIntoAttrcat(INDEXCAT_RELNAME, attrName,
+                                    INDEXCAT_INCLUDEATTRS_OFFSET + i * (MAXNAME + 1),
+                                    STRING, MAXNAME+1, -1))) {
+            rmManager->CloseFile(attrcatFH);
+            rmManager->CloseFile(relcatFH);
+            rmManager->CloseFile(indexcatFH);
+            return rc;
+        }
+    }
+    
+    if ((rc = InsertIntoAttrcat(INDEXCAT_RELNAME, "indexType",
+                                INDEXCAT_INDEXTYPE_OFFSET, INT, sizeof(int), -1)) ||
+        (rc = InsertIntoAttrcat(INDEXCAT_RELNAME, "predCount",
+                                INDEXCAT_PREDCOUNT_OFFSET, INT, sizeof(int), -1))) {
+        rmManager->CloseFile(attrcatFH);
+        rmManager->CloseFile(relcatFH);
+        rmManager->CloseFile(indexcatFH);
+        return rc;
+    }
+    
+    for (int i = 0; i < SM_MAX_INDEX_PREDS; i++) {
+        char attrName[MAXNAME+1], opName[MAXNAME+1], valueName[MAXNAME+1];
+        sprintf(attrName, "predAttr%d", i + 1);
+        sprintf(opName, "predOp%d", i + 1);
+        sprintf(valueName, "predValue%d", i + 1);
+        if ((rc = InsertIntoAttrcat(INDEXCAT_RELNAME, attrName,
+                                    INDEXCAT_PREDATTRS_OFFSET + i * (MAXNAME + 1),
+                                    STRING, MAXNAME+1, -1)) ||
+            (rc = InsertIntoAttrcat(INDEXCAT_RELNAME, opName,
+                                    INDEXCAT_PREDOPS_OFFSET + i * sizeof(int),
+                                    INT, sizeof(int), -1)) ||
+            (rc = InsertIntoAttrcat(INDEXCAT_RELNAME, valueName,
+                                    INDEXCAT_PREDVALUES_OFFSET + i * (MAXSTRINGLEN + 1),
+                                    STRING, MAXSTRINGLEN+1, -1))) {
+            rmManager->CloseFile(attrcatFH);
+            rmManager->CloseFile(relcatFH);
+            rmManager->CloseFile(indexcatFH);
+            return rc;
+        }
+    }
+    
+    if ((rc = InsertIntoAttrcat(INDEXCAT_RELNAME, "bloomFilter",
+                                INDEXCAT_BLOOMFILTER_OFFSET, INT, sizeof(int), -1))) {
+        rmManager->CloseFile(attrcatFH);
+        rmManager->CloseFile(relcatFH);
+        rmManager->CloseFile(indexcatFH);
+        return rc;
+    }
+    
+    // 强制刷新到磁盘，然后关闭三个文件
+    relcatFH.ForcePages();
+    attrcatFH.ForcePages();
+    indexcatFH.ForcePages();
+    rmManager->CloseFile(attrcatFH);
+    rmManager->CloseFile(relcatFH);
+    rmManager->CloseFile(indexcatFH);
+    
+    return OK;
+}
+
+//
+// ReadCatalogVersion: 读取目录版本号
+// 没有版本文件的数据库（加入版本号之前创建的）为版本0，版本文件无法解析时返回SM_BADCATALOG
+//
+RC SM_Manager::ReadCatalogVersion(int &version) {
+    FILE *file = fopen(SM_VERSION_FILENAME, "r");
+    if (file == NULL) {
+        version = 0;
+        return OK;
+    }
+    
+    int n = fscanf(file, "%d", &version);
+    fclose(file);
+    return (n == 1 && version > 0) ? OK : SM_BADCATALOG;
+}
+
+//
+// WriteCatalogVersion: 写入当前的目录版本号
+//
+RC SM_Manager::WriteCatalogVersion() {
+    FILE *file = fopen(SM_VERSION_FILENAME, "w");
+    if (file == NULL) {
+        return SM_INVALIDDB;
+    }
+    
+    fprintf(file, "%d\n", SM_CATALOG_VERSION);
+    return (fclose(file) == 0) ? OK : SM_INVALIDDB;
+}
+
+//
+// UpgradeCatalog: 把旧版本的目录升级为当前版本，在打开系统目录文件之前调用
+// 没有indexcat的数据库（建立组合索引之前创建的）补建indexcat。
+// indexcat的记录格式与当前不同时，按attrcat中登记的旧格式读出所有记录，
+// 重建indexcat后按属性名把各字段复制到新格式中，旧格式中没有的字段为0
+// （存取方法为IX_BTREE、没有部分索引的条件、没有Bloom过滤器）。
+// 全部完成后才写入版本文件
+//
+RC SM_Manager::UpgradeCatalog() {
+    RC rc;
+    
+    if (access(INDEXCAT_RELNAME, F_OK) != 0) {
+        if ((rc = SetupIndexcat())) {
+            return rc;
+        }
+        return WriteCatalogVersion();
+    }
+    
+    // 读出indexcat的旧格式
+    if ((rc = rmManager->OpenFile(RELCAT_RELNAME, relcatFH))) {
+        return rc;
+    }
+    if ((rc = rmManager->OpenFile(ATTRCAT_RELNAME, attrcatFH))) {
+        rmManager->CloseFile(relcatFH);
+        return rc;
+    }
+    
+    DataAttrInfo *oldAttrs;
+    int oldAttrCount;
+    if ((rc = GetRelInfo(INDEXCAT_RELNAME, oldAttrs, oldAttrCount))) {
+        rmManager->CloseFile(attrcatFH);
+        rmManager->CloseFile(relcatFH);
+        return rc;
+    }
+    
+    int oldLength = 0;
+    for (int i = 0; i < oldAttrCount; i++) {
+        oldLength += oldAttrs[i].attrLength;
+    }
+    if (oldAttrCount == INDEXCAT_ATTR_COUNT && oldLength == (int)INDEXCAT_RECORD_SIZE) {
+        delete[] oldAttrs;
+        rmManager->CloseFile(attrcatFH);
+        rmManager->CloseFile(relcatFH);
+        return WriteCatalogVersion();
+    }
+    
+    // 读出所有旧记录，然后删除旧的indexcat
+    vector<string> oldRecords;
+    if ((rc = rmManager->OpenFile(INDEXCAT_RELNAME, indexcatFH)) == OK) {
+        RM_FileScan indexScan;
+        if ((rc = indexScan.OpenScan(indexcatFH, INT, sizeof(int), 0, NO_OP, NULL)) == OK) {
+            RM_Record record;
+            char *data;
+            while ((rc = indexScan.GetNextRec(record)) == OK) {
+                record.GetData(data);
+                oldRecords.push_back(string(data, oldLength));
+            }
+            indexScan.CloseScan();
+            if (rc == RM_EOF) {
+                rc = OK;
+            }
+        }
+        rmManager->CloseFile(indexcatFH);
+    }
+    if (rc == OK) {
+        if ((rc = DeleteFromRelcat(INDEXCAT_RELNAME)) == OK) {
+            rc = DeleteFromAttrcat(INDEXCAT_RELNAME);
+        }
+        relcatFH.ForcePages();
+        attrcatFH.ForcePages();
+    }
+    rmManager->CloseFile(attrcatFH);
+    rmManager->CloseFile(relcatFH);
+    if (rc || (rc = rmManager->DestroyFile(INDEXCAT_RELNAME)) || (rc = SetupIndexcat())) {
+        delete[] oldAttrs;
+        return rc;
+    }
+    
+    // 按属性名把旧记录的字段复制到新格式中，当前格式中没有的字段丢弃
+    DataAttrInfo *newAttrs = NULL;
+    int newAttrCount;
+    if ((rc = rmManager->OpenFile(RELCAT_RELNAME, relcatFH)) == OK) {
+        if ((rc = rmManager->OpenFile(ATTRCAT_RELNAME, attrcatFH)) == OK) {
+            rc = GetRelInfo(INDEXCAT_RELNAME, newAttrs, newAttrCount);
+            rmManager->CloseFile(attrcatFH);
+        }
+        rmManager->CloseFile(relcatFH);
+    }
+    if (rc || (rc = rmManager->OpenFile(INDEXCAT_RELNAME, indexcatFH))) {
+        delete[] oldAttrs;
+        delete[] newAttrs;
+        return rc;
+    }
+    
+    char newRecord[INDEXCAT_RECORD_SIZE];
+    for (const string &oldRecord : oldRecords) {
+        memset(newRecord, 0, sizeof(newRecord));
+        for (int i = 0; i < newAttrCount; i++) {
+            for (int j = 0; j < oldAttrCount; j++) {
+                if (strcmp(newAttrs[i].attrName, oldAttrs[j].attrName) == 0) {
+                    memcpy(newRecord + newAttrs[i].offset, oldRecord.data() + oldAttrs[j].offset,
+                           min(newAttrs[i].attrLength, oldAttrs[j].attrLength));
+                    break;
+                }
+            }
+        }
+        
+        RID rid;
+        if ((rc = indexcatFH.InsertRec(newRecord, rid))) {
+            break;
+        }
+    }
+    delete[] oldAttrs;
+    delete[] newAttrs;
+    
+    indexcatFH.ForcePages();
+    RC closeRC = rmManager->CloseFile(indexcatFH);
+    if (rc || (rc = closeRC)) {
+        return rc;
+    }
+    
+    return WriteCatalogVersion();
+}
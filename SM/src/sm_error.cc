@@ -57,6 +57,12 @@ void SM_PrintError(RC rc) {
         case SM_BADFILENAME:
             cerr << "SM Error: Invalid file name" << endl;
             break;
+        case SM_BADINDEXNAME:
+            cerr << "SM Error: Index name conflicts with an attribute name" << endl;
+            break;
+        case SM_BADCATALOG:
+            cerr << "SM Error: Unsupported catalog version" << endl;
+            break;
             
         default:
             if (rc > 0) {
@@ -40,7 +40,8 @@ bool IsValidName(const char *name) {
 //
 bool IsSystemCatalog(const char *relName) {
     return (strcmp(relName, RELCAT_RELNAME) == 0 || 
-            strcmp(relName, ATTRCAT_RELNAME) == 0);
+            strcmp(relName, ATTRCAT_RELNAME) == 0 ||
+            strcmp(relName, INDEXCAT_RELNAME) == 0);
 }
 
 //
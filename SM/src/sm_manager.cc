@@ -48,6 +48,18 @@ RC SM_Manager::OpenDb(const char *dbName) {
         return SM_INVALIDDB;
     }
     
+    // 检查目录版本，旧版本的目录先升级，比当前版本新的目录不能打开
+    int version;
+    if ((rc = ReadCatalogVersion(version))) {
+        return rc;
+    }
+    if (version > SM_CATALOG_VERSION) {
+        return SM_BADCATALOG;
+    }
+    if (version < SM_CATALOG_VERSION && (rc = UpgradeCatalog())) {
+        return rc;
+    }
+    
     // 打开系统目录文件
     if ((rc = rmManager->OpenFile(RELCAT_RELNAME, relcatFH))) {
         return rc;
@@ -58,6 +70,12 @@ RC SM_Manager::OpenDb(const char *dbName) {
         return rc;
     }
     
+    if ((rc = rmManager->OpenFile(INDEXCAT_RELNAME, indexcatFH))) {
+        rmManager->CloseFile(attrcatFH);
+        rmManager->CloseFile(relcatFH);
+        return rc;
+    }
+    
     // 记录状态
     strcpy(this->dbName, dbName);
     bDbOpen = true;
@@ -84,6 +102,10 @@ RC SM_Manager::CloseDb() {
         rc = tmp;
     }
     
+    if ((tmp = rmManager->CloseFile(indexcatFH))) {
+        rc = tmp;
+    }
+    
     bDbOpen = false;
     dbName[0] = '\0';
     
@@ -103,7 +125,8 @@ RC SM_Manager::CloseDb() {
 // 7. 插入attrcat记录
 // 8. 强制写入目录文件
 // 
-RC SM_Manager::CreateTable(const char *relName, int attrCount, AttrInfo *attributes) {
+RC SM_Manager::CreateTable(const char *relName, int attrCount, AttrInfo *attributes,
+                           RM_PageLayout layout) {
     RC rc;
     
     // 参数检查
@@ -179,8 +202,15 @@ RC SM_Manager::CreateTable(const char *relName, int attrCount, AttrInfo *attribu
     // 计算元组长度和偏移量
     int tupleLength = CalculateTupleLength(attributes, attrCount);
     
-    // 创建关系文件
-    if ((rc = rmManager->CreateFile(relName, tupleLength))) {
+    // 创建关系文件，PAX布局按属性长度划分minipage，SLOTTED布局按类型压缩STRING属性
+    int attrLengths[MAXATTRS];
+    AttrType attrTypes[MAXATTRS];
+    for (int i = 0; i < attrCount; i++) {
+        attrLengths[i] = attributes[i].attrLength;
+        attrTypes[i] = attributes[i].attrType;
+    }
+    if ((rc = rmManager->CreateFile(relName, tupleLength, layout, attrCount,
+                                    attrLengths, attrTypes))) {
         return rc;
     }
     
@@ -235,10 +265,11 @@ RC SM_Manager::DropTable(const char *relName) {
         return rc;
     }
     
-    // 删除所有索引
-    for (int i = 0; i < attrCount; i++) {
-        if (attributes[i].indexNo != -1) {
-            ixManager->DestroyIndex(relName, attributes[i].indexNo);
+    // 删除所有索引（包括组合索引）
+    vector<SM_IndexDesc> indexes;
+    if (GetIndexes(relName, indexes) == OK) {
+        for (const SM_IndexDesc &index : indexes) {
+            ixManager->DestroyIndex(relName, index.indexNo);
         }
     }
     
@@ -251,10 +282,12 @@ RC SM_Manager::DropTable(const char *relName) {
     // 从目录中删除记录
     DeleteFromRelcat(relName);
     DeleteFromAttrcat(relName);
+    DeleteFromIndexcat(relName, NULL);
     
     // 强制写入目录文件
     relcatFH.ForcePages();
     attrcatFH.ForcePages();
+    indexcatFH.ForcePages();
     
     delete[] attributes;
     return OK;
@@ -283,7 +316,8 @@ RC SM_Manager::CreateIndex(const char *relName, const char *attrName) {
     }
     
     // 获取属性信息
-    DataAttrInfo attr;
+    SM_IndexDesc index;
+    DataAttrInfo &attr = index.keyAttrs[0];
     if ((rc = GetAttrInfo(relName, attrName, attr))) {
         return rc;
     }
@@ -293,122 +327,198 @@ RC SM_Manager::CreateIndex(const char *relName, const char *attrName) {
         return SM_DUPLICATEINDEX;
     }
     
-    // 分配索引号（简单递增）
-    int indexNo = 0;
-    DataAttrInfo *attributes;
-    int attrCount;
-    if ((rc = GetRelInfo(relName, attributes, attrCount))) {
+    // 分配索引号，创建索引并加入现有记录
+    strcpy(index.indexName, attrName);
+    index.keyCount = 1;
+    index.includeCount = 0;
+    index.indexType = IX_BTREE;
+    index.predCount = 0;
+    index.bloomFilter = 0;
+    if ((rc = NextIndexNo(relName, index.indexNo)) ||
+        (rc = BuildIndex(relName, index))) {
         return rc;
     }
     
-    for (int i = 0; i < attrCount; i++) {
-        if (attributes[i].indexNo >= indexNo) {
-            indexNo = attributes[i].indexNo + 1;
-        }
+    // 更新目录中的索引信息
+    if ((rc = UpdateAttrIndexNo(relName, attrName, index.indexNo))) {
+        ixManager->DestroyIndex(relName, index.indexNo);
+        return rc;
     }
     
-    // 创建索引文件
-    if ((rc = ixManager->CreateIndex(relName, indexNo, attr.attrType, attr.attrLength))) {
-        delete[] attributes;
+    // 更新关系的索引计数
+    if ((rc = AdjustIndexCount(relName, 1))) {
         return rc;
     }
     
-    // 打开索引和关系文件
-    IX_IndexHandle indexHandle;
-    RM_FileHandle fileHandle;
+    // 强制写入
+    relcatFH.ForcePages();
+    attrcatFH.ForcePages();
     
-    if ((rc = ixManager->OpenIndex(relName, indexNo, indexHandle))) {
-        ixManager->DestroyIndex(relName, indexNo);
-        delete[] attributes;
-        return rc;
+    return OK;
+}
+
+//
+// 创建组合索引
+// 键由attrNames中的属性按顺序拼接而成，按字典序比较，索引登记在indexcat中。
+// includeNames中的属性不参与比较，其值作为附带数据存放在叶子条目中，
+// 查询只用到键和INCLUDE属性时不必再读取记录。
+// indexType为IX_HASH时建立哈希索引，只用于键的全部属性上都有等值条件的查询，不能有INCLUDE属性；
+// IX_BUFFERED时建立带写缓冲的B+树，用法与B+树相同。
+// preds不为空时建立部分索引，只加入满足全部条件的记录，查询的条件蕴含这些条件时才使用。
+// bBloomFilter为true时索引带键值的Bloom过滤器，等值查找不存在的键值时不读索引页。
+// 只有一个属性、没有INCLUDE属性的B+树索引与CreateIndex(relName, attrName)相同
+//
+RC SM_Manager::CreateIndex(const char *relName, int attrCount,
+                           const char * const attrNames[], const char *indexName,
+                           int includeCount, const char * const includeNames[],
+                           IX_IndexType indexType, int predCount, const SM_IndexPred preds[],
+                           bool bBloomFilter) {
+    RC rc;
+    
+    if (attrCount == 1 && attrNames != NULL && includeCount == 0 && indexType == IX_BTREE &&
+        predCount == 0 && !bBloomFilter) {
+        return CreateIndex(relName, attrNames[0]);
     }
     
-    if ((rc = rmManager->OpenFile(relName, fileHandle))) {
-        ixManager->CloseIndex(indexHandle);
-        ixManager->DestroyIndex(relName, indexNo);
-        delete[] attributes;
-        return rc;
+    if (!bDbOpen) {
+        return SM_DBNOTOPEN;
     }
     
-    // 扫描关系，为现有记录建立索引
-    RM_FileScan fileScan;
-    if ((rc = fileScan.OpenScan(fileHandle, INT, sizeof(int), 0, NO_OP, NULL))) {
-        rmManager->CloseFile(fileHandle);
-        ixManager->CloseIndex(indexHandle);
-        ixManager->DestroyIndex(relName, indexNo);
-        delete[] attributes;
-        return rc;
+    if (relName == NULL || !IsValidName(relName)) {
+        return SM_BADRELNAME;
     }
     
-    RM_Record record;
-    while ((rc = fileScan.GetNextRec(record)) != RM_EOF) {
-        if (rc) {
-            break;
+    if (indexName == NULL || !IsValidName(indexName)) {
+        return SM_BADATTRNAME;
+    }
+    
+    if (IsSystemCatalog(relName)) {
+        return SM_SYSTEMCATALOG;
+    }
+    
+    if (attrCount < 1 || attrCount > IX_MAX_KEY_PARTS || attrNames == NULL ||
+        includeCount < 0 || includeCount > SM_MAX_INCLUDE_ATTRS ||
+        (includeCount > 0 && includeNames == NULL) ||
+        predCount < 0 || predCount > SM_MAX_INDEX_PREDS || (predCount > 0 && preds == NULL)) {
+        return SM_TOOMANYATTRS;
+    }
+    if (indexType != IX_BTREE && indexType != IX_BUFFERED &&
+        (indexType != IX_HASH || includeCount > 0)) {
+        return SM_BADATTRTYPE;
+    }
+    
+    // 获取键属性和INCLUDE属性的信息，同一属性不能出现两次
+    SM_IndexDesc index;
+    strcpy(index.indexName, indexName);
+    index.keyCount = attrCount;
+    index.includeCount = includeCount;
+    index.indexType = indexType;
+    index.predCount = predCount;
+    index.bloomFilter = bBloomFilter ? 1 : 0;
+    for (int i = 0; i < attrCount + includeCount; i++) {
+        const char *name = (i < attrCount) ? attrNames[i] : includeNames[i - attrCount];
+        DataAttrInfo &attr = (i < attrCount) ? index.keyAttrs[i]
+                                             : index.includeAttrs[i - attrCount];
+        if (name == NULL || !IsValidName(name)) {
+            return SM_BADATTRNAME;
         }
-        
-        char *data;
-        RID rid;
-        record.GetData(data);
-        record.GetRid(rid);
-        
-        // 插入索引条目
-        void *keyValue = (void*)(data + attr.offset);
-        if ((rc = indexHandle.InsertEntry(keyValue, rid))) {
-            break;
+        if ((rc = GetAttrInfo(relName, name, attr))) {
+            return rc;
+        }
+        for (int j = 0; j < i; j++) {
+            const char *prev = (j < attrCount) ? attrNames[j] : includeNames[j - attrCount];
+            if (strcmp(name, prev) == 0) {
+                return SM_DUPLICATEATTR;
+            }
         }
     }
     
-    fileScan.CloseScan();
-    rmManager->CloseFile(fileHandle);
-    ixManager->CloseIndex(indexHandle);
+    // 部分索引的条件：常量的类型与属性相同，按属性的长度存放
+    for (int i = 0; i < predCount; i++) {
+        SM_IndexPred &pred = index.preds[i];
+        if (!IsValidName(preds[i].attr.attrName)) {
+            return SM_BADATTRNAME;
+        }
+        if ((rc = GetAttrInfo(relName, preds[i].attr.attrName, pred.attr))) {
+            return rc;
+        }
+        if (pred.attr.attrType != preds[i].attr.attrType ||
+            preds[i].op == NO_OP || preds[i].op > NE_OP) {
+            return SM_BADATTRTYPE;
+        }
+        pred.op = preds[i].op;
+        memset(pred.value, 0, sizeof(pred.value));
+        if (pred.attr.attrType == STRING) {
+            strncpy(pred.value, preds[i].value, pred.attr.attrLength);
+        } else {
+            memcpy(pred.value, preds[i].value, pred.attr.attrLength);
+        }
+    }
     
-    if (rc != RM_EOF && rc != OK) {
-        ixManager->DestroyIndex(relName, indexNo);
-        delete[] attributes;
+    // 单属性索引以属性名为名字，组合索引的名字不能与关系的任何属性名相同，
+    // 否则DROP INDEX和REINDEX无法区分两者
+    DataAttrInfo nameAttr;
+    if ((rc = GetAttrInfo(relName, indexName, nameAttr)) == OK) {
+        return SM_BADINDEXNAME;
+    }
+    if (rc != SM_ATTRNOTFOUND) {
         return rc;
     }
     
-    // 更新目录中的索引信息
-    if ((rc = UpdateAttrIndexNo(relName, attrName, indexNo))) {
-        ixManager->DestroyIndex(relName, indexNo);
-        delete[] attributes;
+    // 名字相同，或存取方法、键属性和INCLUDE属性完全相同的索引已经存在
+    vector<SM_IndexDesc> indexes;
+    if ((rc = GetIndexes(relName, indexes))) {
         return rc;
     }
+    for (const SM_IndexDesc &other : indexes) {
+        if (!other.IsCatalogued()) {
+            continue;
+        }
+        bool sameKey = (other.keyCount == attrCount && other.includeCount == includeCount &&
+                        other.indexType == indexType);
+        for (int i = 0; sameKey && i < attrCount; i++) {
+            sameKey = (strcmp(other.keyAttrs[i].attrName, attrNames[i]) == 0);
+        }
+        for (int i = 0; sameKey && i < includeCount; i++) {
+            sameKey = (strcmp(other.includeAttrs[i].attrName, includeNames[i]) == 0);
+        }
+        sameKey = sameKey && (other.predCount == predCount);
+        for (int i = 0; sameKey && i < predCount; i++) {
+            sameKey = (strcmp(other.preds[i].attr.attrName, index.preds[i].attr.attrName) == 0 &&
+                       other.preds[i].op == index.preds[i].op &&
+                       memcmp(other.preds[i].value, index.preds[i].value,
+                              index.preds[i].attr.attrLength) == 0);
+        }
+        if (sameKey || strcmp(other.indexName, indexName) == 0) {
+            return SM_DUPLICATEINDEX;
+        }
+    }
     
-    // 更新关系的索引计数
-    RM_FileScan relScan;
-    RM_Record relRec;
-    if ((rc = relScan.OpenScan(relcatFH, STRING, MAXNAME+1, RELCAT_RELNAME_OFFSET,
-                              EQ_OP, (void*)relName))) {
-        delete[] attributes;
+    // 分配索引号，创建索引并加入现有记录
+    if ((rc = NextIndexNo(relName, index.indexNo)) ||
+        (rc = BuildIndex(relName, index))) {
         return rc;
     }
     
-    if ((rc = relScan.GetNextRec(relRec)) == OK) {
-        char *relData;
-        relRec.GetData(relData);
-        RelcatRecord *relcatRec = (RelcatRecord*)relData;
-        relcatRec->indexCount++;
-        
-        if ((rc = relcatFH.UpdateRec(relRec))) {
-            relScan.CloseScan();
-            delete[] attributes;
-            return rc;
-        }
+    // 登记到indexcat，更新关系的索引计数
+    if ((rc = InsertIntoIndexcat(index))) {
+        ixManager->DestroyIndex(relName, index.indexNo);
+        return rc;
+    }
+    if ((rc = AdjustIndexCount(relName, 1))) {
+        return rc;
     }
-    
-    relScan.CloseScan();
     
     // 强制写入
     relcatFH.ForcePages();
-    attrcatFH.ForcePages();
+    indexcatFH.ForcePages();
     
-    delete[] attributes;
     return OK;
 }
 
 //
 // 删除索引
+// attrName是组合索引的名字时删除该组合索引，否则删除属性上的单属性索引
 //
 RC SM_Manager::DropIndex(const char *relName, const char *attrName) {
     RC rc;
@@ -429,6 +539,25 @@ RC SM_Manager::DropIndex(const char *relName, const char *attrName) {
         return SM_SYSTEMCATALOG;
     }
     
+    // 组合索引
+    vector<SM_IndexDesc> indexes;
+    if ((rc = GetIndexes(relName, indexes))) {
+        return rc;
+    }
+    for (const SM_IndexDesc &index : indexes) {
+        if (!index.IsCatalogued() || strcmp(index.indexName, attrName) != 0) {
+            continue;
+        }
+        if ((rc = ixManager->DestroyIndex(relName, index.indexNo)) ||
+            (rc = DeleteFromIndexcat(relName, attrName)) ||
+            (rc = AdjustIndexCount(relName, -1))) {
+            return rc;
+        }
+        relcatFH.ForcePages();
+        indexcatFH.ForcePages();
+        return OK;
+    }
+    
     // 获取属性信息
     DataAttrInfo attr;
     if ((rc = GetAttrInfo(relName, attrName, attr))) {
@@ -445,42 +574,162 @@ RC SM_Manager::DropIndex(const char *relName, const char *attrName) {
         return rc;
     }
     
-    // 更新目录中的索引信息
-    if ((rc = UpdateAttrIndexNo(relName, attrName, -1))) {
+    // 更新目录中的索引信息和关系的索引计数
+    if ((rc = UpdateAttrIndexNo(relName, attrName, -1)) ||
+        (rc = AdjustIndexCount(relName, -1))) {
         return rc;
     }
     
-    // 更新关系的索引计数
-    RM_FileScan relScan;
-    RM_Record relRec;
-    if ((rc = relScan.OpenScan(relcatFH, STRING, MAXNAME+1, RELCAT_RELNAME_OFFSET,
-                              EQ_OP, (void*)relName))) {
+    // 强制写入
+    relcatFH.ForcePages();
+    attrcatFH.ForcePages();
+    
+    return OK;
+}
+
+//
+// NextIndexNo: 关系上未使用的索引号（比单属性索引和组合索引已用的都大）
+//
+RC SM_Manager::NextIndexNo(const char *relName, int &indexNo) {
+    RC rc;
+    vector<SM_IndexDesc> indexes;
+    
+    if ((rc = GetIndexes(relName, indexes))) {
         return rc;
     }
     
-    if ((rc = relScan.GetNextRec(relRec)) == OK) {
-        char *relData;
-        relRec.GetData(relData);
-        RelcatRecord *relcatRec = (RelcatRecord*)relData;
-        if (relcatRec->indexCount > 0) {
-            relcatRec->indexCount--;
+    indexNo = 0;
+    for (const SM_IndexDesc &index : indexes) {
+        if (index.indexNo >= indexNo) {
+            indexNo = index.indexNo + 1;
+        }
+    }
+    return OK;
+}
+
+//
+// BuildIndex: 创建索引文件，扫描关系收集现有记录的(键值, RID)，
+// 排序后自底向上批量建立索引。部分索引只收集满足条件的记录。失败时删除索引文件
+//
+RC SM_Manager::BuildIndex(const char *relName, const SM_IndexDesc &index) {
+    RC rc;
+    
+    IX_KeyDesc keyDesc;
+    index.GetKeyDesc(keyDesc);
+    if ((rc = ixManager->CreateIndex(relName, index.indexNo, keyDesc,
+                                     (IX_IndexType)index.indexType, index.bloomFilter != 0))) {
+        return rc;
+    }
+    
+    // 打开索引和关系文件
+    IX_IndexHandle indexHandle;
+    RM_FileHandle fileHandle;
+    
+    if ((rc = ixManager->OpenIndex(relName, index.indexNo, indexHandle))) {
+        ixManager->DestroyIndex(relName, index.indexNo);
+        return rc;
+    }
+    
+    if ((rc = rmManager->OpenFile(relName, fileHandle))) {
+        ixManager->CloseIndex(indexHandle);
+        ixManager->DestroyIndex(relName, index.indexNo);
+        return rc;
+    }
+    
+    RM_FileScan fileScan;
+    IX_BulkLoader bulkLoader;
+    if ((rc = bulkLoader.Open(indexHandle)) ||
+        (rc = fileScan.OpenScan(fileHandle, INT, sizeof(int), 0, NO_OP, NULL))) {
+        rmManager->CloseFile(fileHandle);
+        ixManager->CloseIndex(indexHandle);
+        ixManager->DestroyIndex(relName, index.indexNo);
+        return rc;
+    }
+    
+    vector<char> key(index.KeyLength());
+    vector<char> payload(index.IncludeLength() + 1);
+    RM_Record record;
+    while ((rc = fileScan.GetNextRec(record)) != RM_EOF) {
+        if (rc) {
+            break;
         }
         
-        if ((rc = relcatFH.UpdateRec(relRec))) {
-            relScan.CloseScan();
-            return rc;
+        char *data;
+        RID rid;
+        record.GetData(data);
+        record.GetRid(rid);
+        
+        // 加入索引条目（部分索引跳过不满足条件的记录）
+        if (!index.Matches(data)) {
+            continue;
+        }
+        index.BuildKey(data, key.data());
+        index.BuildPayload(data, payload.data());
+        if ((rc = bulkLoader.AddEntry(key.data(), rid, payload.data()))) {
+            break;
         }
     }
     
-    relScan.CloseScan();
+    fileScan.CloseScan();
+    if (rc == RM_EOF) {
+        rc = bulkLoader.Finish();
+    } else {
+        bulkLoader.Abort();
+    }
+    rmManager->CloseFile(fileHandle);
+    ixManager->CloseIndex(indexHandle);
     
-    // 强制写入
-    relcatFH.ForcePages();
-    attrcatFH.ForcePages();
+    if (rc != OK) {
+        ixManager->DestroyIndex(relName, index.indexNo);
+        return rc;
+    }
     
     return OK;
 }
 
+
+//
+// 为属性建立区域映射（每组数据页上的最小/最大值），扫描时用来跳过页面
+// 区域映射保存在关系文件的头页中，不需要修改系统目录
+//
+RC SM_Manager::CreateZoneMap(const char *relName, const char *attrName) {
+    RC rc;
+    
+    if (!bDbOpen) {
+        return SM_DBNOTOPEN;
+    }
+    
+    if (relName == NULL || !IsValidName(relName)) {
+        return SM_BADRELNAME;
+    }
+    
+    if (attrName == NULL || !IsValidName(attrName)) {
+        return SM_BADATTRNAME;
+    }
+    
+    if (IsSystemCatalog(relName)) {
+        return SM_SYSTEMCATALOG;
+    }
+    
+    // 获取属性信息
+    DataAttrInfo attr;
+    if ((rc = GetAttrInfo(relName, attrName, attr))) {
+        return rc;
+    }
+    
+    RM_FileHandle fileHandle;
+    if ((rc = rmManager->OpenFile(relName, fileHandle))) {
+        return rc;
+    }
+    
+    if ((rc = fileHandle.CreateZoneMap(attr.attrType, attr.attrLength, attr.offset))) {
+        rmManager->CloseFile(fileHandle);
+        return rc;
+    }
+    
+    return rmManager->CloseFile(fileHandle);
+}
+
 //
 // 辅助方法实现
 //
@@ -525,4 +774,31 @@ RC SM_Manager::InsertIntoAttrcat(const char *relName, const char *attrName,
     
     RID rid;
     return attrcatFH.InsertRec((char*)&record, rid);
-}
\ No newline at end of file
+}
+
+RC SM_Manager::InsertIntoIndexcat(const SM_IndexDesc &index) {
+    IndexcatRecord record;
+    memset(&record, 0, sizeof(record));
+    strcpy(record.relName, index.keyAttrs[0].relName);
+    strcpy(record.indexName, index.indexName);
+    record.indexNo = index.indexNo;
+    record.keyCount = index.keyCount;
+    for (int i = 0; i < index.keyCount; i++) {
+        strcpy(record.keyAttrs[i], index.keyAttrs[i].attrName);
+    }
+    record.includeCount = index.includeCount;
+    for (int i = 0; i < index.includeCount; i++) {
+        strcpy(record.includeAttrs[i], index.includeAttrs[i].attrName);
+    }
+    record.indexType = index.indexType;
+    record.predCount = index.predCount;
+    for (int i = 0; i < index.predCount; i++) {
+        strcpy(record.predAttrs[i], index.preds[i].attr.attrName);
+        record.predOps[i] = index.preds[i].op;
+        memcpy(record.predValues[i], index.preds[i].value, index.preds[i].attr.attrLength);
+    }
+    record.bloomFilter = index.bloomFilter;
+    
+    RID rid;
+    return indexcatFH.InsertRec((char*)&record, rid);
+}
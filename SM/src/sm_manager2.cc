@@ -3,6 +3,7 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <iomanip>
 #include <cstring>
 #include <cstdlib>
 
@@ -47,26 +48,37 @@ RC SM_Manager::Load(const char *relName, const char *fileName) {
     }
     
     // 打开所有索引
-    IX_IndexHandle *indexHandles = new IX_IndexHandle[attrCount];
-    bool *indexOpen = new bool[attrCount];
-    for (int i = 0; i < attrCount; i++) {
+    vector<SM_IndexDesc> indexes;
+    if ((rc = GetIndexes(relName, indexes))) {
+        rmManager->CloseFile(fileHandle);
+        delete[] attributes;
+        return rc;
+    }
+    int nIndexes = (int)indexes.size();
+    IX_IndexHandle *indexHandles = new IX_IndexHandle[nIndexes];
+    bool *indexOpen = new bool[nIndexes];
+    int maxKeyLength = 0;
+    for (int i = 0; i < nIndexes; i++) {
         indexOpen[i] = false;
-        if (attributes[i].indexNo != -1) {
-            if ((rc = ixManager->OpenIndex(relName, attributes[i].indexNo, indexHandles[i])) == OK) {
-                indexOpen[i] = true;
-            }
+        if ((rc = ixManager->OpenIndex(relName, indexes[i].indexNo, indexHandles[i])) == OK) {
+            indexOpen[i] = true;
+        }
+        if (indexes[i].KeyLength() + indexes[i].IncludeLength() > maxKeyLength) {
+            maxKeyLength = indexes[i].KeyLength() + indexes[i].IncludeLength();
         }
     }
+    char *keyBuffer = new char[maxKeyLength > 0 ? maxKeyLength : 1];
     
     // 打开数据文件
     ifstream dataFile(fileName);
     if (!dataFile.is_open()) {
         rmManager->CloseFile(fileHandle);
-        for (int i = 0; i < attrCount; i++) {
+        for (int i = 0; i < nIndexes; i++) {
             if (indexOpen[i]) {
                 ixManager->CloseIndex(indexHandles[i]);
             }
         }
+        delete[] keyBuffer;
         delete[] indexHandles;
         delete[] indexOpen;
         delete[] attributes;
@@ -124,12 +136,14 @@ RC SM_Manager::Load(const char *relName, const char *fileName) {
             break;
         }
         
-        // 更新索引
-        for (int i = 0; i < attrCount; i++) {
-            if (indexOpen[i]) {
-                void *keyValue = (void*)(tupleData + attributes[i].offset);
-                if ((rc = indexHandles[i].InsertEntry(keyValue, rid))) {
-                    cout << "Error updating index for attribute " << i << " at line " << lineNum << endl;
+        // 更新索引（部分索引只加入满足条件的记录）
+        for (int i = 0; i < nIndexes; i++) {
+            if (indexOpen[i] && indexes[i].Matches(tupleData)) {
+                char *payload = keyBuffer + indexes[i].KeyLength();
+                indexes[i].BuildKey(tupleData, keyBuffer);
+                indexes[i].BuildPayload(tupleData, payload);
+                if ((rc = indexHandles[i].InsertEntry(keyBuffer, rid, payload))) {
+                    cout << "Error updating index " << indexes[i].indexName << " at line " << lineNum << endl;
                 }
             }
         }
@@ -141,12 +155,13 @@ RC SM_Manager::Load(const char *relName, const char *fileName) {
     dataFile.close();
     rmManager->CloseFile(fileHandle);
     
-    for (int i = 0; i < attrCount; i++) {
+    for (int i = 0; i < nIndexes; i++) {
         if (indexOpen[i]) {
             ixManager->CloseIndex(indexHandles[i]);
         }
     }
     
+    delete[] keyBuffer;
     delete[] indexHandles;
     delete[] indexOpen;
     delete[] attributes;
@@ -154,6 +169,273 @@ RC SM_Manager::Load(const char *relName, const char *fileName) {
     return OK;
 }
 
+//
+// SM_IndexMover: VACUUM移动记录时更新关系上的所有索引
+//
+class SM_IndexMover : public RM_MoveListener {
+public:
+    SM_IndexMover(const std::vector<SM_IndexDesc> &indexes, IX_IndexHandle *indexHandles,
+                  char *keyBuffer)
+        : indexes(indexes), indexHandles(indexHandles), keyBuffer(keyBuffer) {}
+    
+    RC RecordMoved(const char *pData, const RID &oldRid, const RID &newRid) {
+        RC rc;
+        for (size_t i = 0; i < indexes.size(); i++) {
+            if (!indexes[i].Matches(pData)) {
+                continue;
+            }
+            char *payload = keyBuffer + indexes[i].KeyLength();
+            indexes[i].BuildKey(pData, keyBuffer);
+            indexes[i].BuildPayload(pData, payload);
+            if ((rc = indexHandles[i].DeleteEntry(keyBuffer, oldRid)) ||
+                (rc = indexHandles[i].InsertEntry(keyBuffer, newRid, payload))) {
+                return rc;
+            }
+        }
+        return OK;
+    }
+    
+private:
+    const std::vector<SM_IndexDesc> &indexes;
+    IX_IndexHandle *indexHandles;
+    char *keyBuffer;
+};
+
+//
+// 压缩关系文件
+// 作用：把记录移到文件前部有空闲空间的页面，截断末尾的空页，并更新索引中的RID
+// 比如：大量删除后执行 Vacuum("students", nMoved, nFreedPages)，扫描只需读取剩余的页面
+//
+RC SM_Manager::Vacuum(const char *relName, int &nMoved, int &nFreedPages) {
+    RC rc;
+    nMoved = 0;
+    nFreedPages = 0;
+    
+    if (!bDbOpen) {
+        return SM_DBNOTOPEN;
+    }
+    
+    if (relName == NULL || !IsValidName(relName)) {
+        return SM_BADRELNAME;
+    }
+    
+    if (IsSystemCatalog(relName)) {
+        return SM_SYSTEMCATALOG;
+    }
+    
+    // 获取关系上的索引
+    vector<SM_IndexDesc> indexes;
+    if ((rc = GetIndexes(relName, indexes))) {
+        return rc;
+    }
+    
+    // 打开所有索引，任何一个打不开都不能移动记录
+    int nIndexes = (int)indexes.size();
+    IX_IndexHandle *indexHandles = new IX_IndexHandle[nIndexes];
+    int maxKeyLength = 0;
+    int nOpened = 0;
+    for (; nOpened < nIndexes; nOpened++) {
+        if ((rc = ixManager->OpenIndex(relName, indexes[nOpened].indexNo,
+                                       indexHandles[nOpened]))) {
+            break;
+        }
+        if (indexes[nOpened].KeyLength() + indexes[nOpened].IncludeLength() > maxKeyLength) {
+            maxKeyLength = indexes[nOpened].KeyLength() + indexes[nOpened].IncludeLength();
+        }
+    }
+    char *keyBuffer = new char[maxKeyLength > 0 ? maxKeyLength : 1];
+    
+    // 打开关系文件并压缩
+    RM_FileHandle fileHandle;
+    if (rc == OK && (rc = rmManager->OpenFile(relName, fileHandle)) == OK) {
+        SM_IndexMover mover(indexes, indexHandles, keyBuffer);
+        rc = fileHandle.Vacuum(&mover, nMoved, nFreedPages);
+        
+        RC closeRC = rmManager->CloseFile(fileHandle);
+        if (rc == OK) {
+            rc = closeRC;
+        }
+    }
+    
+    // 关闭索引
+    for (int i = 0; i < nOpened; i++) {
+        ixManager->CloseIndex(indexHandles[i]);
+    }
+    
+    delete[] keyBuffer;
+    delete[] indexHandles;
+    
+    return rc;
+}
+
+//
+// 重建索引
+// 作用：扫描关系，用批量加载按顺序重新建立索引，代替经过大量插入删除后变得稀疏的索引文件
+// indexName为组合索引名或单属性索引的属性名，为NULL时重建关系上的所有索引。
+// 新索引建好后才切换目录中的索引号并删除旧的索引文件，失败时旧索引保持不变
+//
+RC SM_Manager::Reindex(const char *relName, const char *indexName, int &nRebuilt) {
+    RC rc;
+    nRebuilt = 0;
+    
+    if (!bDbOpen) {
+        return SM_DBNOTOPEN;
+    }
+    
+    if (relName == NULL || !IsValidName(relName)) {
+        return SM_BADRELNAME;
+    }
+    
+    if (IsSystemCatalog(relName)) {
+        return SM_SYSTEMCATALOG;
+    }
+    
+    vector<SM_IndexDesc> indexes;
+    if ((rc = GetIndexes(relName, indexes))) {
+        return rc;
+    }
+    
+    for (const SM_IndexDesc &oldIndex : indexes) {
+        if (indexName != NULL && strcmp(oldIndex.indexName, indexName) != 0) {
+            continue;
+        }
+        
+        // 用新的索引号建立新索引
+        SM_IndexDesc index = oldIndex;
+        if ((rc = NextIndexNo(relName, index.indexNo)) ||
+            (rc = BuildIndex(relName, index))) {
+            return rc;
+        }
+        
+        // 目录中的索引号改为新索引
+        if (index.IsCatalogued()) {
+            if ((rc = DeleteFromIndexcat(relName, index.indexName)) == OK) {
+                rc = InsertIntoIndexcat(index);
+            }
+        } else {
+            rc = UpdateAttrIndexNo(relName, index.indexName, index.indexNo);
+        }
+        if (rc) {
+            ixManager->DestroyIndex(relName, index.indexNo);
+            return rc;
+        }
+        
+        // 删除旧的索引文件
+        if ((rc = ixManager->DestroyIndex(relName, oldIndex.indexNo))) {
+            return rc;
+        }
+        nRebuilt++;
+    }
+    
+    if (indexName != NULL && nRebuilt == 0) {
+        return SM_INDEXNOTFOUND;
+    }
+    
+    // 强制写入
+    attrcatFH.ForcePages();
+    indexcatFH.ForcePages();
+    
+    return OK;
+}
+
+//
+// 获取索引的运行统计（打开索引读出文件头中的统计后关闭）
+//
+RC SM_Manager::GetIndexStats(const char *relName, const SM_IndexDesc &index, IX_IndexStats &stats) {
+    RC rc;
+    IX_IndexHandle indexHandle;
+    
+    if ((rc = ixManager->OpenIndex(relName, index.indexNo, indexHandle))) {
+        return rc;
+    }
+    rc = indexHandle.GetStats(stats);
+    RC rc2 = ixManager->CloseIndex(indexHandle);
+    return rc ? rc : rc2;
+}
+
+//
+// 显示索引的运行统计：每个索引一行
+// 高度、叶子页数（哈希索引为bucket页数）、条目数、叶子平均填充率、分裂和合并次数、
+// 查找次数和平均每次查找读的页数、扫描返回和过滤掉的条目数、Bloom过滤器省掉的查找次数
+//
+RC SM_Manager::ShowIndexStats(const char *relName) {
+    RC rc;
+    
+    if (!bDbOpen) {
+        return SM_DBNOTOPEN;
+    }
+    
+    // 要显示的关系，未指定时为relcat中的所有用户关系
+    vector<string> relNames;
+    if (relName != NULL) {
+        if (!IsValidName(relName)) {
+            return SM_BADRELNAME;
+        }
+        relNames.push_back(relName);
+    } else {
+        RM_FileScan relScan;
+        if ((rc = relScan.OpenScan(relcatFH, INT, sizeof(int), 0, NO_OP, NULL))) {
+            return rc;
+        }
+        RM_Record record;
+        while ((rc = relScan.GetNextRec(record)) == OK) {
+            char *data;
+            record.GetData(data);
+            RelcatRecord *relcatRec = (RelcatRecord*)data;
+            if (!IsSystemCatalog(relcatRec->relName)) {
+                relNames.push_back(relcatRec->relName);
+            }
+        }
+        relScan.CloseScan();
+        if (rc != RM_EOF) {
+            return rc;
+        }
+    }
+    
+    // 先取出全部统计，出错时不输出
+    vector<pair<string, SM_IndexDesc>> rows;
+    vector<IX_IndexStats> rowStats;
+    for (const string &name : relNames) {
+        vector<SM_IndexDesc> indexes;
+        if ((rc = GetIndexes(name.c_str(), indexes))) {
+            return rc;
+        }
+        for (const SM_IndexDesc &index : indexes) {
+            IX_IndexStats stats;
+            if ((rc = GetIndexStats(name.c_str(), index, stats))) {
+                return rc;
+            }
+            rows.push_back(make_pair(name, index));
+            rowStats.push_back(stats);
+        }
+    }
+    
+    cout << left << setw(MAXNAME) << "relation" << " "
+         << setw(MAXNAME) << "index" << right
+         << setw(7) << "height" << setw(8) << "leaves" << setw(10) << "entries"
+         << setw(7) << "fill%" << setw(8) << "splits" << setw(8) << "merges"
+         << setw(10) << "probes" << setw(12) << "pages/probe"
+         << setw(10) << "returned" << setw(10) << "filtered" << setw(10) << "skips" << endl;
+    for (size_t i = 0; i < rows.size(); i++) {
+        const IX_IndexStats &stats = rowStats[i];
+        double pagesPerProbe = (stats.nProbes > 0) ? (double)stats.nProbePages / stats.nProbes : 0;
+        cout << left << setw(MAXNAME) << rows[i].first << " "
+             << setw(MAXNAME) << rows[i].second.indexName << right
+             << setw(7) << stats.height << setw(8) << stats.nLeafPages
+             << setw(10) << stats.nEntries
+             << setw(7) << fixed << setprecision(1) << stats.leafFill * 100
+             << setw(8) << stats.nSplits << setw(8) << stats.nMerges
+             << setw(10) << stats.nProbes
+             << setw(12) << setprecision(2) << pagesPerProbe
+             << setw(10) << stats.nScanReturned << setw(10) << stats.nScanFiltered
+             << setw(10) << stats.nFilterSkips << endl;
+        cout.unsetf(ios::fixed);
+    }
+    
+    cout << rows.size() << " index(es)" << endl;
+    return OK;
+}
+
 //
 // 帮助信息（显示所有关系）
 //
@@ -536,4 +818,310 @@ RC SM_Manager::UpdateAttrIndexNo(const char *relName, const char *attrName, int
     
     attrScan.CloseScan();
     return (rc == RM_EOF) ? OK : rc;
-}
\ No newline at end of file
+}
+//
+// 从indexcat删除组合索引，indexName为NULL时删除关系的所有组合索引
+//
+RC SM_Manager::DeleteFromIndexcat(const char *relName, const char *indexName) {
+    RC rc;
+    
+    RM_FileScan indexScan;
+    if ((rc = indexScan.OpenScan(indexcatFH, STRING, MAXNAME+1, INDEXCAT_RELNAME_OFFSET,
+                                EQ_OP, (void*)relName))) {
+        return rc;
+    }
+    
+    RM_Record record;
+    while ((rc = indexScan.GetNextRec(record)) != RM_EOF) {
+        if (rc) {
+            break;
+        }
+        
+        char *data;
+        record.GetData(data);
+        IndexcatRecord *indexcatRec = (IndexcatRecord*)data;
+        
+        if (indexName == NULL || strcmp(indexcatRec->indexName, indexName) == 0) {
+            RID rid;
+            record.GetRid(rid);
+            if ((rc = indexcatFH.DeleteRec(rid))) {
+                break;
+            }
+        }
+    }
+    
+    indexScan.CloseScan();
+    return (rc == RM_EOF) ? OK : rc;
+}
+
+//
+// 修改relcat中关系的索引计数
+//
+RC SM_Manager::AdjustIndexCount(const char *relName, int delta) {
+    RC rc;
+    
+    RM_FileScan relScan;
+    if ((rc = relScan.OpenScan(relcatFH, STRING, MAXNAME+1, RELCAT_RELNAME_OFFSET,
+                              EQ_OP, (void*)relName))) {
+        return rc;
+    }
+    
+    RM_Record record;
+    if ((rc = relScan.GetNextRec(record)) == OK) {
+        char *data;
+        record.GetData(data);
+        RelcatRecord *relcatRec = (RelcatRecord*)data;
+        relcatRec->indexCount += delta;
+        if (relcatRec->indexCount < 0) {
+            relcatRec->indexCount = 0;
+        }
+        rc = relcatFH.UpdateRec(record);
+    }
+    
+    relScan.CloseScan();
+    return (rc == RM_EOF) ? SM_RELNOTFOUND : rc;
+}
+
+//
+// 获取关系上的所有索引：先是attrcat中的单属性索引，然后是indexcat中的组合索引
+//
+RC SM_Manager::GetIndexes(const char *relName, vector<SM_IndexDesc> &indexes) {
+    RC rc;
+    indexes.clear();
+    
+    DataAttrInfo *attributes;
+    int attrCount;
+    if ((rc = GetRelInfo(relName, attributes, attrCount))) {
+        return rc;
+    }
+    
+    for (int i = 0; i < attrCount; i++) {
+        if (attributes[i].indexNo == -1) {
+            continue;
+        }
+        SM_IndexDesc index;
+        memset(&index, 0, sizeof(index));
+        strcpy(index.indexName, attributes[i].attrName);
+        index.indexNo = attributes[i].indexNo;
+        index.keyCount = 1;
+        index.keyAttrs[0] = attributes[i];
+        indexes.push_back(index);
+    }
+    
+    RM_FileScan indexScan;
+    if ((rc = indexScan.OpenScan(indexcatFH, STRING, MAXNAME+1, INDEXCAT_RELNAME_OFFSET,
+                                EQ_OP, (void*)relName))) {
+        delete[] attributes;
+        return rc;
+    }
+    
+    RM_Record record;
+    while ((rc = indexScan.GetNextRec(record)) != RM_EOF) {
+        if (rc) {
+            break;
+        }
+        
+        char *data;
+        record.GetData(data);
+        IndexcatRecord *indexcatRec = (IndexcatRecord*)data;
+        
+        SM_IndexDesc index;
+        memset(&index, 0, sizeof(index));
+        strcpy(index.indexName, indexcatRec->indexName);
+        index.indexNo = indexcatRec->indexNo;
+        index.keyCount = indexcatRec->keyCount;
+        
+        // 键属性和INCLUDE属性按名字在关系的属性中查找
+        for (int k = 0; k < index.keyCount; k++) {
+            int j = 0;
+            while (j < attrCount && strcmp(attributes[j].attrName, indexcatRec->keyAttrs[k]) != 0) {
+                j++;
+            }
+            if (j == attrCount) {
+                rc = SM_ATTRNOTFOUND;
+                break;
+            }
+            index.keyAttrs[k] = attributes[j];
+        }
+        index.includeCount = indexcatRec->includeCount;
+        index.indexType = indexcatRec->indexType;
+        for (int k = 0; rc == OK && k < index.includeCount; k++) {
+            int j = 0;
+            while (j < attrCount && strcmp(attributes[j].attrName, indexcatRec->includeAttrs[k]) != 0) {
+                j++;
+            }
+            if (j == attrCount) {
+                rc = SM_ATTRNOTFOUND;
+                break;
+            }
+            index.includeAttrs[k] = attributes[j];
+        }
+        index.predCount = indexcatRec->predCount;
+        for (int k = 0; rc == OK && k < index.predCount; k++) {
+            int j = 0;
+            while (j < attrCount && strcmp(attributes[j].attrName, indexcatRec->predAttrs[k]) != 0) {
+                j++;
+            }
+            if (j == attrCount) {
+                rc = SM_ATTRNOTFOUND;
+                break;
+            }
+            index.preds[k].attr = attributes[j];
+            index.preds[k].op = (CompOp)indexcatRec->predOps[k];
+            memcpy(index.preds[k].value, indexcatRec->predValues[k], attributes[j].attrLength);
+        }
+        index.bloomFilter = indexcatRec->bloomFilter;
+        if (rc) {
+            break;
+        }
+        indexes.push_back(index);
+    }
+    
+    indexScan.CloseScan();
+    delete[] attributes;
+    
+    return (rc == RM_EOF) ? OK : rc;
+}
+
+//
+// SM_IndexDesc
+//
+
+//
+// KeyLength: 键的总长度
+//
+int SM_IndexDesc::KeyLength() const {
+    int length = 0;
+    for (int i = 0; i < keyCount; i++) {
+        length += keyAttrs[i].attrLength;
+    }
+    return length;
+}
+
+//
+// GetKeyDesc: 创建索引时的键组成
+//
+void SM_IndexDesc::GetKeyDesc(IX_KeyDesc &keyDesc) const {
+    keyDesc.nParts = keyCount;
+    for (int i = 0; i < keyCount; i++) {
+        keyDesc.types[i] = keyAttrs[i].attrType;
+        keyDesc.lengths[i] = keyAttrs[i].attrLength;
+    }
+    keyDesc.keyLength = KeyLength();
+    keyDesc.includeLength = IncludeLength();
+}
+
+//
+// BuildKey: 按顺序拼接元组中键属性的值，key至少要有KeyLength()字节
+//
+void SM_IndexDesc::BuildKey(const char *tuple, char *key) const {
+    for (int i = 0; i < keyCount; i++) {
+        memcpy(key, tuple + keyAttrs[i].offset, keyAttrs[i].attrLength);
+        key += keyAttrs[i].attrLength;
+    }
+}
+
+//
+// IncludeLength: 附带数据的总长度
+//
+int SM_IndexDesc::IncludeLength() const {
+    int length = 0;
+    for (int i = 0; i < includeCount; i++) {
+        length += includeAttrs[i].attrLength;
+    }
+    return length;
+}
+
+//
+// BuildPayload: 按顺序拼接元组中INCLUDE属性的值，payload至少要有IncludeLength()字节
+//
+void SM_IndexDesc::BuildPayload(const char *tuple, char *payload) const {
+    for (int i = 0; i < includeCount; i++) {
+        memcpy(payload, tuple + includeAttrs[i].offset, includeAttrs[i].attrLength);
+        payload += includeAttrs[i].attrLength;
+    }
+}
+
+//
+// IsCatalogued: 组合索引、带INCLUDE属性的索引、哈希索引、部分索引和带Bloom过滤器的索引
+// 登记在indexcat中，其余记录在attrcat中
+//
+bool SM_IndexDesc::IsCatalogued() const {
+    return keyCount > 1 || includeCount > 0 || indexType != IX_BTREE || predCount > 0 ||
+           bloomFilter != 0;
+}
+
+//
+// Covers: 属性的值能否直接从索引条目中取得
+//
+bool SM_IndexDesc::Covers(const char *attrName) const {
+    for (int i = 0; i < keyCount; i++) {
+        if (strcmp(keyAttrs[i].attrName, attrName) == 0) {
+            return true;
+        }
+    }
+    for (int i = 0; i < includeCount; i++) {
+        if (strcmp(includeAttrs[i].attrName, attrName) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//
+// Matches: 元组是否满足部分索引的全部条件（不是部分索引时总是满足）
+// 比较方式与RM_FileScan相同：字符串按属性长度比较
+//
+bool SM_IndexDesc::Matches(const char *tuple) const {
+    for (int i = 0; i < predCount; i++) {
+        const SM_IndexPred &pred = preds[i];
+        const char *attrValue = tuple + pred.attr.offset;
+        int cmp = 0;
+        switch (pred.attr.attrType) {
+            case INT: {
+                int v1, v2;
+                memcpy(&v1, attrValue, sizeof(int));
+                memcpy(&v2, pred.value, sizeof(int));
+                cmp = (v1 < v2) ? -1 : (v1 > v2) ? 1 : 0;
+                break;
+            }
+            case FLOAT: {
+                float v1, v2;
+                memcpy(&v1, attrValue, sizeof(float));
+                memcpy(&v2, pred.value, sizeof(float));
+                cmp = (v1 < v2) ? -1 : (v1 > v2) ? 1 : 0;
+                break;
+            }
+            case STRING:
+                cmp = strncmp(attrValue, pred.value, pred.attr.attrLength);
+                break;
+        }
+        
+        bool matches;
+        switch (pred.op) {
+            case EQ_OP: matches = (cmp == 0); break;
+            case NE_OP: matches = (cmp != 0); break;
+            case LT_OP: matches = (cmp < 0); break;
+            case LE_OP: matches = (cmp <= 0); break;
+            case GT_OP: matches = (cmp > 0); break;
+            case GE_OP: matches = (cmp >= 0); break;
+            default: matches = true; break;
+        }
+        if (!matches) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//
+// PredicateUses: 部分索引的条件是否用到属性（更新该属性可能使记录进入或离开索引）
+//
+bool SM_IndexDesc::PredicateUses(const char *attrName) const {
+    for (int i = 0; i < predCount; i++) {
+        if (strcmp(preds[i].attr.attrName, attrName) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -61,6 +61,10 @@ void ExecuteShowTables();
 void ExecuteDescTable(const ParsedSQL &parsed);
 void ExecuteCreateIndex(const ParsedSQL &parsed);
 void ExecuteDropIndex(const ParsedSQL &parsed);
+void ExecuteCreateZoneMap(const ParsedSQL &parsed);
+void ExecuteVacuum(const ParsedSQL &parsed);
+void ExecuteReindex(const ParsedSQL &parsed);
+void ExecuteShowIndexStats(const ParsedSQL &parsed);
 
 int main(int argc, char *argv[]) {
     try {
@@ -159,7 +163,7 @@ void PrintHelp() {
     cout << "  CREATE TABLE <table_name> (       - Create a new table" << endl;
     cout << "    <column_name> <type> [constraints]," << endl;
     cout << "    ...                             " << endl;
-    cout << "  );" << endl;
+    cout << "  ) [LAYOUT ROW|PAX|SLOTTED];" << endl;
     cout << "  DROP TABLE <table_name>           - Drop a table" << endl;
     cout << "  SHOW TABLES                       - List all tables" << endl;
     cout << "  DESC <table_name>                 - Describe table structure" << endl;
@@ -167,12 +171,22 @@ void PrintHelp() {
     cout << "Data Operations:" << endl;
     cout << "  INSERT INTO <table> VALUES (...)  - Insert data" << endl;
     cout << "  SELECT * FROM <table> [WHERE ...] - Query data" << endl;
+    cout << "      [ORDER BY <column> [ASC|DESC][, ...]] [LIMIT <n>] - Sort and limit the result" << endl;
     cout << "  UPDATE <table> SET ... [WHERE ...]- Update data" << endl;
     cout << "  DELETE FROM <table> [WHERE ...]   - Delete data" << endl;
+    cout << "  VACUUM <table>                    - Compact table and free empty pages" << endl;
     cout << endl;
     cout << "Index Operations:" << endl;
-    cout << "  CREATE INDEX <index_name> ON <table>(<column>)" << endl;
-    cout << "  DROP INDEX <index_name>           - Drop an index" << endl;
+    cout << "  CREATE INDEX <index_name> ON <table>(<column>[, <column>...])" << endl;
+    cout << "      [INCLUDE (<column>[, <column>...])] - Store extra columns in the index" << endl;
+    cout << "      [USING HASH]                  - Hash index, used for equality on all key columns" << endl;
+    cout << "      [USING BUFFERED]              - B+ tree that batches inserts, for insert-heavy tables" << endl;
+    cout << "      [WITH BLOOM]                  - Bloom filter that skips lookups of absent keys" << endl;
+    cout << "      [WHERE <column> <op> <value> [AND ...]] - Partial index over matching rows only" << endl;
+    cout << "  DROP INDEX <index_name> ON <table> - Drop an index (single-column: column name)" << endl;
+    cout << "  REINDEX <table> | REINDEX INDEX <index_name> ON <table> - Rebuild indexes compactly" << endl;
+    cout << "  CREATE ZONEMAP ON <table>(<column>) - Track per-page min/max" << endl;
+    cout << "  SHOW INDEX STATS [<table>]        - Index shape, splits/merges, probe and scan counters" << endl;
     cout << endl;
     cout << "System Commands:" << endl;
     cout << "  HELP or ?                         - Show this help" << endl;
@@ -217,9 +231,21 @@ void ProcessCommand(const string &command) {
         case SQL_DROP_INDEX:
             ExecuteDropIndex(parsed);
             break;
+        case SQL_CREATE_ZONEMAP:
+            ExecuteCreateZoneMap(parsed);
+            break;
+        case SQL_VACUUM:
+            ExecuteVacuum(parsed);
+            break;
+        case SQL_REINDEX:
+            ExecuteReindex(parsed);
+            break;
         case SQL_SHOW_TABLES:
             ExecuteShowTables();
             break;
+        case SQL_SHOW_INDEX_STATS:
+            ExecuteShowIndexStats(parsed);
+            break;
         case SQL_DESC_TABLE:
             ExecuteDescTable(parsed);
             break;
@@ -228,6 +254,8 @@ void ProcessCommand(const string &command) {
             break;
         case SQL_QUIT:
             cout << "Goodbye!" << endl;
+            // 关闭数据库，系统目录的文件头（页数等）在关闭时才写回
+            CleanupSystem();
             exit(0);
             break;
         default:
@@ -337,10 +365,20 @@ void ExecuteCreateDatabase(const ParsedSQL &parsed) {
             return;
         }
         
+        if ((rc = pSmManager->SetupIndexcat()) != 0) {
+            chdir(currentDir);
+            // 清理已创建的文件
+            unlink("relcat");
+            unlink("attrcat");
+            rmdir(dbName.c_str());
+            cout << "Failed to create indexcat. Error code: " << rc << endl;
+            return;
+        }
+        
         // 返回原目录
         chdir(currentDir);
         
-        cout << "✓ System catalogs initialized (relcat, attrcat)" << endl;
+        cout << "✓ System catalogs initialized (relcat, attrcat, indexcat)" << endl;
         
         cout << "\n╔════════════════════════════════════════════════════╗" << endl;
         cout << "║  Database '" << dbName << "' created successfully!" << string(20 - dbName.length(), ' ') << "║" << endl;
@@ -424,7 +462,11 @@ void ExecuteUseDatabase(const ParsedSQL &parsed) {
             
         } else {
             cout << "Failed to open database '" << dbName << "'. Error code: " << rc << endl;
-            PF_PrintError(rc);
+            if ((rc <= START_SM_ERR && rc >= END_SM_ERR) || (rc >= START_SM_WARN && rc <= END_SM_WARN)) {
+                SM_PrintError(rc);
+            } else {
+                PF_PrintError(rc);
+            }
             currentDatabase = "";
         }
     } catch (const exception &e) {
@@ -454,10 +496,25 @@ void ExecuteCreateTable(const ParsedSQL &parsed) {
         attrInfos.push_back(attr);
     }
     
+    // 页面布局：默认按行存储
+    RM_PageLayout layout = RM_LAYOUT_ROW;
+    if (parsed.tableLayout == "PAX") {
+        layout = RM_LAYOUT_PAX;
+    } else if (parsed.tableLayout == "SLOTTED") {
+        layout = RM_LAYOUT_SLOTTED;
+    } else if (!parsed.tableLayout.empty() && parsed.tableLayout != "ROW") {
+        cout << "Unknown table layout '" << parsed.tableLayout << "'. Use ROW, PAX or SLOTTED." << endl;
+        for (AttrInfo &attr : attrInfos) {
+            delete[] attr.attrName;
+        }
+        return;
+    }
+    
     try {
         RC rc = pSmManager->CreateTable(parsed.tableName.c_str(), 
                                        attrInfos.size(), 
-                                       attrInfos.data());
+                                       attrInfos.data(),
+                                       layout);
         if (rc == 0) {
             cout << "Table '" << parsed.tableName << "' created successfully." << endl;
         } else {
@@ -592,6 +649,26 @@ void ExecuteSelect(const ParsedSQL &parsed) {
             return;
         }
         
+        // ORDER BY的列（同样支持 table.column 格式）
+        vector<OrderAttr> orderAttrs;
+        for (const OrderByClause &clause : parsed.orderByClauses) {
+            orderAttrs.emplace_back();
+            OrderAttr &orderAttr = orderAttrs.back();
+            string relName, attrName = clause.columnName;
+            size_t dotPos = attrName.find('.');
+            if (dotPos != string::npos) {
+                relName = attrName.substr(0, dotPos);
+                attrName = attrName.substr(dotPos + 1);
+                orderAttr.attr.relName = new char[relName.length() + 1];
+                strcpy(orderAttr.attr.relName, relName.c_str());
+            } else {
+                orderAttr.attr.relName = nullptr;
+            }
+            orderAttr.attr.attrName = new char[attrName.length() + 1];
+            strcpy(orderAttr.attr.attrName, attrName.c_str());
+            orderAttr.bDescending = clause.isDescending;
+        }
+        
         // 3. 执行SELECT查询 - 现在支持多表和完整的查询优化
         RC rc = pQlManager->Select(
             selectAttrs.size(),           // SELECT子句中的属性数量
@@ -599,7 +676,10 @@ void ExecuteSelect(const ParsedSQL &parsed) {
             relNames.size(),               // FROM子句中的表数量（支持多表）
             relNames.data(),               // FROM子句中的表名数组
             parsed.conditions.size(),      // WHERE子句中的条件数量
-            parsed.conditions.data()       // WHERE子句中的条件（包括选择和连接条件）
+            parsed.conditions.data(),      // WHERE子句中的条件（包括选择和连接条件）
+            orderAttrs.size(),             // ORDER BY的属性数量
+            orderAttrs.data(),             // ORDER BY的属性和方向
+            parsed.limit                   // LIMIT，-1表示没有
         );
         
         // 4. 清理动态分配的内存
@@ -613,6 +693,10 @@ void ExecuteSelect(const ParsedSQL &parsed) {
                 attr.attrName = nullptr;
             }
         }
+        for (OrderAttr &orderAttr : orderAttrs) {
+            delete[] orderAttr.attr.relName;
+            delete[] orderAttr.attr.attrName;
+        }
         
         // 5. 处理错误码
         // RM_EOF (102) 是正常的结束信号，不是错误
@@ -755,8 +839,50 @@ void ExecuteCreateIndex(const ParsedSQL &parsed) {
             return;
         }
         
-        RC rc = pSmManager->CreateIndex(parsed.tableName.c_str(),
-                                       parsed.columnNames[0].c_str());
+        // 单列B+树索引记录在attrcat中，多列、带INCLUDE列、USING HASH|BUFFERED、WITH BLOOM
+        // 或带WHERE条件的部分索引登记在indexcat中，键按列出的顺序组成
+        RC rc;
+        IX_IndexType indexType = IX_BTREE;
+        if (parsed.indexMethod == "HASH") {
+            indexType = IX_HASH;
+        } else if (parsed.indexMethod == "BUFFERED") {
+            indexType = IX_BUFFERED;
+        }
+        if (parsed.conditions.size() > SM_MAX_INDEX_PREDS) {
+            cout << "Too many conditions in partial index (at most " << SM_MAX_INDEX_PREDS << ")." << endl;
+            return;
+        }
+        vector<SM_IndexPred> preds(parsed.conditions.size());
+        for (size_t i = 0; i < parsed.conditions.size(); i++) {
+            const Condition &cond = parsed.conditions[i];
+            memset(&preds[i], 0, sizeof(SM_IndexPred));
+            strncpy(preds[i].attr.attrName, cond.lhsAttr.attrName, MAXNAME);
+            preds[i].attr.attrType = cond.rhsValue.type;
+            preds[i].op = cond.op;
+            if (cond.rhsValue.type == STRING) {
+                strncpy(preds[i].value, (const char*)cond.rhsValue.data, MAXSTRINGLEN);
+            } else {
+                memcpy(preds[i].value, cond.rhsValue.data, sizeof(int));
+            }
+        }
+        if (parsed.columnNames.size() == 1 && parsed.includeColumns.empty() &&
+            indexType == IX_BTREE && preds.empty() && !parsed.bloomFilter) {
+            rc = pSmManager->CreateIndex(parsed.tableName.c_str(),
+                                         parsed.columnNames[0].c_str());
+        } else {
+            vector<const char*> attrNames, includeNames;
+            for (const string &column : parsed.columnNames) {
+                attrNames.push_back(column.c_str());
+            }
+            for (const string &column : parsed.includeColumns) {
+                includeNames.push_back(column.c_str());
+            }
+            rc = pSmManager->CreateIndex(parsed.tableName.c_str(), (int)attrNames.size(),
+                                         attrNames.data(), parsed.indexName.c_str(),
+                                         (int)includeNames.size(), includeNames.data(),
+                                         indexType, (int)preds.size(), preds.data(),
+                                         parsed.bloomFilter);
+        }
         if (rc == 0) {
             cout << "Index '" << parsed.indexName << "' created successfully." << endl;
         } else {
@@ -784,4 +910,81 @@ void ExecuteDropIndex(const ParsedSQL &parsed) {
     } catch (const exception &e) {
         cout << "Error dropping index: " << e.what() << endl;
     }
-}
\ No newline at end of file
+}
+
+// 逻辑： 1. 检查是否有选中的数据库。
+//      2. 对每个列调用SM_Manager的CreateZoneMap方法建立区域映射。
+void ExecuteCreateZoneMap(const ParsedSQL &parsed) {
+    if (currentDatabase.empty()) {
+        cout << "No database selected. Use 'USE <database_name>' first." << endl;
+        return;
+    }
+    
+    if (parsed.columnNames.empty()) {
+        cout << "No column specified for zone map." << endl;
+        return;
+    }
+    
+    for (const string &column : parsed.columnNames) {
+        RC rc = pSmManager->CreateZoneMap(parsed.tableName.c_str(), column.c_str());
+        if (rc == 0) {
+            cout << "Zone map on '" << parsed.tableName << "." << column
+                 << "' created successfully." << endl;
+        } else {
+            cout << "Failed to create zone map. Error code: " << rc << endl;
+        }
+    }
+}
+
+// 逻辑： 1. 检查是否有选中的数据库。
+//      2. 调用SM_Manager的Vacuum方法压缩表并更新索引。
+void ExecuteVacuum(const ParsedSQL &parsed) {
+    if (currentDatabase.empty()) {
+        cout << "No database selected. Use 'USE <database_name>' first." << endl;
+        return;
+    }
+    
+    int nMoved = 0;
+    int nFreedPages = 0;
+    RC rc = pSmManager->Vacuum(parsed.tableName.c_str(), nMoved, nFreedPages);
+    if (rc == 0) {
+        cout << "Table '" << parsed.tableName << "' vacuumed: " << nMoved
+             << " record(s) moved, " << nFreedPages << " page(s) freed." << endl;
+    } else {
+        cout << "Failed to vacuum table. Error code: " << rc << endl;
+    }
+}
+
+// 逻辑： 1. 检查是否有选中的数据库。
+//      2. 调用SM_Manager的Reindex方法重建表上的所有索引或指定的索引。
+void ExecuteReindex(const ParsedSQL &parsed) {
+    if (currentDatabase.empty()) {
+        cout << "No database selected. Use 'USE <database_name>' first." << endl;
+        return;
+    }
+    
+    int nRebuilt = 0;
+    const char *indexName = parsed.indexName.empty() ? NULL : parsed.indexName.c_str();
+    RC rc = pSmManager->Reindex(parsed.tableName.c_str(), indexName, nRebuilt);
+    if (rc == 0) {
+        cout << "Table '" << parsed.tableName << "': " << nRebuilt
+             << " index(es) rebuilt." << endl;
+    } else {
+        cout << "Failed to reindex. Error code: " << rc << endl;
+    }
+}
+
+// 逻辑： 1. 检查是否有选中的数据库。
+//      2. 调用SM_Manager的ShowIndexStats方法显示指定表（未指定时为所有表）上索引的运行统计。
+void ExecuteShowIndexStats(const ParsedSQL &parsed) {
+    if (currentDatabase.empty()) {
+        cout << "No database selected. Use 'USE <database_name>' first." << endl;
+        return;
+    }
+    
+    const char *tableName = parsed.tableName.empty() ? NULL : parsed.tableName.c_str();
+    RC rc = pSmManager->ShowIndexStats(tableName);
+    if (rc != 0) {
+        cout << "Failed to show index stats. Error code: " << rc << endl;
+    }
+}